@@ -1,4 +1,6 @@
 #include "D3DApp.h"
+#include <TextModelLoader.h>
+#include "project.h"
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -7,27 +9,6 @@ using namespace Microsoft::WRL;
 using namespace D3DHelper;
 using namespace DirectX;
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -48,7 +29,7 @@ protected:
     void OnMouseDown(WPARAM, int, int);
     void OnMouseUp(WPARAM, int, int);
 
-    void BuildVertices();
+    bool BuildVertices();
     void BuildRenderItems();
 
     void UpdateCamera();
@@ -106,7 +87,8 @@ bool D3DFrame::Initialize()
     if(!D3DApp::Initialize())
         return 0;
     ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
-    BuildVertices();
+    if(!BuildVertices())
+        return 0;
     BuildRenderItems();
 /**** */
     D3D12_INPUT_ELEMENT_DESC pInputElements[] = {
@@ -306,105 +288,39 @@ void D3DFrame::OnResize()
     XMStoreFloat4x4(&matProj, proj);
 }
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
+bool D3DFrame::BuildVertices()
 {
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iIndexCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:\\Users\\Administrator.PC-20191006TRUC\\source\\repos\\DirectX\\Models\\skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-    vertices.resize(31076);
-    indices.resize(60339);
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    // vertex
-    while(*pBlock++ != '{');
-
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == 31076)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
+    TextModelLoader::TextModel skullModel;
+    std::vector<Vertex> vertices;
 
-    while(*pBlock)
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../../../Models/skull.txt"), skullModel))
     {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
-
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iIndexCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iIndexCounter;
-        if(iIndexCounter == 60339)
-            break;
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
     }
-    free(pFileBuffer);
-}
-
-void D3DFrame::BuildVertices()
-{
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> indices;
-    std::vector<Vertex> vertices;
 
-    LoadSkullModel(skullVertices, indices);
-
-    vertices.resize(skullVertices.size());
-    for(UINT i = 0; i < skullVertices.size(); ++i)
-        vertices[i].Position = XMFLOAT3(skullVertices[i].Position);
+    vertices.resize(skullModel.Vertices.size());
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i)
+        vertices[i].Position = skullModel.Vertices[i].vec3Position;
     
-    UINT nIndexByteSize = indices.size() * sizeof(SkullModelIndex);
+    UINT nIndexByteSize = skullModel.GetIndexByteSize();
     UINT nVertexByteSize = vertices.size() * sizeof(Vertex);
 
     Geo.pGPUVertexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &vertices[0], nVertexByteSize, &Geo.pUploaderVertexBuffer);
-    Geo.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &indices[0], nIndexByteSize, &Geo.pUploaderIndexBuffer);
+    Geo.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), skullModel.GetIndexData(), nIndexByteSize, &Geo.pUploaderIndexBuffer);
 
     Geo.nIndexBufferByteSize = nIndexByteSize;
     Geo.nVertexBufferByteSize = nVertexByteSize;
     Geo.nVertexByteStride = sizeof(Vertex);
+    Geo.emIndexFormat = skullModel.emIndexFormat;
 
     Render::SubmeshGeometry def;
-    def.nIndexCount = indices.size() * 3;
+    def.nIndexCount = skullModel.GetIndexCount();
     def.nBaseVertexLocation = 0;
     def.nStartIndexLocation = 0;
 
     Geo.DrawArgs["Skull"] = def;
+    return 1;
 }
 
 void D3DFrame::BuildRenderItems()
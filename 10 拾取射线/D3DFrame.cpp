@@ -1,8 +1,6 @@
 #define D3D12_DYNAMIC_INDEX
 #include "D3DFrame.h"
 
-void LoadCarModel(std::vector<CarModelVertex>&, std::vector<CarModelIndex>&);
-
 D3DFrame::D3DFrame(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 
@@ -20,7 +18,8 @@ bool D3DFrame::Initialize()
 
 	ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 	LoadTextures();
-	BuildGeometries();
+	if(!BuildGeometries())
+		return 0;
 	BuildMaterials();
 	ThrowIfFailed(pCommandList->Close());
 	
@@ -46,37 +45,27 @@ void D3DFrame::LoadTextures()
     Textures["white"] = tex;
 }
 
-void D3DFrame::BuildGeometries()
+bool D3DFrame::BuildGeometries()
 {
-    std::vector<CarModelVertex> carVertices;
-    std::vector<CarModelIndex> indices;
-
+    TextModelLoader::TextModel carModel;
     std::vector<Vertex> vertices;
-    LoadCarModel(carVertices, indices);
-    
-    vertices.resize(carVertices.size());
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../Models/car.txt"), carModel))
+    {
+        MessageBoxW(NULL, L"Cannot load Models/car.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
-    XMVECTOR vMin = XMVectorSet(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX);
-    XMVECTOR vMax = XMVectorSet(-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+    vertices.resize(carModel.Vertices.size());
 
-    for(UINT i = 0; i < carVertices.size(); ++i)
+    for(UINT i = 0; i < carModel.Vertices.size(); ++i)
     {
-        XMVECTOR P = XMLoadFloat3(&XMFLOAT3(carVertices[i].Position));
-
-        vertices[i].Position = XMFLOAT3(carVertices[i].Position);
-        vertices[i].Normal = XMFLOAT3(carVertices[i].Normal);
+        vertices[i].Position = carModel.Vertices[i].vec3Position;
+        vertices[i].Normal = carModel.Vertices[i].vec3Normal;
         vertices[i].TexCoords = {0, 0};
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
     }
     
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
-    
     const UINT vertexBytesSize = (UINT)vertices.size() * sizeof(Vertex);
-    const UINT indexBytesSize = (UINT)indices.size() * sizeof(CarModelIndex);
+    const UINT indexBytesSize = carModel.GetIndexByteSize();
 
     Resource::MeshGeometry model;
     model.Name = "Car";
@@ -85,23 +74,25 @@ void D3DFrame::BuildGeometries()
     ThrowIfFailed(D3DCreateBlob(vertexBytesSize, &model.pCPUVertexBuffer));
     CopyMemory(model.pCPUVertexBuffer->GetBufferPointer(), &vertices[0], vertexBytesSize);
     ThrowIfFailed(D3DCreateBlob(indexBytesSize, &model.pCPUIndexBuffer));
-    CopyMemory(model.pCPUIndexBuffer->GetBufferPointer(), &indices[0], indexBytesSize);
+    CopyMemory(model.pCPUIndexBuffer->GetBufferPointer(), carModel.GetIndexData(), indexBytesSize);
 
-    model.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &indices[0], indexBytesSize, &model.pUploaderIndexBuffer);
+    model.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), carModel.GetIndexData(), indexBytesSize, &model.pUploaderIndexBuffer);
     model.pGPUVertexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &vertices[0], vertexBytesSize, &model.pUploaderVertexBuffer);
 
     model.nIndexBufferByteSize = indexBytesSize;
     model.nVertexBufferByteSize = vertexBytesSize;
     model.nVertexByteStride = sizeof(Vertex);
+    model.emIndexFormat = carModel.emIndexFormat;
 
     Resource::SubmeshGeometry main;
-    main.Bounds = bounds;
+    main.Bounds = carModel.Bounds;
     main.nBaseVertexLocation = 0;
     main.nStartIndexLocation = 0;
-    main.nIndexCount = (UINT)indices.size() * 3;    
+    main.nIndexCount = carModel.GetIndexCount();    
 
     model.DrawArgs["main"] = main;
     Geos["car"] = model;
+    return 1;
 }   
 
 void D3DFrame::BuildMaterials()
@@ -156,6 +147,11 @@ void D3DFrame::BuildRenderItems()
     XMStoreFloat4x4(&item.matWorld, XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(0.0f, 1.0f, 0.0f));
     XMStoreFloat4x4(&item.matTexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
 
+    BoundingBox worldBounds;
+    item.Bounds.Transform(worldBounds, XMLoadFloat4x4(&item.matWorld));
+    item.nBvhIndex = sceneBvh.Insert(worldBounds, 0);
+    MeshBvhs[item.pGeo].Build(*item.pGeo, &main);
+
     AllRenderItems.push_back(item);
     RenderItems[RENDER_TYPE_OPEAQUE].push_back(0);
 
@@ -304,6 +300,8 @@ void D3DFrame::Update(const GameTimer& t)
 #endif
     camera.UpdateViewMatrix();
     InputProcess(t);
+    sceneBvh.Refit();
+    sceneBvh.QueryFrustum(camera, VisibleItems);
     UpdateObjects(t);
     UpdateMaterials(t);
     UpdateScene(t);
@@ -351,12 +349,13 @@ void D3DFrame::UpdateScene(const GameTimer& t)
 {
     Constant::SceneConstant sc;
 	
-    XMMATRIX view = camera.GetView();
-    XMMATRIX proj = camera.GetProj();
-    XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+    const CameraMatrices& matrices = camera.GetMatrices();
+    XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+    XMMATRIX proj = XMLoadFloat4x4(&matrices.matProj);
+    XMMATRIX matInvView = XMLoadFloat4x4(&matrices.matInvView);
+    XMMATRIX matInvProj = XMLoadFloat4x4(&matrices.matInvProj);
+    XMMATRIX matViewProj = XMLoadFloat4x4(&matrices.matViewProj);
+    XMMATRIX matInvViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
     
     XMStoreFloat4x4(&sc.matView, view);
     XMStoreFloat4x4(&sc.matInvView, XMMatrixTranspose(matInvView));
@@ -389,7 +388,6 @@ void D3DFrame::OnResize()
     D3DApp::OnResize();
 
     camera.SetLens( 0.25 * XM_PI, AspectRatio(), 0.1f, 1000.0f);
-    BoundingFrustum::CreateFromMatrix(cameraFrustum, camera.GetProj());
 }
 
 void D3DFrame::InputProcess(const GameTimer& t)
@@ -469,7 +467,7 @@ void D3DFrame::Render(const GameTimer& t)
     pCommandList->SetGraphicsRootShaderResourceView(2, pCurrFrameResource->CBMaterial.Resource()->GetGPUVirtualAddress());
     pCommandList->SetGraphicsRootDescriptorTable(3, pSRVHeap->GetGPUDescriptorHandleForHeapStart());
 
-    DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_OPEAQUE]);
+    DrawItems(pCommandList.Get(), VisibleItems);
 
     pCommandList->SetPipelineState(PipelineStates["highLight"].Get());
     
@@ -516,6 +514,13 @@ void D3DFrame::DrawItems(ID3D12GraphicsCommandList* list, std::vector<UINT>& ite
     }
 }
 
+// ʰȡصĲ
+struct PickResult
+{
+    D3DFrame* pFrame;
+    UINT nTriangle;     // е
+};
+
 void D3DFrame::Pick(int x, int y)
 {
     RenderItem* pickedItem = &AllRenderItems[1];
@@ -530,218 +535,54 @@ void D3DFrame::Pick(int x, int y)
     XMVECTOR rayOrigin = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
     XMVECTOR rayDir = XMVectorSet(vx, vy, 1.0f, 0.0f);
 
-    XMMATRIX V = camera.GetView();
-    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(V), V);
+    // 任ռڳΰΧɽԶѯ
+    XMMATRIX invView = XMLoadFloat4x4(&camera.GetMatrices().matInvView);
+    rayOrigin = XMVector3TransformCoord(rayOrigin, invView);
+    rayDir = XMVector3TransformNormal(rayDir, invView);
 
     pickedItem->bVisible = 0;
 
-    for(auto index: RenderItems[RENDER_TYPE_OPEAQUE])
+    PickResult result = {this, 0};
+    UINT nItem = sceneBvh.Raycast(rayOrigin, rayDir, FLT_MAX, PickItem, &result);
+    if(nItem != BVH_NULL_NODE)
     {
-        auto& item = AllRenderItems[index];
-        
-        if(!item.bVisible)
-            continue;
-        
-        // ʰȡ߱任ľֲռ
-        XMMATRIX W = XMLoadFloat4x4(&item.matWorld);
-        XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
-
-        XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
-
-        rayOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
-        rayDir = XMVector3Normalize(XMVector3TransformNormal(rayDir, toLocal));
+        pickedItem->bVisible = 1;
+        pickedItem->nIndexCount = 3;
+        pickedItem->pGeo = AllRenderItems[nItem].pGeo;
+        pickedItem->nBaseVertexLocation = AllRenderItems[nItem].nBaseVertexLocation;
 
-        float tMin = 0.0f;
+        pickedItem->matWorld = AllRenderItems[nItem].matWorld;
+        pickedItem->iFramesDirty = 3;
 
-        // ʰȡײཻ
-        // һĴ
-        if(item.Bounds.Intersects(rayOrigin, rayDir, tMin))
-        {
-            // ȡݵڴ渱
-            Vertex* vertices = (Vertex*)item.pGeo->pCPUVertexBuffer->GetBufferPointer();
-            UINT16* indices = (UINT16*)item.pGeo->pCPUIndexBuffer->GetBufferPointer();
-            UINT triangleCount = item.nIndexCount / 3;
-
-            // ʰȡཻͼԪ
-            tMin = FLT_MAX;
-            for(UINT i = 0; i < triangleCount; ++i)
-            {
-                // ǰεĶ
-                UINT i0 = indices[i * 3 + 0];
-                UINT i1 = indices[i * 3 + 1];
-                UINT i2 = indices[i * 3 + 2];
-
-                // ǰͼԪ
-                XMVECTOR v0 = XMLoadFloat3(&vertices[i0].Position);
-                XMVECTOR v1 = XMLoadFloat3(&vertices[i1].Position);
-                XMVECTOR v2 = XMLoadFloat3(&vertices[i2].Position);
-                
-                float t = 0;
-                // ʰȡеͼԪײ
-                // зص t Ϊ߹ʽ: origin + t * direction е t
-                if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
-                {
-                    if(t < tMin)
-                    {
-                        tMin = t;
-
-                        pickedItem->bVisible = 1;
-                        pickedItem->nIndexCount = 3;
-                        pickedItem->nBaseVertexLocation = 0;
-                        
-                        pickedItem->matWorld = item.matWorld;
-                        pickedItem->iFramesDirty = 3;
-
-                        pickedItem->nStartIndexLocation = 3 * i;
-                    }
-                }
-            }
-        }
+        pickedItem->nStartIndexLocation = 3 * result.nTriangle;
     }
 }
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
+float CALLBACK D3DFrame::PickItem(void* param, UINT nItem, FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance)
 {
-    const UINT nVertexCount = 31076, nTriangleCount = 60339;
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iTriangleCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
+    PickResult* pResult = (PickResult*)param;
+    auto& item = pResult->pFrame->AllRenderItems[nItem];
 
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
+    if(!item.bVisible)
+        return -1.0f;
 
-    vertices.resize(nVertexCount);
-    indices.resize(nTriangleCount);
-//****** Load Data
-    pBlock = pFileBuffer;
+    // ʰȡ߱任ľֲռ
+    XMMATRIX W = XMLoadFloat4x4(&item.matWorld);
+    XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
 
-    // vertex
-    while(*pBlock++ != '{');
+    XMVECTOR rayOrigin = XMVector3TransformCoord(origin, invWorld);
+    XMVECTOR rayDir = XMVector3TransformNormal(dir, invWorld);
 
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
+    // 򲻹һ, ֲռ߹ʽ origin + t * direction е t ռͬ
+    // βΰΧͼԪ, ڵ㼴ײ
+    auto bvh = pResult->pFrame->MeshBvhs.find(item.pGeo);
+    if(bvh == pResult->pFrame->MeshBvhs.end())
+        return -1.0f;
 
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == nVertexCount)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
-
-    while(*pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
+    TriangleHit hit;
+    if(!bvh->second.Intersects(rayOrigin, rayDir, fMaxDistance, hit))
+        return -1.0f;
 
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iTriangleCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iTriangleCounter;
-        if(iTriangleCounter == nTriangleCount)
-            break;
-    }
-    free(pFileBuffer);
+    pResult->nTriangle = hit.nTriangle;
+    return hit.fDistance;
 }
-
-void LoadCarModel(std::vector<CarModelVertex>& vertices, std::vector<CarModelIndex>& indices)
-{
-    const UINT nVertexCount = 1860, nTriangleCount = 1850;
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iTriangleCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/car.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-    vertices.resize(nVertexCount);
-    indices.resize(nTriangleCount);
-    
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    // vertex
-    while(*pBlock++ != '{');
-
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == nVertexCount)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
-
-    while(*pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
-
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iTriangleCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iTriangleCounter;
-        if(iTriangleCounter == nTriangleCount)
-            break;
-    }
-
-    free(pFileBuffer);
-}
\ No newline at end of file
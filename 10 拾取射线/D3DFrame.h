@@ -1,6 +1,10 @@
 #pragma once
 #include <D3DApp.h>
 #include <Camera.h>
+#include <D3DHelper_SceneBvh.h>
+#include <D3DHelper_TriangleBvh.h>
+#include <TextModelLoader.h>
+#include "project.h"
 
 #define USE_FRAMERESOURCE           // ĬϿ֡Դ
 using namespace Microsoft::WRL;
@@ -12,27 +16,6 @@ using namespace DirectX;
 #define RANDF(a, b) a + ((float)(rand()) / (float)RAND_MAX) * (b - a)
 
 
-typedef union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-}CarModelVertex;
-
-typedef union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-}CarModelIndex;
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -66,7 +49,7 @@ protected:
 
     void LoadTextures();
     void BuildMaterials();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildRenderItems();
     void BuildSRV();
     void BuildRootSignatures();
@@ -74,6 +57,7 @@ protected:
 
     void DrawItems(ID3D12GraphicsCommandList*, std::vector<UINT>& );
     void Pick(int x, int y);
+    static float CALLBACK PickItem(void* param, UINT nItem, FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance);
 private:
     std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> PipelineStates;    // Ⱦ
     ComPtr<ID3D12RootSignature> pRootSignature;                                 // ǩ
@@ -91,7 +75,7 @@ private:
 
 	Camera camera;
 
-    DirectX::BoundingFrustum cameraFrustum;
+    SceneBvh sceneBvh;                  // ͸Ⱦռײ
+    std::vector<UINT> VisibleItems;     // ׶ڵĲ͸Ⱦ, ÿ֡ sceneBvh ѯ
+    std::unordered_map<const Resource::MeshGeometry*, TriangleBvh> MeshBvhs;    // βΰΧ, ʰȡ
 };
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
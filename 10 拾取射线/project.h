@@ -0,0 +1,6 @@
+#ifndef _PROJECT_H
+#define _PROJECT_H
+#include <config.h>
+
+#define PROJECT_ROOT(res) PROJECT_ROOT_PATH L##res
+#endif
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 #include <D3DApp.h>
 #include <Camera.h>
+#include <TextModelLoader.h>
 #include "CubeRenderTarget.h"
+#include "project.h"
 
 #define USE_FRAMERESOURCE           // ĬϿ֡Դ
 using namespace Microsoft::WRL;
@@ -13,27 +15,6 @@ using namespace DirectX;
 #define RANDF(a, b) a + ((float)(rand()) / (float)RAND_MAX) * (b - a)
 
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -68,7 +49,7 @@ protected:
 
     void LoadTextures();
     void BuildMaterials();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildRenderItems();
     void BuildSRV();
     void BuildRootSignatures();
@@ -107,5 +88,3 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource> pCubeDepthStencilBuffer;
     
 };
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
@@ -1,7 +1,9 @@
 #pragma once
 #include <D3DApp.h>
 #include <Camera.h>
+#include <TextModelLoader.h>
 #include "ShadowMap.h"
+#include "project.h"
 
 #define USE_FRAMERESOURCE           // ĬϿ֡Դ
 using namespace Microsoft::WRL;
@@ -12,27 +14,6 @@ using namespace DirectX;
 #define RAND(a, b) a + rand() % ((b - a) + 1)
 #define RANDF(a, b) a + ((float)(rand()) / (float)RAND_MAX) * (b - a)
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -77,7 +58,7 @@ protected:
 
     void LoadTextures();
     void BuildMaterials();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildRenderItems();
     void BuildSRV();
     void BuildRootSignatures();
@@ -125,5 +106,3 @@ private:
 
     XMFLOAT4X4 matShadowView, matShadowProj, matShadowTransform;
 };
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
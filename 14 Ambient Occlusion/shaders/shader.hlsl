@@ -7,7 +7,7 @@ struct VsInput
 	float3 vec3Normal: NORMAL;
 	float3 vec3TangentU: TANGENT;
 	float2 vec2TexCoords: TEXCOORD;
-	
+	float fAmbientAccess: AMBIENT;
 };
 
 struct PsInput
@@ -17,6 +17,7 @@ struct PsInput
 	float3 vec3Normal_World: NORMAL;
 	float3 vec3Tangent_World: TANGENT;
 	float2 vec2TexCoords: TEXCOORD;
+	float fAmbientAccess: AMBIENT;
 };
 
 PsInput VsMain(VsInput vin)
@@ -37,6 +38,7 @@ PsInput VsMain(VsInput vin)
 
 	float4 texC = mul(float4(vin.vec2TexCoords, 0.0f, 1.0f), CBObject_matTexTransform);
 	vout.vec2TexCoords = mul(texC, mat.matMaterialTransform).xy;
+	vout.fAmbientAccess = vin.fAmbientAccess;
 	return vout;
 }
 
@@ -65,7 +67,7 @@ float4 PsMain(PsInput pin): SV_TARGET
 
 	float3 eyeDir = normalize(CBScene_vec3EyePos - pin.vec3Position_World);
 		
-	float4 vec4Ambient = CBScene_vec4AmbientLight * diffuseAlbedo;
+	float4 vec4Ambient = pin.fAmbientAccess * CBScene_vec4AmbientLight * diffuseAlbedo;
 	
 	const float shininess = 1.0f - roughness;
 	Material mat;
@@ -1,7 +1,7 @@
 #include "AmbientOcclusion.h"
 using namespace DirectX;
 
-AmbientOcclusion::AmbientOcclusion(HINSTANCE hInst): D3DApp(hInst)
+AmbientOcclusion::AmbientOcclusion(HINSTANCE hInst): D3DApp(hInst), assetCache(PROJECT("/Cache"))
 {}
 
 AmbientOcclusion::~AmbientOcclusion()
@@ -16,7 +16,8 @@ bool AmbientOcclusion::Initialize()
     ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 
     LoadTextures();
-    BuildGeometries();
+    if(!BuildGeometries())
+        return 0;
 
     ThrowIfFailed(pCommandList->Close());
 
@@ -87,33 +88,31 @@ void AmbientOcclusion::LoadTextures()
     _LoadTextures(pD3dDevice.Get(), pCommandList.Get(), TextureList, Textures);
 }
 
-void AmbientOcclusion::BuildGeometries()
+bool AmbientOcclusion::BuildGeometries()
 {
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> skullIndices;
+    TextModelLoader::TextModel skullModel;
     UINT nVertexByteSize, nIndexByteSize;
     Vertex* vertices;
-    UINT* indices;
-
-    LoadSkullModel(skullVertices, skullIndices);
+    void* indices;
 
-    // too big!
-    XMVECTOR vMin = XMVectorSet(FLT_MAX, FLT_MAX, FLT_MAX, 0.0f);
-    XMVECTOR vMax = XMVectorSet(-FLT_MAX, -FLT_MAX, -FLT_MAX, 0.0f);
+    if(!TextModelLoader::LoadTextModel(PROJECT("/../Models/skull.txt"), skullModel, &assetCache) || !skullModel.GetIndexCount())
+    {
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
-    nVertexByteSize = skullVertices.size() * sizeof(Vertex);
-    nIndexByteSize = skullIndices.size() * sizeof(SkullModelIndex);
+    nVertexByteSize = skullModel.Vertices.size() * sizeof(Vertex);
+    nIndexByteSize = skullModel.GetIndexByteSize();
 
     vertices = (Vertex*)malloc(nVertexByteSize);
-    indices = (UINT*)malloc(nIndexByteSize);
-    CopyMemory(indices, &skullIndices[0], nIndexByteSize);
+    indices = malloc(nIndexByteSize);
+    CopyMemory(indices, skullModel.GetIndexData(), nIndexByteSize);
 
-    for(UINT i = 0; i < skullVertices.size(); ++i)
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i)
     {
-        vertices[i].Position = XMFLOAT3(skullVertices[i].Position);
-        vertices[i].Normal = XMFLOAT3(skullVertices[i].Normal);
+        vertices[i].Position = skullModel.Vertices[i].vec3Position;
+        vertices[i].Normal = skullModel.Vertices[i].vec3Normal;
      
-        XMVECTOR P = XMLoadFloat3(&vertices[i].Position);
         XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
         XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
         XMVECTOR T;
@@ -129,34 +128,40 @@ void AmbientOcclusion::BuildGeometries()
             T = XMVector3Normalize(XMVector3Cross(N, up));
         }
         vertices[i].TexCoords = {0.0f, 0.0f};
+        vertices[i].AmbientAccess = 1.0f;
         XMStoreFloat3(&vertices[i].TangentU, T);
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
     }
 
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
+    // per-vertex ambient access, cached after the first launch
+    Geometry::AmbientOcclusionDesc aoDesc;
+    aoDesc.nRayCount = 64;
+    aoDesc.pCache = &assetCache;
+
+    std::vector<float> ambientAccess;
+    Geometry::AmbientOcclusionBaker::BakeMesh(vertices, (UINT)skullModel.Vertices.size(), sizeof(Vertex), offsetof(Vertex, Normal),
+                                              indices, skullModel.emIndexFormat, skullModel.GetIndexCount(), aoDesc, ambientAccess);
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i)
+        vertices[i].AmbientAccess = ambientAccess[i];
 
     GeoListItem skull;
     skull.bAutoRelease = 1;
     skull.pVertices = vertices;
     skull.pIndices = indices;
     skull.nVertexByteStride = sizeof(Vertex);
-    skull.emIndexFormat = DXGI_FORMAT_R16_UINT;
+    skull.emIndexFormat = skullModel.emIndexFormat;
     skull.nVertexByteSize = nVertexByteSize;
     skull.nIndexByteSize = nIndexByteSize;
     
     Resource::SubmeshGeometry submesh;
-    submesh.Bounds = bounds;
+    submesh.Bounds = skullModel.Bounds;
     submesh.nBaseVertexLocation = 0;
     submesh.nStartIndexLocation = 0;
-    submesh.nIndexCount = skullIndices.size() * 3;
+    submesh.nIndexCount = skullModel.GetIndexCount();
     skull.Submeshes["Main"] = submesh;
 
     GeoList["skull"] = skull;
     _BuildGeometries(pD3dDevice.Get(), pCommandList.Get(), Geos, GeoList);
+    return 1;
 }
 
 void AmbientOcclusion::BuildMaterialsAndSrv()
@@ -249,7 +254,8 @@ void AmbientOcclusion::BuildPipelineStates()
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
         {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 0},
 		{"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 0},
-		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"AMBIENT", 0, DXGI_FORMAT_R32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
     };
 
 
@@ -310,12 +316,13 @@ void AmbientOcclusion::UpdateScene(const GameTimer& t)
     );
     
     Constant::SceneConstant sc;
-    XMMATRIX view = camera.GetView();
-    XMMATRIX proj = camera.GetProj();
-    XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+    const CameraMatrices& matrices = camera.GetMatrices();
+    XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+    XMMATRIX proj = XMLoadFloat4x4(&matrices.matProj);
+    XMMATRIX matInvView = XMLoadFloat4x4(&matrices.matInvView);
+    XMMATRIX matInvProj = XMLoadFloat4x4(&matrices.matInvProj);
+    XMMATRIX matViewProj = XMLoadFloat4x4(&matrices.matViewProj);
+    XMMATRIX matInvViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
     XMMATRIX matViewProjTex = XMMatrixMultiply(matViewProj, T);
 
     XMStoreFloat4x4(&sc.matView, XMMatrixTranspose(view));
@@ -2,6 +2,7 @@
 #include <D3DApp.h>
 #include <D3DHelper.h>
 #include <Camera.h>
+#include <D3DHelper_AmbientOcclusion.h>
 #include "Helper.h"
 #include "project.h"
 
@@ -15,6 +16,7 @@ struct Vertex
     XMFLOAT3 Normal;
     XMFLOAT3 TangentU;
     XMFLOAT2 TexCoords;
+    float AmbientAccess;    // baked in BuildGeometries
 };
 
 enum PipelineStateTypes
@@ -49,7 +51,7 @@ private:
     void UpdateMaterials(const GameTimer&);
 
     void LoadTextures();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildMaterialsAndSrv();
     void BuildRenderItems();
 
@@ -83,4 +85,6 @@ private:
     Camera camera;
     POINT lastPos;
 
+    BaseHelper::AssetCache assetCache;  // models and AO, under PROJECT_ROOT_PATH/Cache
+
 };
\ No newline at end of file
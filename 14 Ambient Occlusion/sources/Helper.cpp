@@ -1,6 +1,4 @@
 #include "Helper.h"
-#define SKULL_MODE_PATH "C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt"
-#define IsDigit(c) (c >= '0' && c <= '9')
 
 void GetStaticSampler(CD3DX12_STATIC_SAMPLER_DESC* sampler)
 {
@@ -221,76 +219,3 @@ void _BuildSRV(ID3D12Device* device,
         handle.Offset(1, descriptorSize);
     }
 }
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
-{
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pBlock;
-    UINT nVertexCounter = 0, nTriangleCounter = 0;
-
-//****** Read File
-    if((hFile = CreateFileA(SKULL_MODE_PATH, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    while(!IsDigit(*pBlock))++pBlock;
-    pBegin = pBlock;
-    while(*pBlock != '\r')++pBlock;
-    *pBlock++ = '\0';
-
-    nVertexCounter = atoi(pBegin);
-    while(!IsDigit(*pBlock))++pBlock;
-    pBegin = pBlock;
-    while(*pBlock != '\r')++pBlock;
-    *pBlock++ = '\0';
-    
-    nTriangleCounter = atoi(pBegin);
-    
-    vertices.resize(nVertexCounter);
-    indices.resize(nTriangleCounter);
-
-    while(*pBlock++ != '{');
-
-    for(UINT i = 0; i < nVertexCounter; ++i)
-    {
-        for(UINT j = 0; j < 6; ++j)
-        {
-            while(!IsDigit(*pBlock) && *pBlock != '-')++pBlock;
-            pBegin = pBlock;
-            while(*pBlock != ' ' && *pBlock != '\r')++pBlock;
-            *pBlock++ = '\0';
-
-            vertices[i].v[j] = atof(pBegin);
-        }
-    }
-
-    while(*pBlock++ != '\n');
-    assert(*pBlock == '}');
-
-    while(*pBlock++ != '{');
-    for(UINT i = 0; i < nTriangleCounter; ++i)
-    {
-        for(UINT j = 0; j < 3; ++j)
-        {
-            while(!IsDigit(*pBlock))++pBlock;
-            pBegin = pBlock;
-            while(*pBlock != ' ' && *pBlock != '\r')++pBlock;
-            *pBlock++ = '\0';
-            indices[i].i[j] = atof(pBegin);
-        }
-    }
-
-    free(pFileBuffer);
-}   
@@ -1,29 +1,9 @@
 #pragma once
 #include <D3DHelper.h>
+#include <TextModelLoader.h>
 
 using namespace D3DHelper;
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct TextureListItem
 {
     std::string Name;
@@ -131,5 +111,4 @@ void _BuildSRV(ID3D12Device* device,
               std::vector<SrvListItem>& SrvList, 
               UINT descriptorSize);
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
 void GetStaticSampler(CD3DX12_STATIC_SAMPLER_DESC* sampler);
\ No newline at end of file
@@ -29,7 +29,8 @@ bool D3DFrame::Initialize()
 
 	ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 	LoadTextures();
-	BuildGeometries();
+	if(!BuildGeometries())
+		return 0;
 	BuildMaterials();
 
     stShadowMap.Init(pD3dDevice.Get(), cxClient, cyClient);
@@ -92,7 +93,7 @@ void D3DFrame::LoadTextures()
     }
 }
 
-void D3DFrame::BuildGeometries()
+bool D3DFrame::BuildGeometries()
 {
     Resource::MeshGeometry Geo, SkullGeo;
     Geometry::Mesh box = Geometry::GeometryGenerator::CreateCube(1.0f, 1.0f, 1.0f);
@@ -219,22 +220,20 @@ void D3DFrame::BuildGeometries()
 
     Geos["Geo"] = Geo;
 
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> skullIndices;
-    
-    LoadSkullModel(skullVertices, skullIndices);
-
-    vertices.resize(skullVertices.size());
+    TextModelLoader::TextModel skullModel;
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../Models/skull.txt"), skullModel))
+    {
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
-    XMVECTOR vMin = XMVectorSet(FLT_MAX, FLT_MAX, FLT_MAX, 0.0f);
-    XMVECTOR vMax = XMVectorSet(-FLT_MAX, -FLT_MAX, -FLT_MAX, 0.0f);
+    vertices.resize(skullModel.Vertices.size());
 
-    for(UINT i = 0; i < skullVertices.size(); ++i)
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i)
     {
-        vertices[i].Position = XMFLOAT3(skullVertices[i].Position);
-        vertices[i].Normal = XMFLOAT3(skullVertices[i].Normal);
+        vertices[i].Position = skullModel.Vertices[i].vec3Position;
+        vertices[i].Normal = skullModel.Vertices[i].vec3Normal;
      
-        XMVECTOR P = XMLoadFloat3(&vertices[i].Position);
         XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
         XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
         XMVECTOR T;
@@ -251,35 +250,30 @@ void D3DFrame::BuildGeometries()
         }
         vertices[i].TexCoords = {0.0f, 0.0f};
         XMStoreFloat3(&vertices[i].TangentU, T);
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
     }
 
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
-
     vertexBytesSize = vertices.size() * sizeof(Vertex);
-    indexBytesSize = skullIndices.size() * sizeof(SkullModelIndex);
+    indexBytesSize = skullModel.GetIndexByteSize();
 
     SkullGeo.Name = "SkullGeo";
     SkullGeo.pGPUVertexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &vertices[0], vertexBytesSize, &SkullGeo.pUploaderVertexBuffer);
-    SkullGeo.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &skullIndices[0], indexBytesSize, &SkullGeo.pUploaderIndexBuffer);
+    SkullGeo.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), skullModel.GetIndexData(), indexBytesSize, &SkullGeo.pUploaderIndexBuffer);
 
     SkullGeo.nIndexBufferByteSize = indexBytesSize;
     SkullGeo.nVertexBufferByteSize = vertexBytesSize;
     SkullGeo.nVertexByteStride = sizeof(Vertex);
+    SkullGeo.emIndexFormat = skullModel.emIndexFormat;
 
     Resource::SubmeshGeometry  skullSubmesh;
-    skullSubmesh.nIndexCount = skullIndices.size() * 3;
+    skullSubmesh.nIndexCount = skullModel.GetIndexCount();
     skullSubmesh.nStartIndexLocation = 0;
     skullSubmesh.nBaseVertexLocation = 0;
-    skullSubmesh.Bounds = bounds;
+    skullSubmesh.Bounds = skullModel.Bounds;
 
     SkullGeo.DrawArgs["main"] = skullSubmesh;
 
     Geos["Skull"] = SkullGeo;
+    return 1;
 }   
 
 void D3DFrame::BuildMaterials()
@@ -920,12 +914,13 @@ void D3DFrame::UpdateScene(const GameTimer& t)
     );
     
     Constant::SceneConstant sc;
-    XMMATRIX view = camera.GetView();
-    XMMATRIX proj = camera.GetProj();
-    XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+    const CameraMatrices& matrices = camera.GetMatrices();
+    XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+    XMMATRIX proj = XMLoadFloat4x4(&matrices.matProj);
+    XMMATRIX matInvView = XMLoadFloat4x4(&matrices.matInvView);
+    XMMATRIX matInvProj = XMLoadFloat4x4(&matrices.matInvProj);
+    XMMATRIX matViewProj = XMLoadFloat4x4(&matrices.matViewProj);
+    XMMATRIX matInvViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
     XMMATRIX matViewProjTex = XMMatrixMultiply(matViewProj, T);
 
     XMStoreFloat4x4(&sc.matView, XMMatrixTranspose(view));
@@ -1244,77 +1239,6 @@ void D3DFrame::DrawItems(ID3D12GraphicsCommandList* list, std::vector<UINT>& ite
     }
 }
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
-{
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iIndexCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-    vertices.resize(31076);
-    indices.resize(60339);
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    // vertex
-    while(*pBlock++ != '{');
-
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == 31076)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
-
-    while(*pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
-
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iIndexCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iIndexCounter;
-        if(iIndexCounter == 60339)
-            break;
-    }
-    free(pFileBuffer);
-}
-
 void GetStaticSampler(CD3DX12_STATIC_SAMPLER_DESC* sampler)
 {
     sampler[0].Init(
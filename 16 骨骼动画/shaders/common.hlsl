@@ -1,5 +1,7 @@
 #include "lighting.hlsl"
 
+#define MAX_NUM_CASCADE 4
+
 cbuffer Object: register(b0)
 {
     float4x4 CBObject_matWorld;
@@ -7,9 +9,16 @@ cbuffer Object: register(b0)
 	uint CBObject_nMaterialIndex;
 }
 
+// ɫʽ D3DHelper::SkinnedPaletteFormats Ӧ
 cbuffer Skinned: register(b1)
 {
+#if defined(SKINNED_PALETTE_3X4)
+	float4 CBSkinned_vec4Transform[288];	// ÿ 3 
+#elif defined(SKINNED_PALETTE_DQ)
+	float4 CBSkinned_vec4DualQuat[192];		// ÿ (ʵ, ż)
+#else
 	float4x4 CBSkinned_matTransform[96];
+#endif
 }
 
 cbuffer Scene: register(b2)
@@ -37,6 +46,9 @@ cbuffer Scene: register(b2)
     float2 CBScene_fPerScenePad2;
 
 	Light CBScene_Lights[MAX_NUM_LIGHT];
+
+	float4x4 CBScene_matCascadeTransforms[MAX_NUM_CASCADE];	// ռ䵽Ӱͼе
+	float4 CBScene_vec4CascadeSplits;						// Զ˵Ĺ۲ռ
 }
 
 struct MaterialData
@@ -104,3 +116,13 @@ float CalcShadowFactor(float4 shadowPos)
 
 	return percentLit / 9.0f;
 }
+
+// ۲ռѡ, ӰʱӰ
+float CalcCascadedShadowFactor(float3 posW, float depth)
+{
+	int nCascade = (int)dot((float4)(depth > CBScene_vec4CascadeSplits), 1.0f);
+	if(nCascade >= MAX_NUM_CASCADE)
+		return 1.0f;
+
+	return CalcShadowFactor(mul(float4(posW, 1.0f), CBScene_matCascadeTransforms[nCascade]));
+}
@@ -20,43 +20,89 @@ struct PsInput
 	float3 vec3Normal_World: NORMAL;
 	float3 vec3Tangent_World: TANGENT;
 	float2 vec2TexCoords: TEXCOORD;
-	float4 vec4ShadowPosition: POSITION1;
 	float4 vec4SsaoPos: POSITION2;
 };
 
-PsInput VsMain(VsInput vin)
+#ifdef SKINNED
+#ifdef SKINNED_PALETTE_DQ
+float3 QuatRotate(float3 v, float4 q)
 {
-	PsInput vout;
-	MaterialData mat = MaterialDatas[CBObject_nMaterialIndex];
-	float4x4 matIdentity = {
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-	};
+	return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
 
-#ifdef SKINNED
+// ɫʽԶƤ,  D3DHelper::WriteSkinnedPalette д뷽ʽӦ
+void SkinVertex(inout VsInput vin)
+{
 	float weights[4];
 	weights[0] = vin.vec4BoneWeights.x;
 	weights[1] = vin.vec4BoneWeights.y;
 	weights[2] = vin.vec4BoneWeights.z;
 	weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
 
+#ifdef SKINNED_PALETTE_DQ
+	// żԪԻ; ԵһΪ׼ͳһ, Զ·
+	float4 real0 = CBSkinned_vec4DualQuat[vin.vec4BoneIndices[0] * 2];
+	float4 real = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	float4 dual = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for(int i = 0; i < 4; ++i)
+	{
+		float4 r = CBSkinned_vec4DualQuat[vin.vec4BoneIndices[i] * 2];
+		float w = dot(real0, r) < 0.0f? -weights[i]: weights[i];
+		real += w * r;
+		dual += w * CBSkinned_vec4DualQuat[vin.vec4BoneIndices[i] * 2 + 1];
+	}
+
+	float invLength = rsqrt(dot(real, real));
+	real *= invLength;
+	dual *= invLength;
+	float3 translation = 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+
+	vin.vec3Position = QuatRotate(vin.vec3Position, real) + translation;
+	vin.vec3Normal = QuatRotate(vin.vec3Normal, real);
+	vin.vec3TangentU = QuatRotate(vin.vec3TangentU, real);
+#else
 	float3 posL = float3(0.0f, 0.0f, 0.0f);
 	float3 norL = float3(0.0f, 0.0f, 0.0f);
 	float3 tanL = float3(0.0f, 0.0f, 0.0f);
 	
 	for(int i = 0; i < 4; ++i)
 	{
+#ifdef SKINNED_PALETTE_3X4
+		uint base = vin.vec4BoneIndices[i] * 3;
+		float3x4 M = float3x4(CBSkinned_vec4Transform[base], CBSkinned_vec4Transform[base + 1], CBSkinned_vec4Transform[base + 2]);
+		posL += weights[i] * mul(M, float4(vin.vec3Position, 1.0f));
+		norL += weights[i] * mul((float3x3)M, vin.vec3Normal);
+		tanL += weights[i] * mul((float3x3)M, vin.vec3TangentU);
+#else
 		posL += weights[i] * mul(float4(vin.vec3Position, 1.0f), CBSkinned_matTransform[vin.vec4BoneIndices[i]]).xyz;
 		norL += weights[i] * mul(vin.vec3Normal, (float3x3)CBSkinned_matTransform[vin.vec4BoneIndices[i]]);
 		tanL += weights[i] * mul(vin.vec3TangentU, (float3x3)CBSkinned_matTransform[vin.vec4BoneIndices[i]]);
+#endif
 	}
 	
 	vin.vec3Position = posL;
 	vin.vec3TangentU = tanL;
 	vin.vec3Normal = norL;
 #endif
+}
+#endif
+
+PsInput VsMain(VsInput vin)
+{
+	PsInput vout;
+	MaterialData mat = MaterialDatas[CBObject_nMaterialIndex];
+	float4x4 matIdentity = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+
+#ifdef SKINNED
+	SkinVertex(vin);
+#endif
 
 	float4 pos = mul(float4(vin.vec3Position, 1.0f), CBObject_matWorld);
 	vout.vec3Position_World = pos.xyz;
@@ -67,7 +113,6 @@ PsInput VsMain(VsInput vin)
 	vout.vec3Tangent_World = mul(vin.vec3TangentU, (float3x3)CBObject_matWorld);
 
 	vout.vec4SsaoPos = mul(pos, CBScene_matViewProjTex);
-	vout.vec4ShadowPosition = mul(pos, CBScene_matShadowTransform);
 
 	float4 texC = mul(float4(vin.vec2TexCoords, 0.0f, 1.0f), CBObject_matTexTransform);
 	vout.vec2TexCoords = mul(texC, mat.matMaterialTransform).xy;
@@ -108,7 +153,7 @@ float4 PsMain(PsInput pin): SV_TARGET
 	mat.vec3FresnelR0 = fresnelR0;
 	mat.Shininess = shininess;
 	float3 shadowFactor = 1.0;
-	shadowFactor[0] = CalcShadowFactor(pin.vec4ShadowPosition);
+	shadowFactor[0] = CalcCascadedShadowFactor(pin.vec3Position_World, pin.vec4Position.w);
 
 	float4 vec4Diffuse = ComputeLighting(CBScene_Lights, mat, pin.vec3Position_World, bumpedNormal, eyeDir, shadowFactor);
 	
@@ -20,10 +20,18 @@
 
 void GetStaticSampler(CD3DX12_STATIC_SAMPLER_DESC* sampler);
 
-D3DFrame::D3DFrame(HINSTANCE hInstance) : D3DApp(hInstance)
+D3DFrame::D3DFrame(HINSTANCE hInstance) : D3DApp(hInstance), assetCache(PROJECT_ROOT("/Cache"))
 {
     stSceneBounds.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
     stSceneBounds.Radius = sqrtf(10.0f * 10.0f + 15.0f * 15.0f);
+
+    // Զļֻ̬Ͷ, ԴֹʱԿ֡
+    CascadedShadowDesc shadowDesc;
+    shadowDesc.nCascadeCount = MAX_NUM_CASCADE;
+    shadowDesc.nResolution = 2048;
+    shadowDesc.fShadowDistance = 60.0f;
+    shadowDesc.nFirstCachedCascade = 3;
+    cascadedShadow.SetDesc(shadowDesc);
     
     vec3BaseLightDirection[0] = { 0.57735f, -0.57735f, 0.57735f }; 
     vec3BaseLightDirection[1] = { -0.57735f, -0.57735f, 0.57735f };
@@ -45,12 +53,14 @@ bool D3DFrame::Initialize()
 
     camera.LookAt(XMFLOAT3(0.0f, 0.0f, -5.0f), {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
     
-    stShadowMap.Init(pD3dDevice.Get(), cxClient, cyClient);
+    // 2x2 һӰͼ
+    stShadowMap.Init(pD3dDevice.Get(), 2 * cascadedShadow.GetDesc().nResolution, 2 * cascadedShadow.GetDesc().nResolution);
 
     // б, ׼д
     ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 
-    LoadModels();
+    if(!LoadModels())
+        return 0;
     LoadTextures();
     BuildGeometries();
 
@@ -91,34 +101,29 @@ bool D3DFrame::Initialize()
     return 1;
 }
 
-void D3DFrame::LoadModels()
+bool D3DFrame::LoadModels()
 {
 // Skull Model
     Vertex* vertices;
-    UINT* indices;
+    void* indices;
 
     UINT nVertexByteSize, nIndexByteSize;
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> skullIndices;
+    TextModelLoader::TextModel skullModel;
     
-    LoadSkullModel(skullVertices, skullIndices);
-
-    XMVECTOR vMin = XMVectorSet(FLT_MAX, FLT_MAX, FLT_MAX, 0.0f);
-    XMVECTOR vMax = XMVectorSet(-FLT_MAX, -FLT_MAX, -FLT_MAX, 0.0f);
-
-    nVertexByteSize = skullVertices.size() * sizeof(Vertex);
-    nIndexByteSize = skullIndices.size() * sizeof(SkullModelIndex);
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../Models/skull.txt"), skullModel, &assetCache) || !skullModel.GetIndexCount())
+    {
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
+    nVertexByteSize = skullModel.Vertices.size() * sizeof(Vertex);
     vertices = (Vertex*)malloc(nVertexByteSize);
-    indices = (UINT*)malloc(nIndexByteSize);
-    CopyMemory(indices, &skullIndices[0], nIndexByteSize);
 
-    for(UINT i = 0; i < skullVertices.size(); ++i)
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i)
     {
-        vertices[i].Position = XMFLOAT3(skullVertices[i].Position);
-        vertices[i].Normal = XMFLOAT3(skullVertices[i].Normal);
+        vertices[i].Position = skullModel.Vertices[i].vec3Position;
+        vertices[i].Normal = skullModel.Vertices[i].vec3Normal;
      
-        XMVECTOR P = XMLoadFloat3(&vertices[i].Position);
         XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
         XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
         XMVECTOR T;
@@ -135,30 +140,47 @@ void D3DFrame::LoadModels()
         }
         vertices[i].TexCoords = {0.0f, 0.0f};
         XMStoreFloat3(&vertices[i].TangentU, T);
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
     }
 
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
+    Resource::SubmeshGeometry submesh;
+    submesh.Bounds = skullModel.Bounds;
+    submesh.nBaseVertexLocation = 0;
+    submesh.nStartIndexLocation = 0;
+    submesh.nIndexCount = skullModel.GetIndexCount();
+
+    // LOD: ׷ԭ֮, ͬһݶ
+    Geometry::LodChainDesc lodDesc;
+    lodDesc.pCache = &assetCache;
+    std::vector<Geometry::MeshLodReport> lodReports;
+    Geometry::SimplifyVertexLayout vertexLayout = { sizeof(Vertex), offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TexCoords) };
+    std::vector<UINT> skullLodIndices;
+
+    skullModel.GetIndices(skullLodIndices);
+    Geometry::MeshSimplifier::AppendLods(vertices, skullModel.Vertices.size(), vertexLayout, skullLodIndices, submesh, lodDesc, "Skull", &lodReports);
+
+    if(skullModel.emIndexFormat == DXGI_FORMAT_R16_UINT)
+    {
+        nIndexByteSize = skullLodIndices.size() * sizeof(UINT16);
+        indices = malloc(nIndexByteSize);
+        for(UINT i = 0; i < skullLodIndices.size(); ++i)
+            ((UINT16*)indices)[i] = (UINT16)skullLodIndices[i];
+    }
+    else
+    {
+        nIndexByteSize = skullLodIndices.size() * sizeof(UINT);
+        indices = malloc(nIndexByteSize);
+        CopyMemory(indices, skullLodIndices.data(), nIndexByteSize);
+    }
 
     GeoListItem skull;
     skull.bAutoRelease = 1;
     skull.pVertices = vertices;
     skull.pIndices = indices;
     skull.nVertexByteStride = sizeof(Vertex);
-    skull.emIndexFormat = DXGI_FORMAT_R16_UINT;
+    skull.emIndexFormat = skullModel.emIndexFormat;
     skull.nVertexByteSize = nVertexByteSize;
     skull.nIndexByteSize = nIndexByteSize;
     
-    Resource::SubmeshGeometry submesh;
-    submesh.Bounds = bounds;
-    submesh.nBaseVertexLocation = 0;
-    submesh.nStartIndexLocation = 0;
-    submesh.nIndexCount = skullIndices.size() * 3;
-    
     skull.Submeshes["main"] = submesh;
 
     GeoList["Skull"] = skull;
@@ -173,6 +195,10 @@ void D3DFrame::LoadModels()
     std::vector<UINT> m3dIndices;
 	
 	M3dLoader::LoadM3dFile(PROJECT_ROOT("/Resources/soldier.m3d"), m3dVertices, m3dIndices, m3dSubsets, m3dMaterials, SoldierSkinned);
+    SoldierSkinned.PackClips(60.0f);    // 60 Hz زΪ SoA , ÿͬʱֵ 4 
+
+    std::vector<Resource::SubmeshGeometry> soldierSubmeshes;
+    Geometry::MeshSimplifier::BuildM3dLods(m3dVertices, m3dIndices, m3dSubsets, lodDesc, soldierSubmeshes, &lodReports);
 
     nSoldierMatCount = m3dMaterials.size();
     nIndexByteSize = sizeof(UINT) * m3dIndices.size();
@@ -206,15 +232,17 @@ void D3DFrame::LoadModels()
     soldier.pVertices = pM3dVertices;
     
     for(UINT i = 0; i < m3dSubsets.size(); ++i)
-    {
-        Resource::SubmeshGeometry submesh;
-        submesh.nIndexCount = m3dSubsets[i].nFaceCount * 3;
-        submesh.nStartIndexLocation = m3dSubsets[i].nFaceStart * 3;
-        submesh.nBaseVertexLocation = 0;
-        soldier.Submeshes["sm_" + std::to_string(i)] = submesh;
-    }
+        soldier.Submeshes["sm_" + std::to_string(i)] = soldierSubmeshes[i];
 
     GeoList["Soldier"] = soldier;
+
+    for(auto& report : lodReports)
+    {
+        std::string text = "***LOD: " + report.Name + " [" + std::to_string(report.nLevel) + "] triangles: " + std::to_string(report.nTriangleCount) + " error: " + std::to_string(report.fError) + "\n";
+        OutputDebugStringA(text.c_str());
+    }
+    std::string cacheText = "***AssetCache: hit " + std::to_string(assetCache.GetHitCount()) + " miss " + std::to_string(assetCache.GetMissCount()) + "\n";
+    OutputDebugStringA(cacheText.c_str());
     XMFLOAT4X4 mat = MathHelper::Identity4x4();
 
     // Materials && Textures
@@ -237,10 +265,14 @@ void D3DFrame::LoadModels()
         ));
     }
 
-    Soldier.ClipName = "Take1";
-    Soldier.fTimePos = 0.0f;
     Soldier.Skinned = &SoldierSkinned;
+    Soldier.PlayClip("Take1");
     Soldier.matFinalTransforms.resize(SoldierSkinned.BoneCount());
+    Soldier.nSkinnedCBIndex = 0;
+
+    SoldierBounds.Build(m3dVertices.data(), (UINT)m3dVertices.size());
+    Soldier.pBounds = &SoldierBounds;
+    return 1;
 }
 
 void D3DFrame::LoadTextures()
@@ -378,6 +410,18 @@ void D3DFrame::BuildGeometries()
     indices.insert(std::end(indices), std::begin(cylinder.indices), std::end(cylinder.indices));
     indices.insert(std::end(indices), std::begin(quadIndex), std::end(quadIndex));
 
+    // ײ, ڵ޳
+    BoundingBox::CreateFromPoints(boxSubmesh.Bounds, box.vertices.size(), &vertices[boxVertexOffset].Position, sizeof(Vertex));
+    BoundingBox::CreateFromPoints(gridSubmesh.Bounds, grid.vertices.size(), &vertices[gridVertexOffset].Position, sizeof(Vertex));
+    BoundingBox::CreateFromPoints(sphereSubmesh.Bounds, sphere.vertices.size(), &vertices[sphereVertexOffset].Position, sizeof(Vertex));
+    BoundingBox::CreateFromPoints(cylinderSubmesh.Bounds, cylinder.vertices.size(), &vertices[cylinderVertexOffset].Position, sizeof(Vertex));
+
+    // 㹻״, Ϊڵ
+    nBoxOccluder = occlusionCuller.AddMesh(&vertices[boxVertexOffset], sizeof(Vertex), (UINT)box.vertices.size(),
+                                           &indices[boxIndexOffset], DXGI_FORMAT_R16_UINT, (UINT)box.indices.size());
+    nCylinderOccluder = occlusionCuller.AddMesh(&vertices[cylinderVertexOffset], sizeof(Vertex), (UINT)cylinder.vertices.size(),
+                                                &indices[cylinderIndexOffset], DXGI_FORMAT_R16_UINT, (UINT)cylinder.indices.size());
+
     UINT vertexBytesSize = vertexTotal * sizeof(Vertex);
     UINT indexBytesSize = indices.size() * sizeof(UINT16);
 
@@ -599,6 +643,8 @@ void D3DFrame::BuildRenderItems()
 
     XMStoreFloat4x4(&skull.matWorld, XMMatrixScaling(.5f, .5f, .5f) * XMMatrixTranslation(0.0f, 2.5f, 0.0f));
     skull.matTexTransform = MathHelper::Identity4x4();
+    skull.Bounds = info.Bounds;
+    skull.nLodIndex = lodSelector.Add(&skull.pGeo->DrawArgs["main"], skull.Bounds, XMLoadFloat4x4(&skull.matWorld));
     // AllRenderItems.push_back(skull);
     VectorPushBackEx(AllRenderItems, skull);
 
@@ -615,9 +661,11 @@ void D3DFrame::BuildRenderItems()
     box.nBaseVertexLocation = info.nBaseVertexLocation;
     XMStoreFloat4x4(&box.matWorld, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 1.0f, 0.0f));
     XMStoreFloat4x4(&box.matTexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
+    box.Bounds = info.Bounds;
 
     // AllRenderItems.push_back(box);
     VectorPushBackEx(AllRenderItems, box);
+    Occluders.push_back({VectorSize(AllRenderItems) - 1, nBoxOccluder});
 
     RenderItem grid;
     grid.iFramesDirty = 3;
@@ -632,6 +680,7 @@ void D3DFrame::BuildRenderItems()
     grid.nStartIndexLocation = info.nStartIndexLocation;
     grid.matWorld = MathHelper::Identity4x4();
     XMStoreFloat4x4(&grid.matTexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
+    grid.Bounds = info.Bounds;
     
     // AllRenderItems.push_back(grid);
     VectorPushBackEx(AllRenderItems, grid);
@@ -660,6 +709,7 @@ void D3DFrame::BuildRenderItems()
         lCI.nStartIndexLocation = info.nStartIndexLocation;
         XMStoreFloat4x4(&lCI.matWorld, lCW);
         XMStoreFloat4x4(&lCI.matTexTransform, brickTexTransform);
+        lCI.Bounds = info.Bounds;
 
         rCI.iFramesDirty = 3;
         rCI.nCBObjectIndex = objIndex++;
@@ -673,6 +723,7 @@ void D3DFrame::BuildRenderItems()
         rCI.nStartIndexLocation = info.nStartIndexLocation;
         XMStoreFloat4x4(&rCI.matWorld, rCW);
         XMStoreFloat4x4(&rCI.matTexTransform, brickTexTransform);
+        rCI.Bounds = info.Bounds;
         
         lSI.iFramesDirty = 3;
         lSI.nCBObjectIndex = objIndex++;
@@ -686,6 +737,7 @@ void D3DFrame::BuildRenderItems()
         lSI.nStartIndexLocation = info.nStartIndexLocation;
         lSI.matTexTransform = MathHelper::Identity4x4();
         XMStoreFloat4x4(&lSI.matWorld, lSW);
+        lSI.Bounds = info.Bounds;
 
         
         rSI.iFramesDirty = 3;
@@ -700,6 +752,7 @@ void D3DFrame::BuildRenderItems()
         rSI.nStartIndexLocation = info.nStartIndexLocation;
         rSI.matTexTransform = MathHelper::Identity4x4();
         XMStoreFloat4x4(&rSI.matWorld, rSW);
+        rSI.Bounds = info.Bounds;
         /*
         AllRenderItems.push_back(lCI);
         AllRenderItems.push_back(rCI);
@@ -708,7 +761,9 @@ void D3DFrame::BuildRenderItems()
         */
 
         VectorPushBackEx(AllRenderItems, lCI);
+        Occluders.push_back({VectorSize(AllRenderItems) - 1, nCylinderOccluder});
         VectorPushBackEx(AllRenderItems, rCI);
+        Occluders.push_back({VectorSize(AllRenderItems) - 1, nCylinderOccluder});
         VectorPushBackEx(AllRenderItems, lSI);
         VectorPushBackEx(AllRenderItems, rSI);
 
@@ -733,6 +788,7 @@ void D3DFrame::BuildRenderItems()
 
     model.nSkinnedCBIndex = 0;
     model.Skinned = &Soldier;
+    animationLod.Add(&Soldier, XMLoadFloat4x4(&model.matWorld));
 
     for(UINT i = 0; i < 5; ++i)
     {
@@ -745,22 +801,36 @@ void D3DFrame::BuildRenderItems()
         model.nIndexCount = subset.nIndexCount;
         model.nStartIndexLocation = subset.nStartIndexLocation;
         model.nBaseVertexLocation = subset.nBaseVertexLocation;
+        model.Bounds = subset.Bounds;
+        model.nLodIndex = lodSelector.Add(&subset, model.Bounds, XMLoadFloat4x4(&model.matWorld));
 
         VectorPushBackEx(AllRenderItems, model);
         RenderItems[RENDER_TYPE_SKINNED_OPAQUE].push_back(nIndexBegin++);
     }
+
+    // ȾͨͶ嶼 sceneBvh ѯ; ʿĴ UpdateAnimations и
+    std::vector<UINT> bvhItems = RenderItems[RENDER_TYPE_OPAQUE];
+    bvhItems.insert(bvhItems.end(), RenderItems[RENDER_TYPE_SKINNED_OPAQUE].begin(), RenderItems[RENDER_TYPE_SKINNED_OPAQUE].end());
+    std::vector<BoundingBox> bvhBounds(bvhItems.size());
+    for(UINT i = 0; i < bvhItems.size(); ++i)
+    {
+        RenderItem* item = (RenderItem*)VectorAt(AllRenderItems, bvhItems[i]);
+        item->Bounds.Transform(bvhBounds[i], XMLoadFloat4x4(&item->matWorld));
+        item->nBvhIndex = i;
+    }
+    sceneBvh.Build(bvhBounds.data(), bvhItems.data(), (UINT)bvhItems.size());
 }
 
 void D3DFrame::BuildRootSignatures()
 {
     for(UINT i = 0; i < nFrameResourceCount; ++i)
     {
-        pFrameResources[i].InitConstantBuffer(pD3dDevice.Get(), 2, VectorSize(AllRenderItems));
+        pFrameResources[i].InitConstantBuffer(pD3dDevice.Get(), 1 + MAX_NUM_CASCADE, VectorSize(AllRenderItems));
 
         pFrameResources[i].InitOtherBuffer(Resource::FrameResource::FRAME_RESOURCE_TYPE_SSAO)
         .Init(pD3dDevice.Get(), CONSTANT_VALUE::nCBSsaoByteSize, 1);
         pFrameResources[i].InitOtherBuffer(Resource::FrameResource::FRAME_RESOURCE_TYPE_SKINNED)
-        .Init(pD3dDevice.Get(), CONSTANT_VALUE::nCBSkinnedByteSize, 1);
+        .Init(pD3dDevice.Get(), GetSkinnedPaletteByteSize(SoldierSkinned.BoneCount(), emSkinnedPaletteFormat), 1);
     }
 
     CD3DX12_DESCRIPTOR_RANGE range[2];
@@ -846,8 +916,10 @@ void D3DFrame::BuildPipelineStates()
         NULL, NULL
     };
     
+    const char* lpszPaletteFormats[] = {"SKINNED_PALETTE_4X4", "SKINNED_PALETTE_3X4", "SKINNED_PALETTE_DQ"};
     D3D_SHADER_MACRO Skinned[] = {
         "SKINNED", "1",
+        lpszPaletteFormats[emSkinnedPaletteFormat], "1",
         NULL, NULL
     };
 
@@ -1044,7 +1116,9 @@ void D3DFrame::Update(const GameTimer& t)
     UpdateShadowSpace();
     UpdateScene(t);
     UpdateAnimations(t);
-\
+    UpdateLods();
+    UpdateOcclusion();
+    UpdateShadowCasters();
 }
 
 void D3DFrame::UpdateMaterials(const GameTimer& t)
@@ -1100,12 +1174,13 @@ void D3DFrame::UpdateScene(const GameTimer& t)
     );
     
     Constant::SceneConstant sc;
-    XMMATRIX view = camera.GetView();
-    XMMATRIX proj = camera.GetProj();
-    XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+    const CameraMatrices& matrices = camera.GetMatrices();
+    XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+    XMMATRIX proj = XMLoadFloat4x4(&matrices.matProj);
+    XMMATRIX matInvView = XMLoadFloat4x4(&matrices.matInvView);
+    XMMATRIX matInvProj = XMLoadFloat4x4(&matrices.matInvProj);
+    XMMATRIX matViewProj = XMLoadFloat4x4(&matrices.matViewProj);
+    XMMATRIX matInvViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
     XMMATRIX matViewProjTex = XMMatrixMultiply(matViewProj, T);
 
     XMStoreFloat4x4(&sc.matView, XMMatrixTranspose(view));
@@ -1114,9 +1189,21 @@ void D3DFrame::UpdateScene(const GameTimer& t)
     XMStoreFloat4x4(&sc.matInvProj, XMMatrixTranspose(matInvProj));
     XMStoreFloat4x4(&sc.matViewProj, XMMatrixTranspose(matViewProj));
     XMStoreFloat4x4(&sc.matInvViewProj, XMMatrixTranspose(matInvViewProj));
-    XMStoreFloat4x4(&sc.matShadowTransform, XMMatrixTranspose(XMLoadFloat4x4(&matShadowTransform)));
     XMStoreFloat4x4(&sc.matViewProjTex, XMMatrixTranspose(matViewProjTex));
 
+    //  i λӰͼĵ (i & 1, i >> 1) ; δʹõļظһ, ӰƬԪ˲Ӱ
+    float splits[MAX_NUM_CASCADE];
+    for(UINT i = 0; i < MAX_NUM_CASCADE; ++i)
+    {
+        UINT nCascade = min(i, cascadedShadow.GetCascadeCount() - 1);
+        const ShadowCascade& cascade = cascadedShadow.GetCascade(nCascade);
+        XMMATRIX atlas = XMMatrixScaling(0.5f, 0.5f, 1.0f) * XMMatrixTranslation(0.5f * (nCascade & 1), 0.5f * (nCascade >> 1), 0.0f);
+        XMStoreFloat4x4(&sc.matCascadeTransforms[i], XMMatrixTranspose(XMLoadFloat4x4(&cascade.matShadowTransform) * atlas));
+        splits[i] = cascade.fSplitFar;
+    }
+    sc.vec4CascadeSplits = XMFLOAT4(splits);
+    sc.matShadowTransform = sc.matCascadeTransforms[0];
+
     sc.vec3EyePos = camera.GetPosition3f();
     sc.vec2RenderTargetSize = XMFLOAT2((float)cxClient, (float)cyClient);
     sc.vec2InvRenderTargetSize = XMFLOAT2(1.0f/ cxClient, 1.0f/ cyClient);
@@ -1137,29 +1224,33 @@ void D3DFrame::UpdateScene(const GameTimer& t)
     sc.lights[2].vec3Strength = {0.15f, 0.15f, 0.15f};
     pCurrFrameResource->CBScene.CopyData(0, &sc, CONSTANT_VALUE::nCBSceneByteSize);
 
-    // Shadow Scene
-    view = XMLoadFloat4x4(&matShadowView);
-    proj = XMLoadFloat4x4(&matShadowProj);
-    matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    matViewProj = XMMatrixMultiply(view, proj);
-    matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
-    matViewProjTex = XMMatrixMultiply(matViewProj, T);
-
-    XMStoreFloat4x4(&sc.matView, view);
-    XMStoreFloat4x4(&sc.matInvView, XMMatrixTranspose(matInvView));
-    XMStoreFloat4x4(&sc.matProj, XMMatrixTranspose(proj));
-    XMStoreFloat4x4(&sc.matInvProj, XMMatrixTranspose(matInvProj));
-    XMStoreFloat4x4(&sc.matViewProj, XMMatrixTranspose(matViewProj));
-    XMStoreFloat4x4(&sc.matInvViewProj, XMMatrixTranspose(matInvViewProj));    
-    XMStoreFloat4x4(&sc.matShadowTransform, XMMatrixTranspose(XMLoadFloat4x4(&matShadowTransform)));
-    XMStoreFloat4x4(&sc.matViewProjTex, XMMatrixTranspose(matViewProjTex));
-    sc.vec3EyePos = vec3MainLightPos;
+    // Shadow Scene: λ 1 + i Ϊ i Ӱͨ
     sc.vec2RenderTargetSize = XMFLOAT2(0, 0);
     sc.vec2InvRenderTargetSize = XMFLOAT2(0, 0);
-    sc.fNearZ = nLightNearZ;
-    sc.fFarZ = nLightFarZ;
-    pCurrFrameResource->CBScene.CopyData(1, &sc, CONSTANT_VALUE::nCBSceneByteSize);
+    for(UINT i = 0; i < cascadedShadow.GetCascadeCount(); ++i)
+    {
+        const ShadowCascade& cascade = cascadedShadow.GetCascade(i);
+        XMMATRIX shadowView = XMLoadFloat4x4(&cascade.matView);
+        XMMATRIX shadowProj = XMLoadFloat4x4(&cascade.matProj);
+        XMMATRIX shadowViewProj = XMLoadFloat4x4(&cascade.matViewProj);
+        XMMATRIX shadowInvView = XMMatrixInverse(&XMMatrixDeterminant(shadowView), shadowView);
+        XMMATRIX shadowInvProj = XMMatrixInverse(&XMMatrixDeterminant(shadowProj), shadowProj);
+        XMMATRIX shadowInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(shadowViewProj), shadowViewProj);
+
+        XMStoreFloat4x4(&sc.matView, XMMatrixTranspose(shadowView));
+        XMStoreFloat4x4(&sc.matInvView, XMMatrixTranspose(shadowInvView));
+        XMStoreFloat4x4(&sc.matProj, XMMatrixTranspose(shadowProj));
+        XMStoreFloat4x4(&sc.matInvProj, XMMatrixTranspose(shadowInvProj));
+        XMStoreFloat4x4(&sc.matViewProj, XMMatrixTranspose(shadowViewProj));
+        XMStoreFloat4x4(&sc.matInvViewProj, XMMatrixTranspose(shadowInvViewProj));
+        XMStoreFloat4x4(&sc.matShadowTransform, XMMatrixTranspose(XMLoadFloat4x4(&cascade.matShadowTransform)));
+        XMStoreFloat4x4(&sc.matViewProjTex, XMMatrixTranspose(XMMatrixMultiply(shadowViewProj, T)));
+        // ƽйûλ, ȡͶӰΧƽ
+        XMStoreFloat3(&sc.vec3EyePos, XMVector3TransformCoord(XMVectorSet(cascade.vec2Center.x, cascade.vec2Center.y, cascade.fNearZ, 1.0f), shadowInvView));
+        sc.fNearZ = cascade.fNearZ;
+        sc.fFarZ = cascade.fFarZ;
+        pCurrFrameResource->CBScene.CopyData(1 + i, &sc, CONSTANT_VALUE::nCBSceneByteSize);
+    }
 
     Constant::SsaoConstant cbSsao;
     XMMATRIX matProjTex = XMMatrixMultiply(proj, T);
@@ -1182,49 +1273,90 @@ void D3DFrame::UpdateScene(const GameTimer& t)
 
 void D3DFrame::UpdateShadowSpace()
 {
-    XMVECTOR lightDir = XMLoadFloat3(&vec3RotatedLightDirection[0]);
-    XMVECTOR lightPos = -2.0f * stSceneBounds.Radius * lightDir;
-    XMVECTOR targetPos = XMLoadFloat3(&stSceneBounds.Center);
-    XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    XMMATRIX lightView = XMMatrixLookAtLH(lightPos, targetPos, lightUp);
-
-    XMStoreFloat3(&vec3MainLightPos, lightPos);
+    // Դÿ֡ת, ļÿ֡ػ; Դֹʱ, Զļֻ뿪ػ
+    cascadedShadow.Update(camera, XMLoadFloat3(&vec3RotatedLightDirection[0]), &stSceneBounds);
+}
 
-    XMFLOAT3 sphereCenterLS;
-    XMStoreFloat3(&sphereCenterLS, XMVector3TransformCoord(targetPos, lightView));
+void D3DFrame::UpdateShadowCasters()
+{
+    // ʿײ UpdateAnimations и² Refit, ˲ѯ
+    for(UINT i = 0; i < cascadedShadow.GetCascadeCount(); ++i)
+    {
+        const ShadowCascade& cascade = cascadedShadow.GetCascade(i);
+        ShadowOpaqueItems[i].clear();
+        ShadowSkinnedItems[i].clear();
+        if(!cascade.bDirty)
+            continue;
+
+        sceneBvh.QueryPlanes(cascade.Casters.GetPlanes(), cascade.Casters.GetPlaneCount(), BvhResults);
+        for(UINT n : BvhResults)
+        {
+            RenderItem* item = (RenderItem*)VectorAt(AllRenderItems, n);
+            if(!item->Skinned)
+                ShadowOpaqueItems[i].push_back(n);
+            // Ӱͼö֡, ƶʿ
+            else if(!cascade.bCached)
+                ShadowSkinnedItems[i].push_back(n);
+        }
+    }
+}
 
-    float l = sphereCenterLS.x - stSceneBounds.Radius;
-    float b = sphereCenterLS.y - stSceneBounds.Radius;
-    float n = sphereCenterLS.z - stSceneBounds.Radius;
-    float r = sphereCenterLS.x + stSceneBounds.Radius;
-    float t = sphereCenterLS.y + stSceneBounds.Radius;
-    float f = sphereCenterLS.z + stSceneBounds.Radius;
+void D3DFrame::UpdateAnimations(const GameTimer& t)
+{
+    // ɫֱдʵ nSkinnedCBIndex λ; ʵ϶ʱԶַ̳߳
+    animationLod.Schedule(camera);
+    UpdateSkinnedInstances(&Soldier, 1, t.DeltaTime(),
+                           pCurrFrameResource->CBOthers[Resource::FrameResource::FRAME_RESOURCE_TYPE_SKINNED],
+                           NULL, emSkinnedPaletteFormat);
+
+    // ̬Ӽײ޷Ƕе, õǰģ͵İΧ
+    for(UINT i : RenderItems[RENDER_TYPE_SKINNED_OPAQUE])
+    {
+        RenderItem* item = (RenderItem*)VectorAt(AllRenderItems, i);
+        item->Bounds = item->Skinned->Bounds;
+        if(item->nLodIndex != -1)
+            lodSelector.SetTransform(item->nLodIndex, item->Bounds, XMLoadFloat4x4(&item->matWorld));
 
-    nLightFarZ = f;
-    nLightNearZ = n;
-    XMMATRIX proj = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
+        BoundingBox worldBounds;
+        item->Bounds.Transform(worldBounds, XMLoadFloat4x4(&item->matWorld));
+        sceneBvh.Update(item->nBvhIndex, worldBounds);
+    }
+    sceneBvh.Refit();
+}
 
-    XMMATRIX T(
-        0.5f, 0.0f, 0.0f, 0.0f,
-        0.0f, -0.5f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, 0.0f, 1.0f
-    );
+void D3DFrame::UpdateLods()
+{
+    lodSelector.Select(camera, ScreenViewport.Height);
 
-    XMMATRIX S = lightView * proj * T;
-    XMStoreFloat4x4(&matShadowView, lightView);
-    XMStoreFloat4x4(&matShadowProj, proj);
-    XMStoreFloat4x4(&matShadowTransform, S);
+    // ʱֱʹȾеΧ
+    for(UINT i = 0; i < VectorSize(AllRenderItems); ++i)
+    {
+        RenderItem* item = (RenderItem*)VectorAt(AllRenderItems, i);
+        if(item->nLodIndex != -1)
+            lodSelector.GetRange(item->nLodIndex, item->nIndexCount, item->nStartIndexLocation);
+    }
 }
 
-void D3DFrame::UpdateAnimations(const GameTimer& t)
+void D3DFrame::UpdateOcclusion()
 {
-    Constant::SkinnedConstant sc;
-
-    Soldier.UpdateAnimation(t.DeltaTime());
-   
-    pCurrFrameResource->CBOthers[Resource::FrameResource::FRAME_RESOURCE_TYPE_SKINNED]
-    .CopyData(0, &Soldier.matFinalTransforms[0] , Soldier.matFinalTransforms.size() * sizeof(XMFLOAT4X4));
+    // ڵͬΪڵ, ܱڵﵲס
+    occlusionCuller.ClearOccluders();
+    for(auto& occluder : Occluders)
+        occlusionCuller.AddOccluder(occluder.second, ((RenderItem*)VectorAt(AllRenderItems, occluder.first))->matWorld);
+    occlusionCuller.Render(camera.GetMatrices().matViewProj);
+
+    // ׶ڵȾ sceneBvh ѯ, ռײڵ; ӰͨʹùԴӽ,  UpdateShadowCasters вѯ
+    VisibleOpaqueItems.clear();
+    VisibleSkinnedItems.clear();
+    sceneBvh.QueryFrustum(camera, BvhResults);
+    for(UINT i : BvhResults)
+    {
+        RenderItem* item = (RenderItem*)VectorAt(AllRenderItems, i);
+        BoundingBox worldBounds;
+        item->Bounds.Transform(worldBounds, XMLoadFloat4x4(&item->matWorld));
+        if(occlusionCuller.IsVisible(worldBounds))
+            (item->Skinned ? VisibleSkinnedItems : VisibleOpaqueItems).push_back(i);
+    }
 }
 
 void D3DFrame::OnResize()
@@ -1313,10 +1445,10 @@ void D3DFrame::Render(const GameTimer& t)
     pCommandList->ClearRenderTargetView(CurrentBackBufferView(), clearColor, 0, NULL);
     
     pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_OPAQUE].Get());
-    DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_OPAQUE]);
+    DrawItems(pCommandList.Get(), VisibleOpaqueItems);
     
     pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_SKINNED_OPAQUE].Get());
-    DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_SKINNED_OPAQUE]);
+    DrawItems(pCommandList.Get(), VisibleSkinnedItems);
 
     pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_DEBUG].Get());
     DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_DEBUG]);
@@ -1350,9 +1482,6 @@ void D3DFrame::Render(const GameTimer& t)
 
 void D3DFrame::DrawSceneToShadowMap()
 {
-    pCommandList->RSSetViewports(1, &stShadowMap.Viewport());
-    pCommandList->RSSetScissorRects(1, &stShadowMap.ScissorRect());
-
     pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         stShadowMap.Resource(),
         D3D12_RESOURCE_STATE_GENERIC_READ,
@@ -1360,16 +1489,30 @@ void D3DFrame::DrawSceneToShadowMap()
     ));
 
     pCommandList->OMSetRenderTargets(0, NULL, 0, &stShadowMap.Dsv());
-    pCommandList->ClearDepthStencilView(stShadowMap.Dsv(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, NULL);
 
-    D3D12_GPU_VIRTUAL_ADDRESS cbSceneAddr = pCurrFrameResource->CBScene.Resource()->GetGPUVirtualAddress() + CONSTANT_VALUE::nCBSceneByteSize;
-    pCommandList->SetGraphicsRootConstantBufferView(2, cbSceneAddr);
-    
-    pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_OPAQUE_SHADOW].Get());
-    DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_OPAQUE]);
+    // ƵԼ, ֻ; δ仯ļ֮ǰ
+    const UINT nCascadeSize = stShadowMap.Width() / 2;
+    D3D12_GPU_VIRTUAL_ADDRESS cbSceneAddr = pCurrFrameResource->CBScene.Resource()->GetGPUVirtualAddress();
+    for(UINT i = 0; i < cascadedShadow.GetCascadeCount(); ++i)
+    {
+        if(!cascadedShadow.GetCascade(i).bDirty)
+            continue;
 
-    pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_SKINNED_OPAQUE].Get());
-    DrawItems(pCommandList.Get(), RenderItems[RENDER_TYPE_SKINNED_OPAQUE]);
+        LONG x = nCascadeSize * (i & 1), y = nCascadeSize * (i >> 1);
+        D3D12_VIEWPORT viewport = {(float)x, (float)y, (float)nCascadeSize, (float)nCascadeSize, 0.0f, 1.0f};
+        D3D12_RECT rect = {x, y, x + (LONG)nCascadeSize, y + (LONG)nCascadeSize};
+        pCommandList->RSSetViewports(1, &viewport);
+        pCommandList->RSSetScissorRects(1, &rect);
+        pCommandList->ClearDepthStencilView(stShadowMap.Dsv(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 1, &rect);
+
+        pCommandList->SetGraphicsRootConstantBufferView(2, cbSceneAddr + (1 + i) * CONSTANT_VALUE::nCBSceneByteSize);
+
+        pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_OPAQUE_SHADOW].Get());
+        DrawItems(pCommandList.Get(), ShadowOpaqueItems[i]);
+
+        pCommandList->SetPipelineState(PipelineStates[RENDER_TYPE_SKINNED_OPAQUE].Get());
+        DrawItems(pCommandList.Get(), ShadowSkinnedItems[i]);
+    }
 
     pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         stShadowMap.Resource(),
@@ -1424,8 +1567,9 @@ void D3DFrame::DrawItems(ID3D12GraphicsCommandList* list, std::vector<UINT>& ite
 #ifdef D3D12_SKINNED
         if(item.Skinned)
         {
-            addr = pCurrFrameResource->CBOthers[Resource::FrameResource::FRAME_RESOURCE_TYPE_SKINNED].Resource()->GetGPUVirtualAddress();
-            addr += item.nSkinnedCBIndex * CONSTANT_VALUE::nCBSkinnedByteSize;
+            UploadBuffer& skinnedCB = pCurrFrameResource->CBOthers[Resource::FrameResource::FRAME_RESOURCE_TYPE_SKINNED];
+            addr = skinnedCB.Resource()->GetGPUVirtualAddress();
+            addr += item.nSkinnedCBIndex * skinnedCB.ElementByteSize();
 
             // Skinned Data
             list->SetGraphicsRootConstantBufferView(1, addr);
@@ -1439,81 +1583,6 @@ void D3DFrame::DrawItems(ID3D12GraphicsCommandList* list, std::vector<UINT>& ite
     }
 }
 
-#define IsDigit(c) (c >= '0' && c <= '9')
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
-{
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pBlock;
-    UINT nVertexCounter = 0, nTriangleCounter = 0;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    while(!IsDigit(*pBlock))++pBlock;
-    pBegin = pBlock;
-    while(*pBlock != '\r')++pBlock;
-    *pBlock++ = '\0';
-
-    nVertexCounter = atoi(pBegin);
-    while(!IsDigit(*pBlock))++pBlock;
-    pBegin = pBlock;
-    while(*pBlock != '\r')++pBlock;
-    *pBlock++ = '\0';
-    
-    nTriangleCounter = atoi(pBegin);
-    
-    vertices.resize(nVertexCounter);
-    indices.resize(nTriangleCounter);
-
-    while(*pBlock++ != '{');
-
-    for(UINT i = 0; i < nVertexCounter; ++i)
-    {
-        for(UINT j = 0; j < 6; ++j)
-        {
-            while(!IsDigit(*pBlock) && *pBlock != '-')++pBlock;
-            pBegin = pBlock;
-            while(*pBlock != ' ' && *pBlock != '\r')++pBlock;
-            *pBlock++ = '\0';
-
-            vertices[i].v[j] = atof(pBegin);
-        }
-    }
-
-    while(*pBlock++ != '\n');
-    assert(*pBlock == '}');
-
-    while(*pBlock++ != '{');
-    for(UINT i = 0; i < nTriangleCounter; ++i)
-    {
-        for(UINT j = 0; j < 3; ++j)
-        {
-            while(!IsDigit(*pBlock))++pBlock;
-            pBegin = pBlock;
-            while(*pBlock != ' ' && *pBlock != '\r')++pBlock;
-            *pBlock++ = '\0';
-            indices[i].i[j] = atof(pBegin);
-        }
-    }
-
-    free(pFileBuffer);
-}   
-
 void GetStaticSampler(CD3DX12_STATIC_SAMPLER_DESC* sampler)
 {
     sampler[0].Init(
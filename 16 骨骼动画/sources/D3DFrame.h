@@ -1,6 +1,12 @@
 #pragma once
 #include <D3DApp.h>
 #include <Camera.h>
+#include <D3DHelper_LodSelector.h>
+#include <D3DHelper_AnimationLod.h>
+#include <D3DHelper_OcclusionCulling.h>
+#include <D3DHelper_SceneBvh.h>
+#include <D3DHelper_CascadedShadow.h>
+#include <TextModelLoader.h>
 #include "ShadowMap.h"
 #include "SsaoMap.h"
 #include "project.h"
@@ -14,27 +20,6 @@ using namespace DirectX;
 #define RAND(a, b) a + rand() % ((b - a) + 1)
 #define RANDF(a, b) a + ((float)(rand()) / (float)RAND_MAX) * (b - a)
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -206,6 +191,7 @@ private:
     POINT lastPos; 
 private:
     void UpdateShadowSpace();
+    void UpdateShadowCasters();
     void DrawSceneToShadowMap();
 
 private:
@@ -220,11 +206,10 @@ private:
     float nLightRotationAngle = 0.0f;
     XMFLOAT3 vec3BaseLightDirection[3];
     XMFLOAT3 vec3RotatedLightDirection[3];
-    XMFLOAT3 vec3MainLightPos;
-    float nLightNearZ;
-    float nLightFarZ;
 
-    XMFLOAT4X4 matShadowView, matShadowProj, matShadowTransform;
+    CascadedShadow cascadedShadow;          // ԴļӰ, ռӰͼһ
+    std::vector<UINT> ShadowOpaqueItems[MAX_NUM_CASCADE];   // пͶӰȾ
+    std::vector<UINT> ShadowSkinnedItems[MAX_NUM_CASCADE];  // ļʿ
 
 private:
     void DrawSceneToNormalMap();
@@ -237,15 +222,31 @@ private:
     UINT nNormalMapSrvIndex = 0;
 
 private:
-    void LoadModels();
+    bool LoadModels();
     void UpdateAnimations(const GameTimer&);
+    void UpdateLods();
+    void UpdateOcclusion();
 
 private:
 // ΪĿֻһʵʹģ, ֱӶԱ
     SkinnedInstance Soldier;
     D3DHelper::Animation::SkinnedAnimation SoldierSkinned;
+    SkinnedBounds SoldierBounds;    // İײ, ÿ֡ݴʿİΧ
+    SkinnedPaletteFormats emSkinnedPaletteFormat = SKINNED_PALETTE_FORMAT_3X4;   // ɫݴ˶ SKINNED_PALETTE_* ,  BuildPipelineStates
 
     UINT nSoldierMatCount;
+
+    LodSelector lodSelector;    // ʿ LOD ѡ
+    AnimationLodScheduler animationLod;  // ʿֵƵ
+    BaseHelper::AssetCache assetCache;  // Դ(LOD ), λ PROJECT_ROOT/Cache
+
+    OcclusionCuller occlusionCuller;    // Ϊڵڵ޳
+    UINT nBoxOccluder = 0, nCylinderOccluder = 0;   // ڵ
+    std::vector<std::pair<UINT, UINT>> Occluders;   // (Ⱦ, ڵ)
+    std::vector<UINT> VisibleOpaqueItems;           // Ⱦͨͨڵ޳Ⱦ
+    std::vector<UINT> VisibleSkinnedItems;
+
+    SceneBvh sceneBvh;                  // ͸Ⱦʿռײ, ûΪȾ
+    std::vector<UINT> BvhResults;       // sceneBvh Ĳѯ
 };
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
@@ -1,31 +1,12 @@
 #include "D3DApp.h"
+#include <TextModelLoader.h>
+#include "project.h"
 #define USE_FRAMERESOURCE
 using namespace Microsoft::WRL;
 using namespace D3DHelper;
 using namespace DirectX;
 
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -35,7 +16,6 @@ struct Vertex
     Vertex(){}
 };
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
 class D3DFrame : public D3DApp
 {
     enum RenderType
@@ -64,7 +44,7 @@ protected:
     virtual void OnMouseDown(WPARAM, int, int);
 
     void LoadTextures();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildMaterials();
     void BuildSRV();
     void BuildRenderItems();
@@ -134,7 +114,8 @@ bool D3DFrame::Initialize()
     ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 
     LoadTextures();
-    BuildGeometries();
+    if(!BuildGeometries())
+        return 0;
     BuildMaterials();
     BuildSRV();
     BuildRenderItems();
@@ -220,7 +201,7 @@ void D3DFrame::BuildSRV()
 
 }
 
-void D3DFrame::BuildGeometries()
+bool D3DFrame::BuildGeometries()
 {
     Vertex roomVertices[] = {
         Vertex(-3.5f, 0.0f, -10.0f, 0.0f, 1.0f, 0.0f, 0.0f, 4.0f), // 0 
@@ -270,26 +251,30 @@ void D3DFrame::BuildGeometries()
 		16, 17, 18,
 		16, 18, 19
     };
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> skullIndices;
+    TextModelLoader::TextModel skullModel;
     std::vector<Vertex> vertices;
     std::vector<UINT16> indices;
 
-    LoadSkullModel(skullVertices, skullIndices);
+    // ùһ 16 λ
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../../Models/skull.txt"), skullModel) || skullModel.emIndexFormat != DXGI_FORMAT_R16_UINT)
+    {
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
     UINT k = _countof(roomVertices);
-    vertices.resize(_countof(roomVertices) + skullVertices.size());
+    vertices.resize(_countof(roomVertices) + skullModel.Vertices.size());
     CopyMemory(&vertices[0], roomVertices, sizeof(roomVertices));
-    for(UINT i = 0; i < skullVertices.size(); ++i, ++k)
+    for(UINT i = 0; i < skullModel.Vertices.size(); ++i, ++k)
     {
-        vertices[k].Position = XMFLOAT3(skullVertices[i].Position);
-        vertices[k].Normal = XMFLOAT3(skullVertices[i].Normal);
+        vertices[k].Position = skullModel.Vertices[i].vec3Position;
+        vertices[k].Normal = skullModel.Vertices[i].vec3Normal;
         vertices[k].TexCoords = {0.0, 0.0};
     }
 
-    indices.resize(_countof(roomIndices) + skullIndices.size() * 3);
+    indices.resize(_countof(roomIndices) + skullModel.Indices16.size());
     CopyMemory(&indices[0], roomIndices, sizeof(roomIndices));
-    CopyMemory(&indices[_countof(roomIndices)], &skullIndices[0], 3 * skullIndices.size() * sizeof(UINT16));
+    CopyMemory(&indices[_countof(roomIndices)], &skullModel.Indices16[0], skullModel.Indices16.size() * sizeof(UINT16));
 
     Resource::SubmeshGeometry floor;
     floor.nIndexCount = 6;
@@ -307,7 +292,7 @@ void D3DFrame::BuildGeometries()
     mirror.nBaseVertexLocation = 0;
 
     Resource::SubmeshGeometry skull;
-    skull.nIndexCount = skullIndices.size() * 3;
+    skull.nIndexCount = skullModel.GetIndexCount();
     skull.nStartIndexLocation = _countof(roomIndices);
     skull.nBaseVertexLocation = _countof(roomVertices);
 
@@ -326,7 +311,7 @@ void D3DFrame::BuildGeometries()
     Geo.DrawArgs["wall"] = wall;
     Geo.DrawArgs["mirror"] = mirror;
     Geo.DrawArgs["skull"] = skull;
-
+    return 1;
 }   
 
 void D3DFrame::BuildMaterials()
@@ -571,77 +556,6 @@ void D3DFrame::DrawItems(std::vector<RenderItem>& items)
     }
 }
 
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
-{
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iIndexCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-    vertices.resize(31076);
-    indices.resize(60339);
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    // vertex
-    while(*pBlock++ != '{');
-
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == 31076)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
-
-    while(*pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
-
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iIndexCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iIndexCounter;
-        if(iIndexCounter == 60339)
-            break;
-    }
-    free(pFileBuffer);
-}
-
 void D3DFrame::BuildPipelineStates()
 {
     ComPtr<ID3D12PipelineState> pPipelineState;
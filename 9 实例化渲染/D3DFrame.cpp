@@ -19,7 +19,8 @@ bool D3DFrame::Initialize()
 
 	ThrowIfFailed(pCommandList->Reset(pCommandAllocator.Get(), NULL));
 	LoadTextures();
-	BuildGeometries();
+	if(!BuildGeometries())
+		return 0;
 	BuildMaterials();
 	ThrowIfFailed(pCommandList->Close());
 	
@@ -64,20 +65,20 @@ void D3DFrame::LoadTextures()
     Textures["stone"] = tex;
 }
 
-void D3DFrame::BuildGeometries()
+bool D3DFrame::BuildGeometries()
 {
-    std::vector<SkullModelVertex> skullVertices;
-    std::vector<SkullModelIndex> indices;
-
-    LoadSkullModel(skullVertices, indices);
+    TextModelLoader::TextModel skullModel;
+    if(!TextModelLoader::LoadTextModel(PROJECT_ROOT("/../Models/skull.txt"), skullModel))
+    {
+        MessageBoxW(NULL, L"Cannot load Models/skull.txt", L"Load Failed", MB_OK);
+        return 0;
+    }
 
-    std::vector<Vertex> vertices(skullVertices.size());
+    std::vector<Vertex> vertices(skullModel.Vertices.size());
 
-    XMVECTOR vMin = XMLoadFloat3(&XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
-    XMVECTOR vMax = XMLoadFloat3(&XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
-    for(UINT i = 0; i < (UINT)skullVertices.size(); ++i)
+    for(UINT i = 0; i < (UINT)skullModel.Vertices.size(); ++i)
     {
-        XMVECTOR P = XMLoadFloat3(&XMFLOAT3(skullVertices[i].Position));
+        XMVECTOR P = XMLoadFloat3(&skullModel.Vertices[i].vec3Position);
 
         XMFLOAT3 spherePos;
         XMStoreFloat3(&spherePos, XMVector3Normalize(P));
@@ -93,39 +94,33 @@ void D3DFrame::BuildGeometries()
         float v = phi / XM_PI;
 
         vertices[i].TexCoords = {u, v};
-        vertices[i].Position = XMFLOAT3(skullVertices[i].Position);
-        vertices[i].Normal = XMFLOAT3(skullVertices[i].Normal);
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
+        vertices[i].Position = skullModel.Vertices[i].vec3Position;
+        vertices[i].Normal = skullModel.Vertices[i].vec3Normal;
     }
 
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
-
-
     const UINT vertexBytesSize = (UINT)vertices.size() * sizeof(Vertex);
-    const UINT indexBytesSize = (UINT)indices.size() * sizeof(SkullModelIndex);
+    const UINT indexBytesSize = skullModel.GetIndexByteSize();
 
     Resource::MeshGeometry skull;
     skull.Name = "Skull";
 
-    skull.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &indices[0], indexBytesSize, &skull.pUploaderIndexBuffer);
+    skull.pGPUIndexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), skullModel.GetIndexData(), indexBytesSize, &skull.pUploaderIndexBuffer);
     skull.pGPUVertexBuffer = CreateDefaultBuffer(pD3dDevice.Get(), pCommandList.Get(), &vertices[0], vertexBytesSize, &skull.pUploaderVertexBuffer);
 
     skull.nIndexBufferByteSize = indexBytesSize;
     skull.nVertexBufferByteSize = vertexBytesSize;
     skull.nVertexByteStride = sizeof(Vertex);
+    skull.emIndexFormat = skullModel.emIndexFormat;
 
     Resource::SubmeshGeometry main;
-    main.Bounds = bounds;
+    main.Bounds = skullModel.Bounds;
     main.nBaseVertexLocation = 0;
     main.nStartIndexLocation = 0;
-    main.nIndexCount = (UINT)indices.size() * 3;    
+    main.nIndexCount = skullModel.GetIndexCount();    
 
     skull.DrawArgs["main"] = main;
     Geos["skull"] = skull;
+    return 1;
 }   
 
 void D3DFrame::BuildMaterials()
@@ -237,6 +232,14 @@ void D3DFrame::BuildRenderItems()
     for(UINT i = 0; i < nFrameResourceCount; ++i)
         item.nInstanceIndex = pFrameResources[i].InitInstanceBuffer(pD3dDevice.Get(), sizeof(InstanceData), item.nInstanceTotal);
 
+    // ʵƶ, ռײֻһ
+    FrustumCuller culler;
+    culler.Reserve(item.nInstanceTotal);
+    for(auto& instance: item.InstanceDatas)
+        culler.Add(item.Bounds, XMLoadFloat4x4(&instance.matWorld));
+
+    VisibleInstances.resize(max((UINT)VisibleInstances.size(), item.nInstanceTotal + 3));
+    InstanceCullers.push_back(std::move(culler));
     AllRenderItems.push_back(item);
     RenderItems[RENDER_TYPE_OPEAQUE].push_back(0);
 }
@@ -400,36 +403,28 @@ void D3DFrame::UpdateMaterials(const GameTimer& t)
 
 void D3DFrame::UpdateInstanceDatas(const GameTimer& t)
 {
-    XMMATRIX view = camera.GetView();
-    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-
-    for(auto& e: AllRenderItems)
+    for(UINT n = 0; n < (UINT)AllRenderItems.size(); ++n)
     {
+        auto& e = AllRenderItems[n];
         auto currInstanceBuffer = &pCurrFrameResource->CBInstances[e.nInstanceIndex];
         auto& instanceDatas = e.InstanceDatas;
 
+        // ռƽ޳, ֻпɼʵдʵ
+        UINT nVisible = InstanceCullers[n].Cull(camera, VisibleInstances.data());
+
         e.nInstanceCount = 0;
-        for(UINT i = 0; i < (UINT)instanceDatas.size(); ++i)
+        for(UINT v = 0; v < nVisible; ++v)
         {
+            UINT i = VisibleInstances[v];
             XMMATRIX world = XMLoadFloat4x4(&instanceDatas[i].matWorld);
             XMMATRIX texTransform = XMLoadFloat4x4(&instanceDatas[i].matTexTransform);
 
-            XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
-
-            XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
-
-            BoundingFrustum localSpaceFrustum;
-            cameraFrustum.Transform(localSpaceFrustum, viewToLocal);
-
-            if(localSpaceFrustum.Contains(e.Bounds) != DirectX::DISJOINT)
-            {
-                InstanceData data;
-                XMStoreFloat4x4(&data.matWorld, XMMatrixTranspose(world));
-                XMStoreFloat4x4(&data.matTexTransform, XMMatrixTranspose(texTransform));
-                data.nMaterialIndex = instanceDatas[i].nMaterialIndex;
+            InstanceData data;
+            XMStoreFloat4x4(&data.matWorld, XMMatrixTranspose(world));
+            XMStoreFloat4x4(&data.matTexTransform, XMMatrixTranspose(texTransform));
+            data.nMaterialIndex = instanceDatas[i].nMaterialIndex;
 
-                currInstanceBuffer->CopyData(e.nInstanceCount++, &data, sizeof(InstanceData));
-            }
+            currInstanceBuffer->CopyData(e.nInstanceCount++, &data, sizeof(InstanceData));
         }
     }
 }
@@ -438,12 +433,13 @@ void D3DFrame::UpdateScene(const GameTimer& t)
 {
     Constant::SceneConstant sc;
 	
-    XMMATRIX view = camera.GetView();
-    XMMATRIX proj = camera.GetProj();
-    XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+    const CameraMatrices& matrices = camera.GetMatrices();
+    XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+    XMMATRIX proj = XMLoadFloat4x4(&matrices.matProj);
+    XMMATRIX matInvView = XMLoadFloat4x4(&matrices.matInvView);
+    XMMATRIX matInvProj = XMLoadFloat4x4(&matrices.matInvProj);
+    XMMATRIX matViewProj = XMLoadFloat4x4(&matrices.matViewProj);
+    XMMATRIX matInvViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
     
     XMStoreFloat4x4(&sc.matView, view);
     XMStoreFloat4x4(&sc.matInvView, XMMatrixTranspose(matInvView));
@@ -476,7 +472,6 @@ void D3DFrame::OnResize()
     D3DApp::OnResize();
 
     camera.SetLens( 0.25 * XM_PI, AspectRatio(), 0.1f, 1000.0f);
-    BoundingFrustum::CreateFromMatrix(cameraFrustum, camera.GetProj());
 }
 
 void D3DFrame::InputProcess(const GameTimer& t)
@@ -588,74 +583,3 @@ void D3DFrame::DrawItems(ID3D12GraphicsCommandList* list, std::vector<UINT>& ite
         list->DrawIndexedInstanced(item.nIndexCount, item.nInstanceCount, item.nStartIndexLocation, item.nBaseVertexLocation, 0);
     }
 }
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices)
-{
-    HANDLE hFile;
-    UINT iFileLength;
-    char* pFileBuffer;
-    char* pBegin, *pEnd, *pBlock;
-    UINT iVertexCounter = 0, iIndexCounter = 0;
-    UINT j;
-
-//****** Read File
-    if((hFile = CreateFileA("C:/Users/Administrator.PC-20191006TRUC/source/repos/DirectX/Models/skull.txt", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
-        return;
-    
-    iFileLength = GetFileSize(hFile, NULL);
-
-    pFileBuffer = (char*)malloc(iFileLength + 2);
-    ReadFile(hFile, pFileBuffer, iFileLength, NULL, NULL);
-    CloseHandle(hFile);
-    pFileBuffer[iFileLength] = '\0';
-    pFileBuffer[iFileLength + 1] = '\0';
-
-    vertices.resize(31076);
-    indices.resize(60339);
-//****** Load Data
-    pBlock = pFileBuffer;
-
-    // vertex
-    while(*pBlock++ != '{');
-
-    while(*pBlock != '}' || *pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9') || *pBlock == '-')){++pBlock;}
-        // һĬ 6 
-        for(j = 0; j < 6; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            vertices[iVertexCounter].v[j] = atof(pBegin);
-        }
-        ++iVertexCounter;
-        if(iVertexCounter == 31076)
-            break;
-    }
-
-    // indices
-    while(*pBlock++ != '{');
-
-    while(*pBlock)
-    {
-        while(!((*pBlock >= '0' && *pBlock <= '9'))){++pBlock;}
-
-        for(j = 0; j < 3; ++j)
-        {
-            pBegin = pBlock;
-            while(((*pBlock != ' ') && (*pBlock != '\r'))){++pBlock;}
-            pEnd = pBlock++;      // ' '
-            *pEnd = '\0';
-
-            indices[iIndexCounter].i[j] = atoi(pBegin);
-        }
-        
-        ++iIndexCounter;
-        if(iIndexCounter == 60339)
-            break;
-    }
-    free(pFileBuffer);
-}
@@ -1,6 +1,9 @@
 #pragma once
 #include <D3DApp.h>
 #include <Camera.h>
+#include <D3DHelper_FrustumCulling.h>
+#include <TextModelLoader.h>
+#include "project.h"
 
 #define USE_FRAMERESOURCE           // ĬϿ֡Դ
 using namespace Microsoft::WRL;
@@ -12,27 +15,6 @@ using namespace DirectX;
 #define RANDF(a, b) a + ((float)(rand()) / (float)RAND_MAX) * (b - a)
 
 
-union SkullModelVertex
-{
-    float v[6];
-    struct
-    {
-        float Position[3];
-        float Normal[3];
-    };
-};
-
-union SkullModelIndex
-{
-    UINT16 i[3];
-    struct
-    {
-        UINT16 first;
-        UINT16 second;
-        UINT16 thrid;
-    };
-};
-
 struct Vertex
 {
     XMFLOAT3 Position;
@@ -66,7 +48,7 @@ protected:
 
     void LoadTextures();
     void BuildMaterials();
-    void BuildGeometries();
+    bool BuildGeometries();
     void BuildRenderItems();
     void BuildSRV();
     void BuildRootSignatures();
@@ -90,7 +72,6 @@ private:
 
 	Camera camera;
 
-    DirectX::BoundingFrustum cameraFrustum;
+    std::vector<FrustumCuller> InstanceCullers;     //  AllRenderItems һһӦ, Ÿʵռײ
+    std::vector<UINT> VisibleInstances;             // ޳
 };
-
-void LoadSkullModel(std::vector<SkullModelVertex>& vertices, std::vector<SkullModelIndex>& indices);
@@ -10,6 +10,7 @@
 #include "BaseHelper_Memory.h"
 #include "BaseHelper_File.h"
 #include "BaseHelper_Thread.h"
+#include "BaseHelper_AssetCache.h"
 
 extern "C" {
 #include "c_vector.h"
@@ -0,0 +1,148 @@
+#include "BaseHelper_AssetCache.h"
+
+using namespace BaseHelper;
+
+#define ASSET_CACHE_MAGIC 0x43414144	// "DAAC"
+#define ASSET_CACHE_VERSION 1
+
+#define ASSET_KEY_SEED_HIGH 0x6A09E667F3BCC908ULL
+#define ASSET_KEY_SEED_LOW 0xBB67AE8584CAA73BULL
+
+struct AssetCacheHeader
+{
+	DWORD dwMagic;
+	DWORD dwVersion;
+	AssetKey Key;
+	UINT64 nByteSize;
+	UINT64 nChecksum;				// 内容的 xxHash64
+};
+
+std::wstring AssetKey::ToString() const
+{
+	WCHAR buffer[33];
+	swprintf_s(buffer, 33, L"%016llx%016llx", (unsigned long long)nHigh, (unsigned long long)nLow);
+	return buffer;
+}
+
+AssetKeyBuilder::AssetKeyBuilder(LPCSTR lpszProcess, UINT nVersion)
+{
+	xxhash64_reset(&StateHigh, ASSET_KEY_SEED_HIGH);
+	xxhash64_reset(&StateLow, ASSET_KEY_SEED_LOW);
+
+	Append(lpszProcess, strlen(lpszProcess));
+	AppendValue(nVersion);
+}
+
+AssetKeyBuilder& AssetKeyBuilder::Append(const void* pData, size_t nByteSize)
+{
+	UINT64 nSize = nByteSize;
+	xxhash64_update(&StateHigh, &nSize, sizeof(nSize));
+	xxhash64_update(&StateLow, &nSize, sizeof(nSize));
+
+	if(nByteSize)
+	{
+		xxhash64_update(&StateHigh, pData, nByteSize);
+		xxhash64_update(&StateLow, pData, nByteSize);
+	}
+	return *this;
+}
+
+bool AssetKeyBuilder::AppendFile(PATH lpszFileName)
+{
+	FILE_HANDLE hFile = CreateFileW(lpszFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return 0;
+
+	void* pBuffer = NULL;
+	DWORD dwReadByteSize = 0;
+	bool bResult = File::Read(hFile, &pBuffer, &dwReadByteSize);
+	CloseHandle(hFile);
+
+	if(bResult)
+		Append(pBuffer, dwReadByteSize);
+	if(pBuffer)
+		BASE_MFREE(pBuffer);
+	return bResult;
+}
+
+AssetKey AssetKeyBuilder::GetKey() const
+{
+	return { xxhash64_digest(&StateHigh), xxhash64_digest(&StateLow) };
+}
+
+AssetCache::AssetCache(PATH lpszDirectory): Directory(lpszDirectory)
+{
+	if(!Directory.empty() && Directory.back() != L'/' && Directory.back() != L'\\')
+		Directory += L'/';
+
+	CreateDirectoryW(Directory.c_str(), NULL);
+}
+
+std::wstring AssetCache::GetEntryPath(const AssetKey& key) const
+{
+	return Directory + key.ToString() + L".bin";
+}
+
+bool AssetCache::Load(const AssetKey& key, std::vector<BYTE>& data)
+{
+	FILE_HANDLE hFile = CreateFileW(GetEntryPath(key).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+	{
+		++nMissCount;
+		return 0;
+	}
+
+	AssetCacheHeader header;
+	DWORD dwReadByteSize = 0;
+	bool bResult = File::ReadToBuffer(hFile, &header, sizeof(header), &dwReadByteSize) && dwReadByteSize == sizeof(header)
+				&& header.dwMagic == ASSET_CACHE_MAGIC && header.dwVersion == ASSET_CACHE_VERSION && header.Key == key
+				&& header.nByteSize == GetFileSize(hFile, NULL) - sizeof(header);
+
+	if(bResult)
+	{
+		data.resize((size_t)header.nByteSize);
+		bResult = (!header.nByteSize || (File::ReadToBuffer(hFile, data.data(), (DWORD)header.nByteSize, &dwReadByteSize) && dwReadByteSize == header.nByteSize))
+				&& xxhash64(data.data(), data.size(), 0) == header.nChecksum;
+	}
+	CloseHandle(hFile);
+
+	if(!bResult)
+	{
+		OutputDebugStringW((L"AssetCache: discard invalid entry " + key.ToString() + L"\n").c_str());
+		data.clear();
+		++nMissCount;
+		return 0;
+	}
+
+	++nHitCount;
+	return 1;
+}
+
+bool AssetCache::Store(const AssetKey& key, const void* pData, size_t nByteSize)
+{
+	std::wstring path = GetEntryPath(key);
+	std::wstring temp = path + L".tmp";
+
+	FILE_HANDLE hFile = File::OpenFile(temp.c_str(), File::FILE_METHOD_CREATE_ALWAYS);
+	if(!hFile)
+		return 0;
+
+	AssetCacheHeader header;
+	header.dwMagic = ASSET_CACHE_MAGIC;
+	header.dwVersion = ASSET_CACHE_VERSION;
+	header.Key = key;
+	header.nByteSize = nByteSize;
+	header.nChecksum = xxhash64(pData, nByteSize, 0);
+
+	DWORD dwWrittenByteSize = 0;
+	bool bResult = File::Write(hFile, &header, sizeof(header), &dwWrittenByteSize) && dwWrittenByteSize == sizeof(header)
+				&& (!nByteSize || (File::Write(hFile, (void*)pData, (DWORD)nByteSize, &dwWrittenByteSize) && dwWrittenByteSize == nByteSize));
+	CloseHandle(hFile);
+
+	if(!bResult || !MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(temp.c_str());
+		return 0;
+	}
+	return 1;
+}
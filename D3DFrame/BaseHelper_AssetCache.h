@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include "Base.h"
+#include "BaseHelper_File.h"
+
+extern "C" {
+#include "c_hash.h"
+}
+
+namespace BaseHelper
+{
+	/// @brief 派生资源的缓存键(128 位)
+	struct AssetKey
+	{
+		UINT64 nHigh;
+		UINT64 nLow;
+
+		bool operator==(const AssetKey& key) const { return nHigh == key.nHigh && nLow == key.nLow; }
+		bool operator!=(const AssetKey& key) const { return !(*this == key); }
+
+		/// @brief 32 位十六进制字符串, 用作缓存文件名
+		std::wstring ToString() const;
+	};
+
+	/// @brief 缓存键生成器
+	/// 以两个不同种子的 xxHash64 同时处理输入, 拼接为 128 位; 每段数据都会连同其长度一起参与计算,
+	/// 因此 Append("ab") Append("c") 与 Append("a") Append("bc") 得到不同的键
+	class AssetKeyBuilder
+	{
+	public:
+		/// @param lpszProcess 	处理步骤名, 不同步骤的输出互不混淆
+		/// @param nVersion 	处理步骤的版本; 修改了转换算法或输出格式后递增, 旧缓存即自动失效
+		AssetKeyBuilder(LPCSTR lpszProcess, UINT nVersion);
+
+		/// @brief 追加输入数据或处理参数
+		AssetKeyBuilder& Append(const void* pData, size_t nByteSize);
+
+		template<typename T>
+		AssetKeyBuilder& AppendValue(const T& value) { return Append(&value, sizeof(T)); }
+
+		/// @brief 追加磁盘文件的全部内容
+		/// @return 文件无法读取时返回 0, 此时不应使用该键
+		bool AppendFile(PATH lpszFileName);
+
+		AssetKey GetKey() const;
+
+	private:
+		C_HASH_XXH64_STATE StateHigh;
+		C_HASH_XXH64_STATE StateLow;
+	};
+
+	/// @brief 派生资源磁盘缓存
+	/// 模型文本转二进制、网格优化、Mip 生成等转换步骤以 "输入数据 + 处理参数" 的哈希作为键保存结果,
+	/// 下次启动或只修改了其它资源时直接读取结果, 跳过转换.
+	/// 每个条目为 <目录>/<键>.bin, 文件头记录键、长度与内容校验值; 读取时任一项不符即视为未命中
+	class AssetCache
+	{
+	public:
+		/// @param lpszDirectory 缓存目录, 不存在时自动创建
+		AssetCache(PATH lpszDirectory);
+
+		/// @brief 读取缓存
+		/// @return 命中返回 1
+		bool Load(const AssetKey& key, std::vector<BYTE>& data);
+
+		/// @brief 写入缓存; 先写临时文件再替换, 中途失败不会留下不完整的条目
+		/// @return 写入失败(磁盘只读等)返回 0, 不影响调用方继续使用 pData
+		bool Store(const AssetKey& key, const void* pData, size_t nByteSize);
+
+		/// @brief 读取缓存, 未命中时调用 build 生成数据并写入缓存
+		/// @param build 	bool(std::vector<BYTE>&), 返回 0 表示转换失败, 此时不写入缓存
+		/// @return 		data 是否有效
+		template<typename BuildFunc>
+		bool LoadOrBuild(const AssetKey& key, std::vector<BYTE>& data, BuildFunc build)
+		{
+			if(Load(key, data))
+				return 1;
+
+			data.clear();
+			if(!build(data))
+				return 0;
+
+			Store(key, data.data(), data.size());
+			return 1;
+		}
+
+		UINT GetHitCount() const { return nHitCount; }
+		UINT GetMissCount() const { return nMissCount; }
+
+	private:
+		std::wstring GetEntryPath(const AssetKey& key) const;
+
+		std::wstring Directory;
+		UINT nHitCount = 0;
+		UINT nMissCount = 0;
+	};
+};
@@ -1,8 +1,101 @@
 #include "BaseHelper_Scanner.h"
 #include "BaseHelper_Memory.h"
+#include <math.h>
 
 using namespace BaseHelper;
 
+//***************************
+// Number Parsing
+// 数值直接在缓冲区上解析, 不再经过 atoi / atof, 也不需要临时写入 '\0'
+
+static const double Pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// 跳过数值之前的无关字符; 到达缓冲区末尾时停在 '\0' 上
+static LPSTR SkipToNumber(LPSTR p)
+{
+    while(*p && !(BASE_IsDigit(*p) || (*p == '-' && BASE_IsDigit(*(p + 1))))) ++p;
+    return p;
+}
+
+static LPSTR ParseInteger(LPSTR p, INT64& value)
+{
+    bool bNegative = *p == '-';
+    UINT64 v = 0;
+
+    if(bNegative)
+        ++p;
+    while(BASE_IsDigit(*p))
+        v = v * 10 + (*p++ - '0');
+
+    value = bNegative? -(INT64)v: (INT64)v;
+    return p;
+}
+
+// 尾数最多保留 19 位有效数字, 结果与 atof 的差异在 1 ulp 以内
+static LPSTR ParseFloat(LPSTR p, double& value)
+{
+    bool bNegative = *p == '-';
+    UINT64 mantissa = 0;
+    int nDigits = 0, iExp10 = 0;
+
+    if(bNegative)
+        ++p;
+
+    for(; BASE_IsDigit(*p); ++p)
+    {
+        if(nDigits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa)
+                ++nDigits;
+        }
+        else
+            ++iExp10;
+    }
+
+    if(*p == '.')
+    {
+        for(++p; BASE_IsDigit(*p); ++p)
+        {
+            if(nDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa)
+                    ++nDigits;
+                --iExp10;
+            }
+        }
+    }
+
+    if((*p == 'e' || *p == 'E') &&
+       (BASE_IsDigit(*(p + 1)) || ((*(p + 1) == '-' || *(p + 1) == '+') && BASE_IsDigit(*(p + 2)))))
+    {
+        bool bNegativeExp = *++p == '-';
+        int e = 0;
+
+        if(*p == '-' || *p == '+')
+            ++p;
+        for(; BASE_IsDigit(*p); ++p)
+        {
+            if(e < 10000)
+                e = e * 10 + (*p - '0');
+        }
+        iExp10 += bNegativeExp? -e: e;
+    }
+
+    double v = (double)mantissa;
+    if(iExp10 < 0)
+        v = iExp10 >= -22? v / Pow10[-iExp10]: v * pow(10.0, iExp10);
+    else if(iExp10 > 0)
+        v = iExp10 <= 22? v * Pow10[iExp10]: v * pow(10.0, iExp10);
+
+    value = bNegative? -v: v;
+    return p;
+}
+
 ScannerA::ScannerA()
 {}
 
@@ -10,6 +103,7 @@ ScannerA::ScannerA(const ScannerA& scanner)
 {
     lpszBuffer = scanner.lpszBuffer;
     lpScanner = scanner.lpScanner;
+    bEnd = scanner.bEnd;
 }
 
 ScannerA::ScannerA(LPSTR buffer)
@@ -27,6 +121,7 @@ ScannerA& ScannerA::operator=(const ScannerA& scanner)
 {
     lpszBuffer = scanner.lpszBuffer;
     lpScanner = scanner.lpScanner;
+    bEnd = scanner.bEnd;
 
     return *this;
 }
@@ -35,10 +130,17 @@ ScannerA& ScannerA::operator=(LPSTR buffer)
 {
     lpszBuffer = buffer;
     lpScanner = lpszBuffer;
+    bEnd = 0;
 
     return *this;
 }
 
+// 读取数值时遇到缓冲区末尾(没有可读的数值, 结果为 0)后置位, 直到重新设置缓冲区
+bool ScannerA::IsEnd() const
+{
+    return bEnd;
+}
+
 ScannerA& ScannerA::operator=(LPCSTR buffer)
 {
     return operator=((LPSTR)buffer);
@@ -70,37 +172,19 @@ ScannerA& ScannerA::operator>>(INT16& inum)
 
 ScannerA& ScannerA::operator>>(INT32& inum)
 {
-    LPSTR pBegin;
-    char r;
-    
-    while(!(BASE_IsDigit(*lpScanner) ||
-          (*lpScanner == '-' && BASE_IsDigit(*(lpScanner + 1))))) ++lpScanner;
-    pBegin = lpScanner++;
-    while(BASE_IsDigit(*lpScanner)) ++lpScanner;
-    r = *lpScanner;
-    *lpScanner = '\0';
-
-    inum = atoi(pBegin);
-
-    *lpScanner++ = r;
+    INT64 i;
+    operator>>(i);
+    inum = (INT32)i;
     return *this;
 }
 
 ScannerA& ScannerA::operator>>(INT64& inum)
 {
-    LPSTR pBegin;
-    char r;
-    
-    while(!(BASE_IsDigit(*lpScanner) ||
-          (*lpScanner == '-' && BASE_IsDigit(*(lpScanner + 1))))) ++lpScanner;
-    pBegin = lpScanner++;
-    while(BASE_IsDigit(*lpScanner)) ++lpScanner;
-    r = *lpScanner;
-    *lpScanner = '\0';
-
-    inum = _atoi64(pBegin);
-
-    *lpScanner++ = r;
+    lpScanner = SkipToNumber(lpScanner);
+    bEnd |= !*lpScanner;
+    lpScanner = ParseInteger(lpScanner, inum);
+    if(*lpScanner)
+        ++lpScanner;
     return *this;
 }
 
@@ -138,30 +222,14 @@ ScannerA& ScannerA::operator>>(UINT64& uinum)
 
 ScannerA& ScannerA::operator>>(float& fnum)
 {
-    LPSTR pBegin;
-    bool bPoint = 0;
-    char r;
-    
-    while(!(BASE_IsDigit(*lpScanner) ||
-          (*lpScanner == '-' && BASE_IsDigit(*(lpScanner + 1))))) ++lpScanner;
-        
-    pBegin = lpScanner++;
-    while(1)
-    {
-        if(*lpScanner == '.' && !bPoint)
-            bPoint = 1;
-        else if(!BASE_IsDigit(*lpScanner) &&
-           *lpScanner != 'E' && *lpScanner != 'e' &&
-           *lpScanner != '+' && *lpScanner != '-')
-            break;
+    double d;
+    lpScanner = SkipToNumber(lpScanner);
+    bEnd |= !*lpScanner;
+    lpScanner = ParseFloat(lpScanner, d);
+    if(*lpScanner)
         ++lpScanner;
-    }
-    r = *lpScanner;
-    *lpScanner = '\0';
-    
-    fnum = atof(pBegin);
 
-    *lpScanner++ = r;
+    fnum = (float)d;
     return *this;   
 }
 
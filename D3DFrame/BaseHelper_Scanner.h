@@ -31,9 +31,12 @@ namespace BaseHelper
 
         ScannerA& operator()(char);
 
+        bool IsEnd() const;
+
     private:
         LPSTR lpszBuffer = NULL;
         LPSTR lpScanner = NULL;
+        bool bEnd = 0;
 
         UINT CodePage = CP_ACP;
     };
@@ -1,7 +1,49 @@
 #include "BaseHelper_Thread.h"
+#include <atomic>
 
 using namespace BaseHelper::Thread;
 
+namespace
+{
+    struct ParallelRange
+    {
+        THREAD_RANGE_CALLBACK Callback;
+        void* Param;
+        UINT nCount;
+        UINT nGrain;
+        UINT nChunkCount;
+
+        std::atomic<UINT> nNextChunk;
+        std::atomic<UINT> nDoneChunk;
+        std::atomic<UINT> nRef;             // ύ + ߳; һͷ߸ɾ
+    };
+
+    void ProcessRange(ParallelRange* pRange)
+    {
+        UINT nChunk;
+        while((nChunk = pRange->nNextChunk.fetch_add(1, std::memory_order_relaxed)) < pRange->nChunkCount)
+        {
+            UINT nBegin = nChunk * pRange->nGrain;
+            UINT nEnd = nBegin + pRange->nGrain < pRange->nCount? nBegin + pRange->nGrain: pRange->nCount;
+            pRange->Callback(pRange->Param, nBegin, nEnd);
+            pRange->nDoneChunk.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void ReleaseRange(ParallelRange* pRange)
+    {
+        if(pRange->nRef.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete pRange;
+    }
+
+    void CALLBACK ParallelRangeCallback(ThreadPool* pool, void* param)
+    {
+        ParallelRange* pRange = (ParallelRange*)param;
+        ProcessRange(pRange);
+        ReleaseRange(pRange);
+    }
+}
+
 DWORD WINAPI ThreadPool::ThreadProc(void* param)
 {
     THREAD* thread = (THREAD*)param;
@@ -13,31 +55,35 @@ DWORD WINAPI ThreadPool::ThreadProc(void* param)
     while(1)
     {
         pool->EnterPoolSection();
-        while(pool->Tasks.size() == 0)
+        // λ ThreadPoolTaskNoEmpty  CommitThreadTask е SetEvent ڽ, ᶪʧ
+        while(pool->Tasks.size() == 0 && !thread->bDestory)
         {
             SetEvent(pool->ThreadPoolTaskEmpty);
             ResetEvent(pool->ThreadPoolTaskNoEmpty);
             pool->ExitPoolSection();
-            if(thread->bDestory)
-                break;
             WaitForSingleObject(pool->ThreadPoolTaskNoEmpty, INFINITE);
             pool->EnterPoolSection();
         }
 
         if(thread->bDestory)
+        {
+            pool->ExitPoolSection();
             break;
+        }
 
         ThreadTask task = pool->Tasks.front();
         pool->Tasks.pop();
         
         ++pool->WorkingThreadCount;
-        
-        pool->ExitPoolSection();
+
+        // SignalObjects  CommitThreadTask , д
+        THREAD_EVENT event = pool->Events[thread->threadId];
+        ResetEvent(event);
 		pool->SignalObjects[task.SignalObject] = thread->threadId;
+        pool->ExitPoolSection();
 		
-		ResetEvent(pool->Events[thread->threadId]);
         task.Callback(pool, task.Param);
-		SetEvent(pool->Events[thread->threadId]);
+		SetEvent(event);
 		
         pool->EnterPoolSection();
         --pool->WorkingThreadCount;
@@ -59,6 +105,8 @@ ThreadPool::ThreadPool(UINT threadCount)
     ThreadPoolTaskNoEmpty = CreateEvent(NULL, 1, 0, NULL);
     ThreadPoolTaskEmpty = CreateEvent(NULL, 1, 1, NULL);
 
+    // ߳: ߳ Events д֮ǰͣ ThreadProc ͷ
+    EnterPoolSection();
     for(UINT i = 0; i < ThreadCount; ++i)
     {
         Threads[i].pool = this;
@@ -67,19 +115,42 @@ ThreadPool::ThreadPool(UINT threadCount)
 		THREAD_EVENT event = CreateEvent(NULL, 0, 0, NULL);
 		Events[Threads[i].threadId] = event;
     }
+    ExitPoolSection();
+
+    // ȴ߳̾, ֤ʱ RunningThreadCount ܷӳʵ߳
+    while(1)
+    {
+        EnterPoolSection();
+        UINT nRunning = RunningThreadCount;
+        ExitPoolSection();
+        if(nRunning == ThreadCount)
+            break;
+        Sleep(0);
+    }
 }
 
 ThreadPool::~ThreadPool()
 {
     std::queue<ThreadTask> empty;
+
+    EnterPoolSection();
     std::swap(empty, Tasks);
 
     for(UINT i = 0; i < ThreadCount; ++i)
         Threads[i].bDestory = 1;
     
-    SetEvent(ThreadPoolTaskNoEmpty);        // ̶߳ڵȴ
+    SetEvent(ThreadPoolTaskNoEmpty);        // ѵȴ߳
+    ExitPoolSection();
     
-    while(RunningThreadCount != 0);
+    while(1)
+    {
+        EnterPoolSection();
+        UINT nRunning = RunningThreadCount;
+        ExitPoolSection();
+        if(nRunning == 0)
+            break;
+        Sleep(0);
+    }
 
     for(UINT i = 0; i < ThreadCount; ++i)
         TerminateThread(Threads[i].hThread, 0);
@@ -95,15 +166,18 @@ ThreadPool::~ThreadPool()
 
 UINT ThreadPool::CommitThreadTask(ThreadTask task)
 {
+    EnterPoolSection();
 	task.SignalObject = SignalCounter++;
+	if(SignalCounter >= THREAD_DEF_SIGNALOBJECT_COUNT)
+		SignalCounter = 0;
+
+	// ȵǼźŶ; ߳д߳ ID ܱ︲Ϊ 0
+	SignalObjects[task.SignalObject] = 0;
     Tasks.push(task);
     SetEvent(ThreadPoolTaskNoEmpty);
     ResetEvent(ThreadPoolTaskEmpty);
+    ExitPoolSection();
 
-	if(SignalCounter >= THREAD_DEF_SIGNALOBJECT_COUNT)
-		SignalCounter = 0;
-	
-	SignalObjects[task.SignalObject] = 0;
 	return task.SignalObject;
 }
 
@@ -119,7 +193,15 @@ void ThreadPool::ExitPoolSection()
 
 void ThreadPool::WaitForTaskComplete()
 {
-    while(WorkingThreadCount != 0 || Tasks.size() != 0);
+    while(1)
+    {
+        EnterPoolSection();
+        bool bComplete = WorkingThreadCount == 0 && Tasks.size() == 0;
+        ExitPoolSection();
+        if(bComplete)
+            break;
+        Sleep(0);
+    }
 }
 
 ThreadPool* ThreadPool::GetInstance(UINT threadCount)
@@ -130,8 +212,53 @@ ThreadPool* ThreadPool::GetInstance(UINT threadCount)
 
 void ThreadPool::WaitForSignalObject(UINT signalObj)
 {
-	while(SignalObjects[signalObj] == 0)
+	THREAD_EVENT event;
+	while(1)
+	{
+        EnterPoolSection();
+        DWORD threadId = SignalObjects[signalObj];
+        event = threadId? Events[threadId]: NULL;
+        ExitPoolSection();
+        if(threadId)
+            break;
         Sleep(1000);                // õȴ߳
+	}
     
-    WaitForSingleObject(Events[SignalObjects[signalObj]], 1000);
-}
\ No newline at end of file
+    WaitForSingleObject(event, 1000);
+}
+
+void ThreadPool::ParallelFor(UINT nCount, UINT nGrain, THREAD_RANGE_CALLBACK callback, void* param)
+{
+    if(!nCount)
+        return;
+    if(!nGrain)
+        nGrain = 1;
+
+    UINT nChunkCount = (nCount + nGrain - 1) / nGrain;
+    UINT nTaskCount = ThreadCount < nChunkCount - 1? ThreadCount: nChunkCount - 1;
+    if(!nTaskCount)
+    {
+        callback(param, 0, nCount);
+        return;
+    }
+
+    // п֮ű߳ȡ, ˷ڶϲüͷ, ̲߳صȴ˳
+    ParallelRange* pRange = new ParallelRange;
+    pRange->Callback = callback;
+    pRange->Param = param;
+    pRange->nCount = nCount;
+    pRange->nGrain = nGrain;
+    pRange->nChunkCount = nChunkCount;
+    pRange->nNextChunk = 0;
+    pRange->nDoneChunk = 0;
+    pRange->nRef = nTaskCount + 1;
+
+    for(UINT i = 0; i < nTaskCount; ++i)
+        CommitThreadTask(ThreadTask(ParallelRangeCallback, pRange));
+
+    ProcessRange(pRange);
+    while(pRange->nDoneChunk.load(std::memory_order_acquire) < nChunkCount)
+        Sleep(0);
+
+    ReleaseRange(pRange);
+}
@@ -14,6 +14,7 @@ namespace BaseHelper
 		class ThreadPool;
 		
 		typedef void (CALLBACK *THREAD_CALLBACK)(ThreadPool* pool, void* param);
+		typedef void (CALLBACK *THREAD_RANGE_CALLBACK)(void* param, UINT nBegin, UINT nEnd);
 
 		struct ThreadTask
 		{
@@ -59,6 +60,13 @@ namespace BaseHelper
 			// ȴ̳߳
 			void WaitForTaskComplete();
 
+			// ߳
+			UINT GetThreadCount() const { return ThreadCount; }
+
+			//  [0, nCount)  nGrain ֿ齻̴߳, ߳ͬ; ʱпѴ
+			// ͨԭӼȡ, ֻһʱѹ߳. callback ڶ߳ͬʱִ
+			void ParallelFor(UINT nCount, UINT nGrain, THREAD_RANGE_CALLBACK callback, void* param);
+
 			// ṩģ߳ӿ
 			void WaitForSignalObject(UINT signalObj);
 			
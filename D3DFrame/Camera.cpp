@@ -2,7 +2,11 @@
 
 using namespace DirectX;
 
-Camera::Camera() {}
+Camera::Camera()
+{
+	XMStoreFloat4x4(&matView, XMMatrixIdentity());
+	XMStoreFloat4x4(&matProj, XMMatrixIdentity());
+}
 Camera::~Camera() {}
 
 void Camera::LookAt(FXMVECTOR pos, FXMVECTOR target, FXMVECTOR worldUp)
@@ -38,6 +42,12 @@ void Camera::SetLens(float fovY, float aspect, float nearZ, float farZ)
 
 	XMMATRIX P = XMMatrixPerspectiveFovLH(fFovY, fAspect, fNearZ, fFarZ);
 	XMStoreFloat4x4(&matProj, P);
+
+	BoundingFrustum::CreateFromMatrix(Matrices.ViewFrustum, P);
+
+	// 视图待更新时 matView 与基向量尚不一致, 留给 UpdateViewMatrix 重建
+	if(!bViewDirty)
+		UpdateMatrices();
 }
 
 void Camera::Walk(float d)
@@ -133,9 +143,49 @@ void Camera::UpdateViewMatrix()
 		matView(3, 3) = 1.0f;
 
 		bViewDirty = 0;
+		UpdateMatrices();
 	}
 }
 
+void Camera::UpdateMatrices()
+{
+	Matrices.matView = matView;
+	Matrices.matProj = matProj;
+
+	// 视图矩阵是正交基加平移, 逆矩阵的前三行即为基向量, 最后一行为摄像机位置
+	XMMATRIX invView(
+		vec3Right.x, vec3Right.y, vec3Right.z, 0.0f,
+		vec3Up.x, vec3Up.y, vec3Up.z, 0.0f,
+		vec3Look.x, vec3Look.y, vec3Look.z, 0.0f,
+		vec3Position.x, vec3Position.y, vec3Position.z, 1.0f);
+
+	// XMMatrixPerspectiveFovLH: x' = x * sx, y' = y * sy, z' = z * a + b, w' = z
+	float sx = matProj(0, 0), sy = matProj(1, 1), a = matProj(2, 2), b = matProj(3, 2);
+	XMMATRIX invProj(
+		1.0f / sx, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f / sy, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f / b,
+		0.0f, 0.0f, 1.0f, -a / b);
+
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&matView), XMLoadFloat4x4(&matProj));
+	XMStoreFloat4x4(&Matrices.matInvView, invView);
+	XMStoreFloat4x4(&Matrices.matInvProj, invProj);
+	XMStoreFloat4x4(&Matrices.matViewProj, viewProj);
+	XMStoreFloat4x4(&Matrices.matInvViewProj, XMMatrixMultiply(invProj, invView));
+
+	// 从 viewProj 的列提取裁剪平面(D3D 的 z 范围为 [0, w])
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+	XMVECTOR planes[6] = {
+		columns.r[3] + columns.r[0], columns.r[3] - columns.r[0],
+		columns.r[3] + columns.r[1], columns.r[3] - columns.r[1],
+		columns.r[2], columns.r[3] - columns.r[2]
+	};
+	for(UINT i = 0; i < 6; ++i)
+		XMStoreFloat4(&Matrices.vec4FrustumPlanes[i], XMPlaneNormalize(planes[i]));
+
+	Matrices.ViewFrustum.Transform(Matrices.WorldFrustum, invView);
+}
+
 bool Camera::GetViewDirty() const
 {
 	return bViewDirty;
@@ -151,6 +201,18 @@ XMFLOAT3 Camera::GetPosition3f() const
 	return vec3Position;
 }
 
+void Camera::SetPosition(float x, float y, float z)
+{
+	vec3Position = {x, y, z};
+	bViewDirty = 1;
+}
+
+void Camera::SetPosition3f(const XMFLOAT3& v)
+{
+	vec3Position = v;
+	bViewDirty = 1;
+}
+
 XMVECTOR Camera::GetRight() const
 {
 	return XMLoadFloat3(&vec3Right);
@@ -216,6 +278,16 @@ XMFLOAT4X4 Camera::GetView4x4f() const
 	return matView;
 }
 
+const CameraMatrices& Camera::GetMatrices() const
+{
+	return Matrices;
+}
+
+float Camera::GetFovY() const
+{
+	return fFovY;
+}
+
 float Camera::GetFovX() const
 {
 	float halfWidth = 0.5f * GetNearWindowWidth();
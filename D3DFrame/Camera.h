@@ -1,6 +1,20 @@
 #pragma once
 #include <D3DBase.h>
 
+// 由视图矩阵与投影矩阵派生的数据; 在 UpdateViewMatrix(视图改变时)与 SetLens(视图已更新时)中重建, 每帧直接读取
+struct CameraMatrices
+{
+    DirectX::XMFLOAT4X4 matView;
+    DirectX::XMFLOAT4X4 matInvView;             // 刚体变换的解析逆
+    DirectX::XMFLOAT4X4 matProj;
+    DirectX::XMFLOAT4X4 matInvProj;             // 透视投影的解析逆
+    DirectX::XMFLOAT4X4 matViewProj;
+    DirectX::XMFLOAT4X4 matInvViewProj;         // matInvProj * matInvView
+    DirectX::XMFLOAT4 vec4FrustumPlanes[6];     // 世界空间视锥体平面(左, 右, 下, 上, 近, 远); xyz 为指向内侧的单位法线, dot(xyz, p) + w < 0 时 p 在外侧
+    DirectX::BoundingFrustum ViewFrustum;       // 视图空间视锥体
+    DirectX::BoundingFrustum WorldFrustum;      // 世界空间视锥体
+};
+
 class Camera
 {
 public:
@@ -43,6 +57,8 @@ public:
     DirectX::XMFLOAT4X4 GetView4x4f() const;
     DirectX::XMFLOAT4X4 GetProj4x4f() const;
 
+    const CameraMatrices& GetMatrices() const;
+
     void Strafe(float d);
     void Walk(float d);
 
@@ -60,8 +76,12 @@ private:
 
     float fNearZ = 0.0f, fFarZ = 0.0f, fAspect = 0.0f, fFovY = 0.0f, fNearWindowHeight = 0.0f, fFarWindowHeight = 0.0f;
 
-    bool bViewDirty;
+    bool bViewDirty = 1;
 
     DirectX::XMFLOAT4X4 matView;
     DirectX::XMFLOAT4X4 matProj;
+
+    CameraMatrices Matrices;
+
+    void UpdateMatrices();
 };
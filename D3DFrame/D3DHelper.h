@@ -15,6 +15,10 @@
 #include "D3DHelper_Resource.h"
 #include "D3DHelper_Math.h"
 #include "D3DHelper_Animation.h"
+#include "D3DHelper_PoseCache.h"
+#include "D3DHelper_SkinnedBatch.h"
+#include "D3DHelper_Skinning.h"
+#include "D3DHelper_MeshSimplifier.h"
 
 namespace D3DHelper
 {
@@ -60,19 +64,54 @@ namespace D3DHelper
 	{	
 		Animation::SkinnedAnimation* Skinned;			// 所使用的蒙皮动画
 		std::vector<DirectX::XMFLOAT4X4> matFinalTransforms;	// 存储着 UpdateSkinnedAnimation 执行后的结果 
-		std::string ClipName;									// 动画片段名; 可以通过更改该值以达到切换动画片段的效果
+		std::string ClipName;									// 动画片段名; 切换片段应调用 PlayClip, 直接修改该值后需将 Clip 复位
+		Animation::ClipHandle Clip;								// ClipName 对应的句柄; 无效时在下一次更新时按 ClipName 查找
 		float fTimePos;
-		
-		void UpdateAnimation(float t)
+		Animation::AnimationCursor Cursor;						// 关键帧查找游标
+		Animation::PoseCache* pPoseCache = nullptr;				// 可选; 多个实例共享同一个缓存时, 相同的姿势每帧只计算一次
+		UINT nSkinnedCBIndex = 0;								// UpdateSkinnedInstances 写入的槽位, 与对应渲染项的 nSkinnedCBIndex 相同
+		const SkinnedBounds* pBounds = nullptr;					// 可选; 设置后每次更新动画时求出 Bounds
+		DirectX::BoundingBox Bounds;							// 当前姿势下模型空间的包围盒
+
+		// 动画 LOD, 通常由 AnimationLodScheduler::Schedule 每帧设置; 默认每帧求值
+		UINT nUpdateInterval = 1;								// 求值间隔(帧); 0 表示不可见, 暂停求值
+		bool bUpdateDue = 1;									// 本帧是否求值
+		bool bInterpolate = 0;									// 间隔大于 1 时预先求出下一次求值时刻的姿势, 中间各帧线性插值
+		float fPoseElapsed = 0.0f;								// 距上一次求值经过的时间
+		float fPoseSpan = -1.0f;								// 插值区间的时长; 0 表示不插值, 小于 0 表示姿势已失效(如刚切换片段), 下一次更新必定求值
+		std::vector<DirectX::XMFLOAT4X4> matPosePrev;			// 插值区间两端的姿势
+		std::vector<DirectX::XMFLOAT4X4> matPoseNext;
+
+		/// @brief 切换动画片段, 句柄须由 Skinned->FindClip 取得
+		void PlayClip(Animation::ClipHandle clip, float fStartTime = 0.0f)
 		{
 			assert(Skinned);
 
-			fTimePos += t;
-			if(fTimePos > Skinned->GetClipEndTime(ClipName))
-				fTimePos = 0;
-			
-			Skinned->GetFinalTransforms(ClipName, fTimePos, matFinalTransforms);
+			Clip = clip;
+			ClipName = Skinned->GetClipName(clip);
+			fTimePos = fStartTime;
+			fPoseSpan = -1.0f;
 		}
+
+		/// @brief 按名字切换动画片段; 片段不存在时返回 0, 保持当前片段
+		bool PlayClip(const std::string& clipName, float fStartTime = 0.0f)
+		{
+			assert(Skinned);
+
+			Animation::ClipHandle clip = Skinned->FindClip(clipName);
+			if(!clip.IsValid())
+				return 0;
+
+			PlayClip(clip, fStartTime);
+			return 1;
+		}
+		
+		/// @brief 推进时间并求出当前姿势(定义于 D3DHelper_SkinnedBatch.cpp)
+		/// bUpdateDue 为 0 时只推进时间, 沿用上一次的姿势或在两次求值的姿势之间插值
+		void UpdateAnimation(float t);
+
+	private:
+		void EvaluatePose(float fTime, std::vector<DirectX::XMFLOAT4X4>& pose);
 	};
 	/// @brief 渲染项描述结构体
 	struct RenderItem
@@ -87,6 +126,8 @@ namespace D3DHelper
 		UINT nStartIndexLocation = 0; 					// 索引位置起始值
 		UINT nBaseVertexLocation = 0;  					// 顶点位置基值
         DirectX::BoundingBox Bounds;
+		UINT nLodIndex = -1;							// LodSelector 中的槽位; -1 表示不参与 LOD 选择
+		UINT nBvhIndex = -1;							// SceneBvh 中的代理; -1 表示不在场景层次包围体中
 
 // 下列字段需要通过 D3D12_SKINNED 宏来启用
 #ifdef D3D12_SKINNED
@@ -0,0 +1,170 @@
+#include "D3DHelper_AmbientOcclusion.h"
+
+using namespace D3DHelper;
+using namespace D3DHelper::Geometry;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+// 缓存条目为 nVertexCount 个 float
+// 修改采样或烘焙算法后需要递增版本号, 使旧的缓存失效
+#define AMBIENT_OCCLUSION_CACHE_VERSION 2
+
+namespace
+{
+	const UINT AMBIENT_OCCLUSION_GRAIN = 64;		// 每块的顶点数
+
+	struct BakeJob
+	{
+		const TriangleBvh* pOccluders;
+		const BYTE* pVertices;
+		UINT nByteStride;
+		UINT nNormalOffset;
+		UINT nRayCount;
+		UINT nSeed;
+		float fMaxDistance;
+		float fBias;
+		const XMFLOAT2* pSamples;
+		float* pAccess;
+	};
+
+	// 整数哈希(lowbias32), 为每个顶点生成独立的随机偏移
+	inline UINT Hash(UINT x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352dU;
+		x ^= x >> 15;
+		x *= 0x846ca68bU;
+		x ^= x >> 16;
+		return x;
+	}
+
+	inline float RadicalInverse(UINT i)
+	{
+		i = (i << 16) | (i >> 16);
+		i = ((i & 0x55555555U) << 1) | ((i & 0xAAAAAAAAU) >> 1);
+		i = ((i & 0x33333333U) << 2) | ((i & 0xCCCCCCCCU) >> 2);
+		i = ((i & 0x0F0F0F0FU) << 4) | ((i & 0xF0F0F0F0U) >> 4);
+		i = ((i & 0x00FF00FFU) << 8) | ((i & 0xFF00FF00U) >> 8);
+		return i * 2.3283064365386963e-10f;
+	}
+
+	void CALLBACK BakeCallback(void* param, UINT nBegin, UINT nEnd)
+	{
+		BakeJob* pJob = (BakeJob*)param;
+		for(UINT i = nBegin; i < nEnd; ++i)
+		{
+			const BYTE* pVertex = pJob->pVertices + (size_t)i * pJob->nByteStride;
+			XMVECTOR position = XMLoadFloat3((const XMFLOAT3*)pVertex);
+			XMVECTOR normal = XMLoadFloat3((const XMFLOAT3*)(pVertex + pJob->nNormalOffset));
+			float fLength = XMVectorGetX(XMVector3Length(normal));
+			if(fLength <= 0.0f)
+			{
+				pJob->pAccess[i] = 1.0f;
+				continue;
+			}
+			normal = normal / fLength;
+
+			// 以法线为 z 轴的正交基(Duff 等, 2017), 无分支且在 z 接近 -1 时仍然稳定
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, normal);
+			float fSign = n.z >= 0.0f ? 1.0f : -1.0f;
+			float a = -1.0f / (fSign + n.z), b = n.x * n.y * a;
+			XMVECTOR tangent = XMVectorSet(1.0f + fSign * n.x * n.x * a, fSign * b, -fSign * n.x, 0.0f);
+			XMVECTOR bitangent = XMVectorSet(b, fSign + n.y * n.y * a, -n.y, 0.0f);
+
+			// Cranley-Patterson 旋转: 所有顶点共用点集, 各自平移
+			UINT nHash = Hash(i ^ Hash(pJob->nSeed));
+			float fOffsetU = (nHash & 0xFFFF) / 65536.0f, fOffsetV = (nHash >> 16) / 65536.0f;
+
+			XMVECTOR origin = position + normal * pJob->fBias;
+			UINT nOccluded = 0;
+			for(UINT r = 0; r < pJob->nRayCount; ++r)
+			{
+				float u = pJob->pSamples[r].x + fOffsetU, v = pJob->pSamples[r].y + fOffsetV;
+				u -= u >= 1.0f ? 1.0f : 0.0f;
+				v -= v >= 1.0f ? 1.0f : 0.0f;
+
+				// 余弦分布: 单位圆盘上均匀取点后投影到半球
+				float fRadius = sqrtf(u), fPhi = XM_2PI * v;
+				float x = fRadius * cosf(fPhi), y = fRadius * sinf(fPhi), z = sqrtf(max(0.0f, 1.0f - u));
+				XMVECTOR dir = tangent * x + bitangent * y + normal * z;
+
+				nOccluded += pJob->pOccluders->Occluded(origin, dir, pJob->fMaxDistance);
+			}
+			pJob->pAccess[i] = 1.0f - (float)nOccluded / pJob->nRayCount;
+		}
+	}
+}
+
+void AmbientOcclusionBaker::BakeVertices(const TriangleBvh& occluders, const void* pVertices, UINT nVertexCount, UINT nByteStride,
+										 UINT nNormalOffset, const AmbientOcclusionDesc& desc, float* pAccess, ThreadPool* pPool)
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+
+	BoundingBox bounds = occluders.GetBounds();
+	float fDiagonal = 2.0f * XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+
+	UINT nRayCount = max(desc.nRayCount, 1u);
+	std::vector<XMFLOAT2> samples(nRayCount);
+	for(UINT r = 0; r < nRayCount; ++r)
+		samples[r] = XMFLOAT2((r + 0.5f) / nRayCount, RadicalInverse(r));
+
+	BakeJob job;
+	job.pOccluders = &occluders;
+	job.pVertices = (const BYTE*)pVertices;
+	job.nByteStride = nByteStride;
+	job.nNormalOffset = nNormalOffset;
+	job.nRayCount = nRayCount;
+	job.nSeed = desc.nSeed;
+	job.fMaxDistance = desc.fMaxDistance > 0.0f ? desc.fMaxDistance : 0.25f * fDiagonal;
+	job.fBias = desc.fBias * fDiagonal;
+	job.pSamples = samples.data();
+	job.pAccess = pAccess;
+	pPool->ParallelFor(nVertexCount, AMBIENT_OCCLUSION_GRAIN, BakeCallback, &job);
+}
+
+void AmbientOcclusionBaker::BakeMesh(const void* pVertices, UINT nVertexCount, UINT nByteStride, UINT nNormalOffset,
+									 const void* pIndices, DXGI_FORMAT emIndexFormat, UINT nIndexCount,
+									 const AmbientOcclusionDesc& desc, std::vector<float>& access, ThreadPool* pPool)
+{
+	access.resize(nVertexCount);
+
+	BaseHelper::AssetKey key;
+	if(desc.pCache)
+	{
+		// 只取位置与法线参与键的计算, 顶点中的其他成员(包括未初始化的部分)不影响结果
+		std::vector<XMFLOAT3> geometry(2 * (size_t)nVertexCount);
+		const BYTE* pVertex = (const BYTE*)pVertices;
+		for(UINT i = 0; i < nVertexCount; ++i, pVertex += nByteStride)
+		{
+			CopyMemory(&geometry[2 * i], pVertex, sizeof(XMFLOAT3));
+			CopyMemory(&geometry[2 * i + 1], pVertex + nNormalOffset, sizeof(XMFLOAT3));
+		}
+
+		UINT nIndexSize = emIndexFormat == DXGI_FORMAT_R32_UINT ? 4 : 2;
+		BaseHelper::AssetKeyBuilder builder("AmbientOcclusion.Vertices", AMBIENT_OCCLUSION_CACHE_VERSION);
+		builder.AppendValue(desc.nRayCount)
+			   .AppendValue(desc.fMaxDistance)
+			   .AppendValue(desc.fBias)
+			   .AppendValue(desc.nSeed)
+			   .AppendValue(emIndexFormat)
+			   .Append(geometry.data(), geometry.size() * sizeof(XMFLOAT3))
+			   .Append(pIndices, (size_t)nIndexCount * nIndexSize);
+		key = builder.GetKey();
+
+		std::vector<BYTE> data;
+		if(desc.pCache->Load(key, data) && data.size() == access.size() * sizeof(float))
+		{
+			CopyMemory(access.data(), data.data(), data.size());
+			return;
+		}
+	}
+
+	TriangleBvh bvh;
+	bvh.Build(pVertices, nByteStride, pIndices, emIndexFormat, 0, nIndexCount);
+	BakeVertices(bvh, pVertices, nVertexCount, nByteStride, nNormalOffset, desc, access.data(), pPool);
+
+	if(desc.pCache)
+		desc.pCache->Store(key, access.data(), access.size() * sizeof(float));
+}
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef _D3DHELPER_AMBIENTOCCLUSION_H
+#define _D3DHELPER_AMBIENTOCCLUSION_H
+#include "D3DBase.h"
+#include "D3DHelper_TriangleBvh.h"
+#include "BaseHelper_Thread.h"
+#include "BaseHelper_AssetCache.h"
+
+namespace D3DHelper
+{
+	namespace Geometry
+	{
+		/// @brief 环境光遮蔽烘焙参数
+		struct AmbientOcclusionDesc
+		{
+			UINT nRayCount = 64;			// 每个采样点的射线数
+			float fMaxDistance = 0.0f;		// 遮挡距离, 更远的三角形不产生遮蔽; 为 0 时取遮挡物包围盒对角线的 1/4
+			float fBias = 1e-3f;			// 射线起点沿法线的偏移, 相对于遮挡物包围盒对角线, 避免与所在的三角形自相交
+			UINT nSeed = 0;					// 采样序列的种子; 相同的输入与种子总是得到相同的结果
+
+			BaseHelper::AssetCache* pCache = nullptr;	// 可选, 以顶点/索引数据与上述参数为键缓存烘焙结果
+		};
+
+		/// @brief 逐顶点环境光遮蔽烘焙静态类
+		/// 每个顶点沿法线所在的半球发射按余弦分布的射线, 可达度 = 未被遮挡的射线比例, 即余弦加权的可见性;
+		/// 采样方向为 Hammersley 点集, 每个顶点以不同的随机偏移旋转, 射线只需判断是否被遮挡.
+		/// 顶点按块分发到线程池, 调用线程同样参与. 顶点位置取自每个顶点的前 12 字节
+		class AmbientOcclusionBaker
+		{
+		public:
+			/// @brief 以给定的遮挡物烘焙顶点的可达度
+			/// @param occluders 	遮挡物的三角形层次包围体(网格自身或合并后的场景), 与顶点处于同一空间
+			/// @param pVertices 	顶点数据
+			/// @param nVertexCount	顶点数量
+			/// @param nByteStride 	顶点步长
+			/// @param nNormalOffset 法线(XMFLOAT3)偏移, 法线不必归一化, 为 0 时可达度为 1
+			/// @param desc 		烘焙参数, 不使用 pCache
+			/// @param pAccess 		输出 nVertexCount 个可达度, 取值 [0, 1], 1 表示完全不被遮挡
+			/// @param pPool 		线程池; 为 NULL 时使用 ThreadPool::GetInstance()
+			static void BakeVertices(const TriangleBvh& occluders, const void* pVertices, UINT nVertexCount, UINT nByteStride,
+									 UINT nNormalOffset, const AmbientOcclusionDesc& desc, float* pAccess,
+									 BaseHelper::Thread::ThreadPool* pPool = NULL);
+
+			/// @brief 以网格自身为遮挡物烘焙顶点的可达度
+			/// 设置了 desc.pCache 时, 缓存命中则直接读取之前的结果, 不构建层次包围体
+			/// @param pIndices 	索引数据
+			/// @param emIndexFormat DXGI_FORMAT_R16_UINT 或 DXGI_FORMAT_R32_UINT
+			/// @param nIndexCount 	索引数量
+			/// @param access 		输出, 与顶点一一对应的可达度
+			static void BakeMesh(const void* pVertices, UINT nVertexCount, UINT nByteStride, UINT nNormalOffset,
+								 const void* pIndices, DXGI_FORMAT emIndexFormat, UINT nIndexCount,
+								 const AmbientOcclusionDesc& desc, std::vector<float>& access,
+								 BaseHelper::Thread::ThreadPool* pPool = NULL);
+		};
+	};
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "D3DHelper_Animation.h"
 #include "D3DHelper_Math.h"
+#include <algorithm>
 
 using namespace D3DHelper::Animation;
 using namespace DirectX;
@@ -14,56 +15,133 @@ float BoneAnimation::GetEndTime() const
 	return Keyframes.back().nTimePos;
 }
 
-void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M) const
+static void KeyframeToMatrix(const Keyframe& key, XMFLOAT4X4& M)
 {
 	XMVECTOR Z = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-	XMVECTOR S;
-	XMVECTOR T;
-	XMVECTOR Q;
+	XMVECTOR S = XMLoadFloat3(&key.vec3Scale);
+	XMVECTOR T = XMLoadFloat3(&key.vec3Translation);
+	XMVECTOR Q = XMLoadFloat4(&key.vec4RotationQuat);
+
+	XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, Z, Q, T));
+}
 
+// 在 k0 与 k1 之间插值, 结果写入 key(不含 nTimePos)
+static void LerpKeyframe(const Keyframe& k0, const Keyframe& k1, float lerpPercent, Keyframe& key)
+{
+	XMVECTOR s0 = XMLoadFloat3(&k0.vec3Scale);
+	XMVECTOR s1 = XMLoadFloat3(&k1.vec3Scale);
+	
+	XMVECTOR t0 = XMLoadFloat3(&k0.vec3Translation);
+	XMVECTOR t1 = XMLoadFloat3(&k1.vec3Translation);
+	
+	XMVECTOR q0 = XMLoadFloat4(&k0.vec4RotationQuat);
+	XMVECTOR q1 = XMLoadFloat4(&k1.vec4RotationQuat);
+	
+	// q 与 -q 表示同一旋转, 取同一半球上的 q1 以走较短的路径, 插值后重新归一化
+	if(XMVectorGetX(XMVector4Dot(q0, q1)) < 0.0f)
+		q1 = XMVectorNegate(q1);
+
+	XMStoreFloat3(&key.vec3Scale, XMVectorLerp(s0, s1, lerpPercent));
+	XMStoreFloat3(&key.vec3Translation, XMVectorLerp(t0, t1, lerpPercent));
+	XMStoreFloat4(&key.vec4RotationQuat, XMQuaternionNormalize(XMVectorLerp(q0, q1, lerpPercent)));
+}
+
+// 取骨骼在 t 时刻的变换, 超出范围时取首/尾关键帧
+static void SampleKeyframe(const BoneAnimation& bone, float t, UINT& nCursor, Keyframe& key)
+{
+	const std::vector<Keyframe>& keys = bone.Keyframes;
+
+	if(t <= keys.front().nTimePos)
+		key = keys.front();
+	else if(t >= keys.back().nTimePos)
+		key = keys.back();
+	else
+	{
+		nCursor = bone.FindKeyframe(t, nCursor);
+		const Keyframe& k0 = keys[nCursor];
+		const Keyframe& k1 = keys[nCursor + 1];
+		LerpKeyframe(k0, k1, (t - k0.nTimePos) / (k1.nTimePos - k0.nTimePos), key);
+	}
+	key.nTimePos = t;
+}
+
+UINT BoneAnimation::FindKeyframe(float t, UINT nCursor) const
+{
+	UINT nLast = (UINT)Keyframes.size() - 1;
+
+	if(fInvInterval > 0.0f)
+	{
+		float fIndex = (t - Keyframes.front().nTimePos) * fInvInterval;
+		return fIndex <= 0.0f? 0: min((UINT)fIndex, nLast - 1);
+	}
+
+	// 顺序播放时 t 通常仍在当前区间或刚进入下一个区间
+	if(nCursor < nLast && Keyframes[nCursor].nTimePos <= t)
+	{
+		if(t <= Keyframes[nCursor + 1].nTimePos)
+			return nCursor;
+		if(nCursor + 1 < nLast && t <= Keyframes[nCursor + 2].nTimePos)
+			return nCursor + 1;
+	}
+
+	auto itor = std::upper_bound(Keyframes.begin(), Keyframes.end(), t,
+								 [](float time, const Keyframe& key) { return time < key.nTimePos; });
+	UINT i = (UINT)(itor - Keyframes.begin());
+	return i == 0? 0: min(i - 1, nLast - 1);
+}
+
+void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M) const
+{
+	UINT nCursor = 0;
+	Interpolate(t, M, nCursor);
+}
+
+void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M, UINT& nCursor) const
+{
 	if(t <= Keyframes.front().nTimePos)
 	{
-		S = XMLoadFloat3(&Keyframes.front().vec3Scale);
-		T = XMLoadFloat3(&Keyframes.front().vec3Translation);
-		Q = XMLoadFloat4(&Keyframes.front().vec4RotationQuat);
-		
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, Z, Q, T));
+		nCursor = 0;
+		KeyframeToMatrix(Keyframes.front(), M);
 	}
 	else if(t >= Keyframes.back().nTimePos)
 	{
-		S = XMLoadFloat3(&Keyframes.back().vec3Scale);
-		T = XMLoadFloat3(&Keyframes.back().vec3Translation);
-		Q = XMLoadFloat4(&Keyframes.back().vec4RotationQuat);
-		
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, Z, Q, T));
+		nCursor = (UINT)Keyframes.size() - 1;
+		KeyframeToMatrix(Keyframes.back(), M);
 	}
 	else
 	{
-		for(UINT i = 0; i < Keyframes.size() - 1; ++i)
-		{
-			if(t >= Keyframes[i].nTimePos && t <= Keyframes[i + 1].nTimePos)
-			{
-				float lerpPercent = (t - Keyframes[i].nTimePos) / (Keyframes[i + 1].nTimePos - Keyframes[i].nTimePos);
-				
-				XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].vec3Scale);
-				XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].vec3Scale);
-				
-				XMVECTOR t0 = XMLoadFloat3(&Keyframes[i].vec3Translation);
-				XMVECTOR t1 = XMLoadFloat3(&Keyframes[i + 1].vec3Translation);
-				
-				XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].vec4RotationQuat);
-				XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].vec4RotationQuat);
-				
-				S = XMVectorLerp(s0, s1, lerpPercent);
-				T = XMVectorLerp(t0, t1, lerpPercent);
-				Q = XMVectorLerp(q0, q1, lerpPercent);
-				
-				XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, Z, Q, T));
-				break;
-			}
-		}
+		UINT i = FindKeyframe(t, nCursor);
+		const Keyframe& k0 = Keyframes[i];
+		const Keyframe& k1 = Keyframes[i + 1];
+
+		float lerpPercent = (t - k0.nTimePos) / (k1.nTimePos - k0.nTimePos);
+		lerpPercent = min(max(lerpPercent, 0.0f), 1.0f);
+
+		Keyframe key;
+		LerpKeyframe(k0, k1, lerpPercent, key);
+		KeyframeToMatrix(key, M);
+
+		nCursor = i;
 	}
+}
+
+void BoneAnimation::Resample(float fStartTime, float fEndTime, float fInterval)
+{
+	if(Keyframes.empty() || fInterval <= 0.0f || fEndTime <= fStartTime)
+		return;
+
+	// 采样数取整后重新计算间隔, 保证最后一个采样点恰好落在 fEndTime 上
+	UINT nIntervals = max((UINT)ceilf((fEndTime - fStartTime) / fInterval), 1u);
+	float fStep = (fEndTime - fStartTime) / nIntervals;
 
+	std::vector<Keyframe> samples(nIntervals + 1);
+	UINT nCursor = 0;
+
+	for(UINT i = 0; i <= nIntervals; ++i)
+		SampleKeyframe(*this, i == nIntervals? fEndTime: fStartTime + fStep * i, nCursor, samples[i]);
+
+	Keyframes.swap(samples);
+	fInvInterval = 1.0f / fStep;
 }
 
 float AnimationClip::GetStartTime() const
@@ -92,6 +170,219 @@ void AnimationClip::Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& Ms) c
 		BoneAnimations[i].Interpolate(t, Ms[i]);
 }
 
+void AnimationClip::Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& Ms, AnimationCursor& cursor) const
+{
+	if(cursor.pClip != this || cursor.Keys.size() != BoneAnimations.size())
+	{
+		cursor.pClip = this;
+		cursor.Keys.assign(BoneAnimations.size(), 0);
+	}
+
+	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+		BoneAnimations[i].Interpolate(t, Ms[i], cursor.Keys[i]);
+}
+
+void AnimationClip::Resample(float fSampleRate)
+{
+	float fStartTime = GetStartTime();
+	float fEndTime = GetEndTime();
+
+	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+		BoneAnimations[i].Resample(fStartTime, fEndTime, 1.0f / fSampleRate);
+}
+
+void PackedClip::Build(const AnimationClip& clip, float fSampleRate)
+{
+	nBoneCount = (UINT)clip.BoneAnimations.size();
+	nGroupCount = (nBoneCount + 3) / 4;
+	fStartTime = nBoneCount? clip.GetStartTime(): 0.0f;
+	fEndTime = nBoneCount? clip.GetEndTime(): 0.0f;
+
+	// 与 BoneAnimation::Resample 相同, 最后一个采样点恰好落在 fEndTime 上
+	UINT nIntervals = 1;
+	if(fEndTime > fStartTime && fSampleRate > 0.0f)
+		nIntervals = max((UINT)ceilf((fEndTime - fStartTime) * fSampleRate), 1u);
+	float fStep = (fEndTime - fStartTime) / nIntervals;
+
+	nKeyCount = nIntervals + 1;
+	fInvInterval = fStep > 0.0f? 1.0f / fStep: 0.0f;
+
+	// 补齐的通道为单位变换
+	Translations.assign((size_t)nKeyCount * nGroupCount * 3, XMVectorZero());
+	Scales.assign((size_t)nKeyCount * nGroupCount * 3, XMVectorSplatOne());
+	Rotations.assign((size_t)nKeyCount * nGroupCount * 4, XMVectorZero());
+	for(size_t i = 3; i < Rotations.size(); i += 4)
+		Rotations[i] = XMVectorSplatOne();
+
+	for(UINT b = 0; b < nBoneCount; ++b)
+	{
+		const BoneAnimation& bone = clip.BoneAnimations[b];
+		UINT nGroup = b / 4, nLane = b % 4;
+		UINT nCursor = 0;
+		XMFLOAT4 vec4Prev(0.0f, 0.0f, 0.0f, 1.0f);
+
+		for(UINT k = 0; k < nKeyCount; ++k)
+		{
+			Keyframe key;
+			SampleKeyframe(bone, k == nIntervals? fEndTime: fStartTime + fStep * k, nCursor, key);
+
+			// 相邻关键帧的四元数保持在同一半球, 减少运行时的符号翻转
+			XMFLOAT4& q = key.vec4RotationQuat;
+			if(k > 0 && q.x * vec4Prev.x + q.y * vec4Prev.y + q.z * vec4Prev.z + q.w * vec4Prev.w < 0.0f)
+				q = XMFLOAT4(-q.x, -q.y, -q.z, -q.w);
+			vec4Prev = q;
+
+			size_t n = (size_t)k * nGroupCount + nGroup;
+			XMVECTOR* T = &Translations[n * 3];
+			XMVECTOR* S = &Scales[n * 3];
+			XMVECTOR* R = &Rotations[n * 4];
+
+			T[0] = XMVectorSetByIndex(T[0], key.vec3Translation.x, nLane);
+			T[1] = XMVectorSetByIndex(T[1], key.vec3Translation.y, nLane);
+			T[2] = XMVectorSetByIndex(T[2], key.vec3Translation.z, nLane);
+			S[0] = XMVectorSetByIndex(S[0], key.vec3Scale.x, nLane);
+			S[1] = XMVectorSetByIndex(S[1], key.vec3Scale.y, nLane);
+			S[2] = XMVectorSetByIndex(S[2], key.vec3Scale.z, nLane);
+			R[0] = XMVectorSetByIndex(R[0], q.x, nLane);
+			R[1] = XMVectorSetByIndex(R[1], q.y, nLane);
+			R[2] = XMVectorSetByIndex(R[2], q.z, nLane);
+			R[3] = XMVectorSetByIndex(R[3], q.w, nLane);
+		}
+	}
+}
+
+void PackedClip::Evaluate(float t, XMFLOAT4X4* pLocal, QuaternionBlends emBlend) const
+{
+	if(!nBoneCount)
+		return;
+
+	// 所有骨骼共用同一时间网格, 关键帧下标与插值系数只需计算一次
+	UINT k0 = 0, k1 = 0;
+	float f = 0.0f;
+	float fIndex = (t - fStartTime) * fInvInterval;
+	if(nKeyCount > 1 && fIndex > 0.0f)
+	{
+		k0 = min((UINT)fIndex, nKeyCount - 2);
+		k1 = k0 + 1;
+		f = min(fIndex - k0, 1.0f);
+	}
+
+	const XMVECTOR Zero = XMVectorZero();
+	const XMVECTOR One = XMVectorSplatOne();
+	const XMVECTOR Two = XMVectorReplicate(2.0f);
+	const XMVECTOR F = XMVectorReplicate(f);
+	const XMVECTOR InvF = XMVectorReplicate(1.0f - f);
+	const XMVECTOR SlerpThreshold = XMVectorReplicate(1.0f - 1e-4f);
+
+	for(UINT g = 0; g < nGroupCount; ++g)
+	{
+		const XMVECTOR* T0 = &Translations[((size_t)k0 * nGroupCount + g) * 3];
+		const XMVECTOR* T1 = &Translations[((size_t)k1 * nGroupCount + g) * 3];
+		const XMVECTOR* S0 = &Scales[((size_t)k0 * nGroupCount + g) * 3];
+		const XMVECTOR* S1 = &Scales[((size_t)k1 * nGroupCount + g) * 3];
+		const XMVECTOR* R0 = &Rotations[((size_t)k0 * nGroupCount + g) * 4];
+		const XMVECTOR* R1 = &Rotations[((size_t)k1 * nGroupCount + g) * 4];
+
+		XMVECTOR tx = XMVectorLerpV(T0[0], T1[0], F);
+		XMVECTOR ty = XMVectorLerpV(T0[1], T1[1], F);
+		XMVECTOR tz = XMVectorLerpV(T0[2], T1[2], F);
+		XMVECTOR sx = XMVectorLerpV(S0[0], S1[0], F);
+		XMVECTOR sy = XMVectorLerpV(S0[1], S1[1], F);
+		XMVECTOR sz = XMVectorLerpV(S0[2], S1[2], F);
+
+		// 四元数: 按通道计算点积, 点积为负的通道翻转 q1
+		XMVECTOR dot = XMVectorMultiply(R0[0], R1[0]);
+		dot = XMVectorMultiplyAdd(R0[1], R1[1], dot);
+		dot = XMVectorMultiplyAdd(R0[2], R1[2], dot);
+		dot = XMVectorMultiplyAdd(R0[3], R1[3], dot);
+		XMVECTOR sign = XMVectorSelect(One, XMVectorNegate(One), XMVectorLess(dot, Zero));
+		dot = XMVectorAbs(dot);
+
+		XMVECTOR w0 = InvF;
+		XMVECTOR w1 = F;
+		if(emBlend == QUATERNION_BLEND_SLERP)
+		{
+			// 夹角很小的通道 sin(theta) 接近 0, 退化为线性插值
+			XMVECTOR theta = XMVectorACos(XMVectorMin(dot, One));
+			XMVECTOR invSin = XMVectorReciprocal(XMVectorSin(theta));
+			XMVECTOR useSlerp = XMVectorLess(dot, SlerpThreshold);
+			w0 = XMVectorSelect(w0, XMVectorMultiply(XMVectorSin(XMVectorMultiply(InvF, theta)), invSin), useSlerp);
+			w1 = XMVectorSelect(w1, XMVectorMultiply(XMVectorSin(XMVectorMultiply(F, theta)), invSin), useSlerp);
+		}
+		w1 = XMVectorMultiply(w1, sign);
+
+		XMVECTOR qx = XMVectorMultiplyAdd(R1[0], w1, XMVectorMultiply(R0[0], w0));
+		XMVECTOR qy = XMVectorMultiplyAdd(R1[1], w1, XMVectorMultiply(R0[1], w0));
+		XMVECTOR qz = XMVectorMultiplyAdd(R1[2], w1, XMVectorMultiply(R0[2], w0));
+		XMVECTOR qw = XMVectorMultiplyAdd(R1[3], w1, XMVectorMultiply(R0[3], w0));
+
+		XMVECTOR len = XMVectorMultiply(qx, qx);
+		len = XMVectorMultiplyAdd(qy, qy, len);
+		len = XMVectorMultiplyAdd(qz, qz, len);
+		len = XMVectorMultiplyAdd(qw, qw, len);
+		XMVECTOR invLen = XMVectorReciprocalSqrt(len);
+		qx = XMVectorMultiply(qx, invLen);
+		qy = XMVectorMultiply(qy, invLen);
+		qz = XMVectorMultiply(qz, invLen);
+		qw = XMVectorMultiply(qw, invLen);
+
+		// 与 XMMatrixAffineTransformation(S, 0, Q, T) 相同: 行 i 为旋转矩阵第 i 行乘以 s_i, 第 4 行为平移
+		XMVECTOR x2 = XMVectorMultiply(qx, Two), y2 = XMVectorMultiply(qy, Two), z2 = XMVectorMultiply(qz, Two);
+		XMVECTOR xx = XMVectorMultiply(qx, x2), yy = XMVectorMultiply(qy, y2), zz = XMVectorMultiply(qz, z2);
+		XMVECTOR xy = XMVectorMultiply(qx, y2), xz = XMVectorMultiply(qx, z2), yz = XMVectorMultiply(qy, z2);
+		XMVECTOR wx = XMVectorMultiply(qw, x2), wy = XMVectorMultiply(qw, y2), wz = XMVectorMultiply(qw, z2);
+
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(XMVectorSubtract(One, XMVectorAdd(yy, zz)), sx),
+			XMVectorMultiply(XMVectorAdd(xy, wz), sx),
+			XMVectorMultiply(XMVectorSubtract(xz, wy), sx),
+			Zero));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(XMVectorSubtract(xy, wz), sy),
+			XMVectorMultiply(XMVectorSubtract(One, XMVectorAdd(xx, zz)), sy),
+			XMVectorMultiply(XMVectorAdd(yz, wx), sy),
+			Zero));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(XMVectorAdd(xz, wy), sz),
+			XMVectorMultiply(XMVectorSubtract(yz, wx), sz),
+			XMVectorMultiply(XMVectorSubtract(One, XMVectorAdd(xx, yy)), sz),
+			Zero));
+		XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(tx, ty, tz, One));
+
+		UINT nLanes = min(nBoneCount - g * 4, 4u);
+		for(UINT j = 0; j < nLanes; ++j)
+		{
+			XMFLOAT4X4& M = pLocal[g * 4 + j];
+			XMStoreFloat4((XMFLOAT4*)&M._11, row0.r[j]);
+			XMStoreFloat4((XMFLOAT4*)&M._21, row1.r[j]);
+			XMStoreFloat4((XMFLOAT4*)&M._31, row2.r[j]);
+			XMStoreFloat4((XMFLOAT4*)&M._41, row3.r[j]);
+		}
+	}
+}
+
+SkinnedAnimation::SkinnedAnimation(const SkinnedAnimation& other)
+{
+	*this = other;
+}
+
+SkinnedAnimation& SkinnedAnimation::operator=(const SkinnedAnimation& other)
+{
+	if(this == &other)
+		return *this;
+
+	BoneHierarchy = other.BoneHierarchy;
+	BoneOffsets = other.BoneOffsets;
+	Animations = other.Animations;
+	PackedAnimations = other.PackedAnimations;
+	CompressedAnimations = other.CompressedAnimations;
+	emPackedBlend = other.emPackedBlend;
+	ClipIndices = other.ClipIndices;
+	ClipNames = other.ClipNames;
+	RefreshClips();
+	return *this;
+}
+
 UINT SkinnedAnimation::BoneCount() const
 {
 	return BoneHierarchy.size();
@@ -100,19 +391,23 @@ UINT SkinnedAnimation::BoneCount() const
 float SkinnedAnimation::GetClipStartTime(const std::string& clipName) const
 {
 	auto itor = Animations.find(clipName);
-	if(itor == Animations.end())
-		return 0;
-	else 
+	if(itor != Animations.end())
 		return itor->second.GetStartTime();
+
+	// 压缩时可能已释放原始关键帧
+	const CompressedClip* pCompressed = GetCompressedClip(clipName);
+	return pCompressed? pCompressed->GetStartTime(): 0;
 }
 
 float SkinnedAnimation::GetClipEndTime(const std::string& clipName) const
 {
 	auto itor = Animations.find(clipName);
-	if(itor == Animations.end())
-		return 0;
-	else 
+	if(itor != Animations.end())
 		return itor->second.GetEndTime();
+
+	// 压缩时可能已释放原始关键帧
+	const CompressedClip* pCompressed = GetCompressedClip(clipName);
+	return pCompressed? pCompressed->GetEndTime(): 0;
 }
 
 void SkinnedAnimation::Set(std::vector<int>& boneHierarchy, std::vector<DirectX::XMFLOAT4X4>& boneOffsets, std::unordered_map<std::string, AnimationClip>& animations)
@@ -120,37 +415,182 @@ void SkinnedAnimation::Set(std::vector<int>& boneHierarchy, std::vector<DirectX:
 	BoneHierarchy = boneHierarchy;
 	BoneOffsets = boneOffsets;
 	Animations = animations;
+	PackedAnimations.clear();
+	CompressedAnimations.clear();
+
+	ClipIndices.clear();
+	ClipNames.clear();
+	RefreshClips();
 }
 
-void SkinnedAnimation::GetFinalTransforms(const std::string& clipName, float t, std::vector<DirectX::XMFLOAT4X4>& trans) const
+void SkinnedAnimation::ResampleClips(float fSampleRate)
 {
-	UINT nBones = BoneOffsets.size();
+	for(auto& clip : Animations)
+		clip.second.Resample(fSampleRate);
+}
+
+void SkinnedAnimation::PackClips(float fSampleRate, QuaternionBlends emBlend)
+{
+	PackedAnimations.clear();
+	for(auto& clip : Animations)
+		PackedAnimations[clip.first].Build(clip.second, fSampleRate);
+	emPackedBlend = emBlend;
+	RefreshClips();
+}
 
-	std::vector<XMFLOAT4X4> toParentTransforms(nBones);
+void SkinnedAnimation::CompressClips(const AnimationCompressionDesc& desc)
+{
+	for(auto& clip : Animations)
+		CompressedAnimations[clip.first].Build(clip.second, BoneHierarchy, BoneOffsets, desc);
 
-	auto& clip = Animations.find(clipName);
-	clip->second.Interpolate(t, toParentTransforms);
+	if(desc.bDiscardSource)
+		Animations.clear();
+	RefreshClips();
+}
 
-	std::vector<XMFLOAT4X4> toRootTransforms(nBones);
+const CompressedClip* SkinnedAnimation::GetCompressedClip(const std::string& clipName) const
+{
+	auto itor = CompressedAnimations.find(clipName);
+	return itor == CompressedAnimations.end()? nullptr: &itor->second;
+}
 
-	toRootTransforms[0] = toParentTransforms[0];
+AnimationClip& SkinnedAnimation::GetAnimationClip(std::string& clipName)
+{
+	AnimationClip& clip = Animations[clipName];
+	if(!ClipIndices.count(clipName))
+		RefreshClips();
+	return clip;
+}
 
-	for(UINT i = 1; i < nBones; ++i)
+void SkinnedAnimation::RefreshClips()
+{
+	// 已有的名字保持原来的下标, 之前取得的句柄继续有效; 压缩时丢弃的原始片段仍保留在表中
+	for(auto& clip : Animations)
 	{
-		XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
+		if(ClipIndices.emplace(clip.first, (UINT)ClipNames.size()).second)
+			ClipNames.push_back(clip.first);
+	}
 
-		int parentIndex = BoneHierarchy[i];
-		XMMATRIX parentToRoot = XMLoadFloat4x4(&toRootTransforms[parentIndex]);
+	Clips.resize(ClipNames.size());
+	for(UINT i = 0; i < ClipNames.size(); ++i)
+		Clips[i] = LookupClip(ClipNames[i]);
+}
 
-		XMMATRIX toRoot = XMMatrixMultiply(toParent, parentToRoot);
+ClipHandle SkinnedAnimation::FindClip(const std::string& clipName) const
+{
+	ClipHandle handle;
+	auto itor = ClipIndices.find(clipName);
+	if(itor != ClipIndices.end())
+		handle.nIndex = itor->second;
+	return handle;
+}
 
-		XMStoreFloat4x4(&toRootTransforms[i], toRoot);
+const ResolvedClip& SkinnedAnimation::GetClip(ClipHandle clip) const
+{
+	static const ResolvedClip invalid;
+	return clip.nIndex < Clips.size()? Clips[clip.nIndex]: invalid;
+}
+
+const std::string& SkinnedAnimation::GetClipName(ClipHandle clip) const
+{
+	static const std::string empty;
+	return clip.nIndex < ClipNames.size()? ClipNames[clip.nIndex]: empty;
+}
+
+ResolvedClip SkinnedAnimation::ResolveClip(const std::string& clipName) const
+{
+	return GetClip(FindClip(clipName));
+}
+
+ResolvedClip SkinnedAnimation::LookupClip(const std::string& clipName) const
+{
+	ResolvedClip resolved;
+
+	auto clip = Animations.find(clipName);
+	auto packed = PackedAnimations.find(clipName);
+	if(clip != Animations.end())
+		resolved.pClip = &clip->second;
+	if(packed != PackedAnimations.end())
+		resolved.pPacked = &packed->second;
+	resolved.pCompressed = GetCompressedClip(clipName);
+
+	// 三者的起止时间相同, 优先取已经保存的值, 避免遍历所有骨骼
+	if(resolved.pPacked)
+	{
+		resolved.fStartTime = resolved.pPacked->GetStartTime();
+		resolved.fEndTime = resolved.pPacked->GetEndTime();
+	}
+	else if(resolved.pCompressed)
+	{
+		resolved.fStartTime = resolved.pCompressed->GetStartTime();
+		resolved.fEndTime = resolved.pCompressed->GetEndTime();
+	}
+	else if(resolved.pClip)
+	{
+		resolved.fStartTime = resolved.pClip->GetStartTime();
+		resolved.fEndTime = resolved.pClip->GetEndTime();
+	}
+	return resolved;
+}
+
+// 每个线程一份, 供 UpdateSkinnedInstances 的工作线程并发调用
+static AnimationScratch& ThreadScratch()
+{
+	static thread_local AnimationScratch scratch;
+	return scratch;
+}
+
+void SkinnedAnimation::GetFinalTransforms(const std::string& clipName, float t, std::vector<DirectX::XMFLOAT4X4>& trans, AnimationCursor* pCursor) const
+{
+	const ResolvedClip& clip = ResolveClip(clipName);
+	if(!clip.IsValid())
+	{
+		OutputDebugStringA(("SkinnedAnimation: animation clip \"" + clipName + "\" does not exist\n").c_str());
+		return;
 	}
 
+	if(trans.size() < BoneOffsets.size())
+		trans.resize(BoneOffsets.size());
+	GetFinalTransforms(clip, t, trans.data(), ThreadScratch(), pCursor);
+}
+
+bool SkinnedAnimation::GetFinalTransforms(ClipHandle clip, float t, XMFLOAT4X4* pFinal, AnimationCursor* pCursor) const
+{
+	return GetFinalTransforms(GetClip(clip), t, pFinal, ThreadScratch(), pCursor);
+}
+
+bool SkinnedAnimation::GetFinalTransforms(const ResolvedClip& clip, float t, XMFLOAT4X4* pFinal, AnimationScratch& scratch, AnimationCursor* pCursor) const
+{
+	if(!clip.IsValid())
+		return 0;
+
+	UINT nBones = BoneOffsets.size();
+	std::vector<XMFLOAT4X4>& transforms = scratch.Transforms;
+	if(transforms.size() < nBones)
+		transforms.resize(nBones);
+
+	if(clip.pPacked)
+		clip.pPacked->Evaluate(t, transforms.data(), emPackedBlend);
+	else if(clip.pCompressed)
+		clip.pCompressed->Evaluate(t, transforms.data());
+	else if(pCursor)
+		clip.pClip->Interpolate(t, transforms, *pCursor);
+	else
+		clip.pClip->Interpolate(t, transforms);
+
+	// 父骨骼的下标总小于子骨骼, 因此可以原地把局部变换累乘为到根骨骼的变换, 并在同一遍中乘上偏移矩阵
 	for(UINT i = 0; i < nBones; ++i)
 	{
+		XMMATRIX toRoot = XMLoadFloat4x4(&transforms[i]);
+		if(i > 0)
+		{
+			toRoot = XMMatrixMultiply(toRoot, XMLoadFloat4x4(&transforms[BoneHierarchy[i]]));
+			XMStoreFloat4x4(&transforms[i], toRoot);
+		}
+
 		XMMATRIX offset = XMLoadFloat4x4(&BoneOffsets[i]);
-		XMMATRIX toRoot = XMLoadFloat4x4(&toRootTransforms[i]);
-		XMStoreFloat4x4(&trans[i], XMMatrixTranspose(XMMatrixMultiply(offset, toRoot)));
-	}	
+		XMStoreFloat4x4(&pFinal[i], XMMatrixTranspose(XMMatrixMultiply(offset, toRoot)));
+	}
+
+	return 1;
 }
\ No newline at end of file
@@ -21,8 +21,27 @@ namespace D3DHelper
 			float GetStartTime() const;
 			float GetEndTime() const;
 			void Interpolate(float t, DirectX::XMFLOAT4X4& M) const;
+			// nCursor 为上一次查找到的关键帧, 顺序播放时直接从该处继续; 调用后更新为本次的关键帧
+			void Interpolate(float t, DirectX::XMFLOAT4X4& M, UINT& nCursor) const;
+
+			// 查找满足 Keyframes[i].nTimePos <= t <= Keyframes[i + 1].nTimePos 的 i
+			// 先检查游标所在及其后一帧, 不满足时(跳转/循环)再二分查找; 均匀采样时直接计算
+			UINT FindKeyframe(float t, UINT nCursor) const;
+
+			// 以固定间隔在 [fStartTime, fEndTime] 内重新采样, 之后的查找为 O(1)
+			void Resample(float fStartTime, float fEndTime, float fInterval);
 			
 			std::vector<Keyframe> Keyframes;
+			float fInvInterval = 0.0f;					// 大于 0 时表示关键帧均匀分布, 值为采样间隔的倒数
+		};
+
+		struct AnimationClip;
+
+		// 动画播放游标; 每个实例各自持有, 记录每根骨骼上一次所在的关键帧
+		struct AnimationCursor
+		{
+			const AnimationClip* pClip = nullptr;		// 游标对应的动画片段, 切换片段后自动重置
+			std::vector<UINT> Keys;
 		};
 		
 		struct AnimationClip
@@ -32,13 +51,149 @@ namespace D3DHelper
 			// 获取该动画片段中最晚的结束时间
 			float GetEndTime() const;
 			void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& M) const;
+			void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& M, AnimationCursor& cursor) const;
+
+			// 将所有骨骼按 fSampleRate(每秒帧数)在片段的起止时间内均匀重采样
+			void Resample(float fSampleRate);
 			
 			std::vector<BoneAnimation> BoneAnimations;
 		};
+
+		enum QuaternionBlends		// 四元数插值方式
+		{
+			QUATERNION_BLEND_NLERP,		// 同半球线性插值后归一化, 速度快, 角速度不恒定
+			QUATERNION_BLEND_SLERP		// 球面线性插值
+		};
+
+		/// @brief SoA 布局的动画片段
+		/// 所有骨骼在同一时间网格上均匀采样, 每 4 根骨骼为一组; 
+		/// 同一关键帧、同一组的平移/缩放/旋转各分量分别存放为 XMVECTOR, 每个分量的 4 个通道对应组内的 4 根骨骼,
+		/// 因此一次 SIMD 运算即可同时插值 4 根骨骼
+		struct PackedClip
+		{
+			/// @brief 以 fSampleRate(每秒帧数)对片段重新采样并打包
+			void Build(const AnimationClip& clip, float fSampleRate);
+
+			/// @brief 计算 t 时刻各骨骼的局部(相对父骨骼)变换
+			/// @param pLocal 调用方提供的缓冲区, 至少容纳 nBoneCount 个矩阵
+			void Evaluate(float t, DirectX::XMFLOAT4X4* pLocal, QuaternionBlends emBlend = QUATERNION_BLEND_NLERP) const;
+
+			float GetStartTime() const { return fStartTime; }
+			float GetEndTime() const { return fEndTime; }
+
+			UINT nBoneCount = 0;
+			UINT nGroupCount = 0;							// (nBoneCount + 3) / 4, 末组不足 4 根时以单位变换补齐
+			UINT nKeyCount = 0;
+			float fStartTime = 0.0f;
+			float fEndTime = 0.0f;
+			float fInvInterval = 0.0f;						// 采样间隔的倒数
+
+			std::vector<DirectX::XMVECTOR> Translations;	// [关键帧][组][x, y, z]
+			std::vector<DirectX::XMVECTOR> Scales;			// [关键帧][组][x, y, z]
+			std::vector<DirectX::XMVECTOR> Rotations;		// [关键帧][组][x, y, z, w]
+		};
+		
+		/// @brief 动画压缩参数
+		struct AnimationCompressionDesc
+		{
+			float fTolerance = 0.01f;		// 骨骼链末端允许的最大位置误差(模型空间单位)
+			float fShellDistance = 1.0f;	// 叶骨骼上测试点到关节的最小距离, 用于估计蒙皮顶点的误差
+			bool bDiscardSource = 0;		// 压缩后释放原始关键帧
+		};
+
+		/// @brief 压缩后的动画片段
+		/// 逐骨骼删除在误差范围内可由前后关键帧插值得到的关键帧, 变化在误差范围内的轨道只保留 1 个值;
+		/// 四元数以 smallest-three 编码为 48 位, 平移与缩放按整个片段的取值范围量化为 16 位
+		struct CompressedClip
+		{
+			enum CompressedTrackFlags
+			{
+				COMPRESSED_TRACK_CONSTANT_ROTATION = 1 << 0,
+				COMPRESSED_TRACK_CONSTANT_TRANSLATION = 1 << 1,
+				COMPRESSED_TRACK_CONSTANT_SCALE = 1 << 2
+			};
+
+			struct BoneTrack
+			{
+				UINT nKeyOffset;			// Times 中的起始下标
+				UINT nKeyCount;
+				UINT nRotationOffset;		// 以值为单位(每个值 3 个 UINT16); 常量轨道只有 1 个值
+				UINT nTranslationOffset;
+				UINT nScaleOffset;
+				UINT nFlags;				// CompressedTrackFlags
+			};
+
+			/// @brief 压缩动画片段
+			/// 每根骨骼的误差按其所在最长骨骼链的骨骼数平分, 并以骨骼到最远子孙关节的距离估计旋转/缩放误差
+			/// @param boneHierarchy 	父骨骼下标
+			/// @param boneOffsets 		骨骼偏移矩阵(绑定姿势的逆)
+			void Build(const AnimationClip& clip, const std::vector<int>& boneHierarchy,
+					   const std::vector<DirectX::XMFLOAT4X4>& boneOffsets, const AnimationCompressionDesc& desc);
+
+			/// @brief 解压 t 时刻各骨骼的局部变换
+			/// @param pLocal 调用方提供的缓冲区, 至少容纳 Tracks.size() 个矩阵
+			void Evaluate(float t, DirectX::XMFLOAT4X4* pLocal) const;
+
+			float GetStartTime() const { return fStartTime; }
+			float GetEndTime() const { return fEndTime; }
+			UINT GetKeyCount() const { return (UINT)Times.size(); }
+			size_t GetByteSize() const;
+
+			float fStartTime = 0.0f;
+			float fEndTime = 0.0f;
+			DirectX::XMFLOAT3 vec3TranslationMin, vec3TranslationExtent;	// 平移的量化范围
+			DirectX::XMFLOAT3 vec3ScaleMin, vec3ScaleExtent;				// 缩放的量化范围
+
+			std::vector<BoneTrack> Tracks;
+			std::vector<float> Times;
+			std::vector<UINT16> Rotations;
+			std::vector<UINT16> Translations;
+			std::vector<UINT16> Scales;
+		};
+
+		/// @brief 预先解析的动画片段
+		/// 由 SkinnedAnimation::ResolveClip 取得, 求值时不再按名字查找; 
+		/// Set / PackClips / CompressClips 之后需要重新解析(ClipHandle 不受影响)
+		struct ResolvedClip
+		{
+			const AnimationClip* pClip = nullptr;
+			const PackedClip* pPacked = nullptr;
+			const CompressedClip* pCompressed = nullptr;
+			float fStartTime = 0.0f;
+			float fEndTime = 0.0f;
+
+			bool IsValid() const { return pClip || pPacked || pCompressed; }
+		};
+
+		/// @brief 驻留的动画片段句柄
+		/// 由 SkinnedAnimation::FindClip 取得, 为该蒙皮动画内部片段表的下标; 
+		/// PackClips / CompressClips 之后仍然有效, Set 之后失效, 不能用于其它 SkinnedAnimation
+		struct ClipHandle
+		{
+			UINT nIndex = (UINT)-1;
+
+			bool IsValid() const { return nIndex != (UINT)-1; }
+			bool operator==(const ClipHandle& other) const { return nIndex == other.nIndex; }
+			bool operator!=(const ClipHandle& other) const { return nIndex != other.nIndex; }
+		};
+
+		/// @brief GetFinalTransforms 使用的临时缓冲区
+		/// 每个线程各持有一个并重复使用, 容量足够后求值不再分配内存
+		struct AnimationScratch
+		{
+			std::vector<DirectX::XMFLOAT4X4> Transforms;	// 先存放局部变换, 再原地累乘为到根骨骼的变换
+		};
 		
 		class SkinnedAnimation
 		{
 		public:	
+			SkinnedAnimation() = default;
+			// 复制后重新解析片段表, 使其指向自身的片段; 句柄在副本中同样有效
+			SkinnedAnimation(const SkinnedAnimation& other);
+			SkinnedAnimation& operator=(const SkinnedAnimation& other);
+			SkinnedAnimation(SkinnedAnimation&&) = default;
+			SkinnedAnimation& operator=(SkinnedAnimation&&) = default;
+
 			UINT BoneCount() const;
 			
 			float GetClipStartTime(const std::string& clipName) const;
@@ -46,13 +201,57 @@ namespace D3DHelper
 			
 			void Set(std::vector<int>& boneHierarchy, std::vector<DirectX::XMFLOAT4X4>& boneOffsets, std::unordered_map<std::string, AnimationClip>& animations);
 			
-			void GetFinalTransforms(const std::string& clipName, float timePos, std::vector<DirectX::XMFLOAT4X4>& finalTransforms) const;
+			// 片段不存在时输出调试信息, finalTransforms 保持不变
+			void GetFinalTransforms(const std::string& clipName, float timePos, std::vector<DirectX::XMFLOAT4X4>& finalTransforms, AnimationCursor* pCursor = nullptr) const;
+
+			/// @brief 按名字解析动画片段; 片段不存在时返回的 ResolvedClip 无效
+			ResolvedClip ResolveClip(const std::string& clipName) const;
+
+			/// @brief 查找动画片段的句柄, 每个片段只需查找一次; 片段不存在时返回无效句柄
+			ClipHandle FindClip(const std::string& clipName) const;
+			/// @brief 句柄对应的已解析片段; 句柄无效时返回的 ResolvedClip 也无效
+			const ResolvedClip& GetClip(ClipHandle clip) const;
+			const std::string& GetClipName(ClipHandle clip) const;
+			float GetClipStartTime(ClipHandle clip) const { return GetClip(clip).fStartTime; }
+			float GetClipEndTime(ClipHandle clip) const { return GetClip(clip).fEndTime; }
+
+			/// @brief 以句柄求值, 使用线程各自的临时缓冲区
+			/// @param pFinalTransforms 调用方提供的缓冲区, 至少容纳 BoneCount() 个矩阵
+			/// @return 句柄无效时返回 0, 输出不变
+			bool GetFinalTransforms(ClipHandle clip, float timePos, DirectX::XMFLOAT4X4* pFinalTransforms, AnimationCursor* pCursor = nullptr) const;
 
-			AnimationClip& GetAnimationClip(std::string& clipName){return Animations[clipName];}
+			/// @brief 不分配内存的 GetFinalTransforms
+			/// @param pFinalTransforms 调用方提供的缓冲区, 至少容纳 BoneCount() 个矩阵
+			/// @return 片段无效时返回 0, 输出不变
+			bool GetFinalTransforms(const ResolvedClip& clip, float timePos, DirectX::XMFLOAT4X4* pFinalTransforms, AnimationScratch& scratch, AnimationCursor* pCursor = nullptr) const;
+
+			// 对所有动画片段均匀重采样, 见 AnimationClip::Resample
+			void ResampleClips(float fSampleRate);
+
+			// 为所有动画片段生成 PackedClip, 之后 GetFinalTransforms 改用批量插值
+			void PackClips(float fSampleRate, QuaternionBlends emBlend = QUATERNION_BLEND_NLERP);
+
+			// 压缩所有动画片段, 之后 GetFinalTransforms 从压缩数据解压(PackClips 生成的片段优先)
+			void CompressClips(const AnimationCompressionDesc& desc);
+			const CompressedClip* GetCompressedClip(const std::string& clipName) const;
+
+			// 不存在时创建新片段; 通过返回的引用修改关键帧后需调用 RefreshClips
+			AnimationClip& GetAnimationClip(std::string& clipName);
+			// 重新解析片段表, 已有句柄保持不变
+			void RefreshClips();
 		private:
+			ResolvedClip LookupClip(const std::string& clipName) const;
+
 			std::vector<int> BoneHierarchy;
 			std::vector<DirectX::XMFLOAT4X4> BoneOffsets;
 			std::unordered_map<std::string, AnimationClip> Animations;
+			std::unordered_map<std::string, PackedClip> PackedAnimations;
+			std::unordered_map<std::string, CompressedClip> CompressedAnimations;
+			QuaternionBlends emPackedBlend = QUATERNION_BLEND_NLERP;
+
+			std::unordered_map<std::string, UINT> ClipIndices;		// 片段名 -> ClipHandle::nIndex
+			std::vector<std::string> ClipNames;
+			std::vector<ResolvedClip> Clips;
 		};
 		
 	};
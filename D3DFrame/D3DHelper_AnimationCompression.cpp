@@ -0,0 +1,334 @@
+#include "D3DHelper_Animation.h"
+#include <algorithm>
+
+using namespace D3DHelper::Animation;
+using namespace DirectX;
+
+// smallest-three 中其余 3 个分量的绝对值不超过 1/sqrt(2)
+#define SMALLEST_THREE_RANGE 0.707106781f
+
+// 省略绝对值最大的分量(由单位长度还原), 其余 3 个分量各 15 位, 最大分量的下标放在前两个值的最高位
+static void EncodeQuaternion(const XMFLOAT4& q, UINT16* p)
+{
+	float c[4] = {q.x, q.y, q.z, q.w};
+	UINT nLargest = 0;
+	for(UINT i = 1; i < 4; ++i)
+	{
+		if(fabsf(c[i]) > fabsf(c[nLargest]))
+			nLargest = i;
+	}
+
+	// q 与 -q 表示同一旋转, 翻转后省略的分量总为正
+	float fSign = c[nLargest] < 0.0f? -1.0f: 1.0f;
+	UINT16 v[3];
+	for(UINT i = 0, j = 0; i < 4; ++i)
+	{
+		if(i == nLargest)
+			continue;
+		float f = c[i] * fSign / SMALLEST_THREE_RANGE * 0.5f + 0.5f;
+		v[j++] = (UINT16)(min(max(f, 0.0f), 1.0f) * 32767.0f + 0.5f);
+	}
+
+	p[0] = v[0] | (UINT16)((nLargest & 1) << 15);
+	p[1] = v[1] | (UINT16)((nLargest >> 1) << 15);
+	p[2] = v[2];
+}
+
+static XMVECTOR DecodeQuaternion(const UINT16* p)
+{
+	UINT nLargest = (p[0] >> 15) | ((p[1] >> 15) << 1);
+	float v[3], c[4];
+	float fSum = 0.0f;
+
+	for(UINT j = 0; j < 3; ++j)
+	{
+		v[j] = ((p[j] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+		fSum += v[j] * v[j];
+	}
+	for(UINT i = 0, j = 0; i < 4; ++i)
+		c[i] = i == nLargest? sqrtf(max(1.0f - fSum, 0.0f)): v[j++];
+
+	return XMVectorSet(c[0], c[1], c[2], c[3]);
+}
+
+static void EncodeVector(const XMFLOAT3& v, const XMFLOAT3& vMin, const XMFLOAT3& vExtent, UINT16* p)
+{
+	const float* pValue = &v.x;
+	const float* pMin = &vMin.x;
+	const float* pExtent = &vExtent.x;
+
+	for(UINT i = 0; i < 3; ++i)
+	{
+		float f = pExtent[i] > 0.0f? (pValue[i] - pMin[i]) / pExtent[i]: 0.0f;
+		p[i] = (UINT16)(min(max(f, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	}
+}
+
+static XMVECTOR DecodeVector(const UINT16* p, const XMFLOAT3& vMin, const XMFLOAT3& vExtent)
+{
+	return XMVectorSet(vMin.x + p[0] * (vExtent.x / 65535.0f),
+					   vMin.y + p[1] * (vExtent.y / 65535.0f),
+					   vMin.z + p[2] * (vExtent.z / 65535.0f), 0.0f);
+}
+
+// 在骨骼的第 k0 与 k1 个关键帧之间插值; 常量轨道两端取同一个值
+static void SampleTrack(const CompressedClip& clip, const CompressedClip::BoneTrack& track, UINT k0, UINT k1, float f,
+						XMVECTOR& S, XMVECTOR& Q, XMVECTOR& T)
+{
+	UINT r0 = track.nRotationOffset, r1 = r0;
+	UINT t0 = track.nTranslationOffset, t1 = t0;
+	UINT s0 = track.nScaleOffset, s1 = s0;
+
+	if(!(track.nFlags & CompressedClip::COMPRESSED_TRACK_CONSTANT_ROTATION))
+		r0 += k0, r1 += k1;
+	if(!(track.nFlags & CompressedClip::COMPRESSED_TRACK_CONSTANT_TRANSLATION))
+		t0 += k0, t1 += k1;
+	if(!(track.nFlags & CompressedClip::COMPRESSED_TRACK_CONSTANT_SCALE))
+		s0 += k0, s1 += k1;
+
+	// 常量轨道及落在关键帧上时两端相同, 只解码一次
+	Q = DecodeQuaternion(&clip.Rotations[r0 * 3]);
+	if(r1 != r0)
+	{
+		XMVECTOR q1 = DecodeQuaternion(&clip.Rotations[r1 * 3]);
+		if(XMVectorGetX(XMVector4Dot(Q, q1)) < 0.0f)
+			q1 = XMVectorNegate(q1);
+		Q = XMQuaternionNormalize(XMVectorLerp(Q, q1, f));
+	}
+
+	T = DecodeVector(&clip.Translations[t0 * 3], clip.vec3TranslationMin, clip.vec3TranslationExtent);
+	if(t1 != t0)
+		T = XMVectorLerp(T, DecodeVector(&clip.Translations[t1 * 3], clip.vec3TranslationMin, clip.vec3TranslationExtent), f);
+
+	S = DecodeVector(&clip.Scales[s0 * 3], clip.vec3ScaleMin, clip.vec3ScaleExtent);
+	if(s1 != s0)
+		S = XMVectorLerp(S, DecodeVector(&clip.Scales[s1 * 3], clip.vec3ScaleMin, clip.vec3ScaleExtent), f);
+}
+
+static XMMATRIX PoseMatrix(FXMVECTOR S, FXMVECTOR Q, FXMVECTOR T)
+{
+	return XMMatrixAffineTransformation(S, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), Q, T);
+}
+
+// 以关节为中心、沿 3 个轴距离 fDistance 的 6 个测试点估计两个局部变换造成的最大位移
+// 行向量约定下测试点 d * e_i 变换为 d * r[i] + r[3]
+static float PoseError(FXMMATRIX A, CXMMATRIX B, float fDistance)
+{
+	XMVECTOR dT = XMVectorSubtract(A.r[3], B.r[3]);
+	float fError = XMVectorGetX(XMVector3Length(dT));
+
+	for(UINT i = 0; i < 3; ++i)
+	{
+		XMVECTOR dR = XMVectorScale(XMVectorSubtract(A.r[i], B.r[i]), fDistance);
+		fError = max(fError, XMVectorGetX(XMVector3Length(XMVectorAdd(dT, dR))));
+		fError = max(fError, XMVectorGetX(XMVector3Length(XMVectorSubtract(dT, dR))));
+	}
+	return fError;
+}
+
+static XMMATRIX KeyframeMatrix(const Keyframe& key)
+{
+	return PoseMatrix(XMLoadFloat3(&key.vec3Scale), XMLoadFloat4(&key.vec4RotationQuat), XMLoadFloat3(&key.vec3Translation));
+}
+
+// 用第 a 与 e 个关键帧插值重建 (a, e) 之间的关键帧, 检查误差是否都在 fTolerance 以内
+static bool SpanWithinTolerance(const CompressedClip& clip, const CompressedClip::BoneTrack& track, const std::vector<Keyframe>& keys,
+								const std::vector<XMFLOAT4X4>& exact, UINT a, UINT e, float fTolerance, float fDistance)
+{
+	for(UINT i = a + 1; i < e; ++i)
+	{
+		XMVECTOR S, Q, T;
+		float fSpan = keys[e].nTimePos - keys[a].nTimePos;
+		float f = fSpan > 0.0f? (keys[i].nTimePos - keys[a].nTimePos) / fSpan: 0.0f;
+		SampleTrack(clip, track, a, e, f, S, Q, T);
+		if(PoseError(PoseMatrix(S, Q, T), XMLoadFloat4x4(&exact[i]), fDistance) > fTolerance)
+			return 0;
+	}
+	return 1;
+}
+
+// 将某一通道替换为第一个关键帧的值后, 所有关键帧的误差是否都在 fTolerance 以内
+static bool ChannelIsConstant(const CompressedClip& clip, CompressedClip::BoneTrack track, UINT nFlag,
+							  const std::vector<XMFLOAT4X4>& exact, float fTolerance, float fDistance)
+{
+	track.nFlags = nFlag;
+	for(UINT i = 0; i < exact.size(); ++i)
+	{
+		XMVECTOR S, Q, T;
+		SampleTrack(clip, track, i, i, 0.0f, S, Q, T);
+		if(PoseError(PoseMatrix(S, Q, T), XMLoadFloat4x4(&exact[i]), fDistance) > fTolerance)
+			return 0;
+	}
+	return 1;
+}
+
+void CompressedClip::Build(const AnimationClip& clip, const std::vector<int>& boneHierarchy,
+						   const std::vector<XMFLOAT4X4>& boneOffsets, const AnimationCompressionDesc& desc)
+{
+	UINT nBones = (UINT)clip.BoneAnimations.size();
+	fStartTime = nBones? clip.GetStartTime(): 0.0f;
+	fEndTime = nBones? clip.GetEndTime(): 0.0f;
+	Tracks.resize(nBones);
+	Times.clear();
+	Rotations.clear();
+	Translations.clear();
+	Scales.clear();
+
+	// 量化范围
+	XMVECTOR tMin = XMVectorReplicate(FLT_MAX), tMax = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR sMin = XMVectorReplicate(FLT_MAX), sMax = XMVectorReplicate(-FLT_MAX);
+	for(const BoneAnimation& bone : clip.BoneAnimations)
+	{
+		for(const Keyframe& key : bone.Keyframes)
+		{
+			tMin = XMVectorMin(tMin, XMLoadFloat3(&key.vec3Translation));
+			tMax = XMVectorMax(tMax, XMLoadFloat3(&key.vec3Translation));
+			sMin = XMVectorMin(sMin, XMLoadFloat3(&key.vec3Scale));
+			sMax = XMVectorMax(sMax, XMLoadFloat3(&key.vec3Scale));
+		}
+	}
+	if(!nBones)
+		tMin = tMax = sMin = sMax = XMVectorZero();
+	XMStoreFloat3(&vec3TranslationMin, tMin);
+	XMStoreFloat3(&vec3TranslationExtent, XMVectorSubtract(tMax, tMin));
+	XMStoreFloat3(&vec3ScaleMin, sMin);
+	XMStoreFloat3(&vec3ScaleExtent, XMVectorSubtract(sMax, sMin));
+
+	// 骨骼链: 父骨骼的下标总小于子骨骼(与 GetFinalTransforms 相同的假设)
+	// nDepth + nHeight - 1 为经过该骨骼的最长链的骨骼数, fReach 为绑定姿势下该骨骼到最远子孙关节的路径长度
+	std::vector<UINT> nDepth(nBones, 1), nHeight(nBones, 1);
+	std::vector<float> fReach(nBones, 0.0f);
+	std::vector<XMFLOAT3> bindPositions(nBones, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	bool bHierarchy = boneHierarchy.size() >= nBones && boneOffsets.size() >= nBones;
+
+	if(bHierarchy)
+	{
+		for(UINT b = 0; b < nBones; ++b)
+		{
+			XMMATRIX offset = XMLoadFloat4x4(&boneOffsets[b]);
+			XMStoreFloat3(&bindPositions[b], XMMatrixInverse(nullptr, offset).r[3]);
+			if(boneHierarchy[b] >= 0)
+				nDepth[b] = nDepth[boneHierarchy[b]] + 1;
+		}
+		for(UINT b = nBones; b-- > 0; )
+		{
+			int p = boneHierarchy[b];
+			if(p < 0)
+				continue;
+			float fLength = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&bindPositions[b]), XMLoadFloat3(&bindPositions[p]))));
+			nHeight[p] = max(nHeight[p], nHeight[b] + 1);
+			fReach[p] = max(fReach[p], fReach[b] + fLength);
+		}
+	}
+
+	std::vector<XMFLOAT4X4> exact;
+	std::vector<UINT> retained;
+	for(UINT b = 0; b < nBones; ++b)
+	{
+		const std::vector<Keyframe>& keys = clip.BoneAnimations[b].Keyframes;
+		UINT n = (UINT)keys.size();
+		float fTolerance = desc.fTolerance / (nDepth[b] + nHeight[b] - 1);
+		float fDistance = max(desc.fShellDistance, fReach[b]);
+
+		// 先量化全部关键帧, 误差检查基于解压后的值
+		BoneTrack& track = Tracks[b];
+		track.nKeyOffset = (UINT)Times.size();
+		track.nRotationOffset = (UINT)Rotations.size() / 3;
+		track.nTranslationOffset = (UINT)Translations.size() / 3;
+		track.nScaleOffset = (UINT)Scales.size() / 3;
+		track.nFlags = 0;
+
+		Rotations.resize(Rotations.size() + n * 3);
+		Translations.resize(Translations.size() + n * 3);
+		Scales.resize(Scales.size() + n * 3);
+		exact.resize(n);
+		for(UINT k = 0; k < n; ++k)
+		{
+			EncodeQuaternion(keys[k].vec4RotationQuat, &Rotations[(track.nRotationOffset + k) * 3]);
+			EncodeVector(keys[k].vec3Translation, vec3TranslationMin, vec3TranslationExtent, &Translations[(track.nTranslationOffset + k) * 3]);
+			EncodeVector(keys[k].vec3Scale, vec3ScaleMin, vec3ScaleExtent, &Scales[(track.nScaleOffset + k) * 3]);
+			XMStoreFloat4x4(&exact[k], KeyframeMatrix(keys[k]));
+		}
+
+		// 常量轨道: 3 个通道各占误差的 1/3
+		UINT nConstantFlags[] = {COMPRESSED_TRACK_CONSTANT_ROTATION, COMPRESSED_TRACK_CONSTANT_TRANSLATION, COMPRESSED_TRACK_CONSTANT_SCALE};
+		for(UINT nFlag : nConstantFlags)
+		{
+			if(ChannelIsConstant(*this, track, nFlag, exact, fTolerance / 3.0f, fDistance))
+				track.nFlags |= nFlag;
+		}
+
+		// 贪心地删除关键帧: 从上一个保留的关键帧出发, 尽可能向后延伸
+		retained.assign(1, 0);
+		if(track.nFlags != (COMPRESSED_TRACK_CONSTANT_ROTATION | COMPRESSED_TRACK_CONSTANT_TRANSLATION | COMPRESSED_TRACK_CONSTANT_SCALE))
+		{
+			for(UINT a = 0; a + 1 < n; )
+			{
+				UINT e = a + 1;
+				while(e + 1 < n && SpanWithinTolerance(*this, track, keys, exact, a, e + 1, fTolerance, fDistance))
+					++e;
+				retained.push_back(e);
+				a = e;
+			}
+		}
+
+		// 将保留的关键帧前移, 常量轨道只保留第一个值
+		for(UINT j = 0; j < retained.size(); ++j)
+		{
+			UINT k = retained[j];
+			Times.push_back(keys[k].nTimePos);
+			if(!(track.nFlags & COMPRESSED_TRACK_CONSTANT_ROTATION))
+				std::copy_n(&Rotations[(track.nRotationOffset + k) * 3], 3, &Rotations[(track.nRotationOffset + j) * 3]);
+			if(!(track.nFlags & COMPRESSED_TRACK_CONSTANT_TRANSLATION))
+				std::copy_n(&Translations[(track.nTranslationOffset + k) * 3], 3, &Translations[(track.nTranslationOffset + j) * 3]);
+			if(!(track.nFlags & COMPRESSED_TRACK_CONSTANT_SCALE))
+				std::copy_n(&Scales[(track.nScaleOffset + k) * 3], 3, &Scales[(track.nScaleOffset + j) * 3]);
+		}
+		track.nKeyCount = (UINT)retained.size();
+
+		UINT nCount = (UINT)retained.size();
+		Rotations.resize((track.nRotationOffset + (track.nFlags & COMPRESSED_TRACK_CONSTANT_ROTATION? 1: nCount)) * 3);
+		Translations.resize((track.nTranslationOffset + (track.nFlags & COMPRESSED_TRACK_CONSTANT_TRANSLATION? 1: nCount)) * 3);
+		Scales.resize((track.nScaleOffset + (track.nFlags & COMPRESSED_TRACK_CONSTANT_SCALE? 1: nCount)) * 3);
+	}
+
+	Times.shrink_to_fit();
+	Rotations.shrink_to_fit();
+	Translations.shrink_to_fit();
+	Scales.shrink_to_fit();
+}
+
+void CompressedClip::Evaluate(float t, XMFLOAT4X4* pLocal) const
+{
+	for(UINT b = 0; b < Tracks.size(); ++b)
+	{
+		const BoneTrack& track = Tracks[b];
+		const float* pTimes = &Times[track.nKeyOffset];
+		UINT n = track.nKeyCount;
+		UINT k0 = 0, k1 = 0;
+		float f = 0.0f;
+
+		if(n > 1 && t > pTimes[0])
+		{
+			if(t >= pTimes[n - 1])
+				k0 = k1 = n - 1;
+			else
+			{
+				// 删减后每根骨骼的关键帧较少, 直接二分查找
+				k1 = (UINT)(std::upper_bound(pTimes, pTimes + n, t) - pTimes);
+				k0 = k1 - 1;
+				f = (t - pTimes[k0]) / (pTimes[k1] - pTimes[k0]);
+			}
+		}
+
+		XMVECTOR S, Q, T;
+		SampleTrack(*this, track, k0, k1, f, S, Q, T);
+		XMStoreFloat4x4(&pLocal[b], PoseMatrix(S, Q, T));
+	}
+}
+
+size_t CompressedClip::GetByteSize() const
+{
+	return sizeof(*this) + Tracks.size() * sizeof(BoneTrack) + Times.size() * sizeof(float) +
+		   (Rotations.size() + Translations.size() + Scales.size()) * sizeof(UINT16);
+}
@@ -0,0 +1,100 @@
+#include "D3DHelper_AnimationLod.h"
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+namespace
+{
+	const UINT INVISIBLE_LEVEL = MAX_ANIMATION_LOD_LEVEL + 1;
+
+	// 距离 fFullRateDistance 以内为 0 级, 之后每翻倍升一级
+	UINT LevelFromDistance(float fDistance, float fFullRateDistance)
+	{
+		if(fDistance <= fFullRateDistance || fFullRateDistance <= 0.0f)
+			return 0;
+
+		UINT nLevel = 1 + (UINT)floorf(log2f(fDistance / fFullRateDistance));
+		return min(nLevel, (UINT)MAX_ANIMATION_LOD_LEVEL);
+	}
+}
+
+UINT AnimationLodScheduler::Add(SkinnedInstance* pInstance, FXMMATRIX world)
+{
+	assert(pInstance);
+
+	UINT nIndex = (UINT)Instances.size();
+	Instances.push_back(pInstance);
+	Worlds.emplace_back();
+	Levels.push_back(0);
+
+	SetTransform(nIndex, world);
+	return nIndex;
+}
+
+void AnimationLodScheduler::SetTransform(UINT nIndex, FXMMATRIX world)
+{
+	assert(nIndex < Instances.size());
+	XMStoreFloat4x4(&Worlds[nIndex], world);
+}
+
+void AnimationLodScheduler::Schedule(const Camera& camera)
+{
+	XMVECTOR vEye = camera.GetPosition();
+	const BoundingFrustum& frustum = camera.GetMatrices().WorldFrustum;
+
+	nDueCount = 0;
+	for(UINT i = 0; i < Instances.size(); ++i)
+	{
+		SkinnedInstance* pInstance = Instances[i];
+
+		BoundingSphere local, sphere;
+		BoundingSphere::CreateFromBoundingBox(local, pInstance->Bounds);
+		local.Transform(sphere, XMLoadFloat4x4(&Worlds[i]));
+
+		UINT nLevel = Levels[i];
+		if(bCullInvisible && frustum.Contains(sphere) == DISJOINT)
+		{
+			Levels[i] = INVISIBLE_LEVEL;
+			pInstance->nUpdateInterval = 0;
+			pInstance->bUpdateDue = 0;
+			continue;
+		}
+
+		// 频率升高时立即切换; 只有距离明显超过阈值时才降低频率
+		float fDistance = max(XMVectorGetX(XMVector3Length(XMLoadFloat3(&sphere.Center) - vEye)) - sphere.Radius, 0.0f);
+		UINT nFine = LevelFromDistance(fDistance, fFullRateDistance);
+		UINT nCoarse = LevelFromDistance(fDistance / (1.0f + fHysteresis), fFullRateDistance);
+		UINT nNewLevel = nFine < nLevel? nFine: (nCoarse > nLevel? nCoarse: nLevel);
+
+		// 槽位作为相位, 相邻槽位依次落在不同的帧; 刚变为可见或频率升高时立即求值
+		UINT nInterval = 1u << nNewLevel;
+		bool bDue = ((nFrame + i) & (nInterval - 1)) == 0 || nNewLevel < nLevel;
+
+		Levels[i] = nNewLevel;
+		pInstance->nUpdateInterval = nInterval;
+		pInstance->bUpdateDue = bDue;
+		pInstance->bInterpolate = bInterpolate;
+		nDueCount += bDue;
+	}
+
+	++nFrame;
+}
+
+UINT AnimationLodScheduler::GetLevel(UINT nIndex) const
+{
+	return Levels[nIndex];
+}
+
+UINT AnimationLodScheduler::GetCount() const
+{
+	return (UINT)Instances.size();
+}
+
+void AnimationLodScheduler::Clear()
+{
+	Instances.clear();
+	Worlds.clear();
+	Levels.clear();
+	nFrame = 0;
+	nDueCount = 0;
+}
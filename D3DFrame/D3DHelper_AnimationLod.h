@@ -0,0 +1,54 @@
+#pragma once
+#ifndef _D3DHELPER_ANIMATIONLOD_H
+#define _D3DHELPER_ANIMATIONLOD_H
+#include "D3DBase.h"
+#include "D3DHelper.h"
+#include "Camera.h"
+
+#define MAX_ANIMATION_LOD_LEVEL 3		// 最低求值频率为每 (1 << MAX_ANIMATION_LOD_LEVEL) 帧一次
+
+namespace D3DHelper
+{
+	/// @brief 动画 LOD 调度器
+	/// 按蒙皮实例到摄像机的距离决定姿势的求值频率: 近处每帧求值, 之后距离每翻倍频率减半(1/2, 1/4, 1/8),
+	/// 视锥体外的实例暂停求值, 只推进时间. 同一级别的实例按槽位错开求值的帧, 使每帧的开销保持平稳.
+	/// Schedule 只设置实例的 nUpdateInterval / bUpdateDue / bInterpolate, 求值仍由 UpdateSkinnedInstances 完成
+	class AnimationLodScheduler
+	{
+	public:
+		float fFullRateDistance = 10.0f;	// 包围球表面到摄像机的距离小于该值时每帧求值
+		float fHysteresis = 0.25f;			// 滞后比例: 降低频率时, 距离需超过阈值的 (1 + fHysteresis) 倍
+		bool bInterpolate = 1;				// 降频的实例在两次求值之间插值; 为 0 时沿用上一次的姿势
+		bool bCullInvisible = 1;			// 视锥体外的实例暂停求值
+
+		/// @brief 注册蒙皮实例
+		/// @param pInstance 	蒙皮实例; 设置了 pBounds 时以动画后的包围盒计算距离与可见性
+		/// @param world 		世界变换矩阵
+		/// @return 			槽位索引
+		UINT Add(SkinnedInstance* pInstance, DirectX::FXMMATRIX world);
+
+		/// @brief 实例移动后更新其世界变换
+		void SetTransform(UINT nIndex, DirectX::FXMMATRIX world);
+
+		/// @brief 每帧在 UpdateSkinnedInstances 之前调用, 为所有槽位安排本帧的求值
+		/// @param camera 摄像机, 需已调用 UpdateViewMatrix
+		void Schedule(const Camera& camera);
+
+		/// @brief 槽位当前的级别; 求值间隔为 1 << 级别, 不可见时为 MAX_ANIMATION_LOD_LEVEL + 1
+		UINT GetLevel(UINT nIndex) const;
+		/// @brief 上一次 Schedule 安排求值的实例数
+		UINT GetDueCount() const { return nDueCount; }
+		UINT GetCount() const;
+		void Clear();
+
+	private:
+		std::vector<SkinnedInstance*> Instances;
+		std::vector<DirectX::XMFLOAT4X4> Worlds;
+		std::vector<UINT> Levels;
+
+		UINT nFrame = 0;
+		UINT nDueCount = 0;
+	};
+};
+
+#endif
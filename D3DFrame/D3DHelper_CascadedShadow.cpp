@@ -0,0 +1,160 @@
+#include "D3DHelper_CascadedShadow.h"
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+namespace
+{
+	// 外接球半径按 1/16 向上取整, 避免浮点误差使投影大小逐帧变化
+	const float CASCADE_RADIUS_QUANTUM = 1.0f / 16.0f;
+};
+
+void CascadedShadow::SetDesc(const CascadedShadowDesc& desc)
+{
+	Desc = desc;
+	Desc.nCascadeCount = max(1u, min(Desc.nCascadeCount, (UINT)MAX_NUM_CASCADE));
+	Desc.nResolution = max(Desc.nResolution, 16u);
+	bCacheValid = 0;
+}
+
+const CascadedShadowDesc& CascadedShadow::GetDesc() const
+{
+	return Desc;
+}
+
+void CascadedShadow::ComputeSplits(UINT nCount, float fNear, float fFar, float fLambda, float* pSplits)
+{
+	for(UINT i = 1; i <= nCount; ++i)
+	{
+		float fRatio = (float)i / nCount;
+		float fLog = fNear * powf(fFar / fNear, fRatio);
+		float fUniform = fNear + (fFar - fNear) * fRatio;
+		pSplits[i - 1] = fLambda * fLog + (1.0f - fLambda) * fUniform;
+	}
+	pSplits[nCount - 1] = fFar;
+}
+
+void CascadedShadow::Update(const Camera& camera, FXMVECTOR lightDir, const BoundingSphere* pSceneBounds)
+{
+	const CameraMatrices& matrices = camera.GetMatrices();
+	float fNear = camera.GetNearZ();
+	float fFar = min(Desc.fShadowDistance, camera.GetFarZ());
+	float splits[MAX_NUM_CASCADE];
+	ComputeSplits(Desc.nCascadeCount, fNear, fFar, Desc.fSplitLambda, splits);
+
+	// 光源的观察矩阵只取决于光线方向, 原点固定在世界原点, 纹素网格因此不随摄像机移动
+	XMVECTOR direction = XMVector3Normalize(lightDir);
+	XMFLOAT3 vec3Direction;
+	XMStoreFloat3(&vec3Direction, direction);
+	bool bLightChanged = memcmp(&vec3Direction, &vec3LightDirection, sizeof(XMFLOAT3)) != 0;
+	vec3LightDirection = vec3Direction;
+
+	XMVECTOR up = fabsf(vec3Direction.y) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMMATRIX lightView = XMMatrixLookToLH(XMVectorZero(), direction, up);
+
+	float fSceneNear = 0.0f;
+	if(pSceneBounds)
+		fSceneNear = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&pSceneBounds->Center), lightView)) - pSceneBounds->Radius;
+
+	// 投影深度 z / w 与观察空间深度 d 的关系: z = (d * _33 + _43) / d
+	const XMFLOAT4X4& proj = matrices.matProj;
+	XMMATRIX invViewProj = XMLoadFloat4x4(&matrices.matInvViewProj);
+	const XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f
+	);
+
+	for(UINT i = 0; i < Desc.nCascadeCount; ++i)
+	{
+		ShadowCascade& cascade = Cascades[i];
+		cascade.fSplitNear = i ? splits[i - 1] : fNear;
+		cascade.fSplitFar = splits[i];
+		cascade.bCached = i >= Desc.nFirstCachedCascade;
+
+		XMFLOAT3 corners[8];
+		float fNearZ = (cascade.fSplitNear * proj._33 + proj._43) / cascade.fSplitNear;
+		float fFarZ = (cascade.fSplitFar * proj._33 + proj._43) / cascade.fSplitFar;
+		ShadowCasterVolume::GetFrustumCorners(invViewProj, corners, fNearZ, fFarZ);
+
+		// 切片关于视线对称, 角点的重心位于视线上, 外接半径因此与摄像机朝向无关
+		XMVECTOR center = XMVectorZero();
+		for(UINT k = 0; k < 8; ++k)
+			center = XMVectorAdd(center, XMLoadFloat3(&corners[k]));
+		center = XMVectorScale(center, 1.0f / 8.0f);
+		float fRadius = 0.0f;
+		for(UINT k = 0; k < 8; ++k)
+			fRadius = max(fRadius, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&corners[k]), center))));
+		fRadius = ceilf(fRadius / CASCADE_RADIUS_QUANTUM) * CASCADE_RADIUS_QUANTUM;
+
+		XMFLOAT3 centerLS;
+		XMStoreFloat3(&centerLS, XMVector3TransformCoord(center, lightView));
+		float fNeededNear = pSceneBounds ? min(centerLS.z - fRadius, fSceneNear) : centerLS.z - 3.0f * fRadius;
+		float fNeededFar = centerLS.z + fRadius;
+
+		if(cascade.bCached && bCacheValid && !bLightChanged)
+		{
+			// 切片仍位于上一次的投影范围之内时沿用, 阴影图内容不变
+			float fReach = fRadius + cascade.fTexelSize;
+			if(fabsf(centerLS.x - cascade.vec2Center.x) + fReach <= cascade.fHalfWidth &&
+			   fabsf(centerLS.y - cascade.vec2Center.y) + fReach <= cascade.fHalfWidth &&
+			   fNeededNear >= cascade.fNearZ && fNeededFar <= cascade.fFarZ)
+			{
+				cascade.bDirty = 0;
+				continue;
+			}
+		}
+
+		// 中心对齐最多偏移一个纹素, 边缘的 PCF 再向外读取一个纹素, 半宽为此预留 2 个纹素
+		float fHalfWidth = cascade.bCached ? fRadius * (1.0f + Desc.fCacheMargin) : fRadius;
+		fHalfWidth *= (float)Desc.nResolution / (Desc.nResolution - 4);
+		float fTexel = 2.0f * fHalfWidth / Desc.nResolution;
+		float fCenterX = floorf(centerLS.x / fTexel) * fTexel;
+		float fCenterY = floorf(centerLS.y / fTexel) * fTexel;
+
+		// 缓存的级联在深度方向上同样留出余量
+		float fDepthMargin = cascade.bCached ? fRadius * Desc.fCacheMargin : 0.0f;
+		cascade.fNearZ = fNeededNear - fDepthMargin;
+		cascade.fFarZ = fNeededFar + fDepthMargin;
+		cascade.fTexelSize = fTexel;
+		cascade.vec2Center = XMFLOAT2(fCenterX, fCenterY);
+		cascade.fHalfWidth = fHalfWidth;
+
+		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(fCenterX - fHalfWidth, fCenterX + fHalfWidth, fCenterY - fHalfWidth,
+															 fCenterY + fHalfWidth, cascade.fNearZ, cascade.fFarZ);
+		XMMATRIX viewProj = XMMatrixMultiply(lightView, lightProj);
+		XMStoreFloat4x4(&cascade.matView, lightView);
+		XMStoreFloat4x4(&cascade.matProj, lightProj);
+		XMStoreFloat4x4(&cascade.matViewProj, viewProj);
+		XMStoreFloat4x4(&cascade.matShadowTransform, XMMatrixMultiply(viewProj, T));
+
+		// 缓存的阴影图在摄像机移动时继续使用, 投射体必须覆盖整个投影范围
+		cascade.Casters.Build(viewProj, direction, cascade.bCached ? NULL : corners);
+		cascade.bDirty = 1;
+	}
+	bCacheValid = 1;
+}
+
+void CascadedShadow::InvalidateCache()
+{
+	bCacheValid = 0;
+}
+
+UINT CascadedShadow::GetCascadeCount() const
+{
+	return Desc.nCascadeCount;
+}
+
+const ShadowCascade& CascadedShadow::GetCascade(UINT nIndex) const
+{
+	return Cascades[nIndex];
+}
+
+UINT CascadedShadow::GetDirtyCount() const
+{
+	UINT nDirty = 0;
+	for(UINT i = 0; i < Desc.nCascadeCount; ++i)
+		nDirty += Cascades[i].bDirty;
+	return nDirty;
+}
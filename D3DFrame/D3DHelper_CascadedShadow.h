@@ -0,0 +1,77 @@
+#pragma once
+#ifndef _D3DHELPER_CASCADEDSHADOW_H
+#define _D3DHELPER_CASCADEDSHADOW_H
+#include "D3DBase.h"
+#include "D3DHelper_Constant.h"
+#include "D3DHelper_ShadowCulling.h"
+#include "Camera.h"
+
+namespace D3DHelper
+{
+	/// @brief 级联阴影参数
+	struct CascadedShadowDesc
+	{
+		UINT nCascadeCount = MAX_NUM_CASCADE;		// 级联数, 不超过 MAX_NUM_CASCADE
+		UINT nResolution = 2048;					// 每个级联阴影图的边长(像素)
+		float fShadowDistance = 100.0f;				// 阴影覆盖的最远观察空间深度, 超过摄像机远平面时取远平面
+		float fSplitLambda = 0.75f;					// 对数划分与均匀划分的混合系数, 1 为纯对数划分
+		UINT nFirstCachedCascade = MAX_NUM_CASCADE;	// 从该级联起缓存阴影图, 缓存的级联只绘制静态投射体
+		float fCacheMargin = 0.25f;					// 缓存级联额外覆盖的范围(相对于半径), 摄像机在其中移动时不必重新绘制
+	};
+
+	/// @brief 单个级联
+	struct ShadowCascade
+	{
+		float fSplitNear = 0.0f, fSplitFar = 0.0f;	// 覆盖的观察空间深度范围
+		DirectX::XMFLOAT4X4 matView;				// 光源观察矩阵, 只与光线方向有关
+		DirectX::XMFLOAT4X4 matProj;				// 正交投影, 按纹素对齐
+		DirectX::XMFLOAT4X4 matViewProj;
+		DirectX::XMFLOAT4X4 matShadowTransform;		// 世界空间到阴影图纹理坐标([0, 1], y 向下)
+		DirectX::XMFLOAT2 vec2Center = {0.0f, 0.0f};	// 投影范围在光源观察空间中的中心, 对齐到纹素
+		float fHalfWidth = 0.0f;					// 投影范围的半宽
+		float fNearZ = 0.0f, fFarZ = 0.0f;			// 光源观察空间的深度范围
+		float fTexelSize = 0.0f;					// 一个纹素对应的世界空间边长
+		ShadowCasterVolume Casters;					// 投射体剔除; 缓存的级联覆盖整个投影范围, 否则只覆盖本级联的视锥体切片
+		bool bCached = 0;							// 阴影图被缓存, 只包含静态投射体
+		bool bDirty = 1;							// 本帧需要重新绘制
+	};
+
+	/// @brief 级联阴影(CPU 部分)
+	/// 按对数与均匀划分的混合把摄像机视锥体在 [near, fShadowDistance] 之间切分为若干切片, 每个级联以切片角点的外接球拟合
+	/// 正交投影: 球的半径与摄像机朝向无关, 投影中心再对齐到纹素网格, 摄像机旋转与平移时阴影边缘不会闪烁.
+	/// 远处的级联可以缓存: 拟合时放大 fCacheMargin, 只要当前切片仍位于上一次的投影范围之内, 且光线方向与静态投射体都没有变化,
+	/// 就沿用上一次的投影并把 bDirty 置 0, 渲染端保留其阴影图内容即可
+	class CascadedShadow
+	{
+	public:
+		/// @brief 修改参数, 所有级联在下一次 Update 时重新拟合
+		void SetDesc(const CascadedShadowDesc& desc);
+		const CascadedShadowDesc& GetDesc() const;
+
+		/// @brief 拟合各级联
+		/// @param camera 		摄像机, 需已调用 UpdateViewMatrix
+		/// @param lightDir 	光线的传播方向(世界空间), 不必归一化
+		/// @param pSceneBounds 场景包围球, 用于把光源近平面推到所有投射体之前; 为 NULL 时推到切片之前的一个切片直径处
+		void Update(const Camera& camera, DirectX::FXMVECTOR lightDir, const DirectX::BoundingSphere* pSceneBounds = NULL);
+
+		/// @brief 静态投射体发生变化, 缓存的级联在下一次 Update 时重新绘制
+		void InvalidateCache();
+
+		UINT GetCascadeCount() const;
+		const ShadowCascade& GetCascade(UINT nIndex) const;
+		/// @brief 本帧需要重新绘制的级联数
+		UINT GetDirtyCount() const;
+
+		/// @brief 计算划分距离
+		/// @param pSplits 	输出 nCount 个切片远端的深度, 最后一个等于 fFar
+		static void ComputeSplits(UINT nCount, float fNear, float fFar, float fLambda, float* pSplits);
+
+	private:
+		CascadedShadowDesc Desc;
+		ShadowCascade Cascades[MAX_NUM_CASCADE];
+		DirectX::XMFLOAT3 vec3LightDirection = {0.0f, 0.0f, 0.0f};
+		bool bCacheValid = 0;
+	};
+};
+
+#endif
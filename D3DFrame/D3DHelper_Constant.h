@@ -11,6 +11,7 @@
 #define WORLD_DEF_FOGRANGE 150.0f
 
 #define MATRIX_IDENTITY MathHelper::Identity4x4()
+#define MAX_NUM_CASCADE 4
 
 #include "D3DHelper_Light.h"
 
@@ -56,6 +57,10 @@ namespace D3DHelper
             DirectX::XMFLOAT2 fPerScenePad2 = {0.0f, 0.0f};
 
             Light::Light lights[MAX_NUM_LIGHT];
+
+            // 级联阴影, 见 D3DHelper::CascadedShadow; 不使用级联阴影的着色器不必声明
+            DirectX::XMFLOAT4X4 matCascadeTransforms[MAX_NUM_CASCADE];      // 世界空间到各级联阴影图的纹理坐标
+            DirectX::XMFLOAT4 vec4CascadeSplits = {0.0f, 0.0f, 0.0f, 0.0f}; // 各级联远端的观察空间深度
         };
 
         /// @brief 对象常量数据
@@ -0,0 +1,123 @@
+#include "D3DHelper_FrustumCulling.h"
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+UINT FrustumCuller::Add(const BoundingBox& bounds, FXMMATRIX world)
+{
+	UINT nIndex = nCount++;
+
+	// 保持 SoA 数组按 4 对齐, 补齐的槽位在任意平面外
+	UINT nPadded = (nIndex + 4) & ~3u;
+	if(CenterX.size() < nPadded)
+	{
+		CenterX.resize(nPadded, 0.0f);
+		CenterY.resize(nPadded, 0.0f);
+		CenterZ.resize(nPadded, 0.0f);
+		ExtentX.resize(nPadded, -FLT_MAX);
+		ExtentY.resize(nPadded, -FLT_MAX);
+		ExtentZ.resize(nPadded, -FLT_MAX);
+	}
+
+	SetTransform(nIndex, bounds, world);
+	return nIndex;
+}
+
+void FrustumCuller::SetTransform(UINT nIndex, const BoundingBox& bounds, FXMMATRIX world)
+{
+	assert(nIndex < nCount);
+
+	BoundingBox box;
+	bounds.Transform(box, world);
+
+	CenterX[nIndex] = box.Center.x;
+	CenterY[nIndex] = box.Center.y;
+	CenterZ[nIndex] = box.Center.z;
+	ExtentX[nIndex] = box.Extents.x;
+	ExtentY[nIndex] = box.Extents.y;
+	ExtentZ[nIndex] = box.Extents.z;
+}
+
+UINT FrustumCuller::Cull(const XMFLOAT4* pPlanes, UINT* pVisible) const
+{
+	// 每个平面的分量与分量绝对值各展开为 4 份
+	XMVECTOR vNormal[6][3], vAbsNormal[6][3], vDistance[6];
+	for(UINT p = 0; p < 6; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&pPlanes[p]);
+		XMVECTOR absPlane = XMVectorAbs(plane);
+		vNormal[p][0] = XMVectorSplatX(plane);
+		vNormal[p][1] = XMVectorSplatY(plane);
+		vNormal[p][2] = XMVectorSplatZ(plane);
+		vAbsNormal[p][0] = XMVectorSplatX(absPlane);
+		vAbsNormal[p][1] = XMVectorSplatY(absPlane);
+		vAbsNormal[p][2] = XMVectorSplatZ(absPlane);
+		vDistance[p] = XMVectorSplatW(plane);
+	}
+
+	UINT nVisible = 0;
+	for(UINT i = 0; i < CenterX.size(); i += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4((const XMFLOAT4*)&CenterX[i]);
+		XMVECTOR cy = XMLoadFloat4((const XMFLOAT4*)&CenterY[i]);
+		XMVECTOR cz = XMLoadFloat4((const XMFLOAT4*)&CenterZ[i]);
+		XMVECTOR ex = XMLoadFloat4((const XMFLOAT4*)&ExtentX[i]);
+		XMVECTOR ey = XMLoadFloat4((const XMFLOAT4*)&ExtentY[i]);
+		XMVECTOR ez = XMLoadFloat4((const XMFLOAT4*)&ExtentZ[i]);
+
+		// 中心到平面的有向距离加上半长在法线上的投影仍小于 0 时, 碰撞盒完全在该平面外侧
+		XMVECTOR vOutside = XMVectorFalseInt();
+		for(UINT p = 0; p < 6; ++p)
+		{
+			XMVECTOR d = XMVectorMultiplyAdd(cx, vNormal[p][0], vDistance[p]);
+			d = XMVectorMultiplyAdd(cy, vNormal[p][1], d);
+			d = XMVectorMultiplyAdd(cz, vNormal[p][2], d);
+			d = XMVectorMultiplyAdd(ex, vAbsNormal[p][0], d);
+			d = XMVectorMultiplyAdd(ey, vAbsNormal[p][1], d);
+			d = XMVectorMultiplyAdd(ez, vAbsNormal[p][2], d);
+			vOutside = XMVectorOrInt(vOutside, XMVectorLess(d, XMVectorZero()));
+		}
+
+		// 无分支压缩: 每个槽位都写入, 可见时才推进输出位置
+		uint32_t outside[4];
+		XMStoreInt4(outside, vOutside);
+		for(UINT k = 0; k < 4; ++k)
+		{
+			pVisible[nVisible] = i + k;
+			nVisible += ~outside[k] & 1;
+		}
+	}
+	return nVisible;
+}
+
+UINT FrustumCuller::Cull(const Camera& camera, UINT* pVisible) const
+{
+	return Cull(camera.GetMatrices().vec4FrustumPlanes, pVisible);
+}
+
+UINT FrustumCuller::GetCount() const
+{
+	return nCount;
+}
+
+void FrustumCuller::Reserve(UINT nCapacity)
+{
+	UINT nPadded = (nCapacity + 3) & ~3u;
+	CenterX.reserve(nPadded);
+	CenterY.reserve(nPadded);
+	CenterZ.reserve(nPadded);
+	ExtentX.reserve(nPadded);
+	ExtentY.reserve(nPadded);
+	ExtentZ.reserve(nPadded);
+}
+
+void FrustumCuller::Clear()
+{
+	nCount = 0;
+	CenterX.clear();
+	CenterY.clear();
+	CenterZ.clear();
+	ExtentX.clear();
+	ExtentY.clear();
+	ExtentZ.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef _D3DHELPER_FRUSTUMCULLING_H
+#define _D3DHELPER_FRUSTUMCULLING_H
+#include "D3DBase.h"
+#include "Camera.h"
+
+namespace D3DHelper
+{
+	/// @brief 批量视锥体剔除
+	/// 以世界空间 AABB 描述物体, 数据按 SoA 存放; Cull 每次取 4 个物体, 与 6 个世界空间平面做向量化的
+	/// 中心-半长测试, 结果以紧凑的索引列表输出. 与逐物体求逆并变换 BoundingFrustum 相比, 每帧只需读取
+	/// CameraMatrices 中的平面, 不需要任何矩阵运算. 测试是保守的: 不与视锥体相交的物体可能被判为可见, 反之不会
+	class FrustumCuller
+	{
+	public:
+		/// @brief 注册物体
+		/// @param bounds 	局部空间碰撞盒
+		/// @param world 	世界变换矩阵
+		/// @return 		槽位索引, 即 Cull 输出的索引
+		UINT Add(const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX world);
+
+		/// @brief 物体移动后更新其世界空间 AABB
+		void SetTransform(UINT nIndex, const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX world);
+
+		/// @brief 剔除所有槽位
+		/// @param pPlanes 		6 个世界空间平面, 约定同 CameraMatrices::vec4FrustumPlanes(法线指向内侧)
+		/// @param pVisible 	输出可见槽位的索引(升序), 容量至少为 GetCount() + 3
+		/// @return 			可见槽位数
+		UINT Cull(const DirectX::XMFLOAT4* pPlanes, UINT* pVisible) const;
+		/// @brief 以摄像机缓存的视锥体平面剔除, 摄像机需已调用 UpdateViewMatrix
+		UINT Cull(const Camera& camera, UINT* pVisible) const;
+
+		UINT GetCount() const;
+		void Reserve(UINT nCapacity);
+		void Clear();
+
+	private:
+		UINT nCount = 0;
+
+		// 以下数组的长度均按 4 对齐, 补齐的槽位半长为 -FLT_MAX, 总是被剔除
+		std::vector<float> CenterX, CenterY, CenterZ;
+		std::vector<float> ExtentX, ExtentY, ExtentZ;
+	};
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "D3DHelper_LightClustering.h"
+
+using namespace D3DHelper;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+namespace
+{
+	// 4 个球体与包围盒是否相交: 球心到盒的距离平方不超过半径平方
+	inline XMVECTOR SphereBoxMask(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR radius, const XMFLOAT3& vec3Min, const XMFLOAT3& vec3Max)
+	{
+		XMVECTOR vZero = XMVectorZero();
+		XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(XMVectorReplicate(vec3Min.x), x), XMVectorSubtract(x, XMVectorReplicate(vec3Max.x))), vZero);
+		XMVECTOR dy = XMVectorMax(XMVectorMax(XMVectorSubtract(XMVectorReplicate(vec3Min.y), y), XMVectorSubtract(y, XMVectorReplicate(vec3Max.y))), vZero);
+		XMVECTOR dz = XMVectorMax(XMVectorMax(XMVectorSubtract(XMVectorReplicate(vec3Min.z), z), XMVectorSubtract(z, XMVectorReplicate(vec3Max.z))), vZero);
+		XMVECTOR distSq = XMVectorMultiplyAdd(dz, dz, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dx, dx)));
+		return XMVectorLessOrEqual(distSq, XMVectorMultiply(radius, radius));
+	}
+};
+
+void LightClusterBuilder::LightSoA::Resize(UINT nCount)
+{
+	// 补齐的槽位位于无穷远处, 任何测试都不通过
+	UINT nPadded = (nCount + 3) & ~3u;
+	X.assign(nPadded, FLT_MAX);
+	Y.assign(nPadded, FLT_MAX);
+	Z.assign(nPadded, FLT_MAX);
+	Radius.assign(nPadded, 0.0f);
+	DirX.assign(nPadded, 0.0f);
+	DirY.assign(nPadded, 0.0f);
+	DirZ.assign(nPadded, 0.0f);
+	Cos.assign(nPadded, -1.0f);
+	Sin.assign(nPadded, 0.0f);
+	Index.assign(nPadded, UINT_MAX);
+}
+
+void LightClusterBuilder::SetDesc(const LightClusterDesc& desc)
+{
+	Desc = desc;
+	Desc.nTilesX = max(Desc.nTilesX, 1u);
+	Desc.nTilesY = max(Desc.nTilesY, 1u);
+	Desc.nSlices = max(Desc.nSlices, 1u);
+	Desc.fSpotCutoff = max(Desc.fSpotCutoff, 1e-6f);
+	ClusterMin.clear();
+}
+
+const LightClusterDesc& LightClusterBuilder::GetDesc() const
+{
+	return Desc;
+}
+
+void LightClusterBuilder::UpdateGrid(const XMFLOAT4X4& matProj)
+{
+	this->matProj = matProj;
+
+	// 透视投影: z_ndc = _33 + _43 / z, x_ndc = (x * _11 + z * _31) / z
+	fNearZ = -matProj._43 / matProj._33;
+	fFarZ = matProj._43 / (1.0f - matProj._33);
+
+	UINT nSlices = Desc.nSlices, nTilesX = Desc.nTilesX, nTilesY = Desc.nTilesY;
+	SliceZ.resize(nSlices + 1);
+	for(UINT s = 0; s <= nSlices; ++s)
+		SliceZ[s] = fNearZ * powf(fFarZ / fNearZ, (float)s / nSlices);
+	SliceZ[nSlices] = fFarZ;
+
+	ClusterMin.resize(nSlices * nTilesY * nTilesX);
+	ClusterMax.resize(ClusterMin.size());
+	SliceMin.resize(nSlices);
+	SliceMax.resize(nSlices);
+	for(UINT s = 0; s < nSlices; ++s)
+	{
+		float z[2] = { SliceZ[s], SliceZ[s + 1] };
+		SliceMin[s] = XMFLOAT3(FLT_MAX, FLT_MAX, z[0]);
+		SliceMax[s] = XMFLOAT3(-FLT_MAX, -FLT_MAX, z[1]);
+		for(UINT ty = 0; ty < nTilesY; ++ty)
+		{
+			float ndcY[2] = { 1.0f - 2.0f * (ty + 1) / nTilesY, 1.0f - 2.0f * ty / nTilesY };
+			for(UINT tx = 0; tx < nTilesX; ++tx)
+			{
+				float ndcX[2] = { 2.0f * tx / nTilesX - 1.0f, 2.0f * (tx + 1) / nTilesX - 1.0f };
+
+				// 簇的侧面是平面, 包围盒由两端深度上的 4 个角点决定
+				XMFLOAT3 vec3Min(FLT_MAX, FLT_MAX, z[0]), vec3Max(-FLT_MAX, -FLT_MAX, z[1]);
+				for(UINT k = 0; k < 8; ++k)
+				{
+					float fZ = z[k >> 2];
+					float x = (ndcX[k & 1] - matProj._31) * fZ / matProj._11;
+					float y = (ndcY[(k >> 1) & 1] - matProj._32) * fZ / matProj._22;
+					vec3Min.x = min(vec3Min.x, x);
+					vec3Min.y = min(vec3Min.y, y);
+					vec3Max.x = max(vec3Max.x, x);
+					vec3Max.y = max(vec3Max.y, y);
+				}
+
+				UINT nCluster = (s * nTilesY + ty) * nTilesX + tx;
+				ClusterMin[nCluster] = vec3Min;
+				ClusterMax[nCluster] = vec3Max;
+				SliceMin[s].x = min(SliceMin[s].x, vec3Min.x);
+				SliceMin[s].y = min(SliceMin[s].y, vec3Min.y);
+				SliceMax[s].x = max(SliceMax[s].x, vec3Max.x);
+				SliceMax[s].y = max(SliceMax[s].y, vec3Max.y);
+			}
+		}
+	}
+
+	SliceCandidates.resize(nSlices);
+	SliceIndices.resize(nSlices);
+	Clusters.resize(ClusterMin.size());
+}
+
+void LightClusterBuilder::Build(const XMFLOAT4X4& matView, const XMFLOAT4X4& matProj,
+								const Light::Light* pLights, UINT nPointCount, UINT nSpotCount, ThreadPool* pPool)
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+	if(ClusterMin.empty() || memcmp(&matProj, &this->matProj, sizeof(XMFLOAT4X4)))
+		UpdateGrid(matProj);
+
+	// 变换到观察空间
+	XMMATRIX view = XMLoadFloat4x4(&matView);
+	UINT nCount = nPointCount + nSpotCount;
+	Lights.Resize(nCount);
+	for(UINT i = 0; i < nCount; ++i)
+	{
+		const Light::Light& light = pLights[i];
+		XMFLOAT3 pos;
+		XMStoreFloat3(&pos, XMVector3TransformCoord(XMLoadFloat3(&light.vec3Position), view));
+		Lights.X[i] = pos.x;
+		Lights.Y[i] = pos.y;
+		Lights.Z[i] = pos.z;
+		Lights.Radius[i] = max(light.nFalloffEnd, 0.0f);
+		Lights.Index[i] = i;
+
+		// 聚光灯因子 pow(cos, nSpotPower) 等于 fSpotCutoff 时的角度为锥体半角; nSpotPower 不大于 0 时按点光源处理
+		if(i >= nPointCount && light.nSpotPower > 0.0f)
+		{
+			XMFLOAT3 dir;
+			XMStoreFloat3(&dir, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.vec3Direction), view)));
+			float fCos = powf(Desc.fSpotCutoff, 1.0f / light.nSpotPower);
+			Lights.DirX[i] = dir.x;
+			Lights.DirY[i] = dir.y;
+			Lights.DirZ[i] = dir.z;
+			Lights.Cos[i] = fCos;
+			Lights.Sin[i] = sqrtf(max(1.0f - fCos * fCos, 0.0f));
+		}
+	}
+
+	pPool->ParallelFor(Desc.nSlices, 1, AssignRange, this);
+
+	// 拼接各切片的索引
+	UINT nTotal = 0;
+	UINT nClustersPerSlice = Desc.nTilesX * Desc.nTilesY;
+	nMaxClusterLights = 0;
+	for(UINT s = 0; s < Desc.nSlices; ++s)
+	{
+		for(UINT c = s * nClustersPerSlice; c < (s + 1) * nClustersPerSlice; ++c)
+		{
+			Clusters[c].nOffset += nTotal;
+			nMaxClusterLights = max(nMaxClusterLights, Clusters[c].nCount);
+		}
+		nTotal += (UINT)SliceIndices[s].size();
+	}
+	LightIndices.resize(nTotal);
+	for(UINT s = 0, nOffset = 0; s < Desc.nSlices; ++s)
+	{
+		std::copy(SliceIndices[s].begin(), SliceIndices[s].end(), LightIndices.begin() + nOffset);
+		nOffset += (UINT)SliceIndices[s].size();
+	}
+}
+
+void CALLBACK LightClusterBuilder::AssignRange(void* param, UINT nBegin, UINT nEnd)
+{
+	LightClusterBuilder* pBuilder = (LightClusterBuilder*)param;
+	for(UINT s = nBegin; s < nEnd; ++s)
+		pBuilder->AssignSlice(s);
+}
+
+void LightClusterBuilder::AssignSlice(UINT nSlice)
+{
+	// 先以整个切片的包围盒筛选光源, 切片内的每个簇只测试这些光源
+	std::vector<UINT> candidates;
+	for(UINT i = 0; i < Lights.X.size(); i += 4)
+	{
+		XMVECTOR mask = SphereBoxMask(XMLoadFloat4((const XMFLOAT4*)&Lights.X[i]), XMLoadFloat4((const XMFLOAT4*)&Lights.Y[i]),
+									  XMLoadFloat4((const XMFLOAT4*)&Lights.Z[i]), XMLoadFloat4((const XMFLOAT4*)&Lights.Radius[i]),
+									  SliceMin[nSlice], SliceMax[nSlice]);
+		uint32_t hits[4];
+		XMStoreInt4(hits, mask);
+		for(UINT k = 0; k < 4; ++k)
+			if(hits[k])
+				candidates.push_back(i + k);
+	}
+
+	LightSoA& cand = SliceCandidates[nSlice];
+	cand.Resize((UINT)candidates.size());
+	for(UINT j = 0; j < candidates.size(); ++j)
+	{
+		UINT i = candidates[j];
+		cand.X[j] = Lights.X[i];
+		cand.Y[j] = Lights.Y[i];
+		cand.Z[j] = Lights.Z[i];
+		cand.Radius[j] = Lights.Radius[i];
+		cand.DirX[j] = Lights.DirX[i];
+		cand.DirY[j] = Lights.DirY[i];
+		cand.DirZ[j] = Lights.DirZ[i];
+		cand.Cos[j] = Lights.Cos[i];
+		cand.Sin[j] = Lights.Sin[i];
+		cand.Index[j] = Lights.Index[i];
+	}
+
+	std::vector<UINT>& indices = SliceIndices[nSlice];
+	indices.clear();
+	UINT nClustersPerSlice = Desc.nTilesX * Desc.nTilesY;
+	for(UINT c = nSlice * nClustersPerSlice; c < (nSlice + 1) * nClustersPerSlice; ++c)
+	{
+		const XMFLOAT3& vec3Min = ClusterMin[c];
+		const XMFLOAT3& vec3Max = ClusterMax[c];
+		Clusters[c].nOffset = (UINT)indices.size();
+
+		// 聚光灯锥体与簇外接球的测试
+		XMVECTOR boxMin = XMLoadFloat3(&vec3Min), boxMax = XMLoadFloat3(&vec3Max);
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f);
+		float fRadius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boxMax, center)));
+		XMVECTOR vCenterX = XMVectorSplatX(center), vCenterY = XMVectorSplatY(center), vCenterZ = XMVectorSplatZ(center);
+		XMVECTOR vRadius = XMVectorReplicate(fRadius), vNegRadius = XMVectorReplicate(-fRadius);
+
+		for(UINT i = 0; i < cand.X.size(); i += 4)
+		{
+			XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&cand.X[i]);
+			XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&cand.Y[i]);
+			XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&cand.Z[i]);
+			XMVECTOR range = XMLoadFloat4((const XMFLOAT4*)&cand.Radius[i]);
+			XMVECTOR mask = SphereBoxMask(x, y, z, range, vec3Min, vec3Max);
+
+			// 锥体与球: 球心到锥面的距离超过半径, 或球位于锥顶之后, 或位于锥底之外时不相交
+			XMVECTOR vx = XMVectorSubtract(vCenterX, x), vy = XMVectorSubtract(vCenterY, y), vz = XMVectorSubtract(vCenterZ, z);
+			XMVECTOR lenSq = XMVectorMultiplyAdd(vz, vz, XMVectorMultiplyAdd(vy, vy, XMVectorMultiply(vx, vx)));
+			XMVECTOR v1 = XMVectorMultiplyAdd(vz, XMLoadFloat4((const XMFLOAT4*)&cand.DirZ[i]),
+											  XMVectorMultiplyAdd(vy, XMLoadFloat4((const XMFLOAT4*)&cand.DirY[i]),
+																  XMVectorMultiply(vx, XMLoadFloat4((const XMFLOAT4*)&cand.DirX[i]))));
+			XMVECTOR perp = XMVectorSqrt(XMVectorMax(XMVectorNegativeMultiplySubtract(v1, v1, lenSq), XMVectorZero()));
+			XMVECTOR closest = XMVectorNegativeMultiplySubtract(v1, XMLoadFloat4((const XMFLOAT4*)&cand.Sin[i]),
+																XMVectorMultiply(perp, XMLoadFloat4((const XMFLOAT4*)&cand.Cos[i])));
+			XMVECTOR cull = XMVectorOrInt(XMVectorGreater(closest, vRadius),
+										  XMVectorOrInt(XMVectorGreater(v1, XMVectorAdd(vRadius, range)), XMVectorLess(v1, vNegRadius)));
+			mask = XMVectorAndCInt(mask, cull);
+
+			uint32_t hits[4];
+			XMStoreInt4(hits, mask);
+			for(UINT k = 0; k < 4; ++k)
+				if(hits[k])
+					indices.push_back(cand.Index[i + k]);
+		}
+		Clusters[c].nCount = (UINT)indices.size() - Clusters[c].nOffset;
+	}
+}
+
+UINT LightClusterBuilder::GetClusterCount() const
+{
+	return (UINT)Clusters.size();
+}
+
+const LightCluster* LightClusterBuilder::GetClusters() const
+{
+	return Clusters.data();
+}
+
+const UINT* LightClusterBuilder::GetLightIndices() const
+{
+	return LightIndices.data();
+}
+
+UINT LightClusterBuilder::GetLightIndexCount() const
+{
+	return (UINT)LightIndices.size();
+}
+
+UINT LightClusterBuilder::GetMaxClusterLightCount() const
+{
+	return nMaxClusterLights;
+}
+
+BoundingBox LightClusterBuilder::GetClusterBounds(UINT nCluster) const
+{
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, XMLoadFloat3(&ClusterMin[nCluster]), XMLoadFloat3(&ClusterMax[nCluster]));
+	return bounds;
+}
+
+UINT LightClusterBuilder::GetClusterIndex(FXMVECTOR posView) const
+{
+	XMFLOAT3 pos;
+	XMStoreFloat3(&pos, posView);
+	if(pos.z < fNearZ || pos.z > fFarZ)
+		return UINT_MAX;
+
+	float fNdcX = pos.x * matProj._11 / pos.z + matProj._31;
+	float fNdcY = pos.y * matProj._22 / pos.z + matProj._32;
+	if(fNdcX < -1.0f || fNdcX > 1.0f || fNdcY < -1.0f || fNdcY > 1.0f)
+		return UINT_MAX;
+
+	XMFLOAT2 scaleBias = GetSliceScaleBias();
+	UINT nSlice = min((UINT)max(logf(pos.z) * scaleBias.x + scaleBias.y, 0.0f), Desc.nSlices - 1);
+	UINT nTileX = min((UINT)((fNdcX + 1.0f) * 0.5f * Desc.nTilesX), Desc.nTilesX - 1);
+	UINT nTileY = min((UINT)((1.0f - fNdcY) * 0.5f * Desc.nTilesY), Desc.nTilesY - 1);
+	return (nSlice * Desc.nTilesY + nTileY) * Desc.nTilesX + nTileX;
+}
+
+XMFLOAT2 LightClusterBuilder::GetSliceScaleBias() const
+{
+	float fScale = Desc.nSlices / logf(fFarZ / fNearZ);
+	return XMFLOAT2(fScale, -logf(fNearZ) * fScale);
+}
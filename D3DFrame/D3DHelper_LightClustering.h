@@ -0,0 +1,99 @@
+#pragma once
+#ifndef _D3DHELPER_LIGHTCLUSTERING_H
+#define _D3DHELPER_LIGHTCLUSTERING_H
+#include "D3DBase.h"
+#include "D3DHelper_Constant.h"
+#include "BaseHelper_Thread.h"
+
+namespace D3DHelper
+{
+	/// @brief 分簇光照的网格参数
+	struct LightClusterDesc
+	{
+		UINT nTilesX = 16;					// 屏幕横向的簇数
+		UINT nTilesY = 9;					// 屏幕纵向的簇数
+		UINT nSlices = 24;					// 深度方向的簇数, 在近平面与远平面之间按对数划分
+		float fSpotCutoff = 1.0f / 256.0f;	// 聚光灯因子低于该值的方向视为不受光照, 据此求出锥体半角
+	};
+
+	/// @brief 簇在索引表中的范围
+	struct LightCluster
+	{
+		UINT nOffset;
+		UINT nCount;
+	};
+
+	/// @brief 分簇光照的光源分配(CPU 部分)
+	/// 把观察空间视锥体划分为 nTilesX * nTilesY * nSlices 个簇(froxel), 每帧把点光源与聚光灯分到与其影响范围相交的簇中,
+	/// 得到每个簇的 (偏移, 数量) 与紧凑的光源索引表, 上传后像素着色器只需遍历所在簇的光源.
+	/// 点光源以 nFalloffEnd 为半径的球体与簇的 AABB 测试; 聚光灯另外以锥体与簇的外接球测试, 锥体半角取 nSpotPower 下聚光灯因子
+	/// 等于 fSpotCutoff 的角度. 两种测试都是保守的: 受光照的点所在的簇一定包含该光源.
+	/// 各深度切片由线程池并行处理: 先按深度范围筛选光源, 再对切片中的每个簇以 4 个光源为一组测试, 结果与线程数无关.
+	/// 簇的序号为 (nSlice * nTilesY + nTileY) * nTilesX + nTileX, 纵向自屏幕上方起
+	class LightClusterBuilder
+	{
+	public:
+		void SetDesc(const LightClusterDesc& desc);
+		const LightClusterDesc& GetDesc() const;
+
+		/// @brief 分配光源
+		/// @param matView 		观察矩阵(行向量约定)
+		/// @param matProj 		透视投影矩阵, 簇的划分随之更新
+		/// @param pLights 		光源, 按 [点光源..., 聚光灯...] 排列(与着色器中 ComputeLighting 的约定相同, 不含平行光)
+		/// @param nPointCount 	点光源数量
+		/// @param nSpotCount 	聚光灯数量
+		void Build(const DirectX::XMFLOAT4X4& matView, const DirectX::XMFLOAT4X4& matProj,
+				   const Light::Light* pLights, UINT nPointCount, UINT nSpotCount,
+				   BaseHelper::Thread::ThreadPool* pPool = NULL);
+
+		UINT GetClusterCount() const;
+		/// @brief 各簇在 GetLightIndices 中的范围, 数量为 GetClusterCount
+		const LightCluster* GetClusters() const;
+		/// @brief 紧凑的光源索引表, 每个簇内升序
+		const UINT* GetLightIndices() const;
+		UINT GetLightIndexCount() const;
+		/// @brief 单个簇中光源数量的最大值, 即像素着色的最坏开销
+		UINT GetMaxClusterLightCount() const;
+
+		/// @brief 簇在观察空间中的包围盒
+		DirectX::BoundingBox GetClusterBounds(UINT nCluster) const;
+		/// @brief 观察空间中的点所在的簇, 位于视锥体之外时返回 UINT_MAX
+		UINT GetClusterIndex(DirectX::FXMVECTOR posView) const;
+
+		/// @brief 着色器求深度切片: nSlice = floor(log(z) * x + y)
+		DirectX::XMFLOAT2 GetSliceScaleBias() const;
+
+	private:
+		// 观察空间中的光源, 结构数组按 4 对齐
+		struct LightSoA
+		{
+			std::vector<float> X, Y, Z, Radius;
+			std::vector<float> DirX, DirY, DirZ;
+			std::vector<float> Cos, Sin;		// 锥体半角; 点光源的方向为 0, Cos 为 -1, 锥体测试总是通过
+			std::vector<UINT> Index;
+
+			void Resize(UINT nCount);
+		};
+
+		LightClusterDesc Desc;
+		DirectX::XMFLOAT4X4 matProj;
+		float fNearZ = 0.0f, fFarZ = 0.0f;
+		std::vector<DirectX::XMFLOAT3> ClusterMin, ClusterMax;	// 簇的观察空间包围盒
+		std::vector<float> SliceZ;								// nSlices + 1 个切片边界
+		std::vector<DirectX::XMFLOAT3> SliceMin, SliceMax;		// 各切片的观察空间包围盒
+
+		LightSoA Lights;
+		std::vector<LightSoA> SliceCandidates;					// 各切片按深度筛选后的光源
+		std::vector<std::vector<UINT>> SliceIndices;			// 各切片输出的索引, 最后拼接
+		std::vector<LightCluster> Clusters;
+		std::vector<UINT> LightIndices;
+		UINT nMaxClusterLights = 0;
+
+		static void CALLBACK AssignRange(void* param, UINT nBegin, UINT nEnd);
+
+		void UpdateGrid(const DirectX::XMFLOAT4X4& matProj);
+		void AssignSlice(UINT nSlice);
+	};
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "D3DHelper_LodSelector.h"
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+UINT LodSelector::Add(const Resource::SubmeshGeometry* pSubmesh, const BoundingBox& bounds, FXMMATRIX world)
+{
+	assert(pSubmesh);
+
+	UINT nIndex = (UINT)Submeshes.size();
+	Submeshes.push_back(pSubmesh);
+
+	// 保持 SoA 数组按 4 对齐, 补齐的槽位永远选择原始网格且不会被读取
+	UINT nPadded = (nIndex + 4) & ~3u;
+	if(CenterX.size() < nPadded)
+	{
+		CenterX.resize(nPadded, 0.0f);
+		CenterY.resize(nPadded, 0.0f);
+		CenterZ.resize(nPadded, 0.0f);
+		Radius.resize(nPadded, 0.0f);
+		Levels.resize(nPadded, 0.0f);
+		for(UINT i = 0; i < MAX_MESH_LOD_COUNT - 1; ++i)
+			Errors[i].resize(nPadded, FLT_MAX);
+	}
+
+	SetTransform(nIndex, bounds, world);
+	return nIndex;
+}
+
+void LodSelector::SetTransform(UINT nIndex, const BoundingBox& bounds, FXMMATRIX world)
+{
+	assert(nIndex < Submeshes.size());
+
+	BoundingSphere local, sphere;
+	BoundingSphere::CreateFromBoundingBox(local, bounds);
+	local.Transform(sphere, world);
+
+	CenterX[nIndex] = sphere.Center.x;
+	CenterY[nIndex] = sphere.Center.y;
+	CenterZ[nIndex] = sphere.Center.z;
+	Radius[nIndex] = sphere.Radius;
+
+	// 简化误差是相对于子网格包围盒最大边长的比例, 换算为世界空间长度
+	float fSize = 2.0f * max(bounds.Extents.x, max(bounds.Extents.y, bounds.Extents.z));
+	float fScale = local.Radius > 0.0f ? sphere.Radius / local.Radius : 0.0f;
+
+	const std::vector<Resource::SubmeshLod>& lods = Submeshes[nIndex]->Lods;
+	for(UINT i = 0; i < MAX_MESH_LOD_COUNT - 1; ++i)
+		Errors[i][nIndex] = i < lods.size() ? lods[i].fError * fSize * fScale : FLT_MAX;
+}
+
+void LodSelector::Select(const Camera& camera, float fViewportHeight)
+{
+	XMFLOAT3 eye = camera.GetPosition3f();
+	XMVECTOR vEyeX = XMVectorReplicate(eye.x);
+	XMVECTOR vEyeY = XMVectorReplicate(eye.y);
+	XMVECTOR vEyeZ = XMVectorReplicate(eye.z);
+	XMVECTOR vNear = XMVectorReplicate(max(camera.GetNearZ(), 1e-4f));
+
+	// 世界空间误差 e 在距离 d 处投影到屏幕上的像素数为 e * fProjScale / d
+	XMVECTOR vProjScale = XMVectorReplicate(fViewportHeight / (2.0f * tanf(0.5f * camera.GetFovY())));
+	XMVECTOR vFineLimit = XMVectorReplicate(fPixelError);
+	XMVECTOR vCoarseLimit = XMVectorReplicate(fPixelError * (1.0f - fHysteresis));
+	XMVECTOR vOne = XMVectorSplatOne();
+
+	for(UINT i = 0; i < CenterX.size(); i += 4)
+	{
+		XMVECTOR dx = XMLoadFloat4((const XMFLOAT4*)&CenterX[i]) - vEyeX;
+		XMVECTOR dy = XMLoadFloat4((const XMFLOAT4*)&CenterY[i]) - vEyeY;
+		XMVECTOR dz = XMLoadFloat4((const XMFLOAT4*)&CenterZ[i]) - vEyeZ;
+		XMVECTOR vDist = XMVectorSqrt(dx * dx + dy * dy + dz * dz) - XMLoadFloat4((const XMFLOAT4*)&Radius[i]);
+		XMVECTOR vPixelScale = XMVectorDivide(vProjScale, XMVectorMax(vDist, vNear));
+
+		// 误差随级别单调递增, 满足阈值的级别数即为可用的最粗糙级别
+		XMVECTOR vFine = XMVectorZero();
+		XMVECTOR vCoarse = XMVectorZero();
+		for(UINT l = 0; l < MAX_MESH_LOD_COUNT - 1; ++l)
+		{
+			XMVECTOR vPixels = XMLoadFloat4((const XMFLOAT4*)&Errors[l][i]) * vPixelScale;
+			vFine += XMVectorAndInt(XMVectorLessOrEqual(vPixels, vFineLimit), vOne);
+			vCoarse += XMVectorAndInt(XMVectorLessOrEqual(vPixels, vCoarseLimit), vOne);
+		}
+
+		// 当前级别误差超过阈值时立即细化; 只有误差明显低于阈值时才粗化
+		XMVECTOR vLevel = XMLoadFloat4((const XMFLOAT4*)&Levels[i]);
+		vLevel = XMVectorSelect(vLevel, vFine, XMVectorLess(vFine, vLevel));
+		vLevel = XMVectorSelect(vLevel, vCoarse, XMVectorGreater(vCoarse, vLevel));
+		XMStoreFloat4((XMFLOAT4*)&Levels[i], vLevel);
+	}
+}
+
+void LodSelector::GetRange(UINT nIndex, UINT& nIndexCount, UINT& nStartIndexLocation) const
+{
+	assert(nIndex < Submeshes.size());
+
+	UINT nLevel = GetLevel(nIndex);
+	const Resource::SubmeshGeometry* pSubmesh = Submeshes[nIndex];
+	if(nLevel == 0)
+	{
+		nIndexCount = pSubmesh->nIndexCount;
+		nStartIndexLocation = pSubmesh->nStartIndexLocation;
+	}
+	else
+	{
+		nIndexCount = pSubmesh->Lods[nLevel - 1].nIndexCount;
+		nStartIndexLocation = pSubmesh->Lods[nLevel - 1].nStartIndexLocation;
+	}
+}
+
+UINT LodSelector::GetLevel(UINT nIndex) const
+{
+	return (UINT)Levels[nIndex];
+}
+
+UINT LodSelector::GetCount() const
+{
+	return (UINT)Submeshes.size();
+}
+
+void LodSelector::Clear()
+{
+	Submeshes.clear();
+	CenterX.clear();
+	CenterY.clear();
+	CenterZ.clear();
+	Radius.clear();
+	Levels.clear();
+	for(UINT i = 0; i < MAX_MESH_LOD_COUNT - 1; ++i)
+		Errors[i].clear();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef _D3DHELPER_LODSELECTOR_H
+#define _D3DHELPER_LODSELECTOR_H
+#include "D3DBase.h"
+#include "D3DHelper_Resource.h"
+#include "D3DHelper_MeshSimplifier.h"
+#include "Camera.h"
+
+namespace D3DHelper
+{
+	/// @brief 基于屏幕空间误差的 LOD 选择器
+	/// 每个槽位对应一个带有 LOD 链的子网格实例; 数据按 SoA 存放, Select 每次处理 4 个槽位.
+	/// RenderItem 的布局随 D3D12_SKINNED / D3D12_INSTANCE 宏变化, 因此选择器不直接持有渲染项,
+	/// 渲染项记录槽位(nLodIndex), 在 Select 之后通过 GetRange 取回索引范围
+	class LodSelector
+	{
+	public:
+		float fPixelError = 1.0f;		// 允许的屏幕空间误差(像素)
+		float fHysteresis = 0.25f;		// 滞后比例: 切换到更粗糙的级别时, 误差需低于 fPixelError * (1 - fHysteresis)
+
+		/// @brief 注册子网格实例
+		/// @param pSubmesh 	子网格, 其 Lods 为空时始终使用原始网格
+		/// @param bounds 		子网格的局部空间碰撞盒
+		/// @param world 		世界变换矩阵
+		/// @return 			槽位索引
+		UINT Add(const Resource::SubmeshGeometry* pSubmesh, const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX world);
+
+		/// @brief 实例移动或缩放后更新其包围球
+		void SetTransform(UINT nIndex, const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX world);
+
+		/// @brief 根据摄像机为所有槽位选择 LOD 级别
+		/// @param camera 			摄像机, 需已调用 UpdateViewMatrix
+		/// @param fViewportHeight 	视口高度(像素)
+		void Select(const Camera& camera, float fViewportHeight);
+
+		/// @brief 获取槽位当前选择的索引范围
+		void GetRange(UINT nIndex, UINT& nIndexCount, UINT& nStartIndexLocation) const;
+
+		UINT GetLevel(UINT nIndex) const;
+		UINT GetCount() const;
+		void Clear();
+
+	private:
+		std::vector<const Resource::SubmeshGeometry*> Submeshes;
+
+		// 以下数组的长度均按 4 对齐, 补齐的槽位半径为 0, 误差为 +inf
+		std::vector<float> CenterX, CenterY, CenterZ, Radius;
+		std::vector<float> Errors[MAX_MESH_LOD_COUNT - 1];	// LOD1 起每一级的世界空间误差
+		std::vector<float> Levels;							// 当前级别, 以浮点数存放便于向量化比较
+	};
+};
+
+#endif
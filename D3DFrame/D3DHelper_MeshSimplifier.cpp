@@ -0,0 +1,596 @@
+#include "D3DHelper_MeshSimplifier.h"
+#include "D3DHelper_Exception.h"
+
+using namespace D3DHelper::Geometry;
+using namespace D3DHelper::Resource;
+using namespace DirectX;
+
+#define INVALID_VERTEX 0xFFFFFFFF
+
+// 对称 4x4 矩阵形式的二次误差, 权重为三角形面积
+struct Quadric
+{
+	double a00, a01, a02, a03;
+	double a11, a12, a13;
+	double a22, a23;
+	double a33;
+	double w;
+};
+
+static void QuadricFromPlane(Quadric& q, double a, double b, double c, double d, double w)
+{
+	q.a00 = w * a * a; q.a01 = w * a * b; q.a02 = w * a * c; q.a03 = w * a * d;
+	q.a11 = w * b * b; q.a12 = w * b * c; q.a13 = w * b * d;
+	q.a22 = w * c * c; q.a23 = w * c * d;
+	q.a33 = w * d * d;
+	q.w = w;
+}
+
+static void QuadricAdd(Quadric& q, const Quadric& r)
+{
+	q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+	q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+	q.a22 += r.a22; q.a23 += r.a23;
+	q.a33 += r.a33;
+	q.w += r.w;
+}
+
+/// @brief 计算点到平面集合的加权平均平方距离
+static double QuadricError(const Quadric& q, const XMFLOAT3& p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	double e = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + q.a33
+			 + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+			 + 2.0 * (q.a03 * x + q.a13 * y + q.a23 * z);
+
+	if(q.w <= 0.0)
+		return 0.0;
+	e /= q.w;
+	return e < 0.0 ? 0.0 : e;
+}
+
+static bool IsFlipped(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, const XMFLOAT3& moved, UINT nMovedCorner)
+{
+	XMVECTOR a = XMLoadFloat3(&p0);
+	XMVECTOR b = XMLoadFloat3(&p1);
+	XMVECTOR c = XMLoadFloat3(&p2);
+	XMVECTOR n0 = XMVector3Cross(b - a, c - a);
+
+	XMVECTOR m = XMLoadFloat3(&moved);
+	if(nMovedCorner == 0) a = m;
+	else if(nMovedCorner == 1) b = m;
+	else c = m;
+	XMVECTOR n1 = XMVector3Cross(b - a, c - a);
+
+	float l0 = XMVectorGetX(XMVector3Length(n0));
+	float l1 = XMVectorGetX(XMVector3Length(n1));
+	if(l1 <= 1e-12f * (l0 + 1e-30f))
+		return true;
+
+	// 折叠后法线偏转超过约 78 度时视为翻转
+	return XMVectorGetX(XMVector3Dot(n0, n1)) < 0.2f * l0 * l1;
+}
+
+float MeshSimplifier::Simplify(const void* pVertices, UINT nVertexCount, const SimplifyVertexLayout& layout,
+							   const UINT* pIndices, UINT nIndexCount, UINT nTargetIndexCount, float fTargetError,
+							   const LodChainDesc& desc, std::vector<UINT>& result)
+{
+	assert(nIndexCount % 3 == 0);
+
+	result.assign(pIndices, pIndices + nIndexCount);
+	if(nIndexCount <= nTargetIndexCount || nVertexCount == 0)
+		return 0.0f;
+
+	const BYTE* pBase = (const BYTE*)pVertices;
+	std::vector<XMFLOAT3> positions(nVertexCount);
+	std::vector<XMFLOAT3> normals(layout.iNormalOffset >= 0 ? nVertexCount : 0);
+	std::vector<XMFLOAT2> texCoords(layout.iTexCoordsOffset >= 0 ? nVertexCount : 0);
+	std::vector<BYTE> used(nVertexCount, 0);
+
+	for(UINT i = 0; i < nIndexCount; ++i)
+	{
+		assert(pIndices[i] < nVertexCount);
+		used[pIndices[i]] = 1;
+	}
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for(UINT i = 0; i < nVertexCount; ++i)
+	{
+		if(!used[i])
+			continue;
+
+		const BYTE* pVertex = pBase + (size_t)i * layout.nByteStride;
+		CopyMemory(&positions[i], pVertex + layout.nPositionOffset, sizeof(XMFLOAT3));
+		if(!normals.empty())
+			CopyMemory(&normals[i], pVertex + layout.iNormalOffset, sizeof(XMFLOAT3));
+		if(!texCoords.empty())
+			CopyMemory(&texCoords[i], pVertex + layout.iTexCoordsOffset, sizeof(XMFLOAT2));
+
+		XMVECTOR P = XMLoadFloat3(&positions[i]);
+		vMin = XMVectorMin(vMin, P);
+		vMax = XMVectorMax(vMax, P);
+	}
+
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, vMax - vMin);
+	double fScale = max(extents.x, max(extents.y, extents.z));
+	double fInvScale2 = fScale > 0.0 ? 1.0 / (fScale * fScale) : 1.0;
+
+// 按位置焊接顶点: posGroup 为位置相同的顶点组, remap 将属性也相同的顶点合并为同一个
+	std::vector<UINT> order;
+	order.reserve(nVertexCount);
+	for(UINT i = 0; i < nVertexCount; ++i)
+		if(used[i])
+			order.push_back(i);
+
+	std::sort(order.begin(), order.end(), [&positions](UINT a, UINT b)
+	{
+		const XMFLOAT3& pa = positions[a];
+		const XMFLOAT3& pb = positions[b];
+		if(pa.x != pb.x) return pa.x < pb.x;
+		if(pa.y != pb.y) return pa.y < pb.y;
+		if(pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	});
+
+	auto SameAttributes = [&](UINT a, UINT b)
+	{
+		if(!normals.empty() && (normals[a].x != normals[b].x || normals[a].y != normals[b].y || normals[a].z != normals[b].z))
+			return false;
+		if(!texCoords.empty() && (texCoords[a].x != texCoords[b].x || texCoords[a].y != texCoords[b].y))
+			return false;
+		return true;
+	};
+
+	std::vector<UINT> posGroup(nVertexCount, INVALID_VERTEX);
+	std::vector<UINT> remap(nVertexCount, INVALID_VERTEX);
+	std::vector<BYTE> locked(nVertexCount, 0);
+
+	for(UINT begin = 0; begin < order.size();)
+	{
+		UINT end = begin + 1;
+		const XMFLOAT3& p = positions[order[begin]];
+		while(end < order.size() && positions[order[end]].x == p.x && positions[order[end]].y == p.y && positions[order[end]].z == p.z)
+			++end;
+
+		UINT nDistinct = 0;
+		for(UINT i = begin; i < end; ++i)
+		{
+			UINT v = order[i];
+			posGroup[v] = order[begin];
+			remap[v] = v;
+			for(UINT j = begin; j < i; ++j)
+			{
+				if(remap[order[j]] == order[j] && SameAttributes(order[j], v))
+				{
+					remap[v] = order[j];
+					break;
+				}
+			}
+			if(remap[v] == v)
+				++nDistinct;
+		}
+
+		// 同一位置上存在属性不同的顶点, 说明位于纹理/法线接缝上
+		if(nDistinct > 1)
+			for(UINT i = begin; i < end; ++i)
+				locked[order[i]] = 1;
+
+		begin = end;
+	}
+
+	std::vector<UINT> triangles;
+	triangles.reserve(nIndexCount);
+	for(UINT i = 0; i < nIndexCount; i += 3)
+	{
+		UINT a = remap[pIndices[i]], b = remap[pIndices[i + 1]], c = remap[pIndices[i + 2]];
+		if(posGroup[a] == posGroup[b] || posGroup[b] == posGroup[c] || posGroup[a] == posGroup[c])
+			continue;
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+// 边界与非流形边上的顶点锁定; 子网格之间的材质接缝在单个子网格中表现为边界
+	{
+		std::vector<UINT64> edges;
+		edges.reserve(triangles.size());
+		for(UINT i = 0; i < triangles.size(); i += 3)
+		{
+			for(UINT e = 0; e < 3; ++e)
+			{
+				UINT64 a = posGroup[triangles[i + e]];
+				UINT64 b = posGroup[triangles[i + (e + 1) % 3]];
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		std::vector<BYTE> lockedGroup(nVertexCount, 0);
+		for(UINT begin = 0; begin < edges.size();)
+		{
+			UINT end = begin + 1;
+			while(end < edges.size() && edges[end] == edges[begin])
+				++end;
+			if(end - begin != 2)
+			{
+				lockedGroup[(UINT)(edges[begin] >> 32)] = 1;
+				lockedGroup[(UINT)(edges[begin] & 0xFFFFFFFF)] = 1;
+			}
+			begin = end;
+		}
+
+		for(UINT i = 0; i < nVertexCount; ++i)
+			if(used[i] && lockedGroup[posGroup[i]])
+				locked[i] = 1;
+	}
+
+// 顶点二次误差
+	std::vector<Quadric> quadrics(nVertexCount);
+	ZeroMemory(quadrics.data(), sizeof(Quadric) * quadrics.size());
+	for(UINT i = 0; i < triangles.size(); i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positions[triangles[i]]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[triangles[i + 1]]);
+		XMVECTOR p2 = XMLoadFloat3(&positions[triangles[i + 2]]);
+		XMVECTOR N = XMVector3Cross(p1 - p0, p2 - p0);
+		float fLength = XMVectorGetX(XMVector3Length(N));
+		if(fLength <= 0.0f)
+			continue;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, N / fLength);
+		double d = -(n.x * positions[triangles[i]].x + n.y * positions[triangles[i]].y + n.z * positions[triangles[i]].z);
+
+		Quadric q;
+		QuadricFromPlane(q, n.x, n.y, n.z, d, 0.5 * fLength);
+		for(UINT k = 0; k < 3; ++k)
+			QuadricAdd(quadrics[triangles[i + k]], q);
+	}
+
+	auto CollapseCost = [&](UINT u, UINT v)
+	{
+		Quadric q = quadrics[u];
+		QuadricAdd(q, quadrics[v]);
+
+		double cost = QuadricError(q, positions[v]) * fInvScale2;
+		if(!normals.empty())
+		{
+			XMVECTOR dn = XMLoadFloat3(&normals[u]) - XMLoadFloat3(&normals[v]);
+			cost += desc.fNormalWeight * XMVectorGetX(XMVector3LengthSq(dn));
+		}
+		if(!texCoords.empty())
+		{
+			XMVECTOR dt = XMLoadFloat2(&texCoords[u]) - XMLoadFloat2(&texCoords[v]);
+			cost += desc.fTexCoordsWeight * XMVectorGetX(XMVector2LengthSq(dt));
+		}
+		return cost;
+	};
+
+	double fErrorLimit = (double)fTargetError * fTargetError;
+	double fResultError = 0.0;
+	UINT nTargetTriangles = nTargetIndexCount / 3;
+
+	std::vector<UINT> adjacencyOffsets(nVertexCount + 1);
+	std::vector<UINT> adjacency;
+	std::vector<double> bestCost(nVertexCount);
+	std::vector<UINT> bestTarget(nVertexCount);
+	std::vector<UINT> collapse(nVertexCount);
+	std::vector<BYTE> touched(nVertexCount);
+	std::vector<UINT> candidates;
+
+	while(triangles.size() / 3 > nTargetTriangles)
+	{
+		UINT nTriangleCount = (UINT)triangles.size() / 3;
+
+		// 顶点 -> 三角形邻接表
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for(UINT i = 0; i < triangles.size(); ++i)
+			++adjacencyOffsets[triangles[i] + 1];
+		for(UINT i = 0; i < nVertexCount; ++i)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		adjacency.resize(triangles.size());
+		{
+			std::vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for(UINT i = 0; i < triangles.size(); ++i)
+				adjacency[fill[triangles[i]]++] = i / 3;
+		}
+
+		// 每个可移动顶点只保留代价最小的折叠目标
+		std::fill(bestTarget.begin(), bestTarget.end(), INVALID_VERTEX);
+		for(UINT i = 0; i < triangles.size(); i += 3)
+		{
+			for(UINT e = 0; e < 3; ++e)
+			{
+				UINT a = triangles[i + e];
+				UINT b = triangles[i + (e + 1) % 3];
+
+				for(UINT k = 0; k < 2; ++k)
+				{
+					UINT u = k ? b : a;
+					UINT v = k ? a : b;
+					if(locked[u])
+						continue;
+
+					double cost = CollapseCost(u, v);
+					if(bestTarget[u] == INVALID_VERTEX || cost < bestCost[u] || (cost == bestCost[u] && v < bestTarget[u]))
+					{
+						bestCost[u] = cost;
+						bestTarget[u] = v;
+					}
+				}
+			}
+		}
+
+		candidates.clear();
+		for(UINT i = 0; i < nVertexCount; ++i)
+			if(bestTarget[i] != INVALID_VERTEX && bestCost[i] <= fErrorLimit)
+				candidates.push_back(i);
+
+		std::sort(candidates.begin(), candidates.end(), [&bestCost](UINT a, UINT b)
+		{
+			return bestCost[a] < bestCost[b] || (bestCost[a] == bestCost[b] && a < b);
+		});
+
+		if(candidates.empty())
+			break;
+
+		// 每次折叠约减少两个三角形; 本轮只接受不高于所需数量中最大代价的折叠,
+		// 避免在一轮中因为邻域互斥而提前用掉高代价的候选
+		UINT nNeeded = (nTriangleCount - nTargetTriangles + 1) / 2;
+		double fPassLimit = bestCost[candidates[min((UINT)candidates.size(), max(nNeeded, 1u)) - 1]];
+
+		for(UINT i = 0; i < nVertexCount; ++i)
+			collapse[i] = i;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		UINT nCollapses = 0;
+		for(UINT u : candidates)
+		{
+			if(nTriangleCount <= nTargetTriangles || bestCost[u] > fPassLimit)
+				break;
+
+			UINT v = bestTarget[u];
+			if(touched[u] || touched[v])
+				continue;
+
+			bool bFlipped = false;
+			UINT nRemoved = 0;
+			for(UINT k = adjacencyOffsets[u]; k < adjacencyOffsets[u + 1] && !bFlipped; ++k)
+			{
+				const UINT* tri = &triangles[adjacency[k] * 3];
+				if(tri[0] == v || tri[1] == v || tri[2] == v)
+				{
+					++nRemoved;
+					continue;
+				}
+
+				UINT corner = tri[0] == u ? 0 : (tri[1] == u ? 1 : 2);
+				bFlipped = IsFlipped(positions[tri[0]], positions[tri[1]], positions[tri[2]], positions[v], corner);
+			}
+			if(bFlipped)
+				continue;
+
+			for(UINT k = adjacencyOffsets[u]; k < adjacencyOffsets[u + 1]; ++k)
+			{
+				const UINT* tri = &triangles[adjacency[k] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+
+			collapse[u] = v;
+			QuadricAdd(quadrics[v], quadrics[u]);
+			fResultError = max(fResultError, bestCost[u]);
+			nTriangleCount -= nRemoved;
+			++nCollapses;
+		}
+
+		if(!nCollapses)
+			break;
+
+		UINT nWrite = 0;
+		for(UINT i = 0; i < triangles.size(); i += 3)
+		{
+			UINT a = collapse[triangles[i]], b = collapse[triangles[i + 1]], c = collapse[triangles[i + 2]];
+			if(posGroup[a] == posGroup[b] || posGroup[b] == posGroup[c] || posGroup[a] == posGroup[c])
+				continue;
+			triangles[nWrite++] = a;
+			triangles[nWrite++] = b;
+			triangles[nWrite++] = c;
+		}
+		triangles.resize(nWrite);
+	}
+
+	result.swap(triangles);
+	return (float)sqrt(fResultError);
+}
+
+// LOD 缓存条目: UINT 级数, 每级 SubmeshLod(起始位置相对于第一级), 随后是全部索引
+// 修改简化算法后需要递增版本号, 使旧的缓存失效
+#define MESH_LOD_CACHE_VERSION 1
+
+static BaseHelper::AssetKey MakeLodCacheKey(const BYTE* pBase, UINT nVertexCount, const SimplifyVertexLayout& layout,
+											const std::vector<UINT>& indices, const LodChainDesc& desc)
+{
+	BaseHelper::AssetKeyBuilder builder("MeshSimplifier.Lods", MESH_LOD_CACHE_VERSION);
+	builder.AppendValue(layout)
+		   .AppendValue(desc.nLodCount)
+		   .AppendValue(desc.fReduction)
+		   .AppendValue(desc.fMaxError)
+		   .AppendValue(desc.nMinTriangleCount)
+		   .AppendValue(desc.fNormalWeight)
+		   .AppendValue(desc.fTexCoordsWeight)
+		   .Append(pBase, (size_t)nVertexCount * layout.nByteStride)
+		   .Append(indices.data(), indices.size() * sizeof(UINT));
+	return builder.GetKey();
+}
+
+static bool ReadLodCache(const std::vector<BYTE>& data, std::vector<UINT>& indices, SubmeshGeometry& submesh)
+{
+	UINT nLevels;
+	if(data.size() < sizeof(UINT))
+		return 0;
+	CopyMemory(&nLevels, data.data(), sizeof(UINT));
+
+	size_t nHeaderSize = sizeof(UINT) + nLevels * sizeof(SubmeshLod);
+	if(nLevels >= MAX_MESH_LOD_COUNT || data.size() < nHeaderSize || (data.size() - nHeaderSize) % sizeof(UINT))
+		return 0;
+
+	UINT nFirst = (UINT)indices.size();
+	UINT nIndexCount = (UINT)((data.size() - nHeaderSize) / sizeof(UINT));
+
+	submesh.Lods.resize(nLevels);
+	CopyMemory(submesh.Lods.data(), data.data() + sizeof(UINT), nLevels * sizeof(SubmeshLod));
+	for(SubmeshLod& lod : submesh.Lods)
+	{
+		if(lod.nStartIndexLocation + lod.nIndexCount > nIndexCount)
+		{
+			submesh.Lods.clear();
+			return 0;
+		}
+		lod.nStartIndexLocation += nFirst;
+	}
+
+	indices.resize(nFirst + nIndexCount);
+	CopyMemory(indices.data() + nFirst, data.data() + nHeaderSize, nIndexCount * sizeof(UINT));
+	return 1;
+}
+
+static void WriteLodCache(const std::vector<UINT>& indices, UINT nFirst, const SubmeshGeometry& submesh, std::vector<BYTE>& data)
+{
+	UINT nLevels = (UINT)submesh.Lods.size();
+	size_t nHeaderSize = sizeof(UINT) + nLevels * sizeof(SubmeshLod);
+	size_t nIndexByteSize = (indices.size() - nFirst) * sizeof(UINT);
+
+	data.resize(nHeaderSize + nIndexByteSize);
+	CopyMemory(data.data(), &nLevels, sizeof(UINT));
+	for(UINT i = 0; i < nLevels; ++i)
+	{
+		SubmeshLod lod = submesh.Lods[i];
+		lod.nStartIndexLocation -= nFirst;
+		CopyMemory(data.data() + sizeof(UINT) + i * sizeof(SubmeshLod), &lod, sizeof(SubmeshLod));
+	}
+	if(nIndexByteSize)
+		CopyMemory(data.data() + nHeaderSize, indices.data() + nFirst, nIndexByteSize);
+}
+
+void MeshSimplifier::AppendLods(const void* pVertices, UINT nVertexCount, const SimplifyVertexLayout& layout,
+								std::vector<UINT>& indices, SubmeshGeometry& submesh, const LodChainDesc& desc,
+								const std::string& name, std::vector<MeshLodReport>* pReports)
+{
+	assert(submesh.nStartIndexLocation + submesh.nIndexCount <= indices.size());
+	assert(submesh.nBaseVertexLocation <= nVertexCount);
+
+	submesh.Lods.clear();
+	if(pReports)
+		pReports->push_back({ name, 0, submesh.nIndexCount / 3, 0.0f });
+
+	const BYTE* pBase = (const BYTE*)pVertices + (size_t)submesh.nBaseVertexLocation * layout.nByteStride;
+	UINT nBaseVertexCount = nVertexCount - submesh.nBaseVertexLocation;
+	UINT nLodCount = min(desc.nLodCount, (UINT)MAX_MESH_LOD_COUNT);
+
+	std::vector<UINT> prev(indices.begin() + submesh.nStartIndexLocation, indices.begin() + submesh.nStartIndexLocation + submesh.nIndexCount);
+	std::vector<UINT> lod;
+	float fPrevError = 0.0f;
+
+	UINT nFirst = (UINT)indices.size();
+	BaseHelper::AssetKey cacheKey;
+	std::vector<BYTE> cacheData;
+
+	if(desc.pCache)
+	{
+		cacheKey = MakeLodCacheKey(pBase, nBaseVertexCount, layout, prev, desc);
+		if(desc.pCache->Load(cacheKey, cacheData) && ReadLodCache(cacheData, indices, submesh))
+		{
+			if(pReports)
+			{
+				for(UINT i = 0; i < submesh.Lods.size(); ++i)
+					pReports->push_back({ name, i + 1, submesh.Lods[i].nIndexCount / 3, submesh.Lods[i].fError });
+			}
+			return;
+		}
+	}
+
+	for(UINT level = 1; level < nLodCount; ++level)
+	{
+		UINT nTriangles = (UINT)prev.size() / 3;
+		if(nTriangles <= desc.nMinTriangleCount)
+			break;
+
+		UINT nTarget = max((UINT)(nTriangles * desc.fReduction), desc.nMinTriangleCount);
+		float fError = Simplify(pBase, nBaseVertexCount, layout, prev.data(), (UINT)prev.size(), nTarget * 3, desc.fMaxError, desc, lod);
+
+		// 简化幅度不足 10% 时认为已到达误差上限, 不再生成更粗糙的级别
+		if(lod.empty() || lod.size() * 10 > prev.size() * 9)
+			break;
+
+		fPrevError = max(fPrevError, fError);
+
+		SubmeshLod item;
+		item.nIndexCount = (UINT)lod.size();
+		item.nStartIndexLocation = (UINT)indices.size();
+		item.fError = fPrevError;
+		submesh.Lods.push_back(item);
+
+		indices.insert(indices.end(), lod.begin(), lod.end());
+		if(pReports)
+			pReports->push_back({ name, level, item.nIndexCount / 3, item.fError });
+
+		prev.swap(lod);
+	}
+
+	if(desc.pCache)
+	{
+		WriteLodCache(indices, nFirst, submesh, cacheData);
+		desc.pCache->Store(cacheKey, cacheData.data(), cacheData.size());
+	}
+}
+
+void MeshSimplifier::BuildMeshLods(MeshGeometry& geo, const SimplifyVertexLayout& layout, const LodChainDesc& desc,
+								   std::vector<MeshLodReport>* pReports)
+{
+	assert(geo.pCPUVertexBuffer && geo.pCPUIndexBuffer);
+	assert(layout.nByteStride == geo.nVertexByteStride);
+
+	bool b16Bit = geo.emIndexFormat == DXGI_FORMAT_R16_UINT;
+	UINT nVertexCount = geo.nVertexBufferByteSize / geo.nVertexByteStride;
+	UINT nIndexCount = geo.nIndexBufferByteSize / (b16Bit ? sizeof(UINT16) : sizeof(UINT32));
+
+	std::vector<UINT> indices(nIndexCount);
+	if(b16Bit)
+	{
+		const UINT16* pIndices = (const UINT16*)geo.pCPUIndexBuffer->GetBufferPointer();
+		for(UINT i = 0; i < nIndexCount; ++i)
+			indices[i] = pIndices[i];
+	}
+	else
+		CopyMemory(indices.data(), geo.pCPUIndexBuffer->GetBufferPointer(), nIndexCount * sizeof(UINT32));
+
+	// unordered_map 的遍历顺序不固定, 按名字排序以保证追加的索引布局稳定
+	std::vector<std::string> names;
+	for(auto& item : geo.DrawArgs)
+		names.push_back(item.first);
+	std::sort(names.begin(), names.end());
+
+	for(auto& name : names)
+		AppendLods(geo.pCPUVertexBuffer->GetBufferPointer(), nVertexCount, layout, indices, geo.DrawArgs[name], desc, name, pReports);
+
+	if(indices.size() == nIndexCount)
+		return;
+
+	UINT nIndexByteSize = (UINT)indices.size() * (b16Bit ? sizeof(UINT16) : sizeof(UINT32));
+	Microsoft::WRL::ComPtr<ID3DBlob> pIndexBuffer;
+	ThrowIfFailed(D3DCreateBlob(nIndexByteSize, &pIndexBuffer));
+
+	if(b16Bit)
+	{
+		UINT16* pIndices = (UINT16*)pIndexBuffer->GetBufferPointer();
+		for(UINT i = 0; i < indices.size(); ++i)
+			pIndices[i] = (UINT16)indices[i];
+	}
+	else
+		CopyMemory(pIndexBuffer->GetBufferPointer(), indices.data(), nIndexByteSize);
+
+	geo.pCPUIndexBuffer = pIndexBuffer;
+	geo.nIndexBufferByteSize = nIndexByteSize;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef _D3DHELPER_MESHSIMPLIFIER_H
+#define _D3DHELPER_MESHSIMPLIFIER_H
+#include "D3DBase.h"
+#include "D3DHelper_Resource.h"
+#include "M3dLoader.h"
+#include "BaseHelper_AssetCache.h"
+
+#define MAX_MESH_LOD_COUNT 5
+
+namespace D3DHelper
+{
+	namespace Geometry
+	{
+		/// @brief 简化器读取顶点数据时使用的布局描述
+		/// 偏移量为 -1 时表示顶点不含该属性, 该属性不参与误差计算
+		struct SimplifyVertexLayout
+		{
+			UINT nByteStride;				// 顶点步长
+			UINT nPositionOffset;			// 位置(XMFLOAT3)偏移
+			INT iNormalOffset;				// 法线(XMFLOAT3)偏移
+			INT iTexCoordsOffset;			// 纹理坐标(XMFLOAT2)偏移
+		};
+
+		/// @brief LOD 链生成参数
+		struct LodChainDesc
+		{
+			UINT nLodCount = 4;				// LOD 级数(包含 LOD0), 取值 [1, MAX_MESH_LOD_COUNT]
+			float fReduction = 0.5f;		// 相邻两级之间的三角形保留比例
+			float fMaxError = 0.05f;		// 单级允许的最大相对误差(相对于网格包围盒尺寸)
+			UINT nMinTriangleCount = 32;	// 三角形数量低于该值时不再继续生成
+			float fNormalWeight = 0.01f;	// 法线差异在误差中的权重
+			float fTexCoordsWeight = 0.01f;	// 纹理坐标差异在误差中的权重
+
+			BaseHelper::AssetCache* pCache = nullptr;	// 可选, 以顶点/索引数据与上述参数为键缓存生成结果
+		};
+
+		/// @brief 每一级 LOD 的生成结果
+		struct MeshLodReport
+		{
+			std::string Name;				// 子网格名
+			UINT nLevel;					// LOD 级别, 0 为原始网格
+			UINT nTriangleCount;			// 三角形数量
+			float fError;					// 相对误差
+		};
+
+		/// @brief 基于二次误差度量(QEM)的网格简化静态类
+		/// 简化过程只折叠边到已有顶点上, 因此各级 LOD 共用原始顶点缓冲, 仅追加索引数据;
+		/// 网格边界(子网格/材质接缝)与纹理接缝上的顶点会被锁定, 不参与折叠;
+		/// 折叠按 (误差, 顶点索引) 排序执行, 同样的输入总是得到同样的输出
+		class MeshSimplifier
+		{
+		public:
+			/// @brief 简化一组三角形
+			/// @param pVertices 		顶点数据
+			/// @param nVertexCount 	顶点数量
+			/// @param layout 			顶点布局
+			/// @param pIndices 		三角形索引
+			/// @param nIndexCount 		索引数量
+			/// @param nTargetIndexCount 目标索引数量
+			/// @param fTargetError 	允许的最大相对误差
+			/// @param desc 			误差权重, 仅使用其中的 fNormalWeight 与 fTexCoordsWeight
+			/// @param result 			简化后的索引
+			/// @return 				实际产生的相对误差
+			static float Simplify(const void* pVertices, UINT nVertexCount, const SimplifyVertexLayout& layout,
+								  const UINT* pIndices, UINT nIndexCount, UINT nTargetIndexCount, float fTargetError,
+								  const LodChainDesc& desc, std::vector<UINT>& result);
+
+			/// @brief 为子网格生成 LOD 链; 各级索引追加到 indices 的末尾, 并写入 submesh.Lods
+			/// 设置了 desc.pCache 时, 缓存命中则直接读取之前的结果
+			/// @param pVertices 		整个顶点缓冲(子网格索引相对于 submesh.nBaseVertexLocation)
+			/// @param nVertexCount 	顶点缓冲中的顶点数量
+			/// @param layout 			顶点布局
+			/// @param indices 			整个索引缓冲
+			/// @param submesh 			子网格
+			/// @param desc 			生成参数
+			/// @param name 			子网格名, 仅用于报告
+			/// @param pReports 		可选, 追加每一级的三角形数量与误差
+			static void AppendLods(const void* pVertices, UINT nVertexCount, const SimplifyVertexLayout& layout,
+								   std::vector<UINT>& indices, Resource::SubmeshGeometry& submesh, const LodChainDesc& desc,
+								   const std::string& name = "", std::vector<MeshLodReport>* pReports = nullptr);
+
+			/// @brief 为 MeshGeometry 的全部子网格生成 LOD 链
+			/// 需要 pCPUVertexBuffer 与 pCPUIndexBuffer, 生成后 pCPUIndexBuffer 与 nIndexBufferByteSize 会被替换,
+			/// 因此应在创建 GPU 索引缓冲之前调用
+			static void BuildMeshLods(Resource::MeshGeometry& geo, const SimplifyVertexLayout& layout, const LodChainDesc& desc,
+									  std::vector<MeshLodReport>* pReports = nullptr);
+
+			/// @brief 为 M3dLoader 读取的数据生成 LOD 链
+			/// @param vertices 		M3d 顶点
+			/// @param indices 			M3d 索引, LOD 索引会追加到末尾
+			/// @param subsets 			M3d 子集
+			/// @param desc 			生成参数
+			/// @param submeshes 		输出, 与 subsets 一一对应的子网格(包含碰撞盒与 LOD 链)
+			/// @param pReports 		可选, 追加每一级的三角形数量与误差
+			template<typename VertexT>
+			static void BuildM3dLods(const std::vector<VertexT>& vertices, std::vector<UINT>& indices,
+									 const std::vector<M3dLoader::M3dSubset>& subsets, const LodChainDesc& desc,
+									 std::vector<Resource::SubmeshGeometry>& submeshes, std::vector<MeshLodReport>* pReports = nullptr)
+			{
+				SimplifyVertexLayout layout = MakeVertexLayout<VertexT>();
+
+				submeshes.resize(subsets.size());
+				for(UINT i = 0; i < subsets.size(); ++i)
+				{
+					Resource::SubmeshGeometry& submesh = submeshes[i];
+					submesh.nIndexCount = subsets[i].nFaceCount * 3;
+					submesh.nStartIndexLocation = subsets[i].nFaceStart * 3;
+					submesh.nBaseVertexLocation = 0;
+					submesh.Lods.clear();
+
+					if(subsets[i].nVertexCount)
+						DirectX::BoundingBox::CreateFromPoints(submesh.Bounds, subsets[i].nVertexCount, &vertices[subsets[i].nVertexStart].vec3Position, sizeof(VertexT));
+
+					AppendLods(vertices.data(), (UINT)vertices.size(), layout, indices, submesh, desc, "sm_" + std::to_string(i), pReports);
+				}
+			}
+
+			/// @brief 根据 vec3Position / vec3Normal / vec2TexCoords 成员生成顶点布局
+			template<typename VertexT>
+			static SimplifyVertexLayout MakeVertexLayout()
+			{
+				SimplifyVertexLayout layout;
+				layout.nByteStride = sizeof(VertexT);
+				layout.nPositionOffset = offsetof(VertexT, vec3Position);
+				layout.iNormalOffset = offsetof(VertexT, vec3Normal);
+				layout.iTexCoordsOffset = offsetof(VertexT, vec2TexCoords);
+				return layout;
+			}
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,404 @@
+#include "D3DHelper_OcclusionCulling.h"
+
+using namespace D3DHelper;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+namespace
+{
+	const UINT OCCLUSION_TILE_WIDTH = 32;			// 必须是 4 的倍数
+	const UINT OCCLUSION_TILE_HEIGHT = 16;
+	const UINT OCCLUSION_DEFAULT_WIDTH = 256;
+	const UINT OCCLUSION_DEFAULT_HEIGHT = 128;
+	const UINT OCCLUSION_TRANSFORM_GRAIN = 4;		// 每块的遮挡物数
+	const UINT OCCLUSION_TEST_GRAIN = 64;			// 每块的碰撞盒数
+	const UINT OCCLUSION_TEST_TEXELS = 4;			// 测试时碰撞盒在所选层级上最多覆盖的纹素宽度
+
+	struct TestJob
+	{
+		const OcclusionCuller* pCuller;
+		const BoundingBox* pBounds;
+		BYTE* pFlags;
+	};
+};
+
+void OcclusionCuller::Resize(UINT nWidth, UINT nHeight)
+{
+	this->nWidth = max((nWidth + 3) & ~3U, 4U);
+	this->nHeight = max(nHeight, 1U);
+	nTilesX = (this->nWidth + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+	nTilesY = (this->nHeight + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+	Bins.resize(nTilesX * nTilesY);
+
+	Levels.clear();
+	UINT w = this->nWidth, h = this->nHeight;
+	for(;;)
+	{
+		Levels.push_back({ w, h, std::vector<float>((size_t)w * h, 1.0f) });
+		if(w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+}
+
+UINT OcclusionCuller::AddMesh(const void* pVertices, UINT nVertexStride, UINT nVertexCount,
+							  const void* pIndices, DXGI_FORMAT emIndexFormat, UINT nIndexCount)
+{
+	OccluderMesh mesh;
+	mesh.nFirstVertex = (UINT)Positions.size();
+	mesh.nFirstIndex = (UINT)Indices.size();
+	mesh.nIndexCount = nIndexCount / 3 * 3;
+
+	const BYTE* pVertex = (const BYTE*)pVertices;
+	for(UINT i = 0; i < nVertexCount; ++i, pVertex += nVertexStride)
+		Positions.push_back(*(const XMFLOAT3*)pVertex);
+
+	for(UINT i = 0; i < mesh.nIndexCount; ++i)
+	{
+		UINT nIndex = emIndexFormat == DXGI_FORMAT_R16_UINT ? ((const UINT16*)pIndices)[i] : ((const UINT32*)pIndices)[i];
+		Indices.push_back(min(nIndex, nVertexCount - 1));
+	}
+
+	Meshes.push_back(mesh);
+	return (UINT)Meshes.size() - 1;
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+	Instances.clear();
+}
+
+void OcclusionCuller::AddOccluder(UINT nMesh, const XMFLOAT4X4& matWorld)
+{
+	OccluderInstance instance;
+	instance.nMesh = nMesh;
+	instance.nFirstTriangle = 0;
+	instance.matWorld = matWorld;
+	Instances.push_back(instance);
+}
+
+void OcclusionCuller::Render(const XMFLOAT4X4& matViewProj, ThreadPool* pPool)
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+	if(!nWidth)
+		Resize(OCCLUSION_DEFAULT_WIDTH, OCCLUSION_DEFAULT_HEIGHT);
+
+	this->matViewProj = matViewProj;
+
+	UINT nTriangles = 0;
+	for(OccluderInstance& instance : Instances)
+	{
+		instance.nFirstTriangle = nTriangles;
+		nTriangles += Meshes[instance.nMesh].nIndexCount / 3;
+	}
+	Triangles.resize(nTriangles);
+	pPool->ParallelFor((UINT)Instances.size(), OCCLUSION_TRANSFORM_GRAIN, TransformRange, this);
+
+	// 分块在单线程中按三角形顺序进行, 块内的光栅化顺序因此与线程数无关
+	for(std::vector<UINT>& bin : Bins)
+		bin.clear();
+	nRasterized = 0;
+	for(UINT i = 0; i < nTriangles; ++i)
+	{
+		const ScreenTriangle& tri = Triangles[i];
+		if(tri.nMinX > tri.nMaxX)
+			continue;
+		++nRasterized;
+		UINT nTileX0 = tri.nMinX / OCCLUSION_TILE_WIDTH, nTileX1 = tri.nMaxX / OCCLUSION_TILE_WIDTH;
+		UINT nTileY0 = tri.nMinY / OCCLUSION_TILE_HEIGHT, nTileY1 = tri.nMaxY / OCCLUSION_TILE_HEIGHT;
+		for(UINT ty = nTileY0; ty <= nTileY1; ++ty)
+			for(UINT tx = nTileX0; tx <= nTileX1; ++tx)
+				Bins[ty * nTilesX + tx].push_back(i);
+	}
+
+	pPool->ParallelFor(nTilesX * nTilesY, 1, RasterizeRange, this);
+	BuildHiZ();
+}
+
+void CALLBACK OcclusionCuller::TransformRange(void* param, UINT nBegin, UINT nEnd)
+{
+	OcclusionCuller* pThis = (OcclusionCuller*)param;
+	for(UINT i = nBegin; i < nEnd; ++i)
+		pThis->TransformInstance(pThis->Instances[i]);
+}
+
+void OcclusionCuller::TransformInstance(const OccluderInstance& instance)
+{
+	const OccluderMesh& mesh = Meshes[instance.nMesh];
+	XMMATRIX mat = XMMatrixMultiply(XMLoadFloat4x4(&instance.matWorld), XMLoadFloat4x4(&matViewProj));
+	const float fHalfWidth = nWidth * 0.5f, fHalfHeight = nHeight * 0.5f;
+
+	for(UINT t = 0; t < mesh.nIndexCount / 3; ++t)
+	{
+		ScreenTriangle& tri = Triangles[instance.nFirstTriangle + t];
+		tri.nMinX = 1;
+		tri.nMaxX = 0;
+
+		float z[3];
+		bool bClipped = 0;
+		for(UINT k = 0; k < 3; ++k)
+		{
+			UINT nIndex = Indices[mesh.nFirstIndex + t * 3 + k];
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&Positions[mesh.nFirstVertex + nIndex]), mat));
+			// 穿过近平面的三角形直接丢弃, 只会少遮挡而不会误剔除
+			if(clip.w <= 0.0f || clip.z < 0.0f)
+			{
+				bClipped = 1;
+				break;
+			}
+			float fInvW = 1.0f / clip.w;
+			tri.x[k] = (clip.x * fInvW + 1.0f) * fHalfWidth;
+			tri.y[k] = (1.0f - clip.y * fInvW) * fHalfHeight;
+			z[k] = clip.z * fInvW;
+		}
+		if(bClipped || (z[0] > 1.0f && z[1] > 1.0f && z[2] > 1.0f))
+			continue;
+
+		float d1x = tri.x[1] - tri.x[0], d1y = tri.y[1] - tri.y[0];
+		float d2x = tri.x[2] - tri.x[0], d2y = tri.y[2] - tri.y[0];
+		float fArea = d1x * d2y - d2x * d1y;
+		if(fArea == 0.0f || (bBackfaceCulling && fArea < 0.0f))
+			continue;
+		if(fArea < 0.0f)
+		{
+			// 统一为顺时针, 边函数在内部为正
+			std::swap(tri.x[1], tri.x[2]);
+			std::swap(tri.y[1], tri.y[2]);
+			std::swap(z[1], z[2]);
+			std::swap(d1x, d2x);
+			std::swap(d1y, d2y);
+			fArea = -fArea;
+		}
+
+		float fMinX = min(tri.x[0], min(tri.x[1], tri.x[2])), fMaxX = max(tri.x[0], max(tri.x[1], tri.x[2]));
+		float fMinY = min(tri.y[0], min(tri.y[1], tri.y[2])), fMaxY = max(tri.y[0], max(tri.y[1], tri.y[2]));
+		if(fMaxX < 0.0f || fMaxY < 0.0f || fMinX >= (float)nWidth || fMinY >= (float)nHeight)
+			continue;
+
+		float dz1 = z[1] - z[0], dz2 = z[2] - z[0];
+		float fInvArea = 1.0f / fArea;
+		tri.fDepthA = (dz1 * d2y - dz2 * d1y) * fInvArea;
+		tri.fDepthB = (d1x * dz2 - d2x * dz1) * fInvArea;
+		// 在像素中心取平面上该像素内的最远深度, 使写入的深度不比像素内任何位置的遮挡物更近
+		tri.fDepthC = z[0] - tri.fDepthA * tri.x[0] - tri.fDepthB * tri.y[0] +
+					  0.5f * (fabsf(tri.fDepthA) + fabsf(tri.fDepthB));
+
+		tri.nMinX = (int)max(fMinX, 0.0f) & ~3;
+		tri.nMinY = (int)max(fMinY, 0.0f);
+		tri.nMaxX = (int)min(fMaxX, (float)(nWidth - 1));
+		tri.nMaxY = (int)min(fMaxY, (float)(nHeight - 1));
+	}
+}
+
+void CALLBACK OcclusionCuller::RasterizeRange(void* param, UINT nBegin, UINT nEnd)
+{
+	OcclusionCuller* pThis = (OcclusionCuller*)param;
+	for(UINT i = nBegin; i < nEnd; ++i)
+		pThis->RasterizeTile(i);
+}
+
+void OcclusionCuller::RasterizeTile(UINT nTile)
+{
+	const int nTileX0 = nTile % nTilesX * OCCLUSION_TILE_WIDTH, nTileY0 = nTile / nTilesX * OCCLUSION_TILE_HEIGHT;
+	const int nTileX1 = min(nTileX0 + (int)OCCLUSION_TILE_WIDTH, (int)nWidth) - 1;
+	const int nTileY1 = min(nTileY0 + (int)OCCLUSION_TILE_HEIGHT, (int)nHeight) - 1;
+	float* pDepth = Levels[0].Depth.data();
+
+	for(int y = nTileY0; y <= nTileY1; ++y)
+		std::fill(pDepth + (size_t)y * nWidth + nTileX0, pDepth + (size_t)y * nWidth + nTileX1 + 1, 1.0f);
+
+	const XMVECTOR vPixelOffset = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	for(UINT nTriangle : Bins[nTile])
+	{
+		const ScreenTriangle& tri = Triangles[nTriangle];
+		// nMinX 已按 4 对齐, 块宽也是 4 的倍数, 因此每组 4 个像素不会越过块的边界
+		int nX0 = max(tri.nMinX, nTileX0), nX1 = min(tri.nMaxX, nTileX1);
+		int nY0 = max(tri.nMinY, nTileY0), nY1 = min(tri.nMaxY, nTileY1);
+		if(nX0 > nX1 || nY0 > nY1)
+			continue;
+
+		// 边 i 由顶点 i 指向顶点 i + 1, E(x, y) = A * x + B * y + C
+		XMVECTOR vEdgeA[3], vEdgeB[3], vEdgeC[3];
+		for(UINT k = 0; k < 3; ++k)
+		{
+			UINT j = (k + 1) % 3;
+			float a = tri.y[k] - tri.y[j], b = tri.x[j] - tri.x[k];
+			vEdgeA[k] = XMVectorReplicate(a);
+			vEdgeB[k] = XMVectorReplicate(b);
+			vEdgeC[k] = XMVectorReplicate(-(a * tri.x[k] + b * tri.y[k]));
+		}
+		const XMVECTOR vDepthA = XMVectorReplicate(tri.fDepthA);
+		const XMVECTOR vDepthB = XMVectorReplicate(tri.fDepthB);
+		const XMVECTOR vDepthC = XMVectorReplicate(tri.fDepthC);
+		const XMVECTOR vMaxDepth = XMVectorReplicate(1.0f);
+		const XMVECTOR vStep = XMVectorReplicate(4.0f);
+		const XMVECTOR vZero = XMVectorZero();
+
+		const XMVECTOR vStartX = XMVectorAdd(XMVectorReplicate((float)nX0), vPixelOffset);
+		for(int y = nY0; y <= nY1; ++y)
+		{
+			XMVECTOR vY = XMVectorReplicate(y + 0.5f);
+			XMVECTOR vX = vStartX;
+			XMVECTOR vE0 = XMVectorMultiplyAdd(vEdgeA[0], vX, XMVectorMultiplyAdd(vEdgeB[0], vY, vEdgeC[0]));
+			XMVECTOR vE1 = XMVectorMultiplyAdd(vEdgeA[1], vX, XMVectorMultiplyAdd(vEdgeB[1], vY, vEdgeC[1]));
+			XMVECTOR vE2 = XMVectorMultiplyAdd(vEdgeA[2], vX, XMVectorMultiplyAdd(vEdgeB[2], vY, vEdgeC[2]));
+			XMVECTOR vZ = XMVectorMultiplyAdd(vDepthA, vX, XMVectorMultiplyAdd(vDepthB, vY, vDepthC));
+			const XMVECTOR vStepE0 = XMVectorMultiply(vEdgeA[0], vStep);
+			const XMVECTOR vStepE1 = XMVectorMultiply(vEdgeA[1], vStep);
+			const XMVECTOR vStepE2 = XMVectorMultiply(vEdgeA[2], vStep);
+			const XMVECTOR vStepZ = XMVectorMultiply(vDepthA, vStep);
+
+			float* pRow = pDepth + (size_t)y * nWidth;
+			for(int x = nX0; x <= nX1; x += 4)
+			{
+				XMVECTOR vInside = XMVectorAndInt(XMVectorGreaterOrEqual(vE0, vZero),
+									XMVectorAndInt(XMVectorGreaterOrEqual(vE1, vZero), XMVectorGreaterOrEqual(vE2, vZero)));
+				if(!XMVector4EqualInt(vInside, vZero))
+				{
+					XMVECTOR vDepth = XMLoadFloat4((const XMFLOAT4*)(pRow + x));
+					XMVECTOR vNew = XMVectorMin(vDepth, XMVectorMin(vZ, vMaxDepth));
+					XMStoreFloat4((XMFLOAT4*)(pRow + x), XMVectorSelect(vDepth, vNew, vInside));
+				}
+				vE0 = XMVectorAdd(vE0, vStepE0);
+				vE1 = XMVectorAdd(vE1, vStepE1);
+				vE2 = XMVectorAdd(vE2, vStepE2);
+				vZ = XMVectorAdd(vZ, vStepZ);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	for(size_t l = 1; l < Levels.size(); ++l)
+	{
+		const HiZLevel& src = Levels[l - 1];
+		HiZLevel& dst = Levels[l];
+		for(UINT y = 0; y < dst.nHeight; ++y)
+		{
+			const float* pRow0 = src.Depth.data() + (size_t)min(y * 2, src.nHeight - 1) * src.nWidth;
+			const float* pRow1 = src.Depth.data() + (size_t)min(y * 2 + 1, src.nHeight - 1) * src.nWidth;
+			float* pDst = dst.Depth.data() + (size_t)y * dst.nWidth;
+			for(UINT x = 0; x < dst.nWidth; ++x)
+			{
+				UINT x0 = min(x * 2, src.nWidth - 1), x1 = min(x * 2 + 1, src.nWidth - 1);
+				pDst[x] = max(max(pRow0[x0], pRow0[x1]), max(pRow1[x0], pRow1[x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const BoundingBox& bounds) const
+{
+	if(Levels.empty())
+		return 1;
+
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	bounds.GetCorners(corners);
+	XMMATRIX mat = XMLoadFloat4x4(&matViewProj);
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX), vMax = XMVectorReplicate(-FLT_MAX);
+	for(UINT i = 0; i < BoundingBox::CORNER_COUNT; ++i)
+	{
+		XMVECTOR vClip = XMVector3Transform(XMLoadFloat3(&corners[i]), mat);
+		// 有角点位于近平面之前时投影不再保守, 直接视为可见
+		if(XMVectorGetW(vClip) <= 0.0f || XMVectorGetZ(vClip) < 0.0f)
+			return 1;
+		XMVECTOR vNdc = XMVectorDivide(vClip, XMVectorSplatW(vClip));
+		vMin = XMVectorMin(vMin, vNdc);
+		vMax = XMVectorMax(vMax, vNdc);
+	}
+
+	XMFLOAT3 vec3Min, vec3Max;
+	XMStoreFloat3(&vec3Min, vMin);
+	XMStoreFloat3(&vec3Max, vMax);
+	if(vec3Max.x < -1.0f || vec3Min.x > 1.0f || vec3Max.y < -1.0f || vec3Min.y > 1.0f || vec3Min.z > 1.0f)
+		return 0;
+
+	int nX0 = (int)floorf((vec3Min.x + 1.0f) * 0.5f * nWidth), nX1 = (int)floorf((vec3Max.x + 1.0f) * 0.5f * nWidth);
+	int nY0 = (int)floorf((1.0f - vec3Max.y) * 0.5f * nHeight), nY1 = (int)floorf((1.0f - vec3Min.y) * 0.5f * nHeight);
+	nX0 = max(nX0, 0);
+	nY0 = max(nY0, 0);
+	nX1 = min(nX1, (int)nWidth - 1);
+	nY1 = min(nY1, (int)nHeight - 1);
+
+	// 选择使碰撞盒最多覆盖 OCCLUSION_TEST_TEXELS x OCCLUSION_TEST_TEXELS 个纹素的层级
+	UINT nLevel = 0;
+	while(nLevel + 1 < Levels.size() &&
+		  ((nX1 >> nLevel) - (nX0 >> nLevel) >= (int)OCCLUSION_TEST_TEXELS ||
+		   (nY1 >> nLevel) - (nY0 >> nLevel) >= (int)OCCLUSION_TEST_TEXELS))
+		++nLevel;
+
+	const HiZLevel& level = Levels[nLevel];
+	for(int y = nY0 >> nLevel; y <= nY1 >> nLevel; ++y)
+	{
+		const float* pRow = level.Depth.data() + (size_t)y * level.nWidth;
+		for(int x = nX0 >> nLevel; x <= nX1 >> nLevel; ++x)
+			if(pRow[x] >= vec3Min.z)
+				return 1;
+	}
+	return 0;
+}
+
+void CALLBACK OcclusionCuller::TestRange(void* param, UINT nBegin, UINT nEnd)
+{
+	TestJob* pJob = (TestJob*)param;
+	for(UINT i = nBegin; i < nEnd; ++i)
+		pJob->pFlags[i] = pJob->pCuller->IsVisible(pJob->pBounds[i]);
+}
+
+UINT OcclusionCuller::Cull(const BoundingBox* pBounds, UINT nCount, UINT* pVisible, ThreadPool* pPool) const
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+
+	std::vector<BYTE> flags(nCount);
+	TestJob job = { this, pBounds, flags.data() };
+	pPool->ParallelFor(nCount, OCCLUSION_TEST_GRAIN, TestRange, &job);
+
+	UINT nVisible = 0;
+	for(UINT i = 0; i < nCount; ++i)
+		if(flags[i])
+			pVisible[nVisible++] = i;
+	return nVisible;
+}
+
+UINT OcclusionCuller::GetWidth() const
+{
+	return nWidth;
+}
+
+UINT OcclusionCuller::GetHeight() const
+{
+	return nHeight;
+}
+
+const float* OcclusionCuller::GetDepth(UINT nLevel) const
+{
+	return nLevel < Levels.size() ? Levels[nLevel].Depth.data() : NULL;
+}
+
+UINT OcclusionCuller::GetLevelCount() const
+{
+	return (UINT)Levels.size();
+}
+
+UINT OcclusionCuller::GetRasterizedTriangleCount() const
+{
+	return nRasterized;
+}
+
+void OcclusionCuller::Clear()
+{
+	Positions.clear();
+	Indices.clear();
+	Meshes.clear();
+	Instances.clear();
+	Triangles.clear();
+	for(std::vector<UINT>& bin : Bins)
+		bin.clear();
+	nRasterized = 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef _D3DHELPER_OCCLUSIONCULLING_H
+#define _D3DHELPER_OCCLUSIONCULLING_H
+#include "D3DBase.h"
+#include "BaseHelper_Thread.h"
+
+namespace D3DHelper
+{
+	/// @brief 软件遮挡剔除
+	/// 每帧在 CPU 上把少量遮挡物(墙, 柱子等大而简单的网格)光栅化到低分辨率的深度缓冲区, 再以其最大值
+	/// 金字塔(Hi-Z)测试被遮挡物的碰撞盒, 剔除被完全挡住的物体. 深度约定同 D3D: 投影后 z / w 位于 [0, 1], 越小越近.
+	/// 屏幕按块划分, 三角形先分到所覆盖的块中, 各块由线程池并行光栅化, 每次处理一行中的 4 个像素.
+	/// 穿过近平面的遮挡三角形被丢弃, 穿过近平面的碰撞盒总是可见; 写入的深度取像素内遮挡物的最远深度.
+	/// 覆盖以像素中心判断, 只从比一个像素还窄的缝隙中露出的物体可能被剔除, 分辨率越高越少
+	class OcclusionCuller
+	{
+	public:
+		bool bBackfaceCulling = 1;			// 丢弃背面的遮挡三角形(顺时针为正面)
+
+		/// @brief 设置深度缓冲区的大小, 宽度按块宽对齐
+		void Resize(UINT nWidth, UINT nHeight);
+
+		/// @brief 注册遮挡网格, 只保存位置与索引
+		/// @param pVertices 		顶点数据, 每个顶点以位置开头
+		/// @param nVertexStride 	顶点步长(字节)
+		/// @param nVertexCount 	顶点数量
+		/// @param pIndices 		索引数据
+		/// @param emIndexFormat 	DXGI_FORMAT_R16_UINT 或 DXGI_FORMAT_R32_UINT
+		/// @param nIndexCount 		索引数量
+		/// @return 				网格序号, 用于 AddOccluder
+		UINT AddMesh(const void* pVertices, UINT nVertexStride, UINT nVertexCount,
+					 const void* pIndices, DXGI_FORMAT emIndexFormat, UINT nIndexCount);
+
+		/// @brief 清空本帧的遮挡物
+		void ClearOccluders();
+		/// @brief 添加本帧的遮挡物
+		void AddOccluder(UINT nMesh, const DirectX::XMFLOAT4X4& matWorld);
+
+		/// @brief 变换遮挡物, 分块并光栅化, 最后构建 Hi-Z
+		/// @param matViewProj 	观察投影矩阵(行向量约定)
+		void Render(const DirectX::XMFLOAT4X4& matViewProj, BaseHelper::Thread::ThreadPool* pPool = NULL);
+
+		/// @brief 世界空间碰撞盒是否可能可见, 需在 Render 之后调用
+		/// 完全位于视锥体之外(左右上下)的碰撞盒同样判为不可见
+		bool IsVisible(const DirectX::BoundingBox& bounds) const;
+
+		/// @brief 批量测试
+		/// @param pVisible 	输出可见碰撞盒的索引(升序), 容量至少为 nCount
+		/// @return 			可见数量
+		UINT Cull(const DirectX::BoundingBox* pBounds, UINT nCount, UINT* pVisible,
+				  BaseHelper::Thread::ThreadPool* pPool = NULL) const;
+
+		UINT GetWidth() const;
+		UINT GetHeight() const;
+		/// @brief 第 0 级为光栅化得到的深度, 之后每级取 2x2 的最大值
+		const float* GetDepth(UINT nLevel = 0) const;
+		UINT GetLevelCount() const;
+		/// @brief 上一次 Render 中实际光栅化的三角形数(同一三角形跨块时只计一次)
+		UINT GetRasterizedTriangleCount() const;
+		void Clear();
+
+	private:
+		// 屏幕空间三角形, 深度为屏幕坐标的平面方程 z = a * x + b * y + c
+		struct ScreenTriangle
+		{
+			float x[3], y[3];
+			float fDepthA, fDepthB, fDepthC;
+			int nMinX, nMinY, nMaxX, nMaxY;	// 像素包围盒(闭区间), nMinX > nMaxX 表示被丢弃
+		};
+
+		struct OccluderMesh
+		{
+			UINT nFirstVertex;
+			UINT nFirstIndex;
+			UINT nIndexCount;
+		};
+
+		struct OccluderInstance
+		{
+			UINT nMesh;
+			UINT nFirstTriangle;			// 在 Triangles 中的起始位置
+			DirectX::XMFLOAT4X4 matWorld;
+		};
+
+		struct HiZLevel
+		{
+			UINT nWidth, nHeight;
+			std::vector<float> Depth;
+		};
+
+		UINT nWidth = 0, nHeight = 0;
+		UINT nTilesX = 0, nTilesY = 0;
+		UINT nRasterized = 0;
+		DirectX::XMFLOAT4X4 matViewProj;
+
+		std::vector<DirectX::XMFLOAT3> Positions;
+		std::vector<UINT> Indices;
+		std::vector<OccluderMesh> Meshes;
+		std::vector<OccluderInstance> Instances;
+		std::vector<ScreenTriangle> Triangles;
+		std::vector<std::vector<UINT>> Bins;	// 每块的三角形序号
+		std::vector<HiZLevel> Levels;
+
+		static void CALLBACK TransformRange(void* param, UINT nBegin, UINT nEnd);
+		static void CALLBACK RasterizeRange(void* param, UINT nBegin, UINT nEnd);
+		static void CALLBACK TestRange(void* param, UINT nBegin, UINT nEnd);
+
+		void TransformInstance(const OccluderInstance& instance);
+		void RasterizeTile(UINT nTile);
+		void BuildHiZ();
+	};
+};
+
+#endif
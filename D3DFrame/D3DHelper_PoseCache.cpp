@@ -0,0 +1,75 @@
+#include "D3DHelper_PoseCache.h"
+
+using namespace D3DHelper::Animation;
+using namespace DirectX;
+
+void PoseCache::SetTimeQuantum(float fQuantum)
+{
+	fTimeQuantum = max(fQuantum, 0.0f);
+	BeginFrame();
+}
+
+void PoseCache::BeginFrame()
+{
+	Entries.clear();
+	nPoseCount = 0;
+}
+
+const std::vector<XMFLOAT4X4>& PoseCache::GetFinalTransforms(const SkinnedAnimation& skinned, const std::string& clipName, float t)
+{
+	return GetFinalTransforms(skinned, skinned.FindClip(clipName), t);
+}
+
+const std::vector<XMFLOAT4X4>& PoseCache::GetFinalTransforms(const SkinnedAnimation& skinned, ClipHandle clip, float t)
+{
+	static const std::vector<XMFLOAT4X4> empty;
+	if(!clip.IsValid())
+		return empty;
+
+	PoseKey key;
+	key.pSkinned = &skinned;
+	key.nClip = clip.nIndex;
+
+	// 量化后的时间同时作为求值时间, 保证同一键下的姿势与实例的调用顺序无关
+	if(fTimeQuantum > 0.0f)
+	{
+		key.nTick = (INT64)floorf(t / fTimeQuantum + 0.5f);
+		t = key.nTick * fTimeQuantum;
+	}
+	else
+	{
+		UINT nBits;
+		memcpy(&nBits, &t, sizeof(nBits));
+		key.nTick = nBits;
+	}
+
+	auto itor = Entries.find(key);
+	if(itor != Entries.end())
+	{
+		++nHitCount;
+		return Poses[itor->second];
+	}
+
+	++nMissCount;
+	if(nPoseCount == Poses.size())
+		Poses.emplace_back();
+
+	std::vector<XMFLOAT4X4>& pose = Poses[nPoseCount];
+	pose.resize(skinned.BoneCount());
+	skinned.GetFinalTransforms(clip, t, pose.data());
+
+	Entries.emplace(key, nPoseCount);
+	return Poses[nPoseCount++];
+}
+
+float PoseCache::GetHitRate() const
+{
+	UINT nTotal = nHitCount + nMissCount;
+	return nTotal? (float)nHitCount / nTotal: 0.0f;
+}
+
+void PoseCache::ResetStatistics()
+{
+	nHitCount = 0;
+	nMissCount = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef _D3DHELPER_POSECACHE_H
+#define _D3DHELPER_POSECACHE_H
+#include "D3DBase.h"
+#include "D3DHelper_Animation.h"
+#include <deque>
+
+namespace D3DHelper
+{
+	namespace Animation
+	{
+		/// @brief 每帧的姿势缓存
+		/// 以 (蒙皮动画, 动画片段, 量化后的时间) 为键; 同一帧内多个实例播放同一片段且时间落在同一量化步长内时,
+		/// 只调用一次 GetFinalTransforms, 其余实例直接复制结果. 非线程安全
+		class PoseCache
+		{
+		public:
+			/// @brief 设置时间量化步长(秒)
+			/// 时间按步长四舍五入后再求值, 步长越大命中率越高, 动画越不连贯; 0 表示只共享时间完全相同的姿势
+			void SetTimeQuantum(float fQuantum);
+			float GetTimeQuantum() const { return fTimeQuantum; }
+
+			/// @brief 每帧开始时调用, 丢弃上一帧的姿势(保留已分配的内存)
+			void BeginFrame();
+
+			/// @brief 取得 t 时刻的最终变换, 未命中时计算并缓存
+			/// @return 指向缓存内部的数据, 下一次 BeginFrame 之前有效; 片段不存在时为空
+			const std::vector<DirectX::XMFLOAT4X4>& GetFinalTransforms(const SkinnedAnimation& skinned, ClipHandle clip, float t);
+			const std::vector<DirectX::XMFLOAT4X4>& GetFinalTransforms(const SkinnedAnimation& skinned, const std::string& clipName, float t);
+
+			UINT GetHitCount() const { return nHitCount; }
+			UINT GetMissCount() const { return nMissCount; }
+			/// @brief 自上次 ResetStatistics 以来的命中率
+			float GetHitRate() const;
+			void ResetStatistics();
+
+		private:
+			struct PoseKey
+			{
+				const SkinnedAnimation* pSkinned;
+				UINT nClip;					// ClipHandle::nIndex
+				INT64 nTick;				// 量化后的时间; 步长为 0 时为 t 的位模式
+
+				bool operator==(const PoseKey& other) const
+				{
+					return pSkinned == other.pSkinned && nTick == other.nTick && nClip == other.nClip;
+				}
+			};
+
+			struct PoseKeyHash
+			{
+				size_t operator()(const PoseKey& key) const
+				{
+					size_t h = std::hash<const void*>()(key.pSkinned);
+					h ^= std::hash<UINT>()(key.nClip) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+					h ^= std::hash<INT64>()(key.nTick) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+					return h;
+				}
+			};
+
+			float fTimeQuantum = 1.0f / 60.0f;
+			std::unordered_map<PoseKey, UINT, PoseKeyHash> Entries;	// 键 -> Poses 下标
+			std::deque<std::vector<DirectX::XMFLOAT4X4>> Poses;		// 跨帧复用, 只有前 nPoseCount 个有效; 在末尾追加不会移动已有元素
+			UINT nPoseCount = 0;
+
+			UINT nHitCount = 0;
+			UINT nMissCount = 0;
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "D3DHelper_RayQuery.h"
+
+using namespace D3DHelper;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+namespace
+{
+	const UINT RAY_QUERY_GRAIN = 16;		// 每块的射线组数, 每组 4 条射线
+
+	struct RayContext
+	{
+		const SceneRayQuery* pQuery;
+		SceneRayHit* pHits;					// 单条射线时为 1 个, 射线包时为 4 个
+	};
+
+	struct TraceJob
+	{
+		const SceneRayQuery* pQuery;
+		const SceneRay* pRays;
+		SceneRayHit* pHits;
+		UINT nCount;
+	};
+
+	// 4 条射线方向各分量的符号一致时, 遍历顺序与节点测试结果相近, 适合以射线包遍历
+	inline bool IsCoherent(const SceneRay* pRays)
+	{
+		auto Signs = [](const XMFLOAT3& v) { return (v.x < 0.0f) | ((v.y < 0.0f) << 1) | ((v.z < 0.0f) << 2); };
+		UINT nSigns = Signs(pRays[0].vec3Direction);
+		return Signs(pRays[1].vec3Direction) == nSigns && Signs(pRays[2].vec3Direction) == nSigns && Signs(pRays[3].vec3Direction) == nSigns;
+	}
+}
+
+UINT SceneRayQuery::AddInstance(const Resource::MeshGeometry& geo, const Resource::SubmeshGeometry& range,
+								const XMFLOAT4X4& matWorld, UINT nUserData)
+{
+	MeshKey key = {&geo, range.nStartIndexLocation, range.nIndexCount, range.nBaseVertexLocation};
+	auto it = Meshes.find(key);
+	if(it == Meshes.end())
+	{
+		TriangleBvh bvh;
+		if(!bvh.Build(geo, &range))
+		{
+			OutputDebugStringA("SceneRayQuery: geometry has no CPU copy\n");
+			return BVH_NULL_NODE;
+		}
+		it = Meshes.emplace(key, std::move(bvh)).first;
+	}
+
+	Instance instance;
+	instance.pBvh = &it->second;
+	instance.nUserData = nUserData;
+	instance.matWorld = matWorld;
+	XMMATRIX W = XMLoadFloat4x4(&matWorld);
+	XMStoreFloat4x4(&instance.matInvWorld, XMMatrixInverse(NULL, W));
+
+	UINT nInstance = (UINT)Instances.size();
+	instance.nProxy = TopLevel.Insert(GetWorldBounds(instance), nInstance);
+	Instances.push_back(instance);
+	return nInstance;
+}
+
+void SceneRayQuery::UpdateInstance(UINT nInstance, const XMFLOAT4X4& matWorld)
+{
+	Instance& instance = Instances[nInstance];
+	instance.matWorld = matWorld;
+	XMMATRIX W = XMLoadFloat4x4(&matWorld);
+	XMStoreFloat4x4(&instance.matInvWorld, XMMatrixInverse(NULL, W));
+	TopLevel.Update(instance.nProxy, GetWorldBounds(instance));
+}
+
+void SceneRayQuery::Commit()
+{
+	TopLevel.Refit();
+}
+
+bool SceneRayQuery::Trace(const SceneRay& ray, SceneRayHit& hit) const
+{
+	hit = SceneRayHit();
+	RayContext context = {this, &hit};
+	return TopLevel.Raycast(XMLoadFloat3(&ray.vec3Origin), XMLoadFloat3(&ray.vec3Direction), ray.fMaxDistance,
+							TraceInstance, &context) != BVH_NULL_NODE;
+}
+
+void SceneRayQuery::Trace(const SceneRay* pRays, SceneRayHit* pHits, UINT nCount, ThreadPool* pPool) const
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+
+	TraceJob job = {this, pRays, pHits, nCount};
+	pPool->ParallelFor((nCount + 3) / 4, RAY_QUERY_GRAIN, TraceRange, &job);
+}
+
+void SceneRayQuery::TracePacket(const SceneRay* pRays, SceneRayHit* pHits) const
+{
+	XMFLOAT3 origins[4], dirs[4];
+	float fMaxDistances[4];
+	for(UINT k = 0; k < 4; ++k)
+	{
+		origins[k] = pRays[k].vec3Origin;
+		dirs[k] = pRays[k].vec3Direction;
+		fMaxDistances[k] = pRays[k].fMaxDistance;
+		pHits[k] = SceneRayHit();
+	}
+
+	RayPacket packet;
+	packet.Set(origins, dirs, fMaxDistances);
+	RayContext context = {this, pHits};
+	TopLevel.RaycastPacket(packet, 0xf, TraceInstancePacket, &context);
+}
+
+float CALLBACK SceneRayQuery::TraceInstance(void* param, UINT nInstance, FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance)
+{
+	RayContext* pContext = (RayContext*)param;
+	const Instance& instance = pContext->pQuery->Instances[nInstance];
+
+	// 方向不归一化, 局部空间的距离与世界空间相同
+	XMMATRIX invWorld = XMLoadFloat4x4(&instance.matInvWorld);
+	TriangleHit hit;
+	if(!instance.pBvh->Intersects(XMVector3TransformCoord(origin, invWorld), XMVector3TransformNormal(dir, invWorld), fMaxDistance, hit))
+		return -1.0f;
+
+	SceneRayHit& out = *pContext->pHits;
+	out.fDistance = hit.fDistance;
+	out.nUserData = instance.nUserData;
+	out.nTriangle = hit.nTriangle;
+	out.fU = hit.fU;
+	out.fV = hit.fV;
+	return hit.fDistance;
+}
+
+void CALLBACK SceneRayQuery::TraceInstancePacket(void* param, UINT nInstance, RayPacket& packet, UINT nMask)
+{
+	RayContext* pContext = (RayContext*)param;
+	const Instance& instance = pContext->pQuery->Instances[nInstance];
+	const XMFLOAT4X4& M = instance.matInvWorld;
+
+	// 以 SoA 形式将 4 条射线变换到局部空间
+	RayPacket local;
+	for(UINT a = 0; a < 3; ++a)
+	{
+		local.Direction[a] = packet.Direction[0] * M(0, a) + packet.Direction[1] * M(1, a) + packet.Direction[2] * M(2, a);
+		local.Origin[a] = packet.Origin[0] * M(0, a) + packet.Origin[1] * M(1, a) + packet.Origin[2] * M(2, a) + XMVectorReplicate(M(3, a));
+	}
+	local.UpdateInverse();
+	local.MaxDistance = packet.MaxDistance;
+
+	TriangleHit hits[4];
+	UINT nHitMask = instance.pBvh->Intersects(local, nMask, hits);
+	if(!nHitMask)
+		return;
+
+	packet.MaxDistance = local.MaxDistance;
+	for(UINT k = 0; k < 4; ++k)
+	{
+		if(!(nHitMask & (1u << k)))
+			continue;
+
+		SceneRayHit& out = pContext->pHits[k];
+		out.fDistance = hits[k].fDistance;
+		out.nUserData = instance.nUserData;
+		out.nTriangle = hits[k].nTriangle;
+		out.fU = hits[k].fU;
+		out.fV = hits[k].fV;
+	}
+}
+
+void CALLBACK SceneRayQuery::TraceRange(void* param, UINT nBegin, UINT nEnd)
+{
+	TraceJob* pJob = (TraceJob*)param;
+	const SceneRayQuery* pQuery = pJob->pQuery;
+	for(UINT p = nBegin; p < nEnd; ++p)
+	{
+		UINT i = 4 * p, n = min(4u, pJob->nCount - i);
+		if(n == 4 && pQuery->bPackets && IsCoherent(&pJob->pRays[i]))
+			pQuery->TracePacket(&pJob->pRays[i], &pJob->pHits[i]);
+		else
+		{
+			for(UINT k = 0; k < n; ++k)
+				pQuery->Trace(pJob->pRays[i + k], pJob->pHits[i + k]);
+		}
+	}
+}
+
+BoundingBox SceneRayQuery::GetWorldBounds(const Instance& instance) const
+{
+	BoundingBox bounds;
+	instance.pBvh->GetBounds().Transform(bounds, XMLoadFloat4x4(&instance.matWorld));
+	return bounds;
+}
+
+UINT SceneRayQuery::GetInstanceCount() const
+{
+	return (UINT)Instances.size();
+}
+
+UINT SceneRayQuery::GetMeshCount() const
+{
+	return (UINT)Meshes.size();
+}
+
+void SceneRayQuery::Clear()
+{
+	Meshes.clear();
+	Instances.clear();
+	TopLevel.Clear();
+}
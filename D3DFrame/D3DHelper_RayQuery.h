@@ -0,0 +1,114 @@
+#pragma once
+#ifndef _D3DHELPER_RAYQUERY_H
+#define _D3DHELPER_RAYQUERY_H
+#include "D3DBase.h"
+#include "D3DHelper.h"
+#include "D3DHelper_SceneBvh.h"
+#include "D3DHelper_TriangleBvh.h"
+#include "BaseHelper_Thread.h"
+#include <map>
+#include <tuple>
+
+namespace D3DHelper
+{
+	/// @brief 世界空间射线
+	struct SceneRay
+	{
+		DirectX::XMFLOAT3 vec3Origin;
+		float fMaxDistance = FLT_MAX;		// 以方向的长度为单位
+		DirectX::XMFLOAT3 vec3Direction;	// 不必归一化
+	};
+
+	/// @brief 射线的最近命中
+	struct SceneRayHit
+	{
+		float fDistance = FLT_MAX;			// 以方向的长度为单位
+		UINT nUserData = BVH_NULL_NODE;		// 命中实例的用户数据; 未命中时为 BVH_NULL_NODE
+		UINT nTriangle = -1;				// 三角形在索引缓冲区中的序号
+		float fU = 0.0f, fV = 0.0f;			// 重心坐标, 见 TriangleHit
+	};
+
+	/// @brief 场景射线查询: 顶层为实例世界空间碰撞盒的 SceneBvh, 底层为各网格局部空间的 TriangleBvh.
+	/// 相同几何体与绘制范围的实例共享底层; 实例移动后 UpdateInstance 标记, Commit 统一 Refit 顶层.
+	/// 批量查询以 4 条射线为一组分发到线程池: 同组射线方向符号一致时以射线包遍历两层, 否则逐条遍历,
+	/// 因此调用者应使相邻射线相近(例如按屏幕分块或按起点排序). 查询期间不能修改场景
+	class SceneRayQuery
+	{
+	public:
+		bool bPackets = 1;					// 是否以射线包遍历方向一致的射线组
+
+		/// @brief 添加实例, 底层由几何体的 CPU 副本构建(已构建时直接共享)
+		/// @param geo 			需要 pCPUVertexBuffer / pCPUIndexBuffer
+		/// @param range 		绘制范围, 只使用 nStartIndexLocation / nIndexCount / nBaseVertexLocation
+		/// @param matWorld 	世界变换矩阵
+		/// @param nUserData 	命中时返回的用户数据, 通常为渲染项索引
+		/// @return 			实例序号, 用于 UpdateInstance; 缺少 CPU 副本时为 BVH_NULL_NODE
+		UINT AddInstance(const Resource::MeshGeometry& geo, const Resource::SubmeshGeometry& range,
+						 const DirectX::XMFLOAT4X4& matWorld, UINT nUserData);
+
+#ifndef D3D12_INSTANCE
+		/// @brief 以渲染项的几何体, 绘制范围与 matWorld 添加实例
+		UINT AddItem(const RenderItem& item, UINT nUserData)
+		{
+			Resource::SubmeshGeometry range;
+			range.nStartIndexLocation = item.nStartIndexLocation;
+			range.nIndexCount = item.nIndexCount;
+			range.nBaseVertexLocation = item.nBaseVertexLocation;
+			return item.pGeo ? AddInstance(*item.pGeo, range, item.matWorld, nUserData) : BVH_NULL_NODE;
+		}
+#endif
+
+		/// @brief 更新实例的世界变换矩阵, 在下一次 Commit 时生效
+		void UpdateInstance(UINT nInstance, const DirectX::XMFLOAT4X4& matWorld);
+		/// @brief 重算 UpdateInstance 标记的顶层路径, 查询前调用
+		void Commit();
+
+		/// @brief 求单条射线的最近命中
+		/// @return 命中时返回 1
+		bool Trace(const SceneRay& ray, SceneRayHit& hit) const;
+
+		/// @brief 批量求射线的最近命中, 返回时全部写入
+		/// @param pPool 	线程池; 为 NULL 时使用 ThreadPool::GetInstance()
+		void Trace(const SceneRay* pRays, SceneRayHit* pHits, UINT nCount, BaseHelper::Thread::ThreadPool* pPool = NULL) const;
+
+		UINT GetInstanceCount() const;
+		UINT GetMeshCount() const;
+		void Clear();
+
+	private:
+		struct MeshKey
+		{
+			const Resource::MeshGeometry* pGeo;
+			UINT nStartIndex;
+			UINT nIndexCount;
+			UINT nBaseVertex;
+
+			bool operator<(const MeshKey& key) const
+			{
+				return std::tie(pGeo, nStartIndex, nIndexCount, nBaseVertex) < std::tie(key.pGeo, key.nStartIndex, key.nIndexCount, key.nBaseVertex);
+			}
+		};
+
+		struct Instance
+		{
+			DirectX::XMFLOAT4X4 matWorld;
+			DirectX::XMFLOAT4X4 matInvWorld;
+			const TriangleBvh* pBvh;
+			UINT nUserData;
+			UINT nProxy;					// TopLevel 中的代理
+		};
+
+		std::map<MeshKey, TriangleBvh> Meshes;
+		std::vector<Instance> Instances;
+		SceneBvh TopLevel;					// 用户数据为实例序号
+
+		DirectX::BoundingBox GetWorldBounds(const Instance& instance) const;
+		void TracePacket(const SceneRay* pRays, SceneRayHit* pHits) const;
+
+		static float CALLBACK TraceInstance(void* param, UINT nInstance, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance);
+		static void CALLBACK TraceInstancePacket(void* param, UINT nInstance, RayPacket& packet, UINT nMask);
+		static void CALLBACK TraceRange(void* param, UINT nBegin, UINT nEnd);
+	};
+};
+
+#endif
@@ -16,6 +16,14 @@ namespace D3DHelper
             std::wstring FileName;
         };
 		
+        /// @brief 子网格的一级 LOD; 与原子网格共用顶点数据及 nBaseVertexLocation
+        struct SubmeshLod
+        {
+            UINT nIndexCount;						// 顶点索引数量
+            UINT nStartIndexLocation;				// 顶点索引基值
+            float fError;							// 相对于包围盒尺寸的简化误差
+        };
+
         /// @brief 渲染数据描述结构体
         struct SubmeshGeometry
         {
@@ -24,6 +32,8 @@ namespace D3DHelper
             UINT nBaseVertexLocation;				// 顶点基值
 
             DirectX::BoundingBox Bounds;			// 几何体碰撞盒数据
+
+            std::vector<SubmeshLod> Lods;			// LOD1 起的简化级别, 为空时只有原始网格
         };
 
         /// @brief 渲染数据结构体
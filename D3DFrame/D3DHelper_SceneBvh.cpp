@@ -0,0 +1,753 @@
+#include "D3DHelper_SceneBvh.h"
+#include <algorithm>
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+namespace
+{
+	const UINT SAH_BIN_COUNT = 16;
+
+	// 遍历栈, 较浅时使用固定数组, 超出后转存到堆上
+	template<class T>
+	struct TraversalStack
+	{
+		T Fixed[64];
+		std::vector<T> Spill;
+		UINT nSize = 0;
+
+		void Push(const T& v)
+		{
+			if(nSize < _countof(Fixed))
+				Fixed[nSize] = v;
+			else
+				Spill.push_back(v);
+			++nSize;
+		}
+
+		bool Pop(T& v)
+		{
+			if(!nSize)
+				return 0;
+
+			--nSize;
+			if(nSize < _countof(Fixed))
+				v = Fixed[nSize];
+			else
+			{
+				v = Spill.back();
+				Spill.pop_back();
+			}
+			return 1;
+		}
+	};
+
+	// 表面积的一半, 只用于比较
+	inline float HalfArea(const XMFLOAT3& vMin, const XMFLOAT3& vMax)
+	{
+		float dx = vMax.x - vMin.x, dy = vMax.y - vMin.y, dz = vMax.z - vMin.z;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	inline float HalfArea(FXMVECTOR vMin, FXMVECTOR vMax)
+	{
+		XMFLOAT3 a, b;
+		XMStoreFloat3(&a, vMin);
+		XMStoreFloat3(&b, vMax);
+		return HalfArea(a, b);
+	}
+
+	inline float UnionArea(const XMFLOAT3& aMin, const XMFLOAT3& aMax, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
+	{
+		return HalfArea(XMVectorMin(XMLoadFloat3(&aMin), XMLoadFloat3(&bMin)), XMVectorMax(XMLoadFloat3(&aMax), XMLoadFloat3(&bMax)));
+	}
+
+	// 射线与 AABB 的 slab 测试, 返回进入距离; 未相交时返回 FLT_MAX
+	inline float RayBox(FXMVECTOR origin, FXMVECTOR invDir, const XMFLOAT3& vMin, const XMFLOAT3& vMax, float fMaxDistance)
+	{
+		XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vMin), origin), invDir);
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vMax), origin), invDir);
+		XMFLOAT3 tNear, tFar;
+		XMStoreFloat3(&tNear, XMVectorMin(t0, t1));
+		XMStoreFloat3(&tFar, XMVectorMax(t0, t1));
+
+		float fEnter = max(max(tNear.x, tNear.y), max(tNear.z, 0.0f));
+		float fExit = min(min(tFar.x, tFar.y), min(tFar.z, fMaxDistance));
+		return fEnter <= fExit ? fEnter : FLT_MAX;
+	}
+}
+
+UINT SceneBvh::AllocNode()
+{
+	if(nFreeList == BVH_NULL_NODE)
+	{
+		Nodes.emplace_back();
+		return (UINT)Nodes.size() - 1;
+	}
+
+	UINT nNode = nFreeList;
+	nFreeList = Nodes[nNode].nParent;
+	Nodes[nNode] = BvhNode();
+	return nNode;
+}
+
+void SceneBvh::FreeNode(UINT nNode)
+{
+	Nodes[nNode].nParent = nFreeList;
+	Nodes[nNode].nLeft = Nodes[nNode].nRight = BVH_NULL_NODE;
+	nFreeList = nNode;
+}
+
+void SceneBvh::Build(const BoundingBox* pBounds, const UINT* pUserData, UINT nObjects)
+{
+	Clear();
+	if(!nObjects)
+		return;
+
+	// 叶子占据前 nObjects 个节点, 内部节点在其后
+	Nodes.resize(nObjects);
+	Nodes.reserve(2 * nObjects - 1);
+
+	std::vector<UINT> leaves(nObjects);
+	std::vector<XMFLOAT3> centroids(nObjects);
+	for(UINT i = 0; i < nObjects; ++i)
+	{
+		BvhNode& node = Nodes[i];
+		XMVECTOR c = XMLoadFloat3(&pBounds[i].Center), e = XMLoadFloat3(&pBounds[i].Extents);
+		XMStoreFloat3(&node.vec3Min, c - e);
+		XMStoreFloat3(&node.vec3Max, c + e);
+		node.nUserData = pUserData ? pUserData[i] : i;
+
+		leaves[i] = i;
+		centroids[i] = pBounds[i].Center;
+	}
+
+	nCount = nObjects;
+	nRoot = BuildRange(leaves.data(), centroids.data(), 0, nObjects);
+}
+
+UINT SceneBvh::BuildRange(UINT* pLeaves, const XMFLOAT3* pCentroids, UINT nBegin, UINT nEnd)
+{
+	if(nEnd - nBegin == 1)
+		return pLeaves[nBegin];
+
+	// 按质心包围盒最长的轴分箱
+	XMVECTOR cMin = XMVectorReplicate(FLT_MAX), cMax = XMVectorReplicate(-FLT_MAX);
+	for(UINT i = nBegin; i < nEnd; ++i)
+	{
+		XMVECTOR c = XMLoadFloat3(&pCentroids[pLeaves[i]]);
+		cMin = XMVectorMin(cMin, c);
+		cMax = XMVectorMax(cMax, c);
+	}
+
+	XMFLOAT3 vMin, vExtent;
+	XMStoreFloat3(&vMin, cMin);
+	XMStoreFloat3(&vExtent, cMax - cMin);
+	UINT nAxis = vExtent.x > vExtent.y ? (vExtent.x > vExtent.z ? 0 : 2) : (vExtent.y > vExtent.z ? 1 : 2);
+	float fMin = (&vMin.x)[nAxis], fExtent = (&vExtent.x)[nAxis];
+
+	UINT nMid = nBegin + (nEnd - nBegin) / 2;
+	if(fExtent > 0.0f)
+	{
+		float fScale = SAH_BIN_COUNT / fExtent;
+		auto BinOf = [&](UINT nLeaf) {
+			return min((UINT)(((&pCentroids[nLeaf].x)[nAxis] - fMin) * fScale), SAH_BIN_COUNT - 1);
+		};
+
+		UINT counts[SAH_BIN_COUNT] = {};
+		XMVECTOR binMin[SAH_BIN_COUNT], binMax[SAH_BIN_COUNT];
+		for(UINT b = 0; b < SAH_BIN_COUNT; ++b)
+		{
+			binMin[b] = XMVectorReplicate(FLT_MAX);
+			binMax[b] = XMVectorReplicate(-FLT_MAX);
+		}
+		for(UINT i = nBegin; i < nEnd; ++i)
+		{
+			UINT b = BinOf(pLeaves[i]);
+			++counts[b];
+			binMin[b] = XMVectorMin(binMin[b], XMLoadFloat3(&Nodes[pLeaves[i]].vec3Min));
+			binMax[b] = XMVectorMax(binMax[b], XMLoadFloat3(&Nodes[pLeaves[i]].vec3Max));
+		}
+
+		// 从右向左累积, 再从左向右扫描求代价最小的分割面
+		float rightArea[SAH_BIN_COUNT];
+		UINT rightCount[SAH_BIN_COUNT];
+		XMVECTOR accMin = XMVectorReplicate(FLT_MAX), accMax = XMVectorReplicate(-FLT_MAX);
+		UINT nAcc = 0;
+		for(UINT b = SAH_BIN_COUNT - 1; b > 0; --b)
+		{
+			accMin = XMVectorMin(accMin, binMin[b]);
+			accMax = XMVectorMax(accMax, binMax[b]);
+			nAcc += counts[b];
+			rightArea[b] = nAcc ? HalfArea(accMin, accMax) : 0.0f;
+			rightCount[b] = nAcc;
+		}
+
+		float fBestCost = FLT_MAX;
+		UINT nBestSplit = 0;
+		accMin = XMVectorReplicate(FLT_MAX);
+		accMax = XMVectorReplicate(-FLT_MAX);
+		nAcc = 0;
+		for(UINT b = 0; b < SAH_BIN_COUNT - 1; ++b)
+		{
+			accMin = XMVectorMin(accMin, binMin[b]);
+			accMax = XMVectorMax(accMax, binMax[b]);
+			nAcc += counts[b];
+			if(!nAcc || !rightCount[b + 1])
+				continue;
+
+			float fCost = nAcc * HalfArea(accMin, accMax) + rightCount[b + 1] * rightArea[b + 1];
+			if(fCost < fBestCost)
+			{
+				fBestCost = fCost;
+				nBestSplit = b + 1;
+			}
+		}
+
+		if(nBestSplit)
+			nMid = (UINT)(std::partition(pLeaves + nBegin, pLeaves + nEnd, [&](UINT nLeaf) { return BinOf(nLeaf) < nBestSplit; }) - pLeaves);
+	}
+
+	// 所有质心重合或无法分割时按中位数划分
+	if(nMid == nBegin || nMid == nEnd || fExtent <= 0.0f)
+	{
+		nMid = nBegin + (nEnd - nBegin) / 2;
+		std::nth_element(pLeaves + nBegin, pLeaves + nMid, pLeaves + nEnd, [&](UINT a, UINT b) {
+			return (&pCentroids[a].x)[nAxis] < (&pCentroids[b].x)[nAxis];
+		});
+	}
+
+	UINT nLeft = BuildRange(pLeaves, pCentroids, nBegin, nMid);
+	UINT nRight = BuildRange(pLeaves, pCentroids, nMid, nEnd);
+
+	UINT nNode = AllocNode();
+	Nodes[nNode].nLeft = nLeft;
+	Nodes[nNode].nRight = nRight;
+	Nodes[nLeft].nParent = nNode;
+	Nodes[nRight].nParent = nNode;
+	UpdateBounds(nNode);
+	return nNode;
+}
+
+UINT SceneBvh::Insert(const BoundingBox& bounds, UINT nUserData)
+{
+	UINT nLeaf = AllocNode();
+	XMVECTOR c = XMLoadFloat3(&bounds.Center), e = XMLoadFloat3(&bounds.Extents);
+	XMStoreFloat3(&Nodes[nLeaf].vec3Min, c - e);
+	XMStoreFloat3(&Nodes[nLeaf].vec3Max, c + e);
+	Nodes[nLeaf].nUserData = nUserData;
+	++nCount;
+
+	if(nRoot == BVH_NULL_NODE)
+	{
+		nRoot = nLeaf;
+		return nLeaf;
+	}
+
+	// 自根向下寻找兄弟节点: 在当前节点处新建父节点的代价与继续下降的代价比较
+	const XMFLOAT3& lMin = Nodes[nLeaf].vec3Min;
+	const XMFLOAT3& lMax = Nodes[nLeaf].vec3Max;
+	UINT nSibling = nRoot;
+	while(Nodes[nSibling].nLeft != BVH_NULL_NODE)
+	{
+		const BvhNode& node = Nodes[nSibling];
+		float fArea = HalfArea(node.vec3Min, node.vec3Max);
+		float fCombined = UnionArea(node.vec3Min, node.vec3Max, lMin, lMax);
+		float fCost = 2.0f * fCombined;
+		float fInherit = 2.0f * (fCombined - fArea);
+
+		float fChildCost[2];
+		UINT nChildren[2] = {node.nLeft, node.nRight};
+		for(UINT k = 0; k < 2; ++k)
+		{
+			const BvhNode& child = Nodes[nChildren[k]];
+			float fUnion = UnionArea(child.vec3Min, child.vec3Max, lMin, lMax);
+			fChildCost[k] = fInherit + (child.nLeft == BVH_NULL_NODE ? fUnion : fUnion - HalfArea(child.vec3Min, child.vec3Max));
+		}
+
+		if(fCost < fChildCost[0] && fCost < fChildCost[1])
+			break;
+		nSibling = fChildCost[0] < fChildCost[1] ? nChildren[0] : nChildren[1];
+	}
+
+	UINT nOldParent = Nodes[nSibling].nParent;
+	UINT nParent = AllocNode();
+	Nodes[nParent].nParent = nOldParent;
+	Nodes[nParent].nLeft = nSibling;
+	Nodes[nParent].nRight = nLeaf;
+	Nodes[nSibling].nParent = nParent;
+	Nodes[nLeaf].nParent = nParent;
+	Nodes[nParent].bDirty = Nodes[nSibling].bDirty;		// 兄弟节点的子树有待 Refit 时保持标记路径完整
+
+	if(nOldParent == BVH_NULL_NODE)
+		nRoot = nParent;
+	else if(Nodes[nOldParent].nLeft == nSibling)
+		Nodes[nOldParent].nLeft = nParent;
+	else
+		Nodes[nOldParent].nRight = nParent;
+
+	FixUpwards(nParent);
+	return nLeaf;
+}
+
+void SceneBvh::Remove(UINT nProxy)
+{
+	assert(nProxy < Nodes.size() && Nodes[nProxy].nLeft == BVH_NULL_NODE);
+	--nCount;
+
+	if(nProxy == nRoot)
+	{
+		nRoot = BVH_NULL_NODE;
+		FreeNode(nProxy);
+		return;
+	}
+
+	// 以兄弟节点替换父节点
+	UINT nParent = Nodes[nProxy].nParent;
+	UINT nGrandParent = Nodes[nParent].nParent;
+	UINT nSibling = Nodes[nParent].nLeft == nProxy ? Nodes[nParent].nRight : Nodes[nParent].nLeft;
+
+	Nodes[nSibling].nParent = nGrandParent;
+	if(nGrandParent == BVH_NULL_NODE)
+		nRoot = nSibling;
+	else if(Nodes[nGrandParent].nLeft == nParent)
+		Nodes[nGrandParent].nLeft = nSibling;
+	else
+		Nodes[nGrandParent].nRight = nSibling;
+
+	FreeNode(nParent);
+	FreeNode(nProxy);
+
+	if(nGrandParent != BVH_NULL_NODE)
+		FixUpwards(nGrandParent);
+}
+
+void SceneBvh::Update(UINT nProxy, const BoundingBox& bounds)
+{
+	assert(nProxy < Nodes.size() && Nodes[nProxy].nLeft == BVH_NULL_NODE);
+
+	XMVECTOR c = XMLoadFloat3(&bounds.Center), e = XMLoadFloat3(&bounds.Extents);
+	XMStoreFloat3(&Nodes[nProxy].vec3Min, c - e);
+	XMStoreFloat3(&Nodes[nProxy].vec3Max, c + e);
+
+	// 标记到根节点, 遇到已标记的祖先即可停止
+	for(UINT nNode = Nodes[nProxy].nParent; nNode != BVH_NULL_NODE && !Nodes[nNode].bDirty; nNode = Nodes[nNode].nParent)
+		Nodes[nNode].bDirty = 1;
+}
+
+void SceneBvh::Refit()
+{
+	if(nRoot != BVH_NULL_NODE && Nodes[nRoot].bDirty)
+		RefitNode(nRoot);
+}
+
+void SceneBvh::RefitNode(UINT nNode)
+{
+	// 后序处理被标记的节点: 子节点先更新, 再旋转当前节点
+	BvhNode& node = Nodes[nNode];
+	if(node.nLeft == BVH_NULL_NODE)
+	{
+		node.bDirty = 0;
+		return;
+	}
+
+	if(Nodes[node.nLeft].bDirty)
+		RefitNode(node.nLeft);
+	if(Nodes[node.nRight].bDirty)
+		RefitNode(node.nRight);
+
+	UpdateBounds(nNode);
+	Rotate(nNode);
+	Nodes[nNode].bDirty = 0;
+}
+
+void SceneBvh::FixUpwards(UINT nNode)
+{
+	for(; nNode != BVH_NULL_NODE; nNode = Nodes[nNode].nParent)
+	{
+		UpdateBounds(nNode);
+		Rotate(nNode);
+	}
+}
+
+void SceneBvh::UpdateBounds(UINT nNode)
+{
+	BvhNode& node = Nodes[nNode];
+	const BvhNode& left = Nodes[node.nLeft];
+	const BvhNode& right = Nodes[node.nRight];
+	XMStoreFloat3(&node.vec3Min, XMVectorMin(XMLoadFloat3(&left.vec3Min), XMLoadFloat3(&right.vec3Min)));
+	XMStoreFloat3(&node.vec3Max, XMVectorMax(XMLoadFloat3(&left.vec3Max), XMLoadFloat3(&right.vec3Max)));
+}
+
+void SceneBvh::Rotate(UINT nNode)
+{
+	if(!bRotate)
+		return;
+
+	// 节点 A 的子节点为 B, C; 尝试把 B 与 C 的某个子节点交换(或反之), 选择使被修改的子节点面积减少最多的一种.
+	// A 的碰撞盒不变, 只有被交换进去的那个子节点的面积会变化
+	UINT nB = Nodes[nNode].nLeft, nC = Nodes[nNode].nRight;
+	float fBestGain = 0.0f;
+	UINT nFrom = BVH_NULL_NODE, nTo = BVH_NULL_NODE;		// 把 nFrom 与 nTo 交换; nTo 为另一侧的孙节点
+
+	auto Consider = [&](UINT nChild, UINT nOther) {
+		const BvhNode& other = Nodes[nOther];
+		if(other.nLeft == BVH_NULL_NODE)
+			return;
+
+		const BvhNode& child = Nodes[nChild];
+		float fArea = HalfArea(other.vec3Min, other.vec3Max);
+		const BvhNode& gl = Nodes[other.nLeft];
+		const BvhNode& gr = Nodes[other.nRight];
+
+		// 与左孙节点交换后, other 由 child 与右孙节点组成
+		float fGain = fArea - UnionArea(child.vec3Min, child.vec3Max, gr.vec3Min, gr.vec3Max);
+		if(fGain > fBestGain)
+		{
+			fBestGain = fGain;
+			nFrom = nChild;
+			nTo = other.nLeft;
+		}
+		fGain = fArea - UnionArea(child.vec3Min, child.vec3Max, gl.vec3Min, gl.vec3Max);
+		if(fGain > fBestGain)
+		{
+			fBestGain = fGain;
+			nFrom = nChild;
+			nTo = other.nRight;
+		}
+	};
+	Consider(nB, nC);
+	Consider(nC, nB);
+
+	if(nFrom == BVH_NULL_NODE)
+		return;
+
+	UINT nOther = Nodes[nTo].nParent;
+	if(Nodes[nNode].nLeft == nFrom)
+		Nodes[nNode].nLeft = nTo;
+	else
+		Nodes[nNode].nRight = nTo;
+	if(Nodes[nOther].nLeft == nTo)
+		Nodes[nOther].nLeft = nFrom;
+	else
+		Nodes[nOther].nRight = nFrom;
+
+	Nodes[nTo].nParent = nNode;
+	Nodes[nFrom].nParent = nOther;
+	Nodes[nOther].bDirty |= Nodes[nFrom].bDirty;
+	UpdateBounds(nOther);
+}
+
+UINT SceneBvh::QueryPlanes(const XMFLOAT4* pPlanes, UINT nPlaneCount, std::vector<UINT>& out) const
+{
+	assert(nPlaneCount <= 32);
+	out.clear();
+	if(nRoot == BVH_NULL_NODE)
+		return 0;
+
+	XMVECTOR planes[32], absPlanes[32];
+	for(UINT p = 0; p < nPlaneCount; ++p)
+	{
+		planes[p] = XMLoadFloat4(&pPlanes[p]);
+		absPlanes[p] = XMVectorAbs(planes[p]);
+	}
+
+	// 掩码记录仍需测试的平面; 节点完全位于某个平面内侧时, 其子树不再测试该平面
+	struct Entry { UINT nNode; UINT nMask; };
+	TraversalStack<Entry> stack;
+	stack.Push({nRoot, nPlaneCount == 32 ? ~0u : (1u << nPlaneCount) - 1});
+
+	Entry entry;
+	while(stack.Pop(entry))
+	{
+		const BvhNode& node = Nodes[entry.nNode];
+		UINT nMask = entry.nMask;
+		if(nMask)
+		{
+			XMVECTOR vMin = XMLoadFloat3(&node.vec3Min), vMax = XMLoadFloat3(&node.vec3Max);
+			XMVECTOR center = XMVectorSetW((vMin + vMax) * 0.5f, 1.0f);
+			XMVECTOR extents = (vMax - vMin) * 0.5f;
+
+			bool bOutside = 0;
+			for(UINT p = 0; p < nPlaneCount && !bOutside; ++p)
+			{
+				if(!(nMask & (1u << p)))
+					continue;
+
+				float fDistance = XMVectorGetX(XMVector4Dot(planes[p], center));
+				float fRadius = XMVectorGetX(XMVector3Dot(absPlanes[p], extents));
+				if(fDistance + fRadius < 0.0f)
+					bOutside = 1;
+				else if(fDistance - fRadius >= 0.0f)
+					nMask &= ~(1u << p);
+			}
+			if(bOutside)
+				continue;
+		}
+
+		if(node.nLeft == BVH_NULL_NODE)
+			out.push_back(node.nUserData);
+		else
+		{
+			stack.Push({node.nRight, nMask});
+			stack.Push({node.nLeft, nMask});
+		}
+	}
+	return (UINT)out.size();
+}
+
+UINT SceneBvh::QueryFrustum(const Camera& camera, std::vector<UINT>& out) const
+{
+	return QueryPlanes(camera.GetMatrices().vec4FrustumPlanes, 6, out);
+}
+
+UINT SceneBvh::QueryBox(const BoundingBox& box, std::vector<UINT>& out) const
+{
+	out.clear();
+	if(nRoot == BVH_NULL_NODE)
+		return 0;
+
+	XMFLOAT3 qMin(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+	XMFLOAT3 qMax(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+
+	TraversalStack<UINT> stack;
+	stack.Push(nRoot);
+
+	UINT nNode;
+	while(stack.Pop(nNode))
+	{
+		const BvhNode& node = Nodes[nNode];
+		if(node.vec3Min.x > qMax.x || node.vec3Min.y > qMax.y || node.vec3Min.z > qMax.z ||
+		   node.vec3Max.x < qMin.x || node.vec3Max.y < qMin.y || node.vec3Max.z < qMin.z)
+			continue;
+
+		if(node.nLeft == BVH_NULL_NODE)
+			out.push_back(node.nUserData);
+		else
+		{
+			stack.Push(node.nRight);
+			stack.Push(node.nLeft);
+		}
+	}
+	return (UINT)out.size();
+}
+
+UINT SceneBvh::Raycast(FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance, BVH_RAY_CALLBACK callback, void* param, float* pDistance) const
+{
+	UINT nHit = BVH_NULL_NODE;
+	float fBest = fMaxDistance;
+	if(nRoot != BVH_NULL_NODE)
+	{
+		// 方向分量为 0 时以极大值代替倒数, slab 测试仍然成立
+		XMVECTOR invDir = XMVectorReciprocal(XMVectorSelect(dir, XMVectorReplicate(1e-30f), XMVectorEqual(dir, XMVectorZero())));
+
+		struct Entry { UINT nNode; float fEnter; };
+		TraversalStack<Entry> stack;
+		float fRoot = RayBox(origin, invDir, Nodes[nRoot].vec3Min, Nodes[nRoot].vec3Max, fBest);
+		if(fRoot != FLT_MAX)
+			stack.Push({nRoot, fRoot});
+
+		Entry entry;
+		while(stack.Pop(entry))
+		{
+			if(entry.fEnter > fBest)
+				continue;
+
+			const BvhNode& node = Nodes[entry.nNode];
+			if(node.nLeft == BVH_NULL_NODE)
+			{
+				float t = callback(param, node.nUserData, origin, dir, fBest);
+				if(t >= 0.0f && t < fBest)
+				{
+					fBest = t;
+					nHit = node.nUserData;
+				}
+				continue;
+			}
+
+			// 较近的子节点后入栈, 先处理
+			const BvhNode& left = Nodes[node.nLeft];
+			const BvhNode& right = Nodes[node.nRight];
+			float tLeft = RayBox(origin, invDir, left.vec3Min, left.vec3Max, fBest);
+			float tRight = RayBox(origin, invDir, right.vec3Min, right.vec3Max, fBest);
+			if(tLeft <= tRight)
+			{
+				if(tRight != FLT_MAX)
+					stack.Push({node.nRight, tRight});
+				if(tLeft != FLT_MAX)
+					stack.Push({node.nLeft, tLeft});
+			}
+			else
+			{
+				if(tLeft != FLT_MAX)
+					stack.Push({node.nLeft, tLeft});
+				stack.Push({node.nRight, tRight});
+			}
+		}
+	}
+
+	if(pDistance)
+		*pDistance = fBest;
+	return nHit;
+}
+
+void SceneBvh::RaycastPacket(RayPacket& packet, UINT nMask, BVH_PACKET_CALLBACK callback, void* param) const
+{
+	if(nRoot == BVH_NULL_NODE)
+		return;
+
+	struct Entry { UINT nNode; UINT nMask; float fEnter; };
+	TraversalStack<Entry> stack;
+	float fRoot;
+	nMask = packet.IntersectBox(Nodes[nRoot].vec3Min, Nodes[nRoot].vec3Max, nMask, &fRoot);
+	if(nMask)
+		stack.Push({nRoot, nMask, fRoot});
+
+	Entry entry;
+	while(stack.Pop(entry))
+	{
+		// 射线包中最远的一条也已有更近的命中
+		XMVECTOR vMax = packet.MaxDistance;
+		vMax = XMVectorMax(vMax, XMVectorSwizzle<2, 3, 0, 1>(vMax));
+		vMax = XMVectorMax(vMax, XMVectorSwizzle<1, 0, 3, 2>(vMax));
+		if(entry.fEnter > XMVectorGetX(vMax))
+			continue;
+
+		const BvhNode& node = Nodes[entry.nNode];
+		if(node.nLeft == BVH_NULL_NODE)
+		{
+			callback(param, node.nUserData, packet, entry.nMask);
+			continue;
+		}
+
+		const BvhNode& left = Nodes[node.nLeft];
+		const BvhNode& right = Nodes[node.nRight];
+		float tLeft, tRight;
+		UINT nLeftMask = packet.IntersectBox(left.vec3Min, left.vec3Max, entry.nMask, &tLeft);
+		UINT nRightMask = packet.IntersectBox(right.vec3Min, right.vec3Max, entry.nMask, &tRight);
+		if(tLeft <= tRight)
+		{
+			if(nRightMask)
+				stack.Push({node.nRight, nRightMask, tRight});
+			if(nLeftMask)
+				stack.Push({node.nLeft, nLeftMask, tLeft});
+		}
+		else
+		{
+			if(nLeftMask)
+				stack.Push({node.nLeft, nLeftMask, tLeft});
+			if(nRightMask)
+				stack.Push({node.nRight, nRightMask, tRight});
+		}
+	}
+}
+
+float SceneBvh::GetCost() const
+{
+	if(nRoot == BVH_NULL_NODE)
+		return 0.0f;
+
+	double fSum = 0.0;
+	TraversalStack<UINT> stack;
+	stack.Push(nRoot);
+
+	UINT nNode;
+	while(stack.Pop(nNode))
+	{
+		const BvhNode& node = Nodes[nNode];
+		fSum += HalfArea(node.vec3Min, node.vec3Max);
+		if(node.nLeft != BVH_NULL_NODE)
+		{
+			stack.Push(node.nLeft);
+			stack.Push(node.nRight);
+		}
+	}
+
+	float fRoot = HalfArea(Nodes[nRoot].vec3Min, Nodes[nRoot].vec3Max);
+	return fRoot > 0.0f ? (float)(fSum / fRoot) : 0.0f;
+}
+
+UINT SceneBvh::GetHeight() const
+{
+	if(nRoot == BVH_NULL_NODE)
+		return 0;
+
+	struct Entry { UINT nNode; UINT nDepth; };
+	TraversalStack<Entry> stack;
+	stack.Push({nRoot, 1});
+
+	UINT nHeight = 0;
+	Entry entry;
+	while(stack.Pop(entry))
+	{
+		nHeight = max(nHeight, entry.nDepth);
+		const BvhNode& node = Nodes[entry.nNode];
+		if(node.nLeft != BVH_NULL_NODE)
+		{
+			stack.Push({node.nLeft, entry.nDepth + 1});
+			stack.Push({node.nRight, entry.nDepth + 1});
+		}
+	}
+	return nHeight;
+}
+
+UINT SceneBvh::GetCount() const
+{
+	return nCount;
+}
+
+void SceneBvh::Clear()
+{
+	Nodes.clear();
+	nRoot = BVH_NULL_NODE;
+	nFreeList = BVH_NULL_NODE;
+	nCount = 0;
+}
+
+void RayPacket::Set(const XMFLOAT3* pOrigins, const XMFLOAT3* pDirections, const float* pMaxDistances)
+{
+	for(UINT a = 0; a < 3; ++a)
+	{
+		Origin[a] = XMVectorSet((&pOrigins[0].x)[a], (&pOrigins[1].x)[a], (&pOrigins[2].x)[a], (&pOrigins[3].x)[a]);
+		Direction[a] = XMVectorSet((&pDirections[0].x)[a], (&pDirections[1].x)[a], (&pDirections[2].x)[a], (&pDirections[3].x)[a]);
+	}
+	MaxDistance = XMLoadFloat4((const XMFLOAT4*)pMaxDistances);
+	UpdateInverse();
+}
+
+void RayPacket::UpdateInverse()
+{
+	XMVECTOR vZero = XMVectorZero(), vTiny = XMVectorReplicate(1e-30f);
+	for(UINT a = 0; a < 3; ++a)
+		InvDirection[a] = XMVectorReciprocal(XMVectorSelect(Direction[a], vTiny, XMVectorEqual(Direction[a], vZero)));
+}
+
+UINT RayPacket::IntersectBox(const XMFLOAT3& vMin, const XMFLOAT3& vMax, UINT nMask, float* pEnter) const
+{
+	XMVECTOR tNear = XMVectorZero(), tFar = MaxDistance;
+	for(UINT a = 0; a < 3; ++a)
+	{
+		XMVECTOR t0 = (XMVectorReplicate((&vMin.x)[a]) - Origin[a]) * InvDirection[a];
+		XMVECTOR t1 = (XMVectorReplicate((&vMax.x)[a]) - Origin[a]) * InvDirection[a];
+		tNear = XMVectorMax(tNear, XMVectorMin(t0, t1));
+		tFar = XMVectorMin(tFar, XMVectorMax(t0, t1));
+	}
+
+	uint32_t hits[4];
+	XMStoreInt4(hits, XMVectorLessOrEqual(tNear, tFar));
+	XMFLOAT4 enter;
+	XMStoreFloat4(&enter, tNear);
+
+	UINT nHit = 0;
+	float fEnter = FLT_MAX;
+	for(UINT k = 0; k < 4; ++k)
+	{
+		if((nMask & (1u << k)) && hits[k])
+		{
+			nHit |= 1u << k;
+			fEnter = min(fEnter, (&enter.x)[k]);
+		}
+	}
+	*pEnter = fEnter;
+	return nHit;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef _D3DHELPER_SCENEBVH_H
+#define _D3DHELPER_SCENEBVH_H
+#include "D3DBase.h"
+#include "Camera.h"
+
+#define BVH_NULL_NODE ((UINT)-1)
+
+namespace D3DHelper
+{
+	/// @brief 射线查询的回调, 由 SceneBvh::Raycast 对射线击中其碰撞盒的对象调用
+	/// @param param 		Raycast 传入的参数
+	/// @param nUserData 	对象的用户数据
+	/// @param origin, dir 	世界空间的射线, 与传入 Raycast 的相同
+	/// @param fMaxDistance	当前最近的命中距离(以 dir 的长度为单位), 更远的命中可以直接忽略
+	/// @return 			小于 fMaxDistance 的命中距离; 未命中时返回负数
+	typedef float (CALLBACK *BVH_RAY_CALLBACK)(void* param, UINT nUserData, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance);
+
+	/// @brief 4 条射线的 SoA 数据, 用于同时遍历层次包围体
+	struct RayPacket
+	{
+		DirectX::XMVECTOR Origin[3];		// 4 条射线起点的 x, y, z 分量
+		DirectX::XMVECTOR Direction[3];		// 方向不必归一化
+		DirectX::XMVECTOR InvDirection[3];	// 方向的倒数, 分量为 0 时以极大值代替
+		DirectX::XMVECTOR MaxDistance;		// 各射线当前的最远距离(以方向的长度为单位), 命中后缩短
+
+		/// @brief 由 4 条射线初始化
+		void Set(const DirectX::XMFLOAT3* pOrigins, const DirectX::XMFLOAT3* pDirections, const float* pMaxDistances);
+		/// @brief 由 Direction 重新计算 InvDirection
+		void UpdateInverse();
+		/// @brief 射线与 AABB 的 slab 测试
+		/// @param nMask 	参与测试的射线, 第 i 位对应第 i 条射线
+		/// @param pEnter 	输出命中射线中最小的进入距离
+		/// @return 		命中的射线掩码
+		UINT IntersectBox(const DirectX::XMFLOAT3& vMin, const DirectX::XMFLOAT3& vMax, UINT nMask, float* pEnter) const;
+	};
+
+	/// @brief 射线包查询的回调, 由 SceneBvh::RaycastPacket 对射线包击中其碰撞盒的对象调用
+	/// @param nMask 	击中碰撞盒的射线; 回调应缩短命中射线的 packet.MaxDistance
+	typedef void (CALLBACK *BVH_PACKET_CALLBACK)(void* param, UINT nUserData, RayPacket& packet, UINT nMask);
+
+	/// @brief 场景层次包围体(动态 AABB 树)
+	/// 每个叶子对应一个对象的世界空间碰撞盒, 代理即叶子的节点索引, 在对象移除之前保持不变.
+	/// Build 以分箱 SAH 自顶向下构建; Insert / Remove 按 SAH 增量修改; 对象移动后调用 Update 标记,
+	/// 每帧统一 Refit: 只重算被标记的路径, 并在每个节点尝试树旋转以抑制 refit 导致的质量下降.
+	/// 查询结果为对象的用户数据(通常为渲染项索引)
+	class SceneBvh
+	{
+	public:
+		bool bRotate = 1;					// Insert / Remove / Refit 时是否进行树旋转
+
+		/// @brief 以 SAH 重新构建整棵树, 第 i 个对象的代理为 i
+		/// @param pBounds 		世界空间碰撞盒
+		/// @param pUserData 	用户数据; 为 NULL 时用户数据即为对象序号
+		/// @param nCount 		对象数量
+		void Build(const DirectX::BoundingBox* pBounds, const UINT* pUserData, UINT nCount);
+
+		/// @brief 插入对象
+		/// @return 代理, 用于 Update / Remove
+		UINT Insert(const DirectX::BoundingBox& bounds, UINT nUserData);
+		void Remove(UINT nProxy);
+
+		/// @brief 更新对象的碰撞盒, 在下一次 Refit 时生效
+		void Update(UINT nProxy, const DirectX::BoundingBox& bounds);
+		/// @brief 重算 Update 标记的路径
+		void Refit();
+
+		/// @brief 查询与凸体相交的对象
+		/// @param pPlanes 		凸体的平面, 约定同 CameraMatrices::vec4FrustumPlanes(法线指向内侧), 最多 32 个
+		/// @param nPlaneCount 	平面数量
+		/// @param out 			输出用户数据, 查询前清空
+		/// @return 			对象数量
+		UINT QueryPlanes(const DirectX::XMFLOAT4* pPlanes, UINT nPlaneCount, std::vector<UINT>& out) const;
+		/// @brief 查询与摄像机视锥体相交的对象, 摄像机需已调用 UpdateViewMatrix
+		UINT QueryFrustum(const Camera& camera, std::vector<UINT>& out) const;
+		/// @brief 查询与碰撞盒重叠的对象
+		UINT QueryBox(const DirectX::BoundingBox& box, std::vector<UINT>& out) const;
+
+		/// @brief 按由近到远的顺序对射线击中碰撞盒的对象调用 callback, 求最近的命中
+		/// @param origin, dir 	世界空间射线, dir 不必归一化
+		/// @param fMaxDistance 最大距离(以 dir 的长度为单位)
+		/// @param pDistance 	输出最近的命中距离, 可为 NULL
+		/// @return 			最近命中对象的用户数据; 未命中时为 BVH_NULL_NODE
+		UINT Raycast(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance,
+					 BVH_RAY_CALLBACK callback, void* param, float* pDistance = NULL) const;
+
+		/// @brief 以 4 条射线为一组遍历, 对至少一条射线击中碰撞盒的对象调用 callback
+		/// 射线方向相近时节点测试可由 4 条射线分摊; 遍历顺序按进入距离由近到远, 不保证每条射线各自有序
+		/// @param packet 	世界空间射线包, 回调对 MaxDistance 的缩短用于剔除之后的节点
+		/// @param nMask 	有效的射线
+		void RaycastPacket(RayPacket& packet, UINT nMask, BVH_PACKET_CALLBACK callback, void* param) const;
+
+		/// @brief SAH 代价: 所有节点的表面积之和与根节点表面积之比, 越小越好
+		float GetCost() const;
+		UINT GetHeight() const;
+		UINT GetCount() const;
+		void Clear();
+
+	private:
+		struct BvhNode
+		{
+			DirectX::XMFLOAT3 vec3Min;
+			UINT nParent = BVH_NULL_NODE;				// 空闲节点时为下一个空闲节点
+			DirectX::XMFLOAT3 vec3Max;
+			UINT nLeft = BVH_NULL_NODE;					// 叶子为 BVH_NULL_NODE
+			UINT nRight = BVH_NULL_NODE;
+			UINT nUserData = 0;
+			bool bDirty = 0;							// 子树中有对象被 Update, 需要 Refit
+		};
+
+		std::vector<BvhNode> Nodes;
+		UINT nRoot = BVH_NULL_NODE;
+		UINT nFreeList = BVH_NULL_NODE;
+		UINT nCount = 0;
+
+		UINT AllocNode();
+		void FreeNode(UINT nNode);
+		UINT BuildRange(UINT* pLeaves, const DirectX::XMFLOAT3* pCentroids, UINT nBegin, UINT nEnd);
+		void RefitNode(UINT nNode);
+		void FixUpwards(UINT nNode);
+		void UpdateBounds(UINT nNode);
+		void Rotate(UINT nNode);
+	};
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "D3DHelper_ShadowCulling.h"
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+void ShadowCasterVolume::Build(FXMMATRIX matLightViewProj, FXMVECTOR lightDir, const XMFLOAT3* pReceiverCorners)
+{
+	// 从观察投影矩阵的列提取左, 右, 下, 上, 远平面, 近平面不参与剔除
+	XMMATRIX columns = XMMatrixTranspose(matLightViewProj);
+	XMVECTOR planes[5] = {
+		columns.r[3] + columns.r[0], columns.r[3] - columns.r[0],
+		columns.r[3] + columns.r[1], columns.r[3] - columns.r[1],
+		columns.r[3] - columns.r[2]
+	};
+	nPlaneCount = 0;
+	for(UINT i = 0; i < 5; ++i)
+		XMStoreFloat4(&Planes[nPlaneCount++], XMPlaneNormalize(planes[i]));
+
+	if(!pReceiverCorners)
+		return;
+
+	XMVECTOR corners[8];
+	XMVECTOR centroid = XMVectorZero();
+	for(UINT i = 0; i < 8; ++i)
+	{
+		corners[i] = XMVectorSetW(XMLoadFloat3(&pReceiverCorners[i]), 1.0f);
+		centroid = XMVectorAdd(centroid, corners[i]);
+	}
+	centroid = XMVectorSetW(XMVectorScale(centroid, 1.0f / 8.0f), 1.0f);
+
+	// 平面过 a, b, c 三点, 法线朝向接收体内部; 三点共线时返回 0
+	auto MakePlane = [&centroid](FXMVECTOR a, FXMVECTOR b, FXMVECTOR c, XMVECTOR& plane)
+	{
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+		if(XMVectorGetX(XMVector3LengthSq(normal)) < 1e-12f)
+			return false;
+		plane = XMPlaneNormalize(XMPlaneFromPointNormal(a, normal));
+		if(XMVectorGetX(XMPlaneDotCoord(plane, centroid)) < 0.0f)
+			plane = XMVectorNegate(plane);
+		return true;
+	};
+
+	// 第 f 个面: 轴 f / 2 的位取 f % 2 的 4 个角点. 阴影沿 lightDir 扫掠, 法线与 lightDir 同向的面被扫掠体越过, 不能用于剔除
+	bool bKept[6];
+	for(UINT f = 0; f < 6; ++f)
+	{
+		UINT nAxis = f / 2, nSide = (f % 2) << nAxis;
+		UINT nU = 1 << ((nAxis + 1) % 3), nV = 1 << ((nAxis + 2) % 3);
+		XMVECTOR plane;
+		bKept[f] = 0;
+		if(!MakePlane(corners[nSide], corners[nSide | nU], corners[nSide | nV], plane) &&
+		   !MakePlane(corners[nSide | nU | nV], corners[nSide | nU], corners[nSide | nV], plane))
+			continue;
+		if(XMVectorGetX(XMVector3Dot(plane, lightDir)) <= 0.0f)
+		{
+			XMStoreFloat4(&Planes[nPlaneCount++], plane);
+			bKept[f] = 1;
+		}
+	}
+
+	// 轮廓边: 两侧的面一个保留, 一个被越过; 以边与 lightDir 张成的平面封闭扫掠体
+	for(UINT nAxis = 0; nAxis < 3; ++nAxis)
+	{
+		UINT nBitU = (nAxis + 1) % 3, nBitV = (nAxis + 2) % 3;
+		for(UINT nCorner = 0; nCorner < 4; ++nCorner)
+		{
+			UINT nU = nCorner & 1, nV = nCorner >> 1;
+			if(bKept[nBitU * 2 + nU] == bKept[nBitV * 2 + nV])
+				continue;
+			UINT a = (nU << nBitU) | (nV << nBitV), b = a | (1 << nAxis);
+			XMVECTOR plane;
+			if(MakePlane(corners[a], corners[b], XMVectorAdd(corners[a], lightDir), plane))
+				XMStoreFloat4(&Planes[nPlaneCount++], plane);
+		}
+	}
+}
+
+bool ShadowCasterVolume::Intersects(const BoundingBox& bounds) const
+{
+	XMVECTOR center = XMVectorSetW(XMLoadFloat3(&bounds.Center), 1.0f);
+	XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+	for(UINT i = 0; i < nPlaneCount; ++i)
+	{
+		XMVECTOR plane = XMLoadFloat4(&Planes[i]);
+		// 中心到平面的距离加上碰撞盒在法线上的投影半径仍为负, 则完全位于外侧
+		float fDistance = XMVectorGetX(XMVector4Dot(plane, center));
+		float fRadius = XMVectorGetX(XMVector3Dot(XMVectorAbs(plane), extents));
+		if(fDistance + fRadius < 0.0f)
+			return 0;
+	}
+	return 1;
+}
+
+UINT ShadowCasterVolume::Cull(const BoundingBox* pBounds, UINT nCount, UINT* pVisible) const
+{
+	UINT nVisible = 0;
+	for(UINT i = 0; i < nCount; ++i)
+		if(Intersects(pBounds[i]))
+			pVisible[nVisible++] = i;
+	return nVisible;
+}
+
+const XMFLOAT4* ShadowCasterVolume::GetPlanes() const
+{
+	return Planes;
+}
+
+UINT ShadowCasterVolume::GetPlaneCount() const
+{
+	return nPlaneCount;
+}
+
+void ShadowCasterVolume::GetFrustumCorners(FXMMATRIX matInvViewProj, XMFLOAT3* pCorners, float fNearZ, float fFarZ)
+{
+	for(UINT i = 0; i < 8; ++i)
+	{
+		XMVECTOR ndc = XMVectorSet((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? fFarZ : fNearZ, 1.0f);
+		XMStoreFloat3(&pCorners[i], XMVector3TransformCoord(ndc, matInvViewProj));
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _D3DHELPER_SHADOWCULLING_H
+#define _D3DHELPER_SHADOWCULLING_H
+#include "D3DBase.h"
+
+// 光源体积 5 个平面, 接收体最多 6 个面与 12 条轮廓边
+#define SHADOW_CASTER_MAX_PLANES 23
+
+namespace D3DHelper
+{
+	/// @brief 阴影投射体剔除
+	/// 由光源的观察投影矩阵提取裁剪平面, 去掉近平面, 使体积朝光源方向无限延伸: 位于阴影图之外但处在光线路径上的
+	/// 物体仍然投射阴影. 可选地再加入接收体(通常为摄像机视锥体)沿光线反方向扫掠得到的凸包: 阴影落不进接收体的物体被剔除.
+	/// 凸包由接收体背向光源的面与轮廓边沿光线方向张成的平面组成.
+	/// 物体以世界空间 AABB 测试, 平面约定同 CameraMatrices::vec4FrustumPlanes(法线指向内侧); 测试是保守的
+	class ShadowCasterVolume
+	{
+	public:
+		/// @brief 构建投射体
+		/// @param matLightViewProj 	光源的观察投影矩阵(行向量约定)
+		/// @param lightDir 			光线的传播方向(世界空间), 不必归一化
+		/// @param pReceiverCorners 	接收体的 8 个角点, 第 i 个角点的 x, y, z 取 i 的第 0, 1, 2 位(0 为负侧或近处),
+		/// 							见 GetFrustumCorners; 为 NULL 时只以光源体积剔除
+		void Build(DirectX::FXMMATRIX matLightViewProj, DirectX::FXMVECTOR lightDir, const DirectX::XMFLOAT3* pReceiverCorners = NULL);
+
+		/// @brief 世界空间碰撞盒是否可能投射阴影
+		bool Intersects(const DirectX::BoundingBox& bounds) const;
+
+		/// @brief 批量测试
+		/// @param pVisible 	输出投射体的索引(升序), 容量至少为 nCount
+		/// @return 			投射体数量
+		UINT Cull(const DirectX::BoundingBox* pBounds, UINT nCount, UINT* pVisible) const;
+
+		const DirectX::XMFLOAT4* GetPlanes() const;
+		UINT GetPlaneCount() const;
+
+		/// @brief 求视锥体在投影空间深度 [fNearZ, fFarZ] 之间部分的 8 个世界空间角点, 顺序同 Build
+		/// @param matInvViewProj 	观察投影矩阵的逆, 如 CameraMatrices::matInvViewProj
+		static void GetFrustumCorners(DirectX::FXMMATRIX matInvViewProj, DirectX::XMFLOAT3* pCorners, float fNearZ = 0.0f, float fFarZ = 1.0f);
+
+	private:
+		DirectX::XMFLOAT4 Planes[SHADOW_CASTER_MAX_PLANES];
+		UINT nPlaneCount = 0;
+	};
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "D3DHelper.h"
+
+using namespace D3DHelper;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+namespace
+{
+	const UINT SKINNED_BATCH_GRAIN = 16;		// 每块的实例数; 块越小负载越均衡, 但争用计数器的次数越多
+
+	struct SkinnedBatch
+	{
+		SkinnedInstance* pInstances;
+		float fDeltaTime;
+		BYTE* pDest;
+		UINT nSlotByteSize;
+		SkinnedPaletteFormats emFormat;
+	};
+
+	const UINT PALETTE_BONE_BYTE_SIZE[] = {64, 48, 32};		// 按 SkinnedPaletteFormats 排列
+
+	void UpdateInstance(SkinnedInstance& instance, float fDeltaTime, BYTE* pDest, UINT nSlotByteSize, SkinnedPaletteFormats emFormat)
+	{
+		instance.UpdateAnimation(fDeltaTime);
+
+		UINT nBones = (UINT)instance.matFinalTransforms.size();
+		assert(nBones * PALETTE_BONE_BYTE_SIZE[emFormat] <= nSlotByteSize);
+		nBones = min(nBones, nSlotByteSize / PALETTE_BONE_BYTE_SIZE[emFormat]);
+		WriteSkinnedPalette(instance.matFinalTransforms.data(), nBones, emFormat, pDest + (size_t)instance.nSkinnedCBIndex * nSlotByteSize);
+	}
+
+	void CALLBACK SkinnedBatchCallback(void* param, UINT nBegin, UINT nEnd)
+	{
+		SkinnedBatch* pBatch = (SkinnedBatch*)param;
+		for(UINT i = nBegin; i < nEnd; ++i)
+		{
+			SkinnedInstance& instance = pBatch->pInstances[i];
+			if(!instance.pPoseCache)
+				UpdateInstance(instance, pBatch->fDeltaTime, pBatch->pDest, pBatch->nSlotByteSize, pBatch->emFormat);
+		}
+	}
+}
+
+void SkinnedInstance::EvaluatePose(float fTime, std::vector<XMFLOAT4X4>& pose)
+{
+	if(pPoseCache)
+	{
+		const std::vector<XMFLOAT4X4>& cached = pPoseCache->GetFinalTransforms(*Skinned, Clip, fTime);
+		if(!cached.empty())
+			pose.assign(cached.begin(), cached.end());
+	}
+	else
+	{
+		if(pose.size() < Skinned->BoneCount())
+			pose.resize(Skinned->BoneCount());
+		Skinned->GetFinalTransforms(Clip, fTime, pose.data(), &Cursor);
+	}
+}
+
+void SkinnedInstance::UpdateAnimation(float t)
+{
+	assert(Skinned);
+
+	if(!Clip.IsValid())
+		Clip = Skinned->FindClip(ClipName);
+
+	// 循环时保留超出的部分, 否则所有实例在第一次循环后都会对齐到 0
+	float fEnd = Skinned->GetClipEndTime(Clip);
+	auto Wrap = [fEnd](float fTime) { return fTime > fEnd? (fEnd > 0.0f? fmodf(fTime, fEnd): 0.0f): fTime; };
+	fTimePos = Wrap(fTimePos + t);
+	fPoseElapsed += t;
+
+	if(!bUpdateDue && fPoseSpan >= 0.0f)
+	{
+		// 跳过的帧沿用上一次的姿势; 有插值区间时按经过的时间混合两端的姿势
+		if(fPoseSpan > 0.0f)
+		{
+			XMVECTOR s = XMVectorReplicate(min(fPoseElapsed / fPoseSpan, 1.0f));
+			for(UINT i = 0; i < matPosePrev.size(); ++i)
+			{
+				const XMFLOAT4* pPrev = (const XMFLOAT4*)&matPosePrev[i];
+				const XMFLOAT4* pNext = (const XMFLOAT4*)&matPoseNext[i];
+				XMFLOAT4* pOut = (XMFLOAT4*)&matFinalTransforms[i];
+				for(UINT r = 0; r < 3; ++r)
+					XMStoreFloat4(&pOut[r], XMVectorLerpV(XMLoadFloat4(&pPrev[r]), XMLoadFloat4(&pNext[r]), s));
+			}
+		}
+		return;
+	}
+
+	if(bInterpolate && nUpdateInterval > 1)
+	{
+		// 上一次预先求出的姿势即为当前时刻的姿势; 间隔改变或帧时间波动过大时重新求值
+		if(fPoseSpan > 0.0f && fabsf(fPoseElapsed - fPoseSpan) <= 0.5f * t)
+			matPosePrev.swap(matPoseNext);
+		else
+			EvaluatePose(fTimePos, matPosePrev);
+
+		// 假定帧时间稳定, 下一次求值在 nUpdateInterval 帧之后
+		fPoseSpan = t * nUpdateInterval;
+		EvaluatePose(Wrap(fTimePos + fPoseSpan), matPoseNext);
+		matFinalTransforms.assign(matPosePrev.begin(), matPosePrev.end());
+
+		// 插值后的顶点在两端姿势的顶点之间, 包围盒取两端的并集
+		if(pBounds)
+		{
+			BoundingBox next;
+			pBounds->Transform(matPosePrev.data(), Bounds);
+			pBounds->Transform(matPoseNext.data(), next);
+			BoundingBox::CreateMerged(Bounds, Bounds, next);
+		}
+	}
+	else
+	{
+		fPoseSpan = 0.0f;
+		EvaluatePose(fTimePos, matFinalTransforms);
+
+		if(pBounds)
+			pBounds->Transform(matFinalTransforms.data(), Bounds);
+	}
+	fPoseElapsed = 0.0f;
+}
+
+UINT D3DHelper::GetSkinnedPaletteByteSize(UINT nBoneCount, SkinnedPaletteFormats emFormat)
+{
+	return D3DHelper_CalcConstantBufferBytesSize(nBoneCount * PALETTE_BONE_BYTE_SIZE[emFormat]);
+}
+
+void D3DHelper::WriteSkinnedPalette(const XMFLOAT4X4* pFinal, UINT nBoneCount, SkinnedPaletteFormats emFormat, BYTE* pDest)
+{
+	WriteSkinnedPalette(pFinal, NULL, nBoneCount, emFormat, pDest);
+}
+
+void D3DHelper::WriteSkinnedPalette(const XMFLOAT4X4* pFinal, const UINT* pBoneMap, UINT nBoneCount, SkinnedPaletteFormats emFormat, BYTE* pDest)
+{
+	XMFLOAT4A* pRows = (XMFLOAT4A*)pDest;
+
+	switch(emFormat)
+	{
+	case SKINNED_PALETTE_FORMAT_4X4:
+		if(!pBoneMap)
+		{
+			memcpy(pDest, pFinal, nBoneCount * sizeof(XMFLOAT4X4));
+			break;
+		}
+		for(UINT i = 0; i < nBoneCount; ++i)
+			memcpy(pDest + i * sizeof(XMFLOAT4X4), &pFinal[pBoneMap[i]], sizeof(XMFLOAT4X4));
+		break;
+
+	case SKINNED_PALETTE_FORMAT_3X4:
+		// 最终变换已经转置, 前三行即为仿射变换的三列
+		for(UINT i = 0; i < nBoneCount; ++i, pRows += 3)
+		{
+			const XMFLOAT4* pSource = (const XMFLOAT4*)&pFinal[pBoneMap? pBoneMap[i]: i];
+			XMStoreFloat4A(&pRows[0], XMLoadFloat4(&pSource[0]));
+			XMStoreFloat4A(&pRows[1], XMLoadFloat4(&pSource[1]));
+			XMStoreFloat4A(&pRows[2], XMLoadFloat4(&pSource[2]));
+		}
+		break;
+
+	case SKINNED_PALETTE_FORMAT_DUAL_QUATERNION:
+		// 实部 q 为旋转, 对偶部为 0.5 * t * q; 半球的一致性由着色器在混合时处理
+		for(UINT i = 0; i < nBoneCount; ++i, pRows += 2)
+		{
+			XMMATRIX M = XMMatrixTranspose(XMLoadFloat4x4(&pFinal[pBoneMap? pBoneMap[i]: i]));
+			XMVECTOR real = XMQuaternionNormalize(XMQuaternionRotationMatrix(M));
+			XMVECTOR translation = XMVectorSetW(M.r[3], 0.0f);
+			XMVECTOR dual = XMVectorScale(XMQuaternionMultiply(real, translation), 0.5f);
+
+			XMStoreFloat4A(&pRows[0], real);
+			XMStoreFloat4A(&pRows[1], dual);
+		}
+		break;
+	}
+}
+
+void D3DHelper::UpdateSkinnedInstances(SkinnedInstance* pInstances, UINT nCount, float fDeltaTime, BYTE* pDest, UINT nSlotByteSize, 
+									   ThreadPool* pPool, SkinnedPaletteFormats emFormat)
+{
+	if(!nCount)
+		return;
+
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+
+	for(UINT i = 0; i < nCount; ++i)
+	{
+		if(pInstances[i].pPoseCache)
+			UpdateInstance(pInstances[i], fDeltaTime, pDest, nSlotByteSize, emFormat);
+	}
+
+	SkinnedBatch batch = {pInstances, fDeltaTime, pDest, nSlotByteSize, emFormat};
+	pPool->ParallelFor(nCount, SKINNED_BATCH_GRAIN, SkinnedBatchCallback, &batch);
+}
+
+void D3DHelper::UpdateSkinnedInstances(SkinnedInstance* pInstances, UINT nCount, float fDeltaTime, UploadBuffer& buffer, 
+									   ThreadPool* pPool, SkinnedPaletteFormats emFormat)
+{
+	UpdateSkinnedInstances(pInstances, nCount, fDeltaTime, buffer.Data(), buffer.ElementByteSize(), pPool, emFormat);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef _D3DHELPER_SKINNEDBATCH_H
+#define _D3DHELPER_SKINNEDBATCH_H
+#include "D3DBase.h"
+#include "BaseHelper_Thread.h"
+#include "D3DHelper_UploadBuffer.h"
+
+namespace D3DHelper
+{
+	struct SkinnedInstance;
+
+	enum SkinnedPaletteFormats		// 骨骼调色板在常量缓冲区中的格式
+	{
+		SKINNED_PALETTE_FORMAT_4X4,					// 每根骨骼 64 字节, 转置后的 4x4 矩阵
+		SKINNED_PALETTE_FORMAT_3X4,					// 每根骨骼 48 字节, 省略恒为 (0, 0, 0, 1) 的最后一行
+		SKINNED_PALETTE_FORMAT_DUAL_QUATERNION		// 每根骨骼 32 字节, 实部 + 对偶部; 只能表示旋转与平移, 骨骼的缩放会被丢弃
+	};
+
+	/// @brief 每个实例的调色板槽位大小, 按常量缓冲区要求对齐到 256 字节
+	UINT GetSkinnedPaletteByteSize(UINT nBoneCount, SkinnedPaletteFormats emFormat);
+
+	/// @brief 将 GetFinalTransforms 的结果按指定格式写入 pDest
+	/// 只按顺序写入完整的 16 字节, 适合直接写入写合并的上传堆; pDest 须 16 字节对齐
+	void WriteSkinnedPalette(const DirectX::XMFLOAT4X4* pFinalTransforms, UINT nBoneCount, SkinnedPaletteFormats emFormat, BYTE* pDest);
+
+	/// @brief 同上, 只写入 pBoneMap 中列出的骨骼, 第 i 个槽位为 pFinalTransforms[pBoneMap[i]]
+	/// 用于骨骼调色板分区后的绘制批次(见 M3dLoader::PartitionBonePalettes), 每次绘制只上传用到的骨骼
+	void WriteSkinnedPalette(const DirectX::XMFLOAT4X4* pFinalTransforms, const UINT* pBoneMap, UINT nBoneCount, SkinnedPaletteFormats emFormat, BYTE* pDest);
+
+	/// @brief 批量更新蒙皮实例并写入骨骼调色板
+	/// 实例按块分发到线程池, 调用线程同样参与计算; 每个实例求值后直接复制到第 nSkinnedCBIndex 个槽位.
+	/// 设置了 pPoseCache 的实例(缓存非线程安全)全部在调用线程中更新. 函数返回时所有实例均已写入
+	/// @param pInstances		蒙皮实例数组
+	/// @param nCount			实例数量
+	/// @param fDeltaTime		时间增量
+	/// @param pDest			调色板的目标内存(通常为上传堆的映射地址)
+	/// @param nSlotByteSize	每个槽位的字节数
+	/// @param pPool			线程池; 为 NULL 时使用 ThreadPool::GetInstance()
+	/// @param emFormat			调色板格式, 须与着色器一致
+	void UpdateSkinnedInstances(SkinnedInstance* pInstances, UINT nCount, float fDeltaTime, BYTE* pDest, UINT nSlotByteSize, 
+								BaseHelper::Thread::ThreadPool* pPool = NULL, SkinnedPaletteFormats emFormat = SKINNED_PALETTE_FORMAT_4X4);
+
+	/// @brief 同上, 目标为帧资源中的蒙皮常量缓冲区
+	void UpdateSkinnedInstances(SkinnedInstance* pInstances, UINT nCount, float fDeltaTime, UploadBuffer& buffer, 
+								BaseHelper::Thread::ThreadPool* pPool = NULL, SkinnedPaletteFormats emFormat = SKINNED_PALETTE_FORMAT_4X4);
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "D3DHelper_Skinning.h"
+
+using namespace D3DHelper;
+using namespace D3DHelper::M3dLoader;
+using namespace BaseHelper::Thread;
+using namespace DirectX;
+
+namespace
+{
+	const UINT SKINNING_GRAIN = 1024;		// 每块的顶点数
+
+	struct SkinningJob
+	{
+		const M3dSkinnedVertex* pSource;
+		const XMFLOAT4X4* pFinalTransforms;
+		M3dSkinnedVertex* pDest;
+	};
+
+	// 与着色器相同, 第 4 个权重为 1 - x - y - z
+	inline XMVECTOR LoadBoneWeights(const M3dSkinnedVertex& v)
+	{
+		XMVECTOR weights = XMLoadFloat4(&v.vec4BoneWeights);
+		XMVECTOR sum = XMVectorSum(XMVectorSetW(weights, 0.0f));
+		return XMVectorSetW(weights, 1.0f - XMVectorGetX(sum));
+	}
+
+	void SkinVertex(const M3dSkinnedVertex& v, const XMFLOAT4X4* pFinal, M3dSkinnedVertex& out)
+	{
+		XMVECTOR weights = LoadBoneWeights(v);
+		XMVECTOR w[4] = {XMVectorSplatX(weights), XMVectorSplatY(weights), XMVectorSplatZ(weights), XMVectorSplatW(weights)};
+
+		// 最终变换已经转置, 混合前三行即可; 混合后转置回行向量约定
+		XMMATRIX B;
+		B.r[0] = B.r[1] = B.r[2] = XMVectorZero();
+		B.r[3] = g_XMIdentityR3;
+		for(UINT i = 0; i < 4; ++i)
+		{
+			const XMFLOAT4* pRows = (const XMFLOAT4*)&pFinal[v.vec4BoneIndices[i]];
+			B.r[0] = XMVectorMultiplyAdd(XMLoadFloat4(&pRows[0]), w[i], B.r[0]);
+			B.r[1] = XMVectorMultiplyAdd(XMLoadFloat4(&pRows[1]), w[i], B.r[1]);
+			B.r[2] = XMVectorMultiplyAdd(XMLoadFloat4(&pRows[2]), w[i], B.r[2]);
+		}
+		XMMATRIX M = XMMatrixTranspose(B);
+
+		XMStoreFloat3(&out.vec3Position, XMVector3Transform(XMLoadFloat3(&v.vec3Position), M));
+		XMStoreFloat3(&out.vec3Normal, XMVector3TransformNormal(XMLoadFloat3(&v.vec3Normal), M));
+		XMStoreFloat3(&out.vec3TangentU, XMVector3TransformNormal(XMLoadFloat3(&v.vec3TangentU), M));
+		out.vec2TexCoords = v.vec2TexCoords;
+		out.vec4BoneWeights = v.vec4BoneWeights;
+		memcpy(out.vec4BoneIndices, v.vec4BoneIndices, sizeof(v.vec4BoneIndices));
+	}
+
+	void CALLBACK SkinningCallback(void* param, UINT nBegin, UINT nEnd)
+	{
+		SkinningJob* pJob = (SkinningJob*)param;
+		for(UINT i = nBegin; i < nEnd; ++i)
+			SkinVertex(pJob->pSource[i], pJob->pFinalTransforms, pJob->pDest[i]);
+	}
+}
+
+void SkinnedBounds::Build(const M3dSkinnedVertex* pVertices, UINT nCount)
+{
+	Bones.clear();
+	BoneBounds.clear();
+
+	UINT nBoneCount = 0;
+	for(UINT i = 0; i < nCount; ++i)
+	{
+		for(UINT k = 0; k < 4; ++k)
+			nBoneCount = max(nBoneCount, pVertices[i].vec4BoneIndices[k] + 1);
+	}
+
+	std::vector<XMFLOAT3> vMin(nBoneCount, XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+	std::vector<XMFLOAT3> vMax(nBoneCount, XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+	std::vector<bool> used(nBoneCount, 0);
+
+	for(UINT i = 0; i < nCount; ++i)
+	{
+		float weights[4];
+		XMStoreFloat4((XMFLOAT4*)weights, LoadBoneWeights(pVertices[i]));
+
+		XMVECTOR P = XMLoadFloat3(&pVertices[i].vec3Position);
+		for(UINT k = 0; k < 4; ++k)
+		{
+			if(weights[k] <= 0.0f)
+				continue;
+
+			UINT nBone = pVertices[i].vec4BoneIndices[k];
+			used[nBone] = 1;
+			XMStoreFloat3(&vMin[nBone], XMVectorMin(XMLoadFloat3(&vMin[nBone]), P));
+			XMStoreFloat3(&vMax[nBone], XMVectorMax(XMLoadFloat3(&vMax[nBone]), P));
+		}
+	}
+
+	for(UINT i = 0; i < nBoneCount; ++i)
+	{
+		if(!used[i])
+			continue;
+
+		BoundingBox box;
+		BoundingBox::CreateFromPoints(box, XMLoadFloat3(&vMin[i]), XMLoadFloat3(&vMax[i]));
+		Bones.push_back(i);
+		BoneBounds.push_back(box);
+	}
+}
+
+void SkinnedBounds::Transform(const XMFLOAT4X4* pFinalTransforms, BoundingBox& out) const
+{
+	if(Bones.empty())
+	{
+		out = BoundingBox();
+		return;
+	}
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for(UINT i = 0; i < Bones.size(); ++i)
+	{
+		// 中心按仿射变换, 半长按 3x3 部分的绝对值变换; 最终变换已经转置, 转置回来后前三行即为变换后的各轴
+		XMMATRIX M = XMMatrixTranspose(XMLoadFloat4x4(&pFinalTransforms[Bones[i]]));
+		XMVECTOR center = XMVector3Transform(XMLoadFloat3(&BoneBounds[i].Center), M);
+		XMVECTOR extents = XMLoadFloat3(&BoneBounds[i].Extents);
+
+		XMVECTOR e = XMVectorMultiply(XMVectorAbs(M.r[0]), XMVectorSplatX(extents));
+		e = XMVectorMultiplyAdd(XMVectorAbs(M.r[1]), XMVectorSplatY(extents), e);
+		e = XMVectorMultiplyAdd(XMVectorAbs(M.r[2]), XMVectorSplatZ(extents), e);
+
+		vMin = XMVectorMin(vMin, XMVectorSubtract(center, e));
+		vMax = XMVectorMax(vMax, XMVectorAdd(center, e));
+	}
+
+	BoundingBox::CreateFromPoints(out, vMin, vMax);
+}
+
+void D3DHelper::SkinVertices(const M3dSkinnedVertex* pSource, UINT nCount, const XMFLOAT4X4* pFinalTransforms,
+							 M3dSkinnedVertex* pDest, ThreadPool* pPool)
+{
+	if(!pPool)
+		pPool = ThreadPool::GetInstance();
+
+	SkinningJob job = {pSource, pFinalTransforms, pDest};
+	pPool->ParallelFor(nCount, SKINNING_GRAIN, SkinningCallback, &job);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef _D3DHELPER_SKINNING_H
+#define _D3DHELPER_SKINNING_H
+#include "D3DBase.h"
+#include "BaseHelper_Thread.h"
+#include "M3dLoader.h"
+
+namespace D3DHelper
+{
+	/// @brief 各骨骼在绑定姿势下所影响顶点的碰撞盒, 用于求蒙皮后网格的包围盒
+	/// 线性混合蒙皮后的顶点是各骨骼变换结果的凸组合, 每个变换结果都落在对应骨骼变换后的碰撞盒内,
+	/// 因此所有变换后碰撞盒的并集必然包含蒙皮后的网格; 只需变换骨骼数个碰撞盒, 与顶点数无关
+	struct SkinnedBounds
+	{
+		std::vector<UINT> Bones;							// 至少影响一个顶点的骨骼
+		std::vector<DirectX::BoundingBox> BoneBounds;		// 与 Bones 一一对应, 模型空间
+
+		/// @brief 由绑定姿势的顶点构建; 权重为 0 的骨骼不计入
+		void Build(const M3dLoader::M3dSkinnedVertex* pVertices, UINT nCount);
+
+		/// @brief 按 GetFinalTransforms 的结果求模型空间的包围盒
+		void Transform(const DirectX::XMFLOAT4X4* pFinalTransforms, DirectX::BoundingBox& out) const;
+	};
+
+	/// @brief CPU 线性混合蒙皮, 结果与着色器的 4x4/3x4 调色板路径相同
+	/// 每个顶点先按权重混合骨骼矩阵, 再变换位置, 法线与切线(只取 3x3 部分, 不重新归一化);
+	/// 纹理坐标与骨骼数据原样复制. 顶点按块分发到线程池, 调用线程同样参与, 返回时全部写入.
+	/// 可用于离线校验蒙皮着色器, 或为需要蒙皮后顶点的 CPU 端算法(拾取, 阴影体等)提供数据
+	/// @param pSource			绑定姿势的顶点
+	/// @param nCount			顶点数
+	/// @param pFinalTransforms	GetFinalTransforms 的结果
+	/// @param pDest			输出顶点, 不能与 pSource 重叠
+	/// @param pPool			线程池; 为 NULL 时使用 ThreadPool::GetInstance()
+	void SkinVertices(const M3dLoader::M3dSkinnedVertex* pSource, UINT nCount, const DirectX::XMFLOAT4X4* pFinalTransforms,
+					  M3dLoader::M3dSkinnedVertex* pDest, BaseHelper::Thread::ThreadPool* pPool = NULL);
+};
+
+#endif
@@ -0,0 +1,450 @@
+#include "D3DHelper_TriangleBvh.h"
+#include <algorithm>
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+namespace
+{
+	const UINT SAH_BIN_COUNT = 12;
+	const UINT MAX_LEAF_TRIANGLES = 4;
+	const UINT MAX_SAH_DEPTH = 40;			// 超过该深度后按中位数划分, 保证遍历栈不会溢出
+	const UINT MAX_STACK_DEPTH = 64;
+
+	inline UINT ReadIndex(const void* pIndices, DXGI_FORMAT emIndexFormat, UINT i)
+	{
+		return emIndexFormat == DXGI_FORMAT_R32_UINT ? ((const UINT32*)pIndices)[i] : ((const UINT16*)pIndices)[i];
+	}
+
+	inline float HalfArea(FXMVECTOR vMin, FXMVECTOR vMax)
+	{
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, XMVectorSubtract(vMax, vMin));
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	inline void TriangleBounds(const XMFLOAT3* pCorners, UINT nTriangle, XMVECTOR& vMin, XMVECTOR& vMax)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&pCorners[3 * nTriangle]);
+		XMVECTOR v1 = XMLoadFloat3(&pCorners[3 * nTriangle + 1]);
+		XMVECTOR v2 = XMLoadFloat3(&pCorners[3 * nTriangle + 2]);
+		vMin = XMVectorMin(v0, XMVectorMin(v1, v2));
+		vMax = XMVectorMax(v0, XMVectorMax(v1, v2));
+	}
+
+	// 射线与 AABB 的 slab 测试, 返回进入距离; 未相交时返回 FLT_MAX
+	inline float RayBox(FXMVECTOR origin, FXMVECTOR invDir, const XMFLOAT3& vMin, const XMFLOAT3& vMax, float fMaxDistance)
+	{
+		XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vMin), origin), invDir);
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vMax), origin), invDir);
+		XMFLOAT3 tNear, tFar;
+		XMStoreFloat3(&tNear, XMVectorMin(t0, t1));
+		XMStoreFloat3(&tFar, XMVectorMax(t0, t1));
+
+		float fEnter = max(max(tNear.x, tNear.y), max(tNear.z, 0.0f));
+		float fExit = min(min(tFar.x, tFar.y), min(tFar.z, fMaxDistance));
+		return fEnter <= fExit ? fEnter : FLT_MAX;
+	}
+}
+
+bool TriangleBvh::Build(const Resource::MeshGeometry& geo, const Resource::SubmeshGeometry* pSubmesh)
+{
+	if(!geo.pCPUVertexBuffer || !geo.pCPUIndexBuffer)
+	{
+		Clear();
+		return 0;
+	}
+
+	UINT nIndexSize = geo.emIndexFormat == DXGI_FORMAT_R32_UINT ? 4 : 2;
+	UINT nStartIndex = pSubmesh ? pSubmesh->nStartIndexLocation : 0;
+	UINT nIndexCount = pSubmesh ? pSubmesh->nIndexCount : geo.nIndexBufferByteSize / nIndexSize;
+	UINT nBaseVertex = pSubmesh ? pSubmesh->nBaseVertexLocation : 0;
+
+	Build(geo.pCPUVertexBuffer->GetBufferPointer(), geo.nVertexByteStride, geo.pCPUIndexBuffer->GetBufferPointer(), geo.emIndexFormat,
+		  nStartIndex, nIndexCount, nBaseVertex);
+	return 1;
+}
+
+void TriangleBvh::Build(const void* pVertices, UINT nVertexStride, const void* pIndices, DXGI_FORMAT emIndexFormat,
+						UINT nStartIndex, UINT nIndexCount, UINT nBaseVertex)
+{
+	Clear();
+
+	nTriangleCount = nIndexCount / 3;
+	if(!nTriangleCount)
+		return;
+
+	std::vector<XMFLOAT3> corners(3 * nTriangleCount);
+	std::vector<UINT> order(nTriangleCount);
+	for(UINT i = 0; i < nTriangleCount; ++i)
+	{
+		for(UINT k = 0; k < 3; ++k)
+		{
+			UINT nVertex = ReadIndex(pIndices, emIndexFormat, nStartIndex + 3 * i + k) + nBaseVertex;
+			corners[3 * i + k] = *(const XMFLOAT3*)((const BYTE*)pVertices + (size_t)nVertex * nVertexStride);
+		}
+		order[i] = i;
+	}
+
+	Nodes.reserve(2 * ((nTriangleCount + MAX_LEAF_TRIANGLES - 1) / MAX_LEAF_TRIANGLES));
+	Packets.reserve((nTriangleCount + MAX_LEAF_TRIANGLES - 1) / MAX_LEAF_TRIANGLES + 1);
+	BuildNode(order.data(), corners.data(), 0, nTriangleCount, 0);
+
+	// 三角形序号换算为索引缓冲区中的序号
+	UINT nFirstTriangle = nStartIndex / 3;
+	for(auto& packet: Packets)
+		for(UINT k = 0; k < 4; ++k)
+			packet.Triangles[k] += nFirstTriangle;
+}
+
+UINT TriangleBvh::BuildNode(UINT* pOrder, const XMFLOAT3* pCorners, UINT nBegin, UINT nEnd, UINT nDepth)
+{
+	UINT nNode = (UINT)Nodes.size();
+	Nodes.emplace_back();
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX), vMax = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR cMin = XMVectorReplicate(FLT_MAX), cMax = XMVectorReplicate(-FLT_MAX);
+	for(UINT i = nBegin; i < nEnd; ++i)
+	{
+		XMVECTOR tMin, tMax;
+		TriangleBounds(pCorners, pOrder[i], tMin, tMax);
+		vMin = XMVectorMin(vMin, tMin);
+		vMax = XMVectorMax(vMax, tMax);
+
+		XMVECTOR c = (tMin + tMax) * 0.5f;
+		cMin = XMVectorMin(cMin, c);
+		cMax = XMVectorMax(cMax, c);
+	}
+	XMStoreFloat3(&Nodes[nNode].vec3Min, vMin);
+	XMStoreFloat3(&Nodes[nNode].vec3Max, vMax);
+
+	// 叶子: 打包为 SoA, 补齐的三角形各边为 0, 不会命中
+	UINT nCount = nEnd - nBegin;
+	if(nCount <= MAX_LEAF_TRIANGLES)
+	{
+		TrianglePacket packet = {};
+		for(UINT k = 0; k < nCount; ++k)
+		{
+			UINT nTriangle = pOrder[nBegin + k];
+			const XMFLOAT3* v = &pCorners[3 * nTriangle];
+			float* pV0 = (float*)packet.v0;
+			float* pE1 = (float*)packet.e1;
+			float* pE2 = (float*)packet.e2;
+			for(UINT a = 0; a < 3; ++a)
+			{
+				float f0 = (&v[0].x)[a];
+				pV0[4 * a + k] = f0;
+				pE1[4 * a + k] = (&v[1].x)[a] - f0;
+				pE2[4 * a + k] = (&v[2].x)[a] - f0;
+			}
+			packet.Triangles[k] = nTriangle;
+		}
+
+		Nodes[nNode].nOffset = (UINT)Packets.size();
+		Nodes[nNode].nTriangles = nCount;
+		Packets.push_back(packet);
+		return nNode;
+	}
+
+	// 按质心包围盒最长的轴分箱求 SAH 最优分割
+	XMFLOAT3 vCentroidMin, vExtent;
+	XMStoreFloat3(&vCentroidMin, cMin);
+	XMStoreFloat3(&vExtent, cMax - cMin);
+	UINT nAxis = vExtent.x > vExtent.y ? (vExtent.x > vExtent.z ? 0 : 2) : (vExtent.y > vExtent.z ? 1 : 2);
+	float fMin = (&vCentroidMin.x)[nAxis], fExtent = (&vExtent.x)[nAxis];
+
+	auto Centroid = [&](UINT nTriangle) {
+		const XMFLOAT3* v = &pCorners[3 * nTriangle];
+		float a = (&v[0].x)[nAxis], b = (&v[1].x)[nAxis], c = (&v[2].x)[nAxis];
+		return 0.5f * (min(a, min(b, c)) + max(a, max(b, c)));
+	};
+
+	UINT nMid = nBegin;
+	if(fExtent > 0.0f && nDepth < MAX_SAH_DEPTH)
+	{
+		float fScale = SAH_BIN_COUNT / fExtent;
+		auto BinOf = [&](UINT nTriangle) {
+			return min((UINT)((Centroid(nTriangle) - fMin) * fScale), SAH_BIN_COUNT - 1);
+		};
+
+		UINT counts[SAH_BIN_COUNT] = {};
+		XMVECTOR binMin[SAH_BIN_COUNT], binMax[SAH_BIN_COUNT];
+		for(UINT b = 0; b < SAH_BIN_COUNT; ++b)
+		{
+			binMin[b] = XMVectorReplicate(FLT_MAX);
+			binMax[b] = XMVectorReplicate(-FLT_MAX);
+		}
+		for(UINT i = nBegin; i < nEnd; ++i)
+		{
+			XMVECTOR tMin, tMax;
+			TriangleBounds(pCorners, pOrder[i], tMin, tMax);
+			UINT b = BinOf(pOrder[i]);
+			++counts[b];
+			binMin[b] = XMVectorMin(binMin[b], tMin);
+			binMax[b] = XMVectorMax(binMax[b], tMax);
+		}
+
+		float rightArea[SAH_BIN_COUNT];
+		UINT rightCount[SAH_BIN_COUNT];
+		XMVECTOR accMin = XMVectorReplicate(FLT_MAX), accMax = XMVectorReplicate(-FLT_MAX);
+		UINT nAcc = 0;
+		for(UINT b = SAH_BIN_COUNT - 1; b > 0; --b)
+		{
+			accMin = XMVectorMin(accMin, binMin[b]);
+			accMax = XMVectorMax(accMax, binMax[b]);
+			nAcc += counts[b];
+			rightArea[b] = nAcc ? HalfArea(accMin, accMax) : 0.0f;
+			rightCount[b] = nAcc;
+		}
+
+		float fBestCost = FLT_MAX;
+		UINT nBestSplit = 0;
+		accMin = XMVectorReplicate(FLT_MAX);
+		accMax = XMVectorReplicate(-FLT_MAX);
+		nAcc = 0;
+		for(UINT b = 0; b < SAH_BIN_COUNT - 1; ++b)
+		{
+			accMin = XMVectorMin(accMin, binMin[b]);
+			accMax = XMVectorMax(accMax, binMax[b]);
+			nAcc += counts[b];
+			if(!nAcc || !rightCount[b + 1])
+				continue;
+
+			float fCost = nAcc * HalfArea(accMin, accMax) + rightCount[b + 1] * rightArea[b + 1];
+			if(fCost < fBestCost)
+			{
+				fBestCost = fCost;
+				nBestSplit = b + 1;
+			}
+		}
+
+		if(nBestSplit)
+			nMid = (UINT)(std::partition(pOrder + nBegin, pOrder + nEnd, [&](UINT nTriangle) { return BinOf(nTriangle) < nBestSplit; }) - pOrder);
+	}
+
+	// 质心重合, 无法分割或过深时按中位数划分
+	if(nMid == nBegin || nMid == nEnd)
+	{
+		nMid = nBegin + nCount / 2;
+		std::nth_element(pOrder + nBegin, pOrder + nMid, pOrder + nEnd, [&](UINT a, UINT b) { return Centroid(a) < Centroid(b); });
+	}
+
+	BuildNode(pOrder, pCorners, nBegin, nMid, nDepth + 1);
+	UINT nRight = BuildNode(pOrder, pCorners, nMid, nEnd, nDepth + 1);
+	Nodes[nNode].nOffset = nRight;
+	Nodes[nNode].nTriangles = 0;
+	return nNode;
+}
+
+// Moller-Trumbore, 一次测试整包 4 个三角形
+template<bool bAnyHit>
+bool TriangleBvh::IntersectLeaf(const TrianglePacket& packet, UINT nTriangles, FXMVECTOR origin, FXMVECTOR dir, float& fBest, TriangleHit* pHit)
+{
+	XMVECTOR dx = XMVectorSplatX(dir), dy = XMVectorSplatY(dir), dz = XMVectorSplatZ(dir);
+	XMVECTOR e1x = XMLoadFloat4(&packet.e1[0]), e1y = XMLoadFloat4(&packet.e1[1]), e1z = XMLoadFloat4(&packet.e1[2]);
+	XMVECTOR e2x = XMLoadFloat4(&packet.e2[0]), e2y = XMLoadFloat4(&packet.e2[1]), e2z = XMLoadFloat4(&packet.e2[2]);
+
+	XMVECTOR px = dy * e2z - dz * e2y;
+	XMVECTOR py = dz * e2x - dx * e2z;
+	XMVECTOR pz = dx * e2y - dy * e2x;
+	XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+	XMVECTOR invDet = XMVectorReciprocal(det);
+
+	XMVECTOR tx = XMVectorSplatX(origin) - XMLoadFloat4(&packet.v0[0]);
+	XMVECTOR ty = XMVectorSplatY(origin) - XMLoadFloat4(&packet.v0[1]);
+	XMVECTOR tz = XMVectorSplatZ(origin) - XMLoadFloat4(&packet.v0[2]);
+	XMVECTOR u = (tx * px + ty * py + tz * pz) * invDet;
+
+	XMVECTOR qx = ty * e1z - tz * e1y;
+	XMVECTOR qy = tz * e1x - tx * e1z;
+	XMVECTOR qz = tx * e1y - ty * e1x;
+	XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+	XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+	XMVECTOR vZero = XMVectorZero();
+	XMVECTOR mask = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(1e-20f));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, vZero));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, vZero));
+	mask = XMVectorAndInt(mask, XMVectorLessOrEqual(u + v, XMVectorSplatOne()));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(t, vZero));
+	mask = XMVectorAndInt(mask, XMVectorLess(t, XMVectorReplicate(fBest)));
+
+	uint32_t hits[4];
+	XMStoreInt4(hits, mask);
+	if(!(hits[0] | hits[1] | hits[2] | hits[3]))
+		return 0;
+	if(bAnyHit)
+		return 1;
+
+	XMFLOAT4 fT, fU, fV;
+	XMStoreFloat4(&fT, t);
+	XMStoreFloat4(&fU, u);
+	XMStoreFloat4(&fV, v);
+
+	bool bHit = 0;
+	for(UINT k = 0; k < nTriangles; ++k)
+	{
+		if(hits[k] && (&fT.x)[k] < fBest)
+		{
+			fBest = (&fT.x)[k];
+			pHit->fDistance = fBest;
+			pHit->nTriangle = packet.Triangles[k];
+			pHit->fU = (&fU.x)[k];
+			pHit->fV = (&fV.x)[k];
+			bHit = 1;
+		}
+	}
+	return bHit;
+}
+
+template<bool bAnyHit>
+bool TriangleBvh::Traverse(FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance, TriangleHit* pHit) const
+{
+	if(Nodes.empty())
+		return 0;
+
+	// 方向分量为 0 时以极大值代替倒数, slab 测试仍然成立
+	XMVECTOR invDir = XMVectorReciprocal(XMVectorSelect(dir, XMVectorReplicate(1e-30f), XMVectorEqual(dir, XMVectorZero())));
+
+	float fBest = fMaxDistance;
+	bool bHit = 0;
+
+	struct Entry { UINT nNode; float fEnter; };
+	Entry stack[MAX_STACK_DEPTH];
+	UINT nStack = 0;
+	float fRoot = RayBox(origin, invDir, Nodes[0].vec3Min, Nodes[0].vec3Max, fBest);
+	if(fRoot != FLT_MAX)
+		stack[nStack++] = {0, fRoot};
+
+	while(nStack)
+	{
+		Entry entry = stack[--nStack];
+		if(entry.fEnter > fBest)
+			continue;
+
+		const BvhNode& node = Nodes[entry.nNode];
+		if(node.nTriangles)
+		{
+			if(IntersectLeaf<bAnyHit>(Packets[node.nOffset], node.nTriangles, origin, dir, fBest, pHit))
+			{
+				if(bAnyHit)
+					return 1;
+				bHit = 1;
+			}
+			continue;
+		}
+
+		// 较近的子节点后入栈, 先处理
+		UINT nLeft = entry.nNode + 1, nRight = node.nOffset;
+		float tLeft = RayBox(origin, invDir, Nodes[nLeft].vec3Min, Nodes[nLeft].vec3Max, fBest);
+		float tRight = RayBox(origin, invDir, Nodes[nRight].vec3Min, Nodes[nRight].vec3Max, fBest);
+		if(tLeft > tRight)
+		{
+			std::swap(tLeft, tRight);
+			std::swap(nLeft, nRight);
+		}
+		if(tRight != FLT_MAX)
+			stack[nStack++] = {nRight, tRight};
+		if(tLeft != FLT_MAX)
+			stack[nStack++] = {nLeft, tLeft};
+	}
+	return bHit;
+}
+
+bool TriangleBvh::Intersects(FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance, TriangleHit& hit) const
+{
+	return Traverse<false>(origin, dir, fMaxDistance, &hit);
+}
+
+bool TriangleBvh::Occluded(FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance) const
+{
+	return Traverse<true>(origin, dir, fMaxDistance, NULL);
+}
+
+UINT TriangleBvh::Intersects(RayPacket& packet, UINT nMask, TriangleHit* pHits) const
+{
+	if(Nodes.empty())
+		return 0;
+
+	UINT nHitMask = 0;
+	XMFLOAT4 fMaxDistances;
+	XMStoreFloat4(&fMaxDistances, packet.MaxDistance);
+
+	struct Entry { UINT nNode; UINT nMask; float fEnter; };
+	Entry stack[MAX_STACK_DEPTH];
+	UINT nStack = 0;
+	float fRoot;
+	nMask = packet.IntersectBox(Nodes[0].vec3Min, Nodes[0].vec3Max, nMask, &fRoot);
+	if(nMask)
+		stack[nStack++] = {0, nMask, fRoot};
+
+	while(nStack)
+	{
+		Entry entry = stack[--nStack];
+		const BvhNode& node = Nodes[entry.nNode];
+		if(node.nTriangles)
+		{
+			// 叶子逐条射线测试, 每条射线仍同时测试 4 个三角形
+			XMFLOAT4 ox, oy, oz, dx, dy, dz;
+			XMStoreFloat4(&ox, packet.Origin[0]);
+			XMStoreFloat4(&oy, packet.Origin[1]);
+			XMStoreFloat4(&oz, packet.Origin[2]);
+			XMStoreFloat4(&dx, packet.Direction[0]);
+			XMStoreFloat4(&dy, packet.Direction[1]);
+			XMStoreFloat4(&dz, packet.Direction[2]);
+			for(UINT k = 0; k < 4; ++k)
+			{
+				if(!(entry.nMask & (1u << k)))
+					continue;
+
+				XMVECTOR origin = XMVectorSet((&ox.x)[k], (&oy.x)[k], (&oz.x)[k], 0.0f);
+				XMVECTOR dir = XMVectorSet((&dx.x)[k], (&dy.x)[k], (&dz.x)[k], 0.0f);
+				if(IntersectLeaf<false>(Packets[node.nOffset], node.nTriangles, origin, dir, (&fMaxDistances.x)[k], &pHits[k]))
+					nHitMask |= 1u << k;
+			}
+			packet.MaxDistance = XMLoadFloat4(&fMaxDistances);
+			continue;
+		}
+
+		UINT nLeft = entry.nNode + 1, nRight = node.nOffset;
+		float tLeft, tRight;
+		UINT nLeftMask = packet.IntersectBox(Nodes[nLeft].vec3Min, Nodes[nLeft].vec3Max, entry.nMask, &tLeft);
+		UINT nRightMask = packet.IntersectBox(Nodes[nRight].vec3Min, Nodes[nRight].vec3Max, entry.nMask, &tRight);
+		if(tLeft > tRight)
+		{
+			std::swap(tLeft, tRight);
+			std::swap(nLeft, nRight);
+			std::swap(nLeftMask, nRightMask);
+		}
+		if(nRightMask)
+			stack[nStack++] = {nRight, nRightMask, tRight};
+		if(nLeftMask)
+			stack[nStack++] = {nLeft, nLeftMask, tLeft};
+	}
+	return nHitMask;
+}
+
+BoundingBox TriangleBvh::GetBounds() const
+{
+	BoundingBox box;
+	if(!Nodes.empty())
+		BoundingBox::CreateFromPoints(box, XMLoadFloat3(&Nodes[0].vec3Min), XMLoadFloat3(&Nodes[0].vec3Max));
+	return box;
+}
+
+UINT TriangleBvh::GetTriangleCount() const
+{
+	return nTriangleCount;
+}
+
+UINT TriangleBvh::GetNodeCount() const
+{
+	return (UINT)Nodes.size();
+}
+
+void TriangleBvh::Clear()
+{
+	Nodes.clear();
+	Packets.clear();
+	nTriangleCount = 0;
+}
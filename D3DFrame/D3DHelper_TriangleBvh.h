@@ -0,0 +1,96 @@
+#pragma once
+#ifndef _D3DHELPER_TRIANGLEBVH_H
+#define _D3DHELPER_TRIANGLEBVH_H
+#include "D3DBase.h"
+#include "D3DHelper_Resource.h"
+#include "D3DHelper_SceneBvh.h"
+
+namespace D3DHelper
+{
+	/// @brief 射线与三角形的最近交点
+	struct TriangleHit
+	{
+		float fDistance = FLT_MAX;		// 以射线方向的长度为单位
+		UINT nTriangle = -1;			// 三角形在索引缓冲区中的序号, 即 nStartIndexLocation / 3
+		float fU = 0.0f, fV = 0.0f;		// 重心坐标, 交点 = (1 - u - v) * v0 + u * v1 + v * v2
+	};
+
+	/// @brief 网格的三角形层次包围体, 用于拾取, 射线查询与烘焙
+	/// 以分箱 SAH 构建, 节点按深度优先排列(左子节点紧随父节点); 叶子最多 4 个三角形,
+	/// 按 SoA 存放为一个三角形包, 射线与整包同时测试. 三角形不区分正反面.
+	/// 顶点位置取自每个顶点的前 12 字节, 与仓库中所有顶点结构体的布局一致
+	class TriangleBvh
+	{
+	public:
+		/// @brief 由网格的 CPU 副本构建
+		/// @param geo 		网格, 需要 pCPUVertexBuffer / pCPUIndexBuffer; 索引宽度取自 emIndexFormat
+		/// @param pSubmesh 只包含该子网格的三角形; 为 NULL 时包含整个索引缓冲区(顶点基值为 0)
+		/// @return 		缺少 CPU 副本时返回 0
+		bool Build(const Resource::MeshGeometry& geo, const Resource::SubmeshGeometry* pSubmesh = NULL);
+
+		/// @brief 由顶点与索引数据构建
+		/// @param pVertices 		顶点数据, 每个顶点以位置开头
+		/// @param nVertexStride 	顶点步长(字节)
+		/// @param pIndices 		索引数据
+		/// @param emIndexFormat 	DXGI_FORMAT_R16_UINT 或 DXGI_FORMAT_R32_UINT
+		/// @param nStartIndex 		起始索引, 三角形序号由此计算
+		/// @param nIndexCount 		索引数量
+		/// @param nBaseVertex 		加到每个索引上的顶点基值
+		void Build(const void* pVertices, UINT nVertexStride, const void* pIndices, DXGI_FORMAT emIndexFormat,
+				   UINT nStartIndex, UINT nIndexCount, UINT nBaseVertex = 0);
+
+		/// @brief 求射线的最近交点
+		/// @param origin, dir 	局部空间射线, dir 不必归一化
+		/// @param fMaxDistance 最大距离(以 dir 的长度为单位)
+		/// @return 			命中时返回 1 并填写 hit
+		bool Intersects(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance, TriangleHit& hit) const;
+
+		/// @brief 射线在 fMaxDistance 之内是否与任意三角形相交, 找到第一个交点即返回
+		bool Occluded(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance) const;
+
+		/// @brief 求射线包中各射线的最近交点, 节点测试由 4 条射线共同进行
+		/// @param packet 	局部空间射线包, 命中的射线的 MaxDistance 缩短为命中距离
+		/// @param nMask 	有效的射线
+		/// @param pHits 	4 个命中结果, 只写入比 MaxDistance 更近的命中
+		/// @return 		找到更近命中的射线掩码
+		UINT Intersects(RayPacket& packet, UINT nMask, TriangleHit* pHits) const;
+
+		DirectX::BoundingBox GetBounds() const;
+		UINT GetTriangleCount() const;
+		UINT GetNodeCount() const;
+		void Clear();
+
+	private:
+		struct BvhNode
+		{
+			DirectX::XMFLOAT3 vec3Min;
+			UINT nOffset;						// 内部节点为右子节点, 叶子为三角形包序号
+			DirectX::XMFLOAT3 vec3Max;
+			UINT nTriangles;					// 叶子中的三角形数, 内部节点为 0
+		};
+
+		// 4 个三角形的 SoA 数据, 不足 4 个时以退化三角形补齐
+		struct TrianglePacket
+		{
+			DirectX::XMFLOAT4 v0[3];			// 顶点 0 的 x, y, z
+			DirectX::XMFLOAT4 e1[3];			// v1 - v0
+			DirectX::XMFLOAT4 e2[3];			// v2 - v0
+			UINT Triangles[4];
+		};
+
+		std::vector<BvhNode> Nodes;
+		std::vector<TrianglePacket> Packets;
+		UINT nTriangleCount = 0;
+
+		UINT BuildNode(UINT* pOrder, const DirectX::XMFLOAT3* pCorners, UINT nBegin, UINT nEnd, UINT nDepth);
+
+		template<bool bAnyHit>
+		static bool IntersectLeaf(const TrianglePacket& packet, UINT nTriangles, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir,
+								  float& fBest, TriangleHit* pHit);
+
+		template<bool bAnyHit>
+		bool Traverse(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float fMaxDistance, TriangleHit* pHit) const;
+	};
+};
+
+#endif
@@ -38,4 +38,14 @@ ID3D12Resource* UploadBuffer::Resource() const
 void UploadBuffer::CopyData(int nElementIndex, const void* pData, const UINT nByteSize)
 {
     memcpy(&pBufferBegin[nElementIndex * nElementByteSize], pData, nByteSize);
+}
+
+BYTE* UploadBuffer::Data() const
+{
+    return pBufferBegin;
+}
+
+UINT UploadBuffer::ElementByteSize() const
+{
+    return nElementByteSize;
 }
\ No newline at end of file
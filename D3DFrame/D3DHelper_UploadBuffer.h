@@ -19,6 +19,9 @@ namespace D3DHelper
         void Init(ID3D12Device *Device, UINT ElementByteSize, UINT ElementCount);
         ID3D12Resource *Resource() const;
         void CopyData(int ElementIndex, const void *Data, const UINT ByteSize);
+        // 映射后的首地址; 多个线程写入互不重叠的元素时可直接使用
+        BYTE *Data() const;
+        UINT ElementByteSize() const;
 
     private:
         Microsoft::WRL::ComPtr<ID3D12Resource> pUploadBuffer;
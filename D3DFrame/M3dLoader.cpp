@@ -217,3 +217,134 @@ bool M3dLoader::LoadM3dFile(LPCWSTR file,
 	
 	return 0;
 }
+
+// ɫе 4 ȨΪ 1 - x - y - z; ȨزɺԵĹ
+static UINT InfluentialBones(const M3dLoader::M3dSkinnedVertex& v, UINT* pBones)
+{
+	const float fEpsilon = 1e-5f;
+	float weights[4] = {v.vec4BoneWeights.x, v.vec4BoneWeights.y, v.vec4BoneWeights.z, 0.0f};
+	weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+
+	UINT nCount = 0;
+	for(UINT i = 0; i < 4; ++i)
+	{
+		if(weights[i] > fEpsilon)
+			pBones[nCount++] = v.vec4BoneIndices[i];
+	}
+	return nCount;
+}
+
+bool M3dLoader::PartitionBonePalettes(const std::vector<M3dSkinnedVertex>& vertices,
+									  const std::vector<UINT>& indices,
+									  const std::vector<M3dSubset>& subsets,
+									  UINT nMaxPaletteBones,
+									  std::vector<M3dSkinnedVertex>& outVertices,
+									  std::vector<UINT>& outIndices,
+									  std::vector<M3dPaletteBatch>& batches)
+{
+	UINT nBoneCount = 0;
+	for(const M3dSkinnedVertex& v : vertices)
+	{
+		for(UINT i = 0; i < 4; ++i)
+			nBoneCount = max(nBoneCount, v.vec4BoneIndices[i] + 1);
+	}
+
+	outVertices.clear();
+	outIndices.clear();
+	batches.clear();
+
+	// ǰйĵɫ±붥±; лʱֻλõ
+	std::vector<UINT> boneSlots(nBoneCount, (UINT)-1);
+	std::vector<UINT> vertexRemap(vertices.size(), (UINT)-1);
+	std::vector<UINT> touchedVertices;
+	M3dPaletteBatch batch;
+
+	auto Flush = [&]()
+	{
+		batch.nIndexCount = (UINT)outIndices.size() - batch.nIndexStart;
+		batch.nVertexCount = (UINT)outVertices.size() - batch.nVertexStart;
+		if(batch.nIndexCount)
+			batches.push_back(batch);
+
+		for(UINT bone : batch.Bones)
+			boneSlots[bone] = (UINT)-1;
+		for(UINT vertex : touchedVertices)
+			vertexRemap[vertex] = (UINT)-1;
+		touchedVertices.clear();
+
+		batch.Bones.clear();
+		batch.nIndexStart = (UINT)outIndices.size();
+		batch.nVertexStart = (UINT)outVertices.size();
+	};
+
+	for(const M3dSubset& subset : subsets)
+	{
+		batch.nSubsetID = subset.nSubsetID;
+		batch.nIndexStart = (UINT)outIndices.size();
+		batch.nVertexStart = (UINT)outVertices.size();
+
+		for(UINT f = subset.nFaceStart; f < subset.nFaceStart + subset.nFaceCount; ++f)
+		{
+			// õĹ(ȥ)δеĹ
+			UINT triBones[12], nTriBones = 0, nNewBones = 0;
+			for(UINT k = 0; k < 3; ++k)
+			{
+				UINT vertexBones[4];
+				UINT nVertexBones = InfluentialBones(vertices[indices[f * 3 + k]], vertexBones);
+				for(UINT b = 0; b < nVertexBones; ++b)
+				{
+					if(std::find(triBones, triBones + nTriBones, vertexBones[b]) == triBones + nTriBones)
+					{
+						triBones[nTriBones++] = vertexBones[b];
+						nNewBones += boneSlots[vertexBones[b]] == (UINT)-1;
+					}
+				}
+			}
+
+			if(nTriBones > nMaxPaletteBones)
+			{
+				OutputDebugStringA("M3dLoader: a triangle references more bones than the palette can hold\n");
+				return 0;
+			}
+
+			if(batch.Bones.size() + nNewBones > nMaxPaletteBones)
+			{
+				Flush();
+				nNewBones = nTriBones;
+			}
+
+			for(UINT b = 0; b < nTriBones; ++b)
+			{
+				if(boneSlots[triBones[b]] == (UINT)-1)
+				{
+					boneSlots[triBones[b]] = (UINT)batch.Bones.size();
+					batch.Bones.push_back(triBones[b]);
+				}
+			}
+
+			for(UINT k = 0; k < 3; ++k)
+			{
+				UINT index = indices[f * 3 + k];
+				if(vertexRemap[index] == (UINT)-1)
+				{
+					// ɺԵȨضӦĹڵɫ, ָ 0 
+					M3dSkinnedVertex v = vertices[index];
+					for(UINT b = 0; b < 4; ++b)
+					{
+						UINT nSlot = boneSlots[v.vec4BoneIndices[b]];
+						v.vec4BoneIndices[b] = nSlot == (UINT)-1? 0: nSlot;
+					}
+
+					vertexRemap[index] = (UINT)outVertices.size();
+					touchedVertices.push_back(index);
+					outVertices.push_back(v);
+				}
+				outIndices.push_back(vertexRemap[index]);
+			}
+		}
+
+		Flush();
+	}
+
+	return 1;
+}
\ No newline at end of file
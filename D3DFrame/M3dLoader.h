@@ -50,6 +50,17 @@ namespace D3DHelper
 			UINT vec4BoneIndices[4];
 		};
 		
+		// ɫһ
+		struct M3dPaletteBatch
+		{
+			UINT nSubsetID;				// Ӽ
+			UINT nIndexStart;			// ڷеʼλ
+			UINT nIndexCount;
+			UINT nVertexStart;			// ζռĶ㷶Χ; Ϊ󶥵еľ±
+			UINT nVertexCount;
+			std::vector<UINT> Bones;	// ɫ± -> ±, ״γֵ˳
+		};
+
 		struct M3dVertex
 		{
 			DirectX::XMFLOAT3 vec3Position;
@@ -77,6 +88,18 @@ namespace D3DHelper
 						 std::vector<M3dSubset>& subsets,
 						 std::vector<M3dMaterial>& materials,
 						 D3DHelper::Animation::SkinnedAnimation& animation);
+
+		/// @brief ʱӼΪ nMaxPaletteBones Ļ
+		/// ˳̰ĺϲ, ľֲ; ιõĶᱻ, 
+		/// Ĺ±дΪεɫе±, Ȩؿɺ(< 1e-5)Ĺռõɫ
+		/// @return õĹͳ nMaxPaletteBones ʱ 0
+		bool PartitionBonePalettes(const std::vector<M3dSkinnedVertex>& vertices,
+								   const std::vector<UINT>& indices,
+								   const std::vector<M3dSubset>& subsets,
+								   UINT nMaxPaletteBones,
+								   std::vector<M3dSkinnedVertex>& outVertices,
+								   std::vector<UINT>& outIndices,
+								   std::vector<M3dPaletteBatch>& batches);
 	};
 };
 
@@ -0,0 +1,226 @@
+#include "TextModelLoader.h"
+
+using namespace BaseHelper;
+using namespace D3DHelper;
+using namespace DirectX;
+
+// 缓存条目: TextModelCacheHeader, 顶点, 索引
+// 修改解析结果的格式后需要递增版本号
+#define TEXT_MODEL_CACHE_VERSION 1
+
+struct TextModelCacheHeader
+{
+	UINT nVertexCount;
+	UINT nIndexCount;
+	UINT emIndexFormat;
+	BoundingBox Bounds;
+};
+
+UINT TextModelLoader::TextModel::GetIndexCount() const
+{
+	return emIndexFormat == DXGI_FORMAT_R16_UINT? (UINT)Indices16.size(): (UINT)Indices32.size();
+}
+
+UINT TextModelLoader::TextModel::GetIndexByteSize() const
+{
+	return GetIndexCount() * (emIndexFormat == DXGI_FORMAT_R16_UINT? sizeof(UINT16): sizeof(UINT32));
+}
+
+const void* TextModelLoader::TextModel::GetIndexData() const
+{
+	return emIndexFormat == DXGI_FORMAT_R16_UINT? (const void*)Indices16.data(): (const void*)Indices32.data();
+}
+
+void TextModelLoader::TextModel::GetIndices(std::vector<UINT>& indices) const
+{
+	if(emIndexFormat == DXGI_FORMAT_R16_UINT)
+		indices.assign(Indices16.begin(), Indices16.end());
+	else
+		indices.assign(Indices32.begin(), Indices32.end());
+}
+
+static bool ReadTextFile(LPCWSTR file, std::vector<char>& buffer)
+{
+	FILE_HANDLE hFile = CreateFileW(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return 0;
+
+	DWORD dwFileSize = GetFileSize(hFile, NULL);
+	DWORD dwReadByteSize = 0;
+
+	// 末尾补 '\0', 扫描器以此判断缓冲区结束
+	buffer.resize((size_t)dwFileSize + 1);
+	bool bResult = File::ReadToBuffer(hFile, buffer.data(), dwFileSize, &dwReadByteSize) && dwReadByteSize == dwFileSize;
+	CloseHandle(hFile);
+
+	buffer[dwFileSize] = '\0';
+	return bResult;
+}
+
+template<typename IndexT>
+static bool ReadTriangles(ScannerA& scanner, UINT nIndexCount, UINT nVertexCount, std::vector<IndexT>& indices)
+{
+	UINT index;
+	indices.resize(nIndexCount);
+
+	for(UINT i = 0; i < nIndexCount; ++i)
+	{
+		scanner >> index;
+		if(index >= nVertexCount)
+			return 0;
+		indices[i] = (IndexT)index;
+	}
+	return 1;
+}
+
+// 会把两个列表的 '}' 改写为 '\0', 使扫描器不会越过列表末尾
+static bool ParseTextModel(LPSTR pBuffer, TextModelLoader::TextModel& model)
+{
+	LPSTR pVertexCount = strstr(pBuffer, "VertexCount");
+	LPSTR pTriangleCount = strstr(pBuffer, "TriangleCount");
+	LPSTR pVertexList = strchr(pBuffer, '{');
+	LPSTR pVertexEnd = pVertexList? strchr(pVertexList, '}'): NULL;
+	LPSTR pTriangleList = pVertexEnd? strstr(pVertexEnd, "TriangleList"): NULL;
+	LPSTR pTriangleBegin = pTriangleList? strchr(pTriangleList, '{'): NULL;
+	LPSTR pTriangleEnd = pTriangleBegin? strchr(pTriangleBegin, '}'): NULL;
+
+	if(!pVertexCount || !pTriangleCount || !pTriangleEnd)
+		return 0;
+
+	UINT nVertexCount, nTriangleCount;
+	ScannerA(pVertexCount) >> nVertexCount;
+	ScannerA(pTriangleCount) >> nTriangleCount;
+
+	// 每个数值至少占两个字符(数字与分隔符), 文件头的数量超出列表长度时说明文件已损坏
+	if((UINT64)nVertexCount * 6 * 2 > (UINT64)(pVertexEnd - pVertexList) ||
+	   (UINT64)nTriangleCount * 3 * 2 > (UINT64)(pTriangleEnd - pTriangleBegin))
+		return 0;
+
+	*pVertexEnd = '\0';
+	*pTriangleEnd = '\0';
+
+	// 顶点: 读取的同时计算碰撞盒
+	ScannerA scanner(pVertexList + 1);
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+
+	model.Vertices.resize(nVertexCount);
+	for(UINT i = 0; i < nVertexCount; ++i)
+	{
+		TextModelLoader::TextModelVertex& v = model.Vertices[i];
+		scanner >> v.vec3Position.x >> v.vec3Position.y >> v.vec3Position.z;
+		scanner >> v.vec3Normal.x >> v.vec3Normal.y >> v.vec3Normal.z;
+
+		XMVECTOR P = XMLoadFloat3(&v.vec3Position);
+		vMin = XMVectorMin(vMin, P);
+		vMax = XMVectorMax(vMax, P);
+	}
+
+	// 列表中的数值不足
+	if(scanner.IsEnd())
+		return 0;
+
+	if(nVertexCount)
+		BoundingBox::CreateFromPoints(model.Bounds, vMin, vMax);
+	else
+		model.Bounds = BoundingBox();
+
+	// 索引: 所有索引都小于 65536 时使用 16 位
+	scanner = pTriangleBegin + 1;
+	model.Indices16.clear();
+	model.Indices32.clear();
+
+	if(nVertexCount <= 0x10000)
+	{
+		model.emIndexFormat = DXGI_FORMAT_R16_UINT;
+		return ReadTriangles(scanner, nTriangleCount * 3, nVertexCount, model.Indices16) && !scanner.IsEnd();
+	}
+
+	model.emIndexFormat = DXGI_FORMAT_R32_UINT;
+	return ReadTriangles(scanner, nTriangleCount * 3, nVertexCount, model.Indices32) && !scanner.IsEnd();
+}
+
+static bool ReadModelCache(const std::vector<BYTE>& data, TextModelLoader::TextModel& model)
+{
+	TextModelCacheHeader header;
+	if(data.size() < sizeof(header))
+		return 0;
+	CopyMemory(&header, data.data(), sizeof(header));
+
+	size_t nIndexSize = header.emIndexFormat == DXGI_FORMAT_R16_UINT? sizeof(UINT16): sizeof(UINT32);
+	size_t nVertexByteSize = (size_t)header.nVertexCount * sizeof(TextModelLoader::TextModelVertex);
+	if(data.size() != sizeof(header) + nVertexByteSize + header.nIndexCount * nIndexSize)
+		return 0;
+
+	const BYTE* p = data.data() + sizeof(header);
+	model.Vertices.resize(header.nVertexCount);
+	CopyMemory(model.Vertices.data(), p, nVertexByteSize);
+	p += nVertexByteSize;
+
+	model.emIndexFormat = (DXGI_FORMAT)header.emIndexFormat;
+	model.Bounds = header.Bounds;
+	model.Indices16.clear();
+	model.Indices32.clear();
+	if(model.emIndexFormat == DXGI_FORMAT_R16_UINT)
+	{
+		model.Indices16.resize(header.nIndexCount);
+		CopyMemory(model.Indices16.data(), p, header.nIndexCount * nIndexSize);
+	}
+	else
+	{
+		model.Indices32.resize(header.nIndexCount);
+		CopyMemory(model.Indices32.data(), p, header.nIndexCount * nIndexSize);
+	}
+	return 1;
+}
+
+static void WriteModelCache(const TextModelLoader::TextModel& model, std::vector<BYTE>& data)
+{
+	TextModelCacheHeader header;
+	header.nVertexCount = (UINT)model.Vertices.size();
+	header.nIndexCount = model.GetIndexCount();
+	header.emIndexFormat = model.emIndexFormat;
+	header.Bounds = model.Bounds;
+
+	size_t nVertexByteSize = model.Vertices.size() * sizeof(TextModelLoader::TextModelVertex);
+	data.resize(sizeof(header) + nVertexByteSize + model.GetIndexByteSize());
+
+	BYTE* p = data.data();
+	CopyMemory(p, &header, sizeof(header));
+	p += sizeof(header);
+	CopyMemory(p, model.Vertices.data(), nVertexByteSize);
+	p += nVertexByteSize;
+	CopyMemory(p, model.GetIndexData(), model.GetIndexByteSize());
+}
+
+bool TextModelLoader::LoadTextModel(LPCWSTR file, TextModel& model, AssetCache* pCache)
+{
+	std::vector<char> buffer;
+	if(!ReadTextFile(file, buffer))
+	{
+		OutputDebugStringW((std::wstring(L"TextModelLoader: cannot read ") + file + L"\n").c_str());
+		return 0;
+	}
+
+	AssetKey key;
+	std::vector<BYTE> data;
+	if(pCache)
+	{
+		key = AssetKeyBuilder("TextModel", TEXT_MODEL_CACHE_VERSION).Append(buffer.data(), buffer.size() - 1).GetKey();
+		if(pCache->Load(key, data) && ReadModelCache(data, model))
+			return 1;
+	}
+
+	if(!ParseTextModel(buffer.data(), model))
+	{
+		OutputDebugStringW((std::wstring(L"TextModelLoader: invalid model ") + file + L"\n").c_str());
+		return 0;
+	}
+
+	if(pCache)
+	{
+		WriteModelCache(model, data);
+		pCache->Store(key, data.data(), data.size());
+	}
+	return 1;
+}
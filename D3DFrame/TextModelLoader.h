@@ -0,0 +1,49 @@
+#pragma once
+#ifndef _TEXTMODELLOADER_H
+#define _TEXTMODELLOADER_H
+#include "BaseHelper.h"
+#include "D3DBase.h"
+
+namespace D3DHelper
+{
+	/// @brief 读取 Models/ 目录下的文本模型(skull.txt, car.txt)
+	/// 文件格式:
+	///   VertexCount: n
+	///   TriangleCount: m
+	///   VertexList (pos, normal) { px py pz nx ny nz ... }
+	///   TriangleList { i0 i1 i2 ... }
+	namespace TextModelLoader
+	{
+		struct TextModelVertex
+		{
+			DirectX::XMFLOAT3 vec3Position;
+			DirectX::XMFLOAT3 vec3Normal;
+		};
+
+		struct TextModel
+		{
+			std::vector<TextModelVertex> Vertices;
+			std::vector<UINT16> Indices16;			// emIndexFormat == DXGI_FORMAT_R16_UINT 时有效
+			std::vector<UINT32> Indices32;			// emIndexFormat == DXGI_FORMAT_R32_UINT 时有效
+			DXGI_FORMAT emIndexFormat = DXGI_FORMAT_R16_UINT;	// 顶点数不超过 65536 时使用 16 位索引
+			DirectX::BoundingBox Bounds;			// 顶点位置的碰撞盒
+
+			UINT GetIndexCount() const;
+			UINT GetIndexByteSize() const;
+			const void* GetIndexData() const;
+
+			/// @brief 以 32 位形式取出索引, 用于网格简化等处理
+			void GetIndices(std::vector<UINT>& indices) const;
+		};
+
+		/// @brief 读取文本模型
+		/// 按文件头中的 VertexCount / TriangleCount 一次性分配内存, 碰撞盒在读取顶点时同时计算
+		/// @param file 	磁盘文件名
+		/// @param model 	输出
+		/// @param pCache 	可选, 以文件内容为键缓存解析结果, 文件未改动时跳过文本解析
+		/// @return 		文件不存在或格式错误(索引越界, 列表被截断, 数量与列表不符等)时返回 0
+		bool LoadTextModel(LPCWSTR file, TextModel& model, BaseHelper::AssetCache* pCache = nullptr);
+	};
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "c_hash.h"
 
 DWORD bkdrhashW(LPWSTR wstr)
@@ -25,4 +26,289 @@ DWORD bkdrhashA(LPSTR str)
 	}
 	
 	return hash;
-}
\ No newline at end of file
+}
+
+/************************************************/
+/*                   xxHash64                   */
+/************************************************/
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+// Сȡ, Ҫַ
+static UINT64 xxh_read64(const BYTE* p)
+{
+	UINT64 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static DWORD xxh_read32(const BYTE* p)
+{
+	DWORD v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static UINT64 xxh64_round(UINT64 acc, UINT64 input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = XXH_ROTL64(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static UINT64 xxh64_merge_round(UINT64 acc, UINT64 val)
+{
+	acc ^= xxh64_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// ʣ಻ 32 ֽڵݲѩ
+static UINT64 xxh64_finalize(UINT64 h, const BYTE* p, size_t len)
+{
+	while(len >= 8)
+	{
+		h ^= xxh64_round(0, xxh_read64(p));
+		h = XXH_ROTL64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+		len -= 8;
+	}
+	if(len >= 4)
+	{
+		h ^= (UINT64)xxh_read32(p) * XXH_PRIME64_1;
+		h = XXH_ROTL64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+		len -= 4;
+	}
+	while(len)
+	{
+		h ^= (*p++) * XXH_PRIME64_5;
+		h = XXH_ROTL64(h, 11) * XXH_PRIME64_1;
+		--len;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+static UINT64 xxh64_converge(const UINT64 v[4])
+{
+	UINT64 h = XXH_ROTL64(v[0], 1) + XXH_ROTL64(v[1], 7) + XXH_ROTL64(v[2], 12) + XXH_ROTL64(v[3], 18);
+	h = xxh64_merge_round(h, v[0]);
+	h = xxh64_merge_round(h, v[1]);
+	h = xxh64_merge_round(h, v[2]);
+	h = xxh64_merge_round(h, v[3]);
+	return h;
+}
+
+UINT64 xxhash64(const void* data, size_t size, UINT64 seed)
+{
+	const BYTE* p = (const BYTE*)data;
+	const BYTE* end = p + size;
+	UINT64 h;
+
+	if(size >= 32)
+	{
+		UINT64 v[4];
+		const BYTE* limit = end - 32;
+		v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		v[1] = seed + XXH_PRIME64_2;
+		v[2] = seed;
+		v[3] = seed - XXH_PRIME64_1;
+
+		do
+		{
+			v[0] = xxh64_round(v[0], xxh_read64(p));
+			v[1] = xxh64_round(v[1], xxh_read64(p + 8));
+			v[2] = xxh64_round(v[2], xxh_read64(p + 16));
+			v[3] = xxh64_round(v[3], xxh_read64(p + 24));
+			p += 32;
+		} while(p <= limit);
+
+		h = xxh64_converge(v);
+	}
+	else
+		h = seed + XXH_PRIME64_5;
+
+	h += (UINT64)size;
+	return xxh64_finalize(h, p, (size_t)(end - p));
+}
+
+void xxhash64_reset(C_HASH_XXH64_STATE* state, UINT64 seed)
+{
+	assert(state);
+	memset(state, 0, sizeof(*state));
+	state->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+	state->v[1] = seed + XXH_PRIME64_2;
+	state->v[2] = seed;
+	state->v[3] = seed - XXH_PRIME64_1;
+}
+
+void xxhash64_update(C_HASH_XXH64_STATE* state, const void* data, size_t size)
+{
+	const BYTE* p = (const BYTE*)data;
+	const BYTE* end = p + size;
+	assert(state);
+
+	state->total += size;
+
+	// ݲһʱȻ
+	if(state->memsize + size < 32)
+	{
+		memcpy(state->mem + state->memsize, p, size);
+		state->memsize += (DWORD)size;
+		return;
+	}
+
+	if(state->memsize)
+	{
+		DWORD fill = 32 - state->memsize;
+		memcpy(state->mem + state->memsize, p, fill);
+		state->v[0] = xxh64_round(state->v[0], xxh_read64(state->mem));
+		state->v[1] = xxh64_round(state->v[1], xxh_read64(state->mem + 8));
+		state->v[2] = xxh64_round(state->v[2], xxh_read64(state->mem + 16));
+		state->v[3] = xxh64_round(state->v[3], xxh_read64(state->mem + 24));
+		p += fill;
+		state->memsize = 0;
+	}
+
+	while(p + 32 <= end)
+	{
+		state->v[0] = xxh64_round(state->v[0], xxh_read64(p));
+		state->v[1] = xxh64_round(state->v[1], xxh_read64(p + 8));
+		state->v[2] = xxh64_round(state->v[2], xxh_read64(p + 16));
+		state->v[3] = xxh64_round(state->v[3], xxh_read64(p + 24));
+		p += 32;
+	}
+
+	if(p < end)
+	{
+		memcpy(state->mem, p, (size_t)(end - p));
+		state->memsize = (DWORD)(end - p);
+	}
+}
+
+UINT64 xxhash64_digest(const C_HASH_XXH64_STATE* state)
+{
+	UINT64 h;
+	assert(state);
+
+	if(state->total >= 32)
+		h = xxh64_converge(state->v);
+	else
+		h = state->v[2] + XXH_PRIME64_5;	// v[2] == seed
+
+	h += state->total;
+	return xxh64_finalize(h, state->mem, state->memsize);
+}
+
+/************************************************/
+/*                      MD5                     */
+/************************************************/
+
+static const DWORD md5_k[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const BYTE md5_r[64] = {
+	7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+	4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_block(DWORD h[4], const BYTE* block)
+{
+	DWORD w[16];
+	DWORD a = h[0], b = h[1], c = h[2], d = h[3];
+	DWORD f, g, t;
+	UINT i;
+
+	memcpy(w, block, sizeof(w));
+
+	for(i = 0; i < 64; ++i)
+	{
+		if(i < 16)
+		{
+			f = (b & c) | (~b & d);
+			g = i;
+		}
+		else if(i < 32)
+		{
+			f = (d & b) | (~d & c);
+			g = (5 * i + 1) & 15;
+		}
+		else if(i < 48)
+		{
+			f = b ^ c ^ d;
+			g = (3 * i + 5) & 15;
+		}
+		else
+		{
+			f = c ^ (b | ~d);
+			g = (7 * i) & 15;
+		}
+
+		t = d;
+		d = c;
+		c = b;
+		f = a + f + md5_k[i] + w[g];
+		b = b + ((f << md5_r[i]) | (f >> (32 - md5_r[i])));
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+}
+
+void md5(const void* data, size_t size, C_HASH_MD5_16* digest)
+{
+	const BYTE* p = (const BYTE*)data;
+	DWORD h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	BYTE tail[128];
+	size_t rest, tailsize;
+	UINT64 bits = (UINT64)size * 8;
+	assert(digest);
+
+	while(size >= 64)
+	{
+		md5_block(h, p);
+		p += 64;
+		size -= 64;
+	}
+
+	// : 0x80,  56 ֽ(ģ 64),  8 ֽΪس
+	rest = size;
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, p, rest);
+	tail[rest] = 0x80;
+	tailsize = rest < 56? 64: 128;
+	memcpy(tail + tailsize - 8, &bits, 8);
+
+	md5_block(h, tail);
+	if(tailsize == 128)
+		md5_block(h, tail + 64);
+
+	digest->_0 = h[0];
+	digest->_1 = h[1];
+	digest->_2 = h[2];
+	digest->_3 = h[3];
+}
@@ -11,8 +11,25 @@ typedef struct MD5_16
 	DWORD _3;
 }C_HASH_MD5_16;
 
+// xxHash64 ʽ״̬; ݿԷֶ, һԼͬ
+typedef struct XXH64_STATE
+{
+	UINT64 total;
+	UINT64 v[4];
+	BYTE mem[32];
+	DWORD memsize;
+}C_HASH_XXH64_STATE;
+
 DWORD bkdrhashW(LPWSTR wstr);
 DWORD bkdrhashA(LPSTR str);
 
+// xxHash64: ڴ(ļ)Ŀٹϣ
+UINT64 xxhash64(const void* data, size_t size, UINT64 seed);
+void xxhash64_reset(C_HASH_XXH64_STATE* state, UINT64 seed);
+void xxhash64_update(C_HASH_XXH64_STATE* state, const void* data, size_t size);
+UINT64 xxhash64_digest(const C_HASH_XXH64_STATE* state);
+
+// MD5: 128 λժҪ,  xxHash64 , Ҫⲿ߶յĳ
+void md5(const void* data, size_t size, C_HASH_MD5_16* digest);
 
-#endif
\ No newline at end of file
+#endif
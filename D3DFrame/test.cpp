@@ -0,0 +1,2602 @@
+/******************************************************/
+/*     D3DAppTest: 性能测试(控制台程序)                 */
+/*     用法:                                            */
+/*       D3DAppTest textmodel [模型文件] [缓存目录]     */
+/*       D3DAppTest animation [m3d 文件] [实例数] [秒]  */
+/*       D3DAppTest compression [m3d 文件] [误差]       */
+/*       D3DAppTest posecache [m3d 文件] [实例数] [毫秒] */
+/*       D3DAppTest palette [m3d 文件] [实例数] [线程数] */
+/******************************************************/
+#include "TextModelLoader.h"
+#include "M3dLoader.h"
+#include "D3DHelper_Math.h"
+#include "D3DHelper_PoseCache.h"
+#include "D3DHelper.h"
+#include "D3DHelper_AnimationLod.h"
+#include "D3DHelper_FrustumCulling.h"
+#include "D3DHelper_SceneBvh.h"
+#include "D3DHelper_TriangleBvh.h"
+#include "D3DHelper_RayQuery.h"
+#include "D3DHelper_AmbientOcclusion.h"
+#include "D3DHelper_OcclusionCulling.h"
+#include "D3DHelper_ShadowCulling.h"
+#include "D3DHelper_CascadedShadow.h"
+#include "D3DHelper_LightClustering.h"
+#include "D3DHelper_MeshSimplifier.h"
+#include <thread>
+#include <algorithm>
+
+using namespace D3DHelper;
+using namespace DirectX;
+
+static double GetMilliseconds()
+{
+	static LARGE_INTEGER frequency = {};
+	LARGE_INTEGER counter;
+
+	if(!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
+static bool SameModel(const TextModelLoader::TextModel& a, const TextModelLoader::TextModel& b)
+{
+	return a.Vertices.size() == b.Vertices.size() && a.emIndexFormat == b.emIndexFormat &&
+		   a.GetIndexCount() == b.GetIndexCount() &&
+		   !memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(TextModelLoader::TextModelVertex)) &&
+		   !memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexByteSize());
+}
+
+static bool WriteWholeFile(PATH lpszFileName, const std::string& text)
+{
+	FILE_HANDLE hFile = BaseHelper::File::OpenFile(lpszFileName, BaseHelper::File::FILE_METHOD_CREATE_ALWAYS);
+	if(!hFile)
+		return 0;
+	DWORD dwWritten = 0;
+	bool bResult = BaseHelper::File::Write(hFile, text.data(), (DWORD)text.size(), &dwWritten) && dwWritten == text.size();
+	CloseHandle(hFile);
+	return bResult;
+}
+
+// 把文件头中 lpszField 后面的数量改为 nValue
+static std::string ReplaceCount(const std::string& text, const char* lpszField, UINT nValue)
+{
+	size_t nBegin = text.find(lpszField) + strlen(lpszField);
+	nBegin = text.find_first_of("0123456789", nBegin);
+	size_t nEnd = text.find_first_not_of("0123456789", nBegin);
+	return text.substr(0, nBegin) + std::to_string(nValue) + text.substr(nEnd);
+}
+
+static int BenchTextModel(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/skull.txt";
+	LPCWSTR lpszCache = argc > 1? argv[1]: L"./Cache";
+	const UINT nRepeat = 10;
+
+	TextModelLoader::TextModel parsed, cached;
+	double fBegin, fParse, fCacheMiss, fCacheHit;
+
+	// 文本解析
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRepeat; ++i)
+	{
+		if(!TextModelLoader::LoadTextModel(lpszModel, parsed))
+		{
+			wprintf(L"cannot load %ls\n", lpszModel);
+			return 1;
+		}
+	}
+	fParse = (GetMilliseconds() - fBegin) / nRepeat;
+
+	// 首次写入缓存, 之后均为命中
+	BaseHelper::AssetCache cache(lpszCache);
+	fBegin = GetMilliseconds();
+	TextModelLoader::LoadTextModel(lpszModel, cached, &cache);
+	fCacheMiss = GetMilliseconds() - fBegin;
+
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRepeat; ++i)
+		TextModelLoader::LoadTextModel(lpszModel, cached, &cache);
+	fCacheHit = (GetMilliseconds() - fBegin) / nRepeat;
+
+	wprintf(L"%ls: %u vertices, %u triangles, %u-bit indices\n", lpszModel, (UINT)parsed.Vertices.size(),
+			parsed.GetIndexCount() / 3, parsed.emIndexFormat == DXGI_FORMAT_R16_UINT? 16: 32);
+	wprintf(L"text parse:  %8.3f ms\n", fParse);
+	wprintf(L"cache miss:  %8.3f ms\n", fCacheMiss);
+	wprintf(L"cache hit:   %8.3f ms (hit %u, miss %u)\n", fCacheHit, cache.GetHitCount(), cache.GetMissCount());
+	wprintf(L"cached data %ls\n", SameModel(parsed, cached)? L"matches": L"DIFFERS");
+
+	// 截断或文件头损坏的文件必须读取失败, 而不是以 0 补齐
+	FILE_HANDLE hFile = CreateFileW(lpszModel, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	void* pBuffer = NULL;
+	DWORD dwByteSize = 0;
+	if(hFile == INVALID_HANDLE_VALUE || !BaseHelper::File::Read(hFile, &pBuffer, &dwByteSize))
+		return 1;
+	CloseHandle(hFile);
+	std::string text((const char*)pBuffer, dwByteSize);
+	BASE_MFREE(pBuffer);
+
+	UINT nVertexCount = (UINT)parsed.Vertices.size(), nTriangleCount = parsed.GetIndexCount() / 3;
+	size_t nTriangleList = text.find("TriangleList");
+	std::string full = text.substr(0, text.find_last_of("0123456789") + 1);
+	std::string cut = full.substr(0, full.find_last_not_of("0123456789") + 1);
+	const std::pair<const wchar_t*, std::string> malformed[] = {
+		{L"cut inside TriangleList", text.substr(0, nTriangleList + (text.size() - nTriangleList) / 2)},
+		{L"cut inside VertexList", text.substr(0, nTriangleList / 2)},
+		{L"last index missing", cut + "\n}\n"},
+		{L"VertexCount + 1", ReplaceCount(text, "VertexCount", nVertexCount + 1)},
+		{L"TriangleCount + 1", ReplaceCount(text, "TriangleCount", nTriangleCount + 1)},
+		{L"huge VertexCount", ReplaceCount(text, "VertexCount", 0x7fffffff)},
+		{L"huge TriangleCount", ReplaceCount(text, "TriangleCount", 0x7fffffff)},
+	};
+	std::wstring path = std::wstring(lpszCache) + L"/malformed.txt";
+	UINT nRejected = 0;
+	for(const auto& test: malformed)
+	{
+		TextModelLoader::TextModel model;
+		bool bRejected = WriteWholeFile(path.c_str(), test.second) && !TextModelLoader::LoadTextModel(path.c_str(), model);
+		nRejected += bRejected;
+		wprintf(L"  %-24ls %ls\n", test.first, bRejected? L"rejected": L"LOADED");
+	}
+	DeleteFileW(path.c_str());
+
+	// 末尾的 '}' 紧跟在数值之后也是完整的文件
+	TextModelLoader::TextModel compact;
+	bool bCompact = WriteWholeFile(path.c_str(), full + "}") && TextModelLoader::LoadTextModel(path.c_str(), compact) &&
+					SameModel(parsed, compact);
+	DeleteFileW(path.c_str());
+	wprintf(L"  %-24ls %ls\n", L"no space before '}'", bCompact? L"loaded": L"REJECTED");
+	return nRejected == _countof(malformed) && bCompact? 0: 1;
+}
+
+// 原 BoneAnimation::Interpolate 的逐帧线性查找, 作为对照
+static void LinearScanInterpolate(const Animation::BoneAnimation& bone, float t, XMFLOAT4X4& M)
+{
+	const std::vector<Animation::Keyframe>& keys = bone.Keyframes;
+	if(t <= keys.front().nTimePos || t >= keys.back().nTimePos)
+	{
+		bone.Interpolate(t, M);
+		return;
+	}
+
+	for(UINT i = 0; i < keys.size() - 1; ++i)
+	{
+		if(t >= keys[i].nTimePos && t <= keys[i + 1].nTimePos)
+		{
+			float lerpPercent = (t - keys[i].nTimePos) / (keys[i + 1].nTimePos - keys[i].nTimePos);
+			XMVECTOR S = XMVectorLerp(XMLoadFloat3(&keys[i].vec3Scale), XMLoadFloat3(&keys[i + 1].vec3Scale), lerpPercent);
+			XMVECTOR T = XMVectorLerp(XMLoadFloat3(&keys[i].vec3Translation), XMLoadFloat3(&keys[i + 1].vec3Translation), lerpPercent);
+			XMVECTOR q0 = XMLoadFloat4(&keys[i].vec4RotationQuat);
+			XMVECTOR q1 = XMLoadFloat4(&keys[i + 1].vec4RotationQuat);
+			if(XMVectorGetX(XMVector4Dot(q0, q1)) < 0.0f)
+				q1 = XMVectorNegate(q1);
+			XMVECTOR Q = XMQuaternionNormalize(XMVectorLerp(q0, q1, lerpPercent));
+			XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), Q, T));
+			return;
+		}
+	}
+}
+
+static float MaxDifference(const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+{
+	float fDiff = 0.0f;
+	for(UINT i = 0; i < a.size(); ++i)
+	{
+		for(UINT j = 0; j < 16; ++j)
+			fDiff = max(fDiff, fabsf((&a[i]._11)[j] - (&b[i]._11)[j]));
+	}
+	return fDiff;
+}
+
+// 双精度球面线性插值, 作为 PackedClip 的对照
+static XMFLOAT4 ReferenceSlerp(const XMFLOAT4& a, const XMFLOAT4& b, double t)
+{
+	double q0[4] = {a.x, a.y, a.z, a.w}, q1[4] = {b.x, b.y, b.z, b.w};
+	double dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+	double sign = dot < 0.0? -1.0: 1.0;
+	dot = fabs(dot);
+
+	double w0 = 1.0 - t, w1 = t;
+	if(dot < 1.0 - 1e-9)
+	{
+		double theta = acos(dot > 1.0? 1.0: dot);
+		w0 = sin((1.0 - t) * theta) / sin(theta);
+		w1 = sin(t * theta) / sin(theta);
+	}
+
+	double q[4], len = 0.0;
+	for(UINT i = 0; i < 4; ++i)
+	{
+		q[i] = q0[i] * w0 + q1[i] * w1 * sign;
+		len += q[i] * q[i];
+	}
+	len = sqrt(len);
+	return XMFLOAT4((float)(q[0] / len), (float)(q[1] / len), (float)(q[2] / len), (float)(q[3] / len));
+}
+
+static XMFLOAT4 RandomQuaternion()
+{
+	XMVECTOR axis = XMVector3Normalize(XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f),
+												   MathHelper::RandomF(-1.0f, 1.0f), 0.0f));
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, XMQuaternionRotationAxis(axis, MathHelper::RandomF(-XM_PI, XM_PI)));
+	return q;
+}
+
+// 两个关键帧之间随机旋转(含夹角接近 180 度及 q1 位于另一半球的情况), 比较批量插值与双精度 slerp
+static bool CheckQuaternionBlend()
+{
+	const UINT nBones = 4 * 64 + 3;			// 末组不足 4 根, 同时检查补齐的通道
+	const UINT nSteps = 64;
+
+	Animation::AnimationClip clip;
+	clip.BoneAnimations.resize(nBones);
+	for(UINT b = 0; b < nBones; ++b)
+	{
+		Animation::Keyframe k0, k1;
+		k0.nTimePos = 0.0f;
+		k1.nTimePos = 1.0f;
+		k0.vec3Scale = k1.vec3Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		k0.vec3Translation = k1.vec3Translation = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		k0.vec4RotationQuat = RandomQuaternion();
+		k1.vec4RotationQuat = RandomQuaternion();
+		clip.BoneAnimations[b].Keyframes = {k0, k1};
+	}
+
+	// 采样率为 1 时打包后的关键帧与原关键帧相同
+	Animation::PackedClip packed;
+	packed.Build(clip, 1.0f);
+
+	std::vector<XMFLOAT4X4> reference(nBones), slerp(nBones), nlerp(nBones);
+	float fSlerpDiff = 0.0f, fNlerpDiff = 0.0f;
+	for(UINT s = 0; s <= nSteps; ++s)
+	{
+		float t = (float)s / nSteps;
+		packed.Evaluate(t, slerp.data(), Animation::QUATERNION_BLEND_SLERP);
+		packed.Evaluate(t, nlerp.data(), Animation::QUATERNION_BLEND_NLERP);
+
+		for(UINT b = 0; b < nBones; ++b)
+		{
+			const std::vector<Animation::Keyframe>& keys = clip.BoneAnimations[b].Keyframes;
+			XMFLOAT4 q = ReferenceSlerp(keys[0].vec4RotationQuat, keys[1].vec4RotationQuat, t);
+			XMStoreFloat4x4(&reference[b], XMMatrixRotationQuaternion(XMLoadFloat4(&q)));
+		}
+		fSlerpDiff = max(fSlerpDiff, MaxDifference(reference, slerp));
+		fNlerpDiff = max(fNlerpDiff, MaxDifference(reference, nlerp));
+	}
+
+	bool bPass = fSlerpDiff < 1e-4f;
+	wprintf(L"quaternion blend vs reference slerp (%u bones, %u steps):\n", nBones, nSteps);
+	wprintf(L"  slerp max diff %g (%ls)\n", fSlerpDiff, bPass? L"ok": L"FAILED");
+	wprintf(L"  nlerp max diff %g\n", fNlerpDiff);
+	return bPass;
+}
+
+static int BenchAnimation(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	UINT nInstances = argc > 1? _wtoi(argv[1]): 256;
+	float fSeconds = argc > 2? (float)_wtof(argv[2]): 30.0f;
+	const UINT nFrames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	// 将第一个片段首尾相接, 拼成 fSeconds 秒的长动画
+	std::string clipName = "Take1";
+	const Animation::AnimationClip& source = skinned.GetAnimationClip(clipName);
+	float fDuration = source.GetEndTime() - source.GetStartTime();
+	UINT nRepeat = max((UINT)(fSeconds / fDuration), 1u);
+
+	Animation::AnimationClip clip;
+	clip.BoneAnimations.resize(source.BoneAnimations.size());
+	for(UINT b = 0; b < source.BoneAnimations.size(); ++b)
+	{
+		const std::vector<Animation::Keyframe>& keys = source.BoneAnimations[b].Keyframes;
+		for(UINT r = 0; r < nRepeat; ++r)
+		{
+			for(UINT k = (r == 0? 0: 1); k < keys.size(); ++k)
+			{
+				Animation::Keyframe key = keys[k];
+				key.nTimePos += fDuration * r;
+				clip.BoneAnimations[b].Keyframes.push_back(key);
+			}
+		}
+	}
+	Animation::AnimationClip uniform = clip;
+	uniform.Resample(60.0f);
+	Animation::PackedClip packed;
+	packed.Build(clip, 60.0f);
+
+	UINT nBones = (UINT)clip.BoneAnimations.size();
+	float fEnd = clip.GetEndTime();
+	std::vector<XMFLOAT4X4> reference(nBones), result(nBones);
+	std::vector<Animation::AnimationCursor> cursors(nInstances);
+	float fCursorDiff = 0.0f, fUniformDiff = 0.0f, fPackedDiff = 0.0f;
+
+	// 各实例的播放进度错开
+	auto TimeOf = [&](UINT f, UINT i) { return fmodf(i * 0.37f + f * dt, fEnd); };
+
+	// 每种方式单独计时, 避免前一种方式预热缓存
+	auto Measure = [&](auto&& fn)
+	{
+		double fBegin = GetMilliseconds();
+		for(UINT f = 0; f < nFrames; ++f)
+		{
+			for(UINT i = 0; i < nInstances; ++i)
+				fn(TimeOf(f, i), i);
+		}
+		return (GetMilliseconds() - fBegin) / nFrames;
+	};
+
+	double fLinear = Measure([&](float t, UINT i) {
+		for(UINT b = 0; b < nBones; ++b)
+			LinearScanInterpolate(clip.BoneAnimations[b], t, result[b]);
+	});
+	double fBinary = Measure([&](float t, UINT i) { clip.Interpolate(t, result); });
+	double fCursor = Measure([&](float t, UINT i) { clip.Interpolate(t, result, cursors[i]); });
+	double fUniform = Measure([&](float t, UINT i) { uniform.Interpolate(t, result); });
+	double fNlerp = Measure([&](float t, UINT i) { packed.Evaluate(t, result.data()); });
+	double fSlerp = Measure([&](float t, UINT i) { packed.Evaluate(t, result.data(), Animation::QUATERNION_BLEND_SLERP); });
+
+	// 完整的 GetFinalTransforms(与第 16 章相同使用 PackedClip): 每次按名字查找 vs 预先解析并复用临时缓冲区
+	skinned.PackClips(60.0f);
+	Animation::ResolvedClip resolved = skinned.ResolveClip(clipName);
+	Animation::AnimationScratch scratch;
+	std::vector<XMFLOAT4X4> finals(nBones);
+	double fByName = Measure([&](float t, UINT i) { skinned.GetFinalTransforms(clipName, fmodf(t, resolved.fEndTime), result); });
+	double fResolved = Measure([&](float t, UINT i) { skinned.GetFinalTransforms(resolved, fmodf(t, resolved.fEndTime), finals.data(), scratch); });
+	float fFinalDiff = MaxDifference(result, finals);
+
+	// SkinnedInstance::UpdateAnimation 每帧查询片段长度: 按名字 vs 句柄
+	Animation::ClipHandle handle = skinned.FindClip(clipName);
+	volatile float fSink = 0.0f;
+	double fEndByName = Measure([&](float t, UINT i) { fSink = fSink + skinned.GetClipEndTime(clipName); });
+	double fEndByHandle = Measure([&](float t, UINT i) { fSink = fSink + skinned.GetClipEndTime(handle); });
+
+	// 精度: 与逐帧线性查找的结果比较
+	std::vector<Animation::AnimationCursor> checkCursors(nInstances);
+	for(UINT f = 0; f < nFrames; ++f)
+	{
+		for(UINT i = 0; i < nInstances; ++i)
+		{
+			float t = TimeOf(f, i);
+			for(UINT b = 0; b < nBones; ++b)
+				LinearScanInterpolate(clip.BoneAnimations[b], t, reference[b]);
+
+			clip.Interpolate(t, result, checkCursors[i]);
+			fCursorDiff = max(fCursorDiff, MaxDifference(reference, result));
+
+			uniform.Interpolate(t, result);
+			fUniformDiff = max(fUniformDiff, MaxDifference(reference, result));
+
+			packed.Evaluate(t, result.data());
+			fPackedDiff = max(fPackedDiff, MaxDifference(reference, result));
+		}
+	}
+
+	wprintf(L"%u bones, %u keys per bone (%.1f s), %u instances, %u frames\n", nBones,
+			(UINT)clip.BoneAnimations[0].Keyframes.size(), fEnd, nInstances, nFrames);
+	wprintf(L"linear scan:    %8.3f ms/frame\n", fLinear);
+	wprintf(L"binary search:  %8.3f ms/frame\n", fBinary);
+	wprintf(L"cursor:         %8.3f ms/frame (max diff %g)\n", fCursor, fCursorDiff);
+	wprintf(L"uniform 60 Hz:  %8.3f ms/frame (max diff %g)\n", fUniform, fUniformDiff);
+	wprintf(L"packed nlerp:   %8.3f ms/frame (max diff %g)\n", fNlerp, fPackedDiff);
+	wprintf(L"packed slerp:   %8.3f ms/frame\n", fSlerp);
+	wprintf(L"final by name:  %8.3f ms/frame\n", fByName);
+	wprintf(L"final resolved: %8.3f ms/frame (max diff %g)\n", fResolved, fFinalDiff);
+	wprintf(L"end by name:    %8.3f ms/frame\n", fEndByName);
+	wprintf(L"end by handle:  %8.3f ms/frame\n", fEndByHandle);
+	return CheckQuaternionBlend()? 0: 1;
+}
+
+// 按 M3d 顶点的骨骼权重蒙皮, 返回两组调色板下顶点位置的最大偏差
+static float MaxSkinnedDifference(const std::vector<M3dLoader::M3dSkinnedVertex>& vertices,
+								  const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+{
+	float fDiff = 0.0f;
+	for(const M3dLoader::M3dSkinnedVertex& v : vertices)
+	{
+		XMVECTOR P = XMLoadFloat3(&v.vec3Position);
+		XMVECTOR Pa = XMVectorZero(), Pb = XMVectorZero();
+		const float* pWeights = &v.vec4BoneWeights.x;
+
+		for(UINT i = 0; i < 4; ++i)
+		{
+			// GetFinalTransforms 输出的是转置后的矩阵
+			UINT nBone = v.vec4BoneIndices[i];
+			Pa = XMVectorAdd(Pa, XMVectorScale(XMVector3Transform(P, XMMatrixTranspose(XMLoadFloat4x4(&a[nBone]))), pWeights[i]));
+			Pb = XMVectorAdd(Pb, XMVectorScale(XMVector3Transform(P, XMMatrixTranspose(XMLoadFloat4x4(&b[nBone]))), pWeights[i]));
+		}
+		fDiff = max(fDiff, XMVectorGetX(XMVector3Length(XMVectorSubtract(Pa, Pb))));
+	}
+	return fDiff;
+}
+
+static int BenchCompression(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	Animation::AnimationCompressionDesc desc;
+	desc.fTolerance = argc > 1? (float)_wtof(argv[1]): desc.fTolerance;
+	const UINT nLibrary = 256;
+	const UINT nRepeat = 10000;
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	// 片段库: 同一片段复制 nLibrary 份, 每次随机取一个, 模拟工作集大于缓存的情况
+	std::string clipName = "Take1";
+	const Animation::AnimationClip& source = skinned.GetAnimationClip(clipName);
+	std::vector<std::string> library(nLibrary);
+	for(UINT i = 0; i < nLibrary; ++i)
+	{
+		library[i] = clipName + "_" + std::to_string(i);
+		skinned.GetAnimationClip(library[i]) = source;
+	}
+	skinned.RefreshClips();
+
+	size_t nSourceKeys = 0, nSourceBytes = sizeof(source) + source.BoneAnimations.size() * sizeof(Animation::BoneAnimation);
+	for(const Animation::BoneAnimation& bone : source.BoneAnimations)
+		nSourceKeys += bone.Keyframes.size();
+	nSourceBytes += nSourceKeys * sizeof(Animation::Keyframe);
+
+	Animation::SkinnedAnimation compressed = skinned;
+	desc.bDiscardSource = 1;
+	double fBegin = GetMilliseconds();
+	compressed.CompressClips(desc);
+	double fBuild = GetMilliseconds() - fBegin;
+	const Animation::CompressedClip* pClip = compressed.GetCompressedClip(clipName);
+
+	// 以 240 Hz 比较蒙皮后的顶点位置
+	UINT nBones = skinned.BoneCount();
+	std::vector<XMFLOAT4X4> reference(nBones), result(nBones);
+	float fStart = skinned.GetClipStartTime(clipName), fEnd = skinned.GetClipEndTime(clipName);
+	float fVertexDiff = 0.0f;
+	for(float t = fStart; t <= fEnd; t += 1.0f / 240.0f)
+	{
+		skinned.GetFinalTransforms(clipName, t, reference);
+		compressed.GetFinalTransforms(clipName, t, result);
+		fVertexDiff = max(fVertexDiff, MaxSkinnedDifference(vertices, reference, result));
+	}
+
+	std::vector<UINT> order(nRepeat);
+	for(UINT i = 0; i < nRepeat; ++i)
+		order[i] = rand() % nLibrary;
+
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRepeat; ++i)
+		skinned.GetFinalTransforms(library[order[i]], fmodf(i * 0.37f, fEnd), result);
+	double fSourceTime = (GetMilliseconds() - fBegin) * 1000.0 / nRepeat;
+
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRepeat; ++i)
+		compressed.GetFinalTransforms(library[order[i]], fmodf(i * 0.37f, fEnd), result);
+	double fCompressedTime = (GetMilliseconds() - fBegin) * 1000.0 / nRepeat;
+
+	wprintf(L"%u bones, tolerance %g, %u clips built in %.2f ms\n", nBones, desc.fTolerance, nLibrary + 1, fBuild);
+	wprintf(L"keys per clip:   %8u -> %8u\n", (UINT)nSourceKeys, pClip->GetKeyCount());
+	wprintf(L"bytes per clip:  %8u -> %8u (%.1f%%)\n", (UINT)nSourceBytes, (UINT)pClip->GetByteSize(), pClip->GetByteSize() * 100.0 / nSourceBytes);
+	wprintf(L"max skinned vertex error: %g\n", fVertexDiff);
+	wprintf(L"GetFinalTransforms, random clip of %u: source %.2f us, compressed %.2f us\n", nLibrary, fSourceTime, fCompressedTime);
+	return 0;
+}
+
+static int BenchPoseCache(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	UINT nInstances = argc > 1? _wtoi(argv[1]): 1000;
+	float fQuantum = argc > 2? (float)_wtof(argv[2]) / 1000.0f: 1.0f / 60.0f;
+	const UINT nFrames = 120;
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	// 与 SkinnedInstance::UpdateAnimation 相同的推进方式, 各实例的起始时间随机
+	std::string clipName = "Take1";
+	float fEnd = skinned.GetClipEndTime(clipName);
+	std::vector<float> starts(nInstances);
+	for(UINT i = 0; i < nInstances; ++i)
+		starts[i] = MathHelper::RandomF(0.0f, fEnd);
+
+	std::vector<std::vector<XMFLOAT4X4>> palettes(nInstances, std::vector<XMFLOAT4X4>(skinned.BoneCount()));
+	std::vector<std::vector<XMFLOAT4X4>> reference(nInstances, std::vector<XMFLOAT4X4>(skinned.BoneCount()));
+	auto Step = [&](float& t)
+	{
+		t += dt;
+		if(t > fEnd)
+			t = fmodf(t, fEnd);
+	};
+
+	std::vector<float> times = starts;
+	double fBegin = GetMilliseconds();
+	for(UINT f = 0; f < nFrames; ++f)
+	{
+		for(UINT i = 0; i < nInstances; ++i)
+		{
+			Step(times[i]);
+			skinned.GetFinalTransforms(clipName, times[i], reference[i]);
+		}
+	}
+	double fDirect = (GetMilliseconds() - fBegin) / nFrames;
+
+	Animation::PoseCache cache;
+	cache.SetTimeQuantum(fQuantum);
+	times = starts;
+
+	fBegin = GetMilliseconds();
+	for(UINT f = 0; f < nFrames; ++f)
+	{
+		cache.BeginFrame();
+		for(UINT i = 0; i < nInstances; ++i)
+		{
+			Step(times[i]);
+			const std::vector<XMFLOAT4X4>& pose = cache.GetFinalTransforms(skinned, clipName, times[i]);
+			palettes[i].assign(pose.begin(), pose.end());
+		}
+	}
+	double fCached = (GetMilliseconds() - fBegin) / nFrames;
+
+	// 最后一帧的结果与逐实例求值比较, 误差来自时间量化
+	float fDiff = 0.0f;
+	for(UINT i = 0; i < nInstances; ++i)
+		fDiff = max(fDiff, MaxDifference(reference[i], palettes[i]));
+
+	wprintf(L"%u instances, quantum %.2f ms, %u frames\n", nInstances, fQuantum * 1000.0f, nFrames);
+	wprintf(L"per instance:  %8.3f ms/frame\n", fDirect);
+	wprintf(L"pose cache:    %8.3f ms/frame (hit rate %.1f%%, %u poses/frame, max diff %g)\n", fCached,
+			cache.GetHitRate() * 100.0f, cache.GetMissCount() / nFrames, fDiff);
+
+	// 同一帧内先前返回的引用在之后的未命中(缓存扩容)后仍然有效
+	Animation::PoseCache fresh;
+	fresh.SetTimeQuantum(fQuantum);
+	fresh.BeginFrame();
+	const std::vector<XMFLOAT4X4>& first = fresh.GetFinalTransforms(skinned, clipName, 0.0f);
+	const std::vector<XMFLOAT4X4>& second = fresh.GetFinalTransforms(skinned, clipName, fEnd * 0.5f);
+	std::vector<XMFLOAT4X4> firstCopy = first, secondCopy = second;
+	const XMFLOAT4X4* pFirst = first.data();
+	for(UINT i = 1; i <= 256; ++i)
+		fresh.GetFinalTransforms(skinned, clipName, fEnd * i / 257.0f);
+	bool bStable = &fresh.GetFinalTransforms(skinned, clipName, 0.0f) == &first && first.data() == pFirst &&
+				   MaxDifference(first, firstCopy) == 0.0f && MaxDifference(second, secondCopy) == 0.0f;
+	wprintf(L"references across %u misses: %ls\n", fresh.GetMissCount(), bStable? L"stable": L"INVALIDATED");
+	return bStable? 0: 1;
+}
+
+// 与着色器相同的方式用调色板蒙皮一个顶点
+static XMVECTOR SkinPosition(const M3dLoader::M3dSkinnedVertex& v, const BYTE* pPalette, SkinnedPaletteFormats emFormat)
+{
+	const XMFLOAT4* pRows = (const XMFLOAT4*)pPalette;
+	float weights[4] = {v.vec4BoneWeights.x, v.vec4BoneWeights.y, v.vec4BoneWeights.z, 0.0f};
+	weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+
+	XMVECTOR P = XMVectorSetW(XMLoadFloat3(&v.vec3Position), 1.0f);
+	if(emFormat == SKINNED_PALETTE_FORMAT_DUAL_QUATERNION)
+	{
+		// 线性混合对偶四元数, 以第一根骨骼为准统一半球
+		XMVECTOR real0 = XMLoadFloat4(&pRows[v.vec4BoneIndices[0] * 2]);
+		XMVECTOR real = XMVectorZero(), dual = XMVectorZero();
+		for(UINT i = 0; i < 4; ++i)
+		{
+			XMVECTOR r = XMLoadFloat4(&pRows[v.vec4BoneIndices[i] * 2]);
+			float w = XMVectorGetX(XMVector4Dot(real0, r)) < 0.0f? -weights[i]: weights[i];
+			real = XMVectorAdd(real, XMVectorScale(r, w));
+			dual = XMVectorAdd(dual, XMVectorScale(XMLoadFloat4(&pRows[v.vec4BoneIndices[i] * 2 + 1]), w));
+		}
+		float fInvLength = 1.0f / XMVectorGetX(XMVector4Length(real));
+		real = XMVectorScale(real, fInvLength);
+		dual = XMVectorScale(dual, fInvLength);
+
+		XMVECTOR translation = XMVectorScale(XMQuaternionMultiply(XMQuaternionConjugate(real), dual), 2.0f);
+		return XMVectorAdd(XMVector3Rotate(P, real), translation);
+	}
+
+	UINT nStride = emFormat == SKINNED_PALETTE_FORMAT_3X4? 3: 4;
+	XMVECTOR result = XMVectorZero();
+	for(UINT i = 0; i < 4; ++i)
+	{
+		const XMFLOAT4* pBone = pRows + v.vec4BoneIndices[i] * nStride;
+		XMVECTOR skinned = XMVectorSet(XMVectorGetX(XMVector4Dot(XMLoadFloat4(&pBone[0]), P)),
+									   XMVectorGetX(XMVector4Dot(XMLoadFloat4(&pBone[1]), P)),
+									   XMVectorGetX(XMVector4Dot(XMLoadFloat4(&pBone[2]), P)), 0.0f);
+		result = XMVectorAdd(result, XMVectorScale(skinned, weights[i]));
+	}
+	return result;
+}
+
+static int BenchPalette(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	UINT nMaxThreads = argc > 2? _wtoi(argv[2]): std::thread::hardware_concurrency();
+	const UINT nFrames = 60;
+	const float dt = 1.0f / 60.0f;
+	const UINT nSlotByteSize = CONSTANT_VALUE::nCBSkinnedByteSize;
+
+	std::vector<UINT> counts;
+	if(argc > 1 && _wtoi(argv[1]) > 0)
+		counts.push_back(_wtoi(argv[1]));
+	else
+		counts = {1000, 10000};
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+	skinned.PackClips(60.0f);
+
+	std::string clipName = "Take1";
+	float fEnd = skinned.GetClipEndTime(clipName);
+
+	for(UINT nInstances: counts)
+	{
+		std::vector<SkinnedInstance> instances(nInstances);
+		std::vector<float> starts(nInstances);
+		for(UINT i = 0; i < nInstances; ++i)
+		{
+			starts[i] = MathHelper::RandomF(0.0f, fEnd);
+			instances[i].Skinned = &skinned;
+			instances[i].ClipName = clipName;
+			instances[i].matFinalTransforms.resize(skinned.BoneCount());
+			instances[i].nSkinnedCBIndex = nInstances - 1 - i;		// 槽位与数组顺序无关
+		}
+
+		// 模拟上传堆: 每个实例一个蒙皮常量缓冲区槽位
+		std::vector<BYTE> reference((size_t)nInstances * nSlotByteSize);
+		std::vector<BYTE> buffer((size_t)nInstances * nSlotByteSize);
+
+		wprintf(L"%u instances, %u bones, %u frames\n", nInstances, skinned.BoneCount(), nFrames);
+
+		double fSingle = 0.0;
+		for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+		{
+			// 调用线程也参与计算, 因此线程池只需 nThreads - 1 个线程
+			BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+			std::vector<BYTE>& dest = nThreads == 1? reference: buffer;
+
+			for(UINT i = 0; i < nInstances; ++i)
+			{
+				instances[i].fTimePos = starts[i];
+				instances[i].Cursor = Animation::AnimationCursor();
+			}
+
+			double fBegin = GetMilliseconds();
+			for(UINT f = 0; f < nFrames; ++f)
+				UpdateSkinnedInstances(instances.data(), nInstances, dt, dest.data(), nSlotByteSize, &pool);
+			double fTime = (GetMilliseconds() - fBegin) / nFrames;
+
+			if(nThreads == 1)
+				fSingle = fTime;
+
+			// 各线程数下的调色板必须与单线程逐字节相同
+			bool bSame = nThreads == 1 || !memcmp(reference.data(), buffer.data(), buffer.size());
+			wprintf(L"  %2u threads: %8.3f ms/frame, speedup %5.2fx, efficiency %5.1f%%%ls\n", nThreads, fTime,
+					fSingle / fTime, fSingle / fTime / nThreads * 100.0, bSame? L"": L"  MISMATCH");
+			if(!bSame)
+				return 1;
+			if(nThreads == nMaxThreads)
+				break;
+		}
+
+		// 各调色板格式: 槽位按实际骨骼数对齐到 256 字节, 误差为蒙皮后顶点与 4x4 结果的最大距离
+		const wchar_t* lpszFormats[] = {L"4x4", L"3x4", L"dual quat"};
+		BaseHelper::Thread::ThreadPool pool(nMaxThreads - 1);
+		for(UINT n = SKINNED_PALETTE_FORMAT_4X4; n <= SKINNED_PALETTE_FORMAT_DUAL_QUATERNION; ++n)
+		{
+			SkinnedPaletteFormats emFormat = (SkinnedPaletteFormats)n;
+			UINT nPaletteByteSize = GetSkinnedPaletteByteSize(skinned.BoneCount(), emFormat);
+			std::vector<BYTE> palettes((size_t)nInstances * nPaletteByteSize);
+
+			for(UINT i = 0; i < nInstances; ++i)
+				instances[i].fTimePos = starts[i];
+
+			double fBegin = GetMilliseconds();
+			for(UINT f = 0; f < nFrames; ++f)
+				UpdateSkinnedInstances(instances.data(), nInstances, dt, palettes.data(), nPaletteByteSize, &pool, emFormat);
+			double fTime = (GetMilliseconds() - fBegin) / nFrames;
+
+			float fDiff = 0.0f;
+			for(UINT i = 0; i < min(nInstances, 16u); ++i)
+			{
+				const BYTE* pPalette = &palettes[(size_t)instances[i].nSkinnedCBIndex * nPaletteByteSize];
+				for(const M3dLoader::M3dSkinnedVertex& v : vertices)
+				{
+					XMVECTOR P = SkinPosition(v, (const BYTE*)instances[i].matFinalTransforms.data(), SKINNED_PALETTE_FORMAT_4X4);
+					XMVECTOR Q = SkinPosition(v, pPalette, emFormat);
+					fDiff = max(fDiff, XMVectorGetX(XMVector3Length(XMVectorSubtract(P, Q))));
+				}
+			}
+
+			wprintf(L"  %-9ls %5u bytes/instance (%6.2f MB/frame), %8.3f ms/frame, max vertex diff %g\n", lpszFormats[n],
+					nPaletteByteSize, nPaletteByteSize * (double)nInstances / (1024.0 * 1024.0), fTime, fDiff);
+		}
+	}
+	return 0;
+}
+
+static int BenchPartition(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	const SkinnedPaletteFormats emFormat = SKINNED_PALETTE_FORMAT_3X4;
+
+	std::vector<UINT> sizes;
+	if(argc > 1 && _wtoi(argv[1]) > 0)
+		sizes.push_back(_wtoi(argv[1]));
+	else
+		sizes = {12, 16, 24, 32, 96};
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	std::vector<XMFLOAT4X4> finals(skinned.BoneCount());
+	skinned.GetFinalTransforms("Take1", skinned.GetClipEndTime("Take1") * 0.5f, finals);
+
+	// 未分区时每个子集一次绘制, 上传完整的调色板
+	std::vector<BYTE> full(GetSkinnedPaletteByteSize(skinned.BoneCount(), emFormat));
+	WriteSkinnedPalette(finals.data(), skinned.BoneCount(), emFormat, full.data());
+	wprintf(L"%u bones, %u subsets, %zu vertices, %zu triangles; unpartitioned %u bytes/draw\n", skinned.BoneCount(),
+			(UINT)subsets.size(), vertices.size(), indices.size() / 3, (UINT)full.size());
+
+	for(UINT nPaletteSize : sizes)
+	{
+		std::vector<M3dLoader::M3dSkinnedVertex> outVertices;
+		std::vector<UINT> outIndices;
+		std::vector<M3dLoader::M3dPaletteBatch> batches;
+
+		double fBegin = GetMilliseconds();
+		if(!M3dLoader::PartitionBonePalettes(vertices, indices, subsets, nPaletteSize, outVertices, outIndices, batches))
+		{
+			wprintf(L"  palette %3u: cannot partition\n", nPaletteSize);
+			continue;
+		}
+		double fTime = GetMilliseconds() - fBegin;
+
+		// 分区保持子集内三角形的顺序, 第 k 个分区后的索引对应原网格中子集顺序下的第 k 个索引
+		std::vector<UINT> sourceIndices;
+		for(const M3dLoader::M3dSubset& subset : subsets)
+			sourceIndices.insert(sourceIndices.end(), indices.begin() + subset.nFaceStart * 3,
+								 indices.begin() + (subset.nFaceStart + subset.nFaceCount) * 3);
+
+		UINT nMaxBones = 0, nTotalBytes = 0;
+		float fDiff = 0.0f;
+		std::vector<BYTE> local(GetSkinnedPaletteByteSize(nPaletteSize, emFormat));
+		for(const M3dLoader::M3dPaletteBatch& batch : batches)
+		{
+			nMaxBones = max(nMaxBones, (UINT)batch.Bones.size());
+			nTotalBytes += GetSkinnedPaletteByteSize((UINT)batch.Bones.size(), emFormat);
+
+			WriteSkinnedPalette(finals.data(), batch.Bones.data(), (UINT)batch.Bones.size(), emFormat, local.data());
+			for(UINT i = batch.nIndexStart; i < batch.nIndexStart + batch.nIndexCount; ++i)
+			{
+				XMVECTOR P = SkinPosition(vertices[sourceIndices[i]], full.data(), emFormat);
+				XMVECTOR Q = SkinPosition(outVertices[outIndices[i]], local.data(), emFormat);
+				fDiff = max(fDiff, XMVectorGetX(XMVector3Length(XMVectorSubtract(P, Q))));
+			}
+		}
+
+		bool bValid = outIndices.size() == indices.size() && nMaxBones <= nPaletteSize;
+		wprintf(L"  palette %3u: %3u draws (max %2u bones), %6zu vertices (+%5.1f%%), %6u bytes/frame, %7.3f ms, max vertex diff %g%ls\n",
+				nPaletteSize, (UINT)batches.size(), nMaxBones, outVertices.size(),
+				(outVertices.size() / (double)vertices.size() - 1.0) * 100.0, nTotalBytes, fTime, fDiff, bValid? L"": L"  INVALID");
+		if(!bValid)
+			return 1;
+	}
+	return 0;
+}
+
+static int BenchSkinning(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	UINT nMaxThreads = argc > 1? _wtoi(argv[1]): std::thread::hardware_concurrency();
+	const UINT nFrames = 60;
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	UINT nVertices = (UINT)vertices.size();
+	float fEnd = skinned.GetClipEndTime("Take1");
+	std::vector<XMFLOAT4X4> finals(skinned.BoneCount());
+	std::vector<M3dLoader::M3dSkinnedVertex> result(nVertices);
+	wprintf(L"%u vertices, %u bones, %u frames\n", nVertices, skinned.BoneCount(), nFrames);
+
+	// 逐骨骼变换再混合的标量写法, 与着色器逐行对应
+	skinned.GetFinalTransforms("Take1", fEnd * 0.37f, finals);
+	double fBegin = GetMilliseconds();
+	float fDiff = 0.0f;
+	for(UINT f = 0; f < nFrames; ++f)
+	{
+		for(UINT i = 0; i < nVertices; ++i)
+			XMStoreFloat3(&result[i].vec3Position, SkinPosition(vertices[i], (const BYTE*)finals.data(), SKINNED_PALETTE_FORMAT_4X4));
+	}
+	double fScalar = (GetMilliseconds() - fBegin) / nFrames;
+	std::vector<M3dLoader::M3dSkinnedVertex> reference = result;
+	wprintf(L"  per bone:   %8.3f ms/frame\n", fScalar);
+
+	for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+	{
+		BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+
+		fBegin = GetMilliseconds();
+		for(UINT f = 0; f < nFrames; ++f)
+			SkinVertices(vertices.data(), nVertices, finals.data(), result.data(), &pool);
+		double fTime = (GetMilliseconds() - fBegin) / nFrames;
+
+		fDiff = 0.0f;
+		for(UINT i = 0; i < nVertices; ++i)
+		{
+			XMVECTOR d = XMVectorSubtract(XMLoadFloat3(&result[i].vec3Position), XMLoadFloat3(&reference[i].vec3Position));
+			fDiff = max(fDiff, XMVectorGetX(XMVector3Length(d)));
+		}
+
+		wprintf(L"  %2u threads: %8.3f ms/frame, speedup %5.2fx vs per bone, max position diff %g\n", nThreads, fTime,
+				fScalar / fTime, fDiff);
+		if(fDiff > 1e-3f)
+			return 1;
+		if(nThreads == nMaxThreads)
+			break;
+	}
+
+	// 包围盒: 逐帧检查所有蒙皮后的顶点都在包围盒内, 并与精确的包围盒比较体积
+	SkinnedBounds bounds;
+	bounds.Build(vertices.data(), nVertices);
+
+	BoundingBox bindBox;
+	BoundingBox::CreateFromPoints(bindBox, nVertices, &vertices[0].vec3Position, sizeof(M3dLoader::M3dSkinnedVertex));
+
+	const UINT nSamples = 100;
+	UINT nOutside = 0, nStaticOutside = 0;
+	double fVolumeRatio = 0.0, fBoundsTime = 0.0;
+	for(UINT n = 0; n < nSamples; ++n)
+	{
+		skinned.GetFinalTransforms("Take1", fEnd * n / nSamples, finals);
+		SkinVertices(vertices.data(), nVertices, finals.data(), result.data());
+
+		BoundingBox box;
+		fBegin = GetMilliseconds();
+		bounds.Transform(finals.data(), box);
+		fBoundsTime += GetMilliseconds() - fBegin;
+
+		BoundingBox exact;
+		BoundingBox::CreateFromPoints(exact, nVertices, &result[0].vec3Position, sizeof(M3dLoader::M3dSkinnedVertex));
+
+		// 留出浮点误差
+		BoundingBox inflated = box;
+		inflated.Extents.x += 1e-3f;
+		inflated.Extents.y += 1e-3f;
+		inflated.Extents.z += 1e-3f;
+		for(UINT i = 0; i < nVertices; ++i)
+		{
+			XMVECTOR P = XMLoadFloat3(&result[i].vec3Position);
+			if(inflated.Contains(P) == DISJOINT)
+				++nOutside;
+			if(bindBox.Contains(P) == DISJOINT)
+				++nStaticOutside;
+		}
+
+		fVolumeRatio += (double)box.Extents.x * box.Extents.y * box.Extents.z / ((double)exact.Extents.x * exact.Extents.y * exact.Extents.z);
+	}
+
+	wprintf(L"  bounds:     %8.4f ms/update (%zu bone boxes), volume %.2fx exact, %u vertices outside%ls\n",
+			fBoundsTime / nSamples, bounds.Bones.size(), fVolumeRatio / nSamples, nOutside, nOutside? L"  INVALID": L"");
+	wprintf(L"  bind pose box misses %.2f%% of animated vertices\n", nStaticOutside * 100.0 / ((double)nVertices * nSamples));
+	return nOutside? 1: 0;
+}
+
+static int BenchAnimationLod(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/soldier.m3d";
+	UINT nInstances = argc > 1 && _wtoi(argv[1]) > 0? _wtoi(argv[1]): 1024;
+	const UINT nFrames = 240;
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<M3dLoader::M3dSkinnedVertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<M3dLoader::M3dSubset> subsets;
+	std::vector<M3dLoader::M3dMaterial> materials;
+	Animation::SkinnedAnimation skinned;
+
+	if(!M3dLoader::LoadM3dFile(lpszModel, vertices, indices, subsets, materials, skinned))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+	skinned.PackClips(60.0f);
+
+	SkinnedBounds bounds;
+	bounds.Build(vertices.data(), (UINT)vertices.size());
+
+	// 摄像机位于原点看向 +z; 实例铺成 32 列的方阵, 一半在摄像机后方
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 2.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+
+	float fEnd = skinned.GetClipEndTime("Take1");
+	const float fScale = 0.05f;
+	UINT nSlotByteSize = GetSkinnedPaletteByteSize(skinned.BoneCount(), SKINNED_PALETTE_FORMAT_3X4);
+	std::vector<BYTE> palettes((size_t)nInstances * nSlotByteSize);
+	BaseHelper::Thread::ThreadPool pool(0);
+
+	std::vector<float> starts(nInstances);
+	std::vector<XMMATRIX> worlds(nInstances);
+	for(UINT i = 0; i < nInstances; ++i)
+	{
+		starts[i] = MathHelper::RandomF(0.0f, fEnd);
+		float x = ((i % 32) - 15.5f) * 3.0f;
+		float z = ((float)(i / 32) - nInstances / 64.0f) * 6.0f;
+		worlds[i] = XMMatrixScaling(fScale, fScale, fScale) * XMMatrixTranslation(x, 0.0f, z);
+	}
+
+	auto Create = [&](std::vector<SkinnedInstance>& instances)
+	{
+		instances.resize(nInstances);
+		for(UINT i = 0; i < nInstances; ++i)
+		{
+			instances[i].Skinned = &skinned;
+			instances[i].PlayClip("Take1", starts[i]);
+			instances[i].pBounds = &bounds;
+			instances[i].nSkinnedCBIndex = i;
+		}
+	};
+
+	// 采样部分顶点, 与实例当前时刻精确求值的姿势比较模型空间中的最大距离
+	std::vector<XMFLOAT4X4> exact(skinned.BoneCount());
+	auto PoseError = [&](const SkinnedInstance& instance)
+	{
+		skinned.GetFinalTransforms(instance.Clip, instance.fTimePos, exact.data());
+
+		float fDiff = 0.0f;
+		for(UINT v = 0; v < vertices.size(); v += 64)
+		{
+			XMVECTOR P = SkinPosition(vertices[v], (const BYTE*)instance.matFinalTransforms.data(), SKINNED_PALETTE_FORMAT_4X4);
+			XMVECTOR Q = SkinPosition(vertices[v], (const BYTE*)exact.data(), SKINNED_PALETTE_FORMAT_4X4);
+			fDiff = max(fDiff, XMVectorGetX(XMVector3Length(P - Q)));
+		}
+		return fDiff;
+	};
+
+	const wchar_t* lpszModes[] = {L"full rate", L"lod, hold", L"lod, interpolate"};
+	double fFullTime = 0.0;
+	wprintf(L"%u instances, %u frames\n", nInstances, nFrames);
+	for(UINT nMode = 0; nMode < 3; ++nMode)
+	{
+		std::vector<SkinnedInstance> instances;
+		Create(instances);
+
+		AnimationLodScheduler scheduler;
+		scheduler.bInterpolate = nMode == 2;
+		for(UINT i = 0; i < nInstances; ++i)
+			scheduler.Add(&instances[i], worlds[i]);
+
+		UINT nMinDue = (UINT)-1, nMaxDue = 0, nTotalDue = 0;
+		float fVisibleError = 0.0f;
+		double fTime = 0.0;
+		for(UINT f = 0; f < nFrames; ++f)
+		{
+			double fBegin = GetMilliseconds();
+			if(nMode)
+				scheduler.Schedule(camera);
+			UpdateSkinnedInstances(instances.data(), nInstances, dt, palettes.data(), nSlotByteSize, &pool, SKINNED_PALETTE_FORMAT_3X4);
+			fTime += GetMilliseconds() - fBegin;
+
+			UINT nDue = nMode? scheduler.GetDueCount(): nInstances;
+			nMinDue = min(nMinDue, nDue);
+			nMaxDue = max(nMaxDue, nDue);
+			nTotalDue += nDue;
+
+			// 跳过前 8 帧, 使所有实例都已进入各自的级别
+			if(nMode && f >= 8 && f % 5 == 0)
+			{
+				for(UINT i = 0; i < nInstances; i += 7)
+				{
+					if(scheduler.GetLevel(i) <= MAX_ANIMATION_LOD_LEVEL)
+						fVisibleError = max(fVisibleError, PoseError(instances[i]));
+				}
+			}
+		}
+		fTime /= nFrames;
+		if(!nMode)
+			fFullTime = fTime;
+
+		UINT nLevels[MAX_ANIMATION_LOD_LEVEL + 2] = {};
+		for(UINT i = 0; i < nInstances && nMode; ++i)
+			++nLevels[scheduler.GetLevel(i)];
+
+		wprintf(L"  %-16ls %8.3f ms/frame (%5.2fx), evaluations/frame min %4u avg %6.1f max %4u", lpszModes[nMode], fTime,
+				fFullTime / fTime, nMinDue, nTotalDue / (double)nFrames, nMaxDue);
+		if(nMode)
+			wprintf(L", levels %u/%u/%u/%u, invisible %u, max visible error %g", nLevels[0], nLevels[1], nLevels[2], nLevels[3],
+					nLevels[MAX_ANIMATION_LOD_LEVEL + 1], fVisibleError);
+		wprintf(L"\n");
+	}
+	return 0;
+}
+
+static float MaxMatrixDifference(const XMFLOAT4X4& a, FXMMATRIX b)
+{
+	XMFLOAT4X4 B;
+	XMStoreFloat4x4(&B, b);
+
+	float fDiff = 0.0f;
+	for(UINT r = 0; r < 4; ++r)
+		for(UINT c = 0; c < 4; ++c)
+			fDiff = max(fDiff, fabsf(a(r, c) - B(r, c)));
+	return fDiff;
+}
+
+static int BenchCamera(int argc, wchar_t** argv)
+{
+	UINT nCameras = argc > 0 && _wtoi(argv[0]) > 0? _wtoi(argv[0]): 4096;
+	const UINT nPoints = 256;
+
+	// 随机位置与朝向的摄像机, 远平面取得较远以放大一般求逆的误差
+	std::vector<Camera> cameras(nCameras);
+	for(auto& camera: cameras)
+	{
+		camera.SetLens(MathHelper::RandomF(0.2f, 0.5f) * XM_PI, MathHelper::RandomF(1.0f, 2.4f), MathHelper::RandomF(0.05f, 1.0f),
+					   MathHelper::RandomF(100.0f, 5000.0f));
+		camera.SetPosition(MathHelper::RandomF(-500.0f, 500.0f), MathHelper::RandomF(-50.0f, 50.0f), MathHelper::RandomF(-500.0f, 500.0f));
+		camera.RotateY(MathHelper::RandomF(-XM_PI, XM_PI));
+		camera.Pitch(MathHelper::RandomF(-1.2f, 1.2f));
+		camera.UpdateViewMatrix();
+	}
+
+	// 原来每帧的做法: 三次一般 4x4 求逆; 视锥体另外由投影矩阵构建再变换到世界空间
+	double fBegin = GetMilliseconds();
+	XMMATRIX sink = XMMatrixIdentity();
+	for(auto& camera: cameras)
+	{
+		XMMATRIX view = camera.GetView();
+		XMMATRIX proj = camera.GetProj();
+		XMMATRIX matInvView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+		XMMATRIX matInvProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+		XMMATRIX matViewProj = XMMatrixMultiply(view, proj);
+		XMMATRIX matInvViewProj = XMMatrixInverse(&XMMatrixDeterminant(matViewProj), matViewProj);
+
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, proj);
+		frustum.Transform(frustum, matInvView);
+
+		sink.r[0] += matInvView.r[0] + matInvProj.r[1] + matInvViewProj.r[2] + XMLoadFloat3(&frustum.Origin);
+	}
+	double fGeneral = (GetMilliseconds() - fBegin) / nCameras;
+
+	// 重建缓存: 每台摄像机转动一个很小的角度后 UpdateViewMatrix
+	fBegin = GetMilliseconds();
+	for(auto& camera: cameras)
+	{
+		camera.RotateY(1e-4f);
+		camera.UpdateViewMatrix();
+	}
+	double fRebuild = (GetMilliseconds() - fBegin) / nCameras;
+
+	// 视图未改变时 UpdateViewMatrix 直接返回, 读取缓存
+	fBegin = GetMilliseconds();
+	for(auto& camera: cameras)
+	{
+		camera.UpdateViewMatrix();
+		const CameraMatrices& matrices = camera.GetMatrices();
+		sink.r[0] += XMLoadFloat4x4(&matrices.matInvView).r[0] + XMLoadFloat4x4(&matrices.matInvProj).r[1] +
+					 XMLoadFloat4x4(&matrices.matInvViewProj).r[2] + XMLoadFloat3(&matrices.WorldFrustum.Origin);
+	}
+	double fCached = (GetMilliseconds() - fBegin) / nCameras;
+
+	// 精度: 视锥体内的随机点投影到 NDC 后再用各逆矩阵还原(着色器由深度重建位置的做法), 误差相对于到摄像机的距离;
+	// 平面与 BoundingFrustum 对随机点的判断应一致
+	float fInvViewDiff = 0.0f, fInvProjDiff = 0.0f;
+	float fAnalyticError = 0.0f, fGeneralError = 0.0f;
+	UINT nMismatches = 0, nInside = 0;
+	for(auto& camera: cameras)
+	{
+		const CameraMatrices& matrices = camera.GetMatrices();
+		XMMATRIX view = camera.GetView();
+		XMMATRIX proj = camera.GetProj();
+		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+		XMMATRIX analytic = XMLoadFloat4x4(&matrices.matInvViewProj);
+		XMMATRIX general = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+		fInvViewDiff = max(fInvViewDiff, MaxMatrixDifference(matrices.matInvView, XMMatrixInverse(nullptr, view)));
+		fInvProjDiff = max(fInvProjDiff, MaxMatrixDifference(matrices.matInvProj, XMMatrixInverse(nullptr, proj)));
+
+		float fRange = camera.GetFarZ() * 0.5f;
+		XMVECTOR vEye = camera.GetPosition();
+		for(UINT i = 0; i < nPoints; ++i)
+		{
+			// 在摄像机周围取点, 落在视锥体内外的都有
+			XMVECTOR P = vEye + XMVectorSet(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange),
+											 MathHelper::RandomF(-fRange, fRange), 0.0f);
+			bool bInside = 1;
+			for(UINT k = 0; k < 6; ++k)
+				bInside &= XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&matrices.vec4FrustumPlanes[k]), P)) >= 0.0f;
+
+			nInside += bInside;
+			nMismatches += bInside != (matrices.WorldFrustum.Contains(P) != DISJOINT);
+			if(!bInside)
+				continue;
+
+			XMVECTOR ndc = XMVector3TransformCoord(P, viewProj);
+			float fDistance = XMVectorGetX(XMVector3Length(P - vEye));
+			fAnalyticError = max(fAnalyticError, XMVectorGetX(XMVector3Length(XMVector3TransformCoord(ndc, analytic) - P)) / fDistance);
+			fGeneralError = max(fGeneralError, XMVectorGetX(XMVector3Length(XMVector3TransformCoord(ndc, general) - P)) / fDistance);
+		}
+	}
+
+	// 窗口大小改变: 视图未改变时 SetLens 立即重建, 视图待更新时留给 UpdateViewMatrix
+	float fResizeDiff = 0.0f;
+	for(auto& camera: cameras)
+	{
+		camera.SetLens(camera.GetFovY(), camera.GetAspect() * 1.25f, camera.GetNearZ(), camera.GetFarZ());
+		const CameraMatrices& matrices = camera.GetMatrices();
+		fResizeDiff = max(fResizeDiff, MaxMatrixDifference(matrices.matViewProj, XMMatrixMultiply(camera.GetView(), camera.GetProj())));
+	}
+	Camera fresh;
+	fresh.SetLens(0.25f * XM_PI, 1.5f, 1.0f, 1000.0f);
+	fresh.SetPosition(3.0f, 4.0f, 5.0f);
+	fresh.UpdateViewMatrix();
+	const CameraMatrices& freshMatrices = fresh.GetMatrices();
+	fResizeDiff = max(fResizeDiff, MaxMatrixDifference(freshMatrices.matViewProj, XMMatrixMultiply(fresh.GetView(), fresh.GetProj())));
+	fResizeDiff = max(fResizeDiff, MaxMatrixDifference(freshMatrices.matInvView, XMMatrixInverse(nullptr, fresh.GetView())));
+
+	wprintf(L"%u cameras\n", nCameras);
+	wprintf(L"  general inverses + frustum %8.3f us/camera\n", fGeneral * 1000.0);
+	wprintf(L"  cache rebuild              %8.3f us/camera (%5.2fx)\n", fRebuild * 1000.0, fGeneral / fRebuild);
+	wprintf(L"  cached read                %8.3f us/camera (%5.2fx)\n", fCached * 1000.0, fGeneral / fCached);
+	wprintf(L"  max diff vs general inverse: invView %g, invProj %g\n", fInvViewDiff, fInvProjDiff);
+	wprintf(L"  NDC -> world relative error: analytic %g, general %g\n", fAnalyticError, fGeneralError);
+	wprintf(L"  frustum planes vs BoundingFrustum: %u of %u points disagree (%u inside)\n", nMismatches, nCameras * nPoints, nInside);
+	wprintf(L"  max diff after SetLens: %g\n", fResizeDiff);
+	if(fResizeDiff > 1e-3f)
+		return 1;
+	return XMVectorGetX(sink.r[0]) == 12345.0f;
+}
+
+static int BenchFrustumCulling(int argc, wchar_t** argv)
+{
+	std::vector<UINT> counts;
+	for(int i = 0; i < argc; ++i)
+		if(_wtoi(argv[i]) > 0)
+			counts.push_back(_wtoi(argv[i]));
+	if(counts.empty())
+		counts = {10000, 100000, 1000000};
+
+	// 摄像机位于原点看向 +z; 物体为单位立方体, 随机旋转与缩放后分布在摄像机周围, 约 1/16 可见.
+	// BoundingFrustum::Transform 只支持均匀缩放, 因此这里也只用均匀缩放
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	const CameraMatrices& matrices = camera.GetMatrices();
+	BoundingBox bounds(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+	for(UINT nCount: counts)
+	{
+		float fRange = 400.0f;
+		std::vector<XMFLOAT4X4> worlds(nCount);
+		for(auto& world: worlds)
+		{
+			XMVECTOR axis = XMVector3Normalize(XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), 1.0f, 0.0f));
+			float fScale = MathHelper::RandomF(0.5f, 4.0f);
+			XMMATRIX W = XMMatrixScaling(fScale, fScale, fScale) *
+						 XMMatrixRotationAxis(axis, MathHelper::RandomF(0.0f, XM_2PI)) *
+						 XMMatrixTranslation(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange));
+			XMStoreFloat4x4(&world, W);
+		}
+
+		// 原来的做法: 逐实例求逆, 把视锥体变换到局部空间后测试
+		const UINT nRepeat = max(1u, 1000000u / nCount);
+		std::vector<bool> reference(nCount);
+		UINT nReference = 0;
+		double fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nRepeat; ++r)
+		{
+			XMMATRIX invView = XMLoadFloat4x4(&matrices.matInvView);
+			nReference = 0;
+			for(UINT i = 0; i < nCount; ++i)
+			{
+				XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+				XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
+
+				BoundingFrustum localSpaceFrustum;
+				matrices.ViewFrustum.Transform(localSpaceFrustum, XMMatrixMultiply(invView, invWorld));
+				reference[i] = localSpaceFrustum.Contains(bounds) != DISJOINT;
+				nReference += reference[i];
+			}
+		}
+		double fPerInstance = (GetMilliseconds() - fBegin) / nRepeat;
+
+		FrustumCuller culler;
+		culler.Reserve(nCount);
+		fBegin = GetMilliseconds();
+		for(UINT i = 0; i < nCount; ++i)
+			culler.Add(bounds, XMLoadFloat4x4(&worlds[i]));
+		double fBuild = GetMilliseconds() - fBegin;
+
+		std::vector<UINT> visible(nCount + 3);
+		UINT nVisible = 0;
+		fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nRepeat; ++r)
+			nVisible = culler.Cull(camera, visible.data());
+		double fBatch = (GetMilliseconds() - fBegin) / nRepeat;
+
+		// 批量剔除以世界空间 AABB 测试, 可能多出一些物体, 但不应漏掉参考结果中的可见物体
+		std::vector<bool> batch(nCount);
+		for(UINT v = 0; v < nVisible; ++v)
+			batch[visible[v]] = 1;
+		UINT nMissed = 0, nExtra = 0;
+		for(UINT i = 0; i < nCount; ++i)
+		{
+			nMissed += reference[i] && !batch[i];
+			nExtra += !reference[i] && batch[i];
+		}
+
+		wprintf(L"%8u instances: per-instance %9.3f ms, batch %8.3f ms (%6.2fx, build %8.3f ms), visible %u / %u, missed %u, extra %u\n",
+				nCount, fPerInstance, fBatch, fPerInstance / fBatch, fBuild, nReference, nVisible, nMissed, nExtra);
+	}
+	return 0;
+}
+
+static float CALLBACK RayBoxCallback(void* param, UINT nObject, FXMVECTOR origin, FXMVECTOR dir, float fMaxDistance)
+{
+	const BoundingBox* pBoxes = (const BoundingBox*)param;
+	float t = 0.0f;
+	XMVECTOR unit = XMVector3Normalize(dir);
+	if(!pBoxes[nObject].Intersects(origin, unit, t))
+		return -1.0f;
+
+	// 起点在碰撞盒内时距离为 0
+	return max(t, 0.0f) / XMVectorGetX(XMVector3Length(dir));
+}
+
+static int BenchSceneBvh(int argc, wchar_t** argv)
+{
+	std::vector<UINT> counts;
+	for(int i = 0; i < argc; ++i)
+		if(_wtoi(argv[i]) > 0)
+			counts.push_back(_wtoi(argv[i]));
+	if(counts.empty())
+		counts = {10000, 100000};
+
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.3f, 0.1f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	const XMFLOAT4* pPlanes = camera.GetMatrices().vec4FrustumPlanes;
+
+	for(UINT nCount: counts)
+	{
+		// 物体为大小不一的碰撞盒, 密度与数量无关
+		float fRange = 20.0f * powf((float)nCount, 1.0f / 3.0f);
+		std::vector<BoundingBox> boxes(nCount);
+		for(auto& box: boxes)
+		{
+			box.Center = XMFLOAT3(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange));
+			box.Extents = XMFLOAT3(MathHelper::RandomF(0.5f, 4.0f), MathHelper::RandomF(0.5f, 4.0f), MathHelper::RandomF(0.5f, 4.0f));
+		}
+		wprintf(L"%u objects\n", nCount);
+
+		SceneBvh bvh;
+		double fBegin = GetMilliseconds();
+		bvh.Build(boxes.data(), NULL, nCount);
+		wprintf(L"  SAH build        %9.3f ms, cost %7.2f, height %u\n", GetMilliseconds() - fBegin, bvh.GetCost(), bvh.GetHeight());
+
+		SceneBvh incremental;
+		fBegin = GetMilliseconds();
+		for(UINT i = 0; i < nCount; ++i)
+			incremental.Insert(boxes[i], i);
+		wprintf(L"  insert           %9.3f ms, cost %7.2f, height %u\n", GetMilliseconds() - fBegin, incremental.GetCost(), incremental.GetHeight());
+
+		// 视锥体查询: 与逐个测试的线性扫描比较
+		const UINT nRepeat = max(1u, 1000000u / nCount);
+		std::vector<UINT> linear, result;
+		fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nRepeat; ++r)
+		{
+			linear.clear();
+			for(UINT i = 0; i < nCount; ++i)
+			{
+				bool bOutside = 0;
+				for(UINT p = 0; p < 6 && !bOutside; ++p)
+				{
+					XMVECTOR plane = XMLoadFloat4(&pPlanes[p]);
+					float fDistance = XMVectorGetX(XMPlaneDotCoord(plane, XMLoadFloat3(&boxes[i].Center)));
+					float fRadius = XMVectorGetX(XMVector3Dot(XMVectorAbs(plane), XMLoadFloat3(&boxes[i].Extents)));
+					bOutside = fDistance + fRadius < 0.0f;
+				}
+				if(!bOutside)
+					linear.push_back(i);
+			}
+		}
+		double fLinear = (GetMilliseconds() - fBegin) / nRepeat;
+
+		fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nRepeat; ++r)
+			bvh.QueryFrustum(camera, result);
+		double fQuery = (GetMilliseconds() - fBegin) / nRepeat;
+		std::sort(result.begin(), result.end());
+		wprintf(L"  frustum          linear %8.3f ms, bvh %8.3f ms (%6.2fx), visible %u, %ls\n", fLinear, fQuery, fLinear / fQuery,
+				(UINT)result.size(), result == linear ? L"match" : L"MISMATCH");
+
+		// 射线: 求最近命中的碰撞盒
+		const UINT nRays = 10000;
+		std::vector<XMFLOAT3> origins(nRays), dirs(nRays);
+		for(UINT i = 0; i < nRays; ++i)
+		{
+			origins[i] = XMFLOAT3(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange));
+			XMStoreFloat3(&dirs[i], XMVector3Normalize(XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), 0.0f)));
+		}
+		const UINT nLinearRays = min(nRays, 20000000u / nCount);
+		UINT nMismatch = 0;
+		std::vector<UINT> nearest(nRays);
+		fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nLinearRays; ++r)
+		{
+			float fBest = FLT_MAX;
+			nearest[r] = BVH_NULL_NODE;
+			for(UINT i = 0; i < nCount; ++i)
+			{
+				float t;
+				if(boxes[i].Intersects(XMLoadFloat3(&origins[r]), XMLoadFloat3(&dirs[r]), t) && max(t, 0.0f) < fBest)
+				{
+					fBest = max(t, 0.0f);
+					nearest[r] = i;
+				}
+			}
+		}
+		double fLinearRay = (GetMilliseconds() - fBegin) / nLinearRays;
+
+		fBegin = GetMilliseconds();
+		for(UINT r = 0; r < nRays; ++r)
+		{
+			UINT nHit = bvh.Raycast(XMLoadFloat3(&origins[r]), XMLoadFloat3(&dirs[r]), FLT_MAX, RayBoxCallback, boxes.data());
+			nMismatch += r < nLinearRays && nHit != nearest[r];
+		}
+		double fBvhRay = (GetMilliseconds() - fBegin) / nRays;
+		wprintf(L"  raycast          linear %8.3f us, bvh %8.3f us (%6.2fx), mismatches %u of %u\n", fLinearRay * 1000.0, fBvhRay * 1000.0,
+				fLinearRay / fBvhRay, nMismatch, nLinearRays);
+
+		// 动态更新: 每帧 10% 的物体随机漂移, 比较只 refit, refit 加旋转与每帧重建
+		const UINT nFrames = 60;
+		std::vector<XMFLOAT3> velocities(nCount);
+		for(auto& v: velocities)
+			v = XMFLOAT3(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f));
+
+		const wchar_t* lpszModes[] = {L"refit", L"refit + rotate", L"rebuild"};
+		for(UINT nMode = 0; nMode < 3; ++nMode)
+		{
+			std::vector<BoundingBox> moving = boxes;
+			SceneBvh dynamic;
+			dynamic.bRotate = nMode == 1;
+			dynamic.Build(moving.data(), NULL, nCount);
+
+			double fTime = 0.0;
+			for(UINT f = 0; f < nFrames; ++f)
+			{
+				for(UINT i = f % 10; i < nCount; i += 10)
+				{
+					moving[i].Center.x += velocities[i].x;
+					moving[i].Center.y += velocities[i].y;
+					moving[i].Center.z += velocities[i].z;
+				}
+
+				fBegin = GetMilliseconds();
+				if(nMode == 2)
+					dynamic.Build(moving.data(), NULL, nCount);
+				else
+				{
+					for(UINT i = f % 10; i < nCount; i += 10)
+						dynamic.Update(i, moving[i]);
+					dynamic.Refit();
+				}
+				fTime += GetMilliseconds() - fBegin;
+			}
+
+			fBegin = GetMilliseconds();
+			for(UINT r = 0; r < nRepeat; ++r)
+				dynamic.QueryFrustum(camera, result);
+			double fDynamicQuery = (GetMilliseconds() - fBegin) / nRepeat;
+			wprintf(L"  %-16ls %9.3f ms/frame, cost after %u frames %7.2f, frustum query %8.3f ms\n", lpszModes[nMode], fTime / nFrames,
+					nFrames, dynamic.GetCost(), fDynamicQuery);
+		}
+	}
+	return 0;
+}
+
+// 逐个三角形求最近交点, 作为 TriangleBvh 的参照
+static bool RayTrianglesLinear(const TextModelLoader::TextModel& model, const std::vector<UINT>& indices, FXMVECTOR origin, FXMVECTOR dir,
+							   float fMaxDistance, TriangleHit& hit)
+{
+	bool bHit = 0;
+	for(UINT i = 0; i + 2 < indices.size(); i += 3)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&model.Vertices[indices[i]].vec3Position);
+		XMVECTOR e1 = XMLoadFloat3(&model.Vertices[indices[i + 1]].vec3Position) - v0;
+		XMVECTOR e2 = XMLoadFloat3(&model.Vertices[indices[i + 2]].vec3Position) - v0;
+
+		XMVECTOR p = XMVector3Cross(dir, e2);
+		float fDet = XMVectorGetX(XMVector3Dot(e1, p));
+		if(fabsf(fDet) <= 1e-20f)
+			continue;
+
+		XMVECTOR t = origin - v0;
+		float u = XMVectorGetX(XMVector3Dot(t, p)) / fDet;
+		XMVECTOR q = XMVector3Cross(t, e1);
+		float v = XMVectorGetX(XMVector3Dot(dir, q)) / fDet;
+		float fDistance = XMVectorGetX(XMVector3Dot(e2, q)) / fDet;
+		if(u >= 0.0f && v >= 0.0f && u + v <= 1.0f && fDistance >= 0.0f && fDistance < fMaxDistance)
+		{
+			fMaxDistance = fDistance;
+			hit.fDistance = fDistance;
+			hit.nTriangle = i / 3;
+			hit.fU = u;
+			hit.fV = v;
+			bHit = 1;
+		}
+	}
+	return bHit;
+}
+
+static int BenchTriangleBvh(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/skull.txt";
+	UINT nRays = argc > 1? _wtoi(argv[1]): 2000;
+
+	TextModelLoader::TextModel model;
+	if(!TextModelLoader::LoadTextModel(lpszModel, model))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	std::vector<UINT> indices;
+	model.GetIndices(indices);
+	std::vector<UINT16> indices16(indices.begin(), indices.end());
+	bool bHas16 = model.Vertices.size() <= 0xffff;
+	wprintf(L"%ls: %zu vertices, %zu triangles\n", lpszModel, model.Vertices.size(), indices.size() / 3);
+
+	// 16 位与 32 位索引应得到相同的树
+	TriangleBvh bvh, bvh16;
+	double fBegin = GetMilliseconds();
+	bvh.Build(model.Vertices.data(), sizeof(TextModelLoader::TextModelVertex), indices.data(), DXGI_FORMAT_R32_UINT, 0, (UINT)indices.size());
+	double fBuild = GetMilliseconds() - fBegin;
+	if(bHas16)
+		bvh16.Build(model.Vertices.data(), sizeof(TextModelLoader::TextModelVertex), indices16.data(), DXGI_FORMAT_R16_UINT, 0, (UINT)indices16.size());
+	wprintf(L"  build %8.3f ms, %u nodes\n", fBuild, bvh.GetNodeCount());
+
+	// 射线起点位于包围球外, 一半指向模型内部的随机点, 一半随机方向
+	BoundingBox bounds = bvh.GetBounds();
+	XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	float fRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+	std::vector<XMFLOAT3> origins(nRays), dirs(nRays);
+	for(UINT i = 0; i < nRays; ++i)
+	{
+		XMVECTOR origin = center + 2.0f * fRadius * XMVector3Normalize(XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f),
+																				   MathHelper::RandomF(-1.0f, 1.0f), 0.0f));
+		XMVECTOR target = center + XMLoadFloat3(&bounds.Extents) * XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f),
+																				MathHelper::RandomF(-1.0f, 1.0f), 0.0f);
+		XMVECTOR dir = i & 1? XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), 0.0f):
+							  target - origin;
+		XMStoreFloat3(&origins[i], origin);
+		XMStoreFloat3(&dirs[i], dir);
+	}
+
+	std::vector<TriangleHit> linear(nRays), hits(nRays);
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRays; ++i)
+		RayTrianglesLinear(model, indices, XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), FLT_MAX, linear[i]);
+	double fLinear = (GetMilliseconds() - fBegin) / nRays;
+
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRays; ++i)
+		bvh.Intersects(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), FLT_MAX, hits[i]);
+	double fBvh = (GetMilliseconds() - fBegin) / nRays;
+
+	UINT nOccluded = 0;
+	fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nRays; ++i)
+		nOccluded += bvh.Occluded(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), FLT_MAX);
+	double fOccluded = (GetMilliseconds() - fBegin) / nRays;
+
+	// 三角形不同但距离相同(共享边)不算错误
+	UINT nHits = 0, nMismatches = 0, n16Mismatches = 0, nOccludedMismatches = 0;
+	float fMaxDiff = 0.0f;
+	for(UINT i = 0; i < nRays; ++i)
+	{
+		bool bLinear = linear[i].nTriangle != (UINT)-1, bBvh = hits[i].nTriangle != (UINT)-1;
+		nHits += bLinear;
+		nOccludedMismatches += bLinear != bvh.Occluded(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), FLT_MAX);
+		if(bLinear != bBvh)
+		{
+			++nMismatches;
+			continue;
+		}
+		if(!bLinear)
+			continue;
+
+		float fDiff = fabsf(linear[i].fDistance - hits[i].fDistance) / max(linear[i].fDistance, 1e-6f);
+		fMaxDiff = max(fMaxDiff, fDiff);
+		nMismatches += linear[i].nTriangle != hits[i].nTriangle && fDiff > 1e-5f;
+
+		if(bHas16)
+		{
+			TriangleHit hit16;
+			bvh16.Intersects(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), FLT_MAX, hit16);
+			n16Mismatches += hit16.nTriangle != hits[i].nTriangle || hit16.fDistance != hits[i].fDistance;
+		}
+	}
+
+	wprintf(L"  %u rays, %u hits\n", nRays, nHits);
+	wprintf(L"  closest hit  linear %9.3f us, bvh %8.3f us (%7.2fx), mismatches %u, max relative distance diff %g\n", fLinear * 1000.0,
+			fBvh * 1000.0, fLinear / fBvh, nMismatches, fMaxDiff);
+	wprintf(L"  any hit      bvh %8.3f us, %u occluded, mismatches %u\n", fOccluded * 1000.0, nOccluded, nOccludedMismatches);
+	if(bHas16)
+		wprintf(L"  16-bit indices: %u mismatches vs 32-bit\n", n16Mismatches);
+	return 0;
+}
+
+// 由文本模型创建只含 CPU 副本的几何体
+static bool LoadRayQueryMesh(LPCWSTR lpszModel, Resource::MeshGeometry& geo)
+{
+	TextModelLoader::TextModel model;
+	if(!TextModelLoader::LoadTextModel(lpszModel, model))
+		return 0;
+
+	std::vector<UINT> indices;
+	model.GetIndices(indices);
+
+	geo.nVertexByteStride = sizeof(TextModelLoader::TextModelVertex);
+	geo.nVertexBufferByteSize = (UINT)(model.Vertices.size() * sizeof(TextModelLoader::TextModelVertex));
+	geo.nIndexBufferByteSize = (UINT)(indices.size() * sizeof(UINT));
+	geo.emIndexFormat = DXGI_FORMAT_R32_UINT;
+	D3DCreateBlob(geo.nVertexBufferByteSize, &geo.pCPUVertexBuffer);
+	D3DCreateBlob(geo.nIndexBufferByteSize, &geo.pCPUIndexBuffer);
+	memcpy(geo.pCPUVertexBuffer->GetBufferPointer(), model.Vertices.data(), geo.nVertexBufferByteSize);
+	memcpy(geo.pCPUIndexBuffer->GetBufferPointer(), indices.data(), geo.nIndexBufferByteSize);
+
+	Resource::SubmeshGeometry main;
+	main.nIndexCount = (UINT)indices.size();
+	main.nStartIndexLocation = 0;
+	main.nBaseVertexLocation = 0;
+	geo.DrawArgs["main"] = main;
+	return 1;
+}
+
+static int BenchRayQuery(int argc, wchar_t** argv)
+{
+	UINT nInstances = argc > 0? _wtoi(argv[0]): 1000;
+	UINT nSide = argc > 1? _wtoi(argv[1]): 256;
+	UINT nMaxThreads = argc > 2? _wtoi(argv[2]): std::thread::hardware_concurrency();
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	Resource::MeshGeometry geos[2];
+	LPCWSTR lpszModels[] = {L"../Models/skull.txt", L"../Models/car.txt"};
+	for(UINT i = 0; i < 2; ++i)
+	{
+		if(!LoadRayQueryMesh(lpszModels[i], geos[i]))
+		{
+			wprintf(L"cannot load %ls\n", lpszModels[i]);
+			return 1;
+		}
+	}
+
+	// 实例随机旋转, 缩放与平移, 分布密度与数量无关
+	SceneRayQuery query;
+	std::vector<XMFLOAT4X4> worlds(nInstances);
+	float fRange = 15.0f * powf((float)nInstances, 1.0f / 3.0f);
+	double fBegin = GetMilliseconds();
+	for(UINT i = 0; i < nInstances; ++i)
+	{
+		XMMATRIX W = XMMatrixScaling(0.3f, 0.3f, 0.3f) * XMMatrixScaling(MathHelper::RandomF(0.5f, 1.5f), MathHelper::RandomF(0.5f, 1.5f), 1.0f) *
+					 XMMatrixRotationX(MathHelper::RandomF(0.0f, XM_2PI)) * XMMatrixRotationY(MathHelper::RandomF(0.0f, XM_2PI)) *
+					 XMMatrixTranslation(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange));
+		XMStoreFloat4x4(&worlds[i], W);
+		Resource::MeshGeometry& geo = geos[i & 1];
+		query.AddInstance(geo, geo.DrawArgs["main"], worlds[i], i);
+	}
+	query.Commit();
+	wprintf(L"%u instances of %u meshes, setup %8.3f ms\n", query.GetInstanceCount(), query.GetMeshCount(), GetMilliseconds() - fBegin);
+
+	// 相机射线按 2x2 像素分组, 相邻 4 条射线方向一致; 随机射线作为不相干的对照
+	UINT nRays = nSide * nSide;
+	std::vector<SceneRay> cameraRays(nRays), randomRays(nRays);
+	XMVECTOR eye = XMVectorSet(0.0f, 0.0f, -2.0f * fRange, 1.0f);
+	for(UINT i = 0; i < nRays; ++i)
+	{
+		UINT nQuad = i / 4, k = i % 4;
+		UINT x = 2 * (nQuad % (nSide / 2)) + (k & 1), y = 2 * (nQuad / (nSide / 2)) + (k >> 1);
+		XMVECTOR dir = XMVectorSet((2.0f * x / nSide - 1.0f) * 0.5f, (1.0f - 2.0f * y / nSide) * 0.5f, 1.0f, 0.0f);
+		XMStoreFloat3(&cameraRays[i].vec3Origin, eye);
+		XMStoreFloat3(&cameraRays[i].vec3Direction, dir);
+
+		randomRays[i].vec3Origin = XMFLOAT3(MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange), MathHelper::RandomF(-fRange, fRange));
+		randomRays[i].vec3Direction = XMFLOAT3(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f));
+		randomRays[i].fMaxDistance = 0.5f * fRange;
+	}
+
+	const wchar_t* lpszSets[] = {L"camera", L"random"};
+	std::vector<SceneRay>* pSets[] = {&cameraRays, &randomRays};
+	for(UINT nSet = 0; nSet < 2; ++nSet)
+	{
+		const std::vector<SceneRay>& rays = *pSets[nSet];
+		wprintf(L"  %ls rays: %u\n", lpszSets[nSet], nRays);
+
+		// 参照: 逐条射线遍历顶层, 与底层的正确性已由 tribvh 验证
+		std::vector<SceneRayHit> reference(nRays), hits(nRays);
+		fBegin = GetMilliseconds();
+		for(UINT i = 0; i < nRays; ++i)
+			query.Trace(rays[i], reference[i]);
+		double fSingle = GetMilliseconds() - fBegin;
+		UINT nHits = 0;
+		for(auto& hit: reference)
+			nHits += hit.nUserData != BVH_NULL_NODE;
+		wprintf(L"    single ray        %9.3f ms (%7.3f Mrays/s), %u hits\n", fSingle, nRays / fSingle / 1000.0, nHits);
+
+		// 少量射线与逐实例暴力求交比较
+		TriangleBvh meshes[2];
+		for(UINT n = 0; n < 2; ++n)
+			meshes[n].Build(geos[n], &geos[n].DrawArgs["main"]);
+
+		UINT nCheck = min(nRays, 256u), nBruteMismatches = 0;
+		for(UINT i = 0; i < nRays; i += nRays / nCheck)
+		{
+			SceneRayHit brute;
+			for(UINT n = 0; n < nInstances; ++n)
+			{
+				XMMATRIX W = XMLoadFloat4x4(&worlds[n]);
+				XMMATRIX invWorld = XMMatrixInverse(NULL, W);
+
+				TriangleHit hit;
+				float fMax = min(brute.fDistance, rays[i].fMaxDistance);
+				if(meshes[n & 1].Intersects(XMVector3TransformCoord(XMLoadFloat3(&rays[i].vec3Origin), invWorld),
+											XMVector3TransformNormal(XMLoadFloat3(&rays[i].vec3Direction), invWorld), fMax, hit))
+				{
+					brute.fDistance = hit.fDistance;
+					brute.nUserData = n;
+					brute.nTriangle = hit.nTriangle;
+				}
+			}
+			nBruteMismatches += brute.nUserData != reference[i].nUserData || brute.nTriangle != reference[i].nTriangle;
+		}
+
+		for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+		{
+			BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+			for(UINT nPackets = 0; nPackets < 2; ++nPackets)
+			{
+				query.bPackets = nPackets;
+				fBegin = GetMilliseconds();
+				query.Trace(rays.data(), hits.data(), nRays, &pool);
+				double fTime = GetMilliseconds() - fBegin;
+
+				UINT nMismatches = 0;
+				for(UINT i = 0; i < nRays; ++i)
+					nMismatches += hits[i].nUserData != reference[i].nUserData || hits[i].nTriangle != reference[i].nTriangle ||
+								   fabsf(hits[i].fDistance - reference[i].fDistance) > 1e-4f * reference[i].fDistance;
+				wprintf(L"    %2u threads %-7ls %9.3f ms (%7.3f Mrays/s, %5.2fx), mismatches %u\n", nThreads, nPackets? L"packet": L"single",
+						fTime, nRays / fTime / 1000.0, fSingle / fTime, nMismatches);
+			}
+			if(nThreads == nMaxThreads)
+				break;
+		}
+		wprintf(L"    brute force check: %u of %u rays mismatch\n", nBruteMismatches, nCheck);
+	}
+	query.bPackets = 1;
+	return 0;
+}
+
+static int BenchAmbientOcclusion(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/skull.txt";
+	UINT nRayCount = argc > 1? _wtoi(argv[1]): 64;
+	UINT nMaxThreads = argc > 2? _wtoi(argv[2]): std::thread::hardware_concurrency();
+	LPCWSTR lpszCache = argc > 3? argv[3]: L"./Cache";
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	TextModelLoader::TextModel model;
+	if(!TextModelLoader::LoadTextModel(lpszModel, model))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	const TextModelLoader::TextModelVertex* pVertices = model.Vertices.data();
+	UINT nVertexCount = (UINT)model.Vertices.size();
+	UINT nStride = sizeof(TextModelLoader::TextModelVertex), nNormalOffset = offsetof(TextModelLoader::TextModelVertex, vec3Normal);
+	wprintf(L"%ls: %u vertices, %u triangles, %u rays per vertex\n", lpszModel, nVertexCount, model.GetIndexCount() / 3, nRayCount);
+
+	double fBegin = GetMilliseconds();
+	TriangleBvh bvh;
+	bvh.Build(pVertices, nStride, model.GetIndexData(), model.emIndexFormat, 0, model.GetIndexCount());
+	wprintf(L"  bvh build  %9.3f ms\n", GetMilliseconds() - fBegin);
+
+	Geometry::AmbientOcclusionDesc desc;
+	desc.nRayCount = nRayCount;
+
+	// 各线程数的结果必须逐位相同
+	std::vector<float> reference(nVertexCount), access(nVertexCount);
+	double fSingle = 0.0;
+	for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+	{
+		BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+		std::vector<float>& out = nThreads == 1? reference: access;
+		fBegin = GetMilliseconds();
+		Geometry::AmbientOcclusionBaker::BakeVertices(bvh, pVertices, nVertexCount, nStride, nNormalOffset, desc, out.data(), &pool);
+		double fTime = GetMilliseconds() - fBegin;
+		if(nThreads == 1)
+			fSingle = fTime;
+
+		bool bSame = nThreads == 1 || !memcmp(reference.data(), access.data(), access.size() * sizeof(float));
+		wprintf(L"  %2u threads %9.3f ms (%6.2f Mrays/s, speedup %5.2fx)%ls\n", nThreads, fTime,
+				(double)nVertexCount * nRayCount / fTime / 1000.0, fSingle / fTime, bSame? L"": L"  MISMATCH");
+		if(!bSame)
+			return 1;
+		if(nThreads == nMaxThreads)
+			break;
+	}
+
+	double fMean = 0.0;
+	UINT nOpen = 0, nClosed = 0;
+	for(float f: reference)
+	{
+		fMean += f;
+		nOpen += f == 1.0f;
+		nClosed += f == 0.0f;
+	}
+	wprintf(L"  access mean %.3f, %u fully open, %u fully occluded\n", fMean / nVertexCount, nOpen, nClosed);
+
+	// 与 16 倍射线数的结果比较, 估计采样噪声
+	Geometry::AmbientOcclusionDesc fine = desc;
+	fine.nRayCount = nRayCount * 16;
+	UINT nCheck = min(nVertexCount, 2048u), nStep = nVertexCount / nCheck;
+	std::vector<BYTE> subset((size_t)nCheck * nStride);
+	for(UINT i = 0; i < nCheck; ++i)
+		memcpy(&subset[(size_t)i * nStride], &pVertices[i * nStep], nStride);
+	std::vector<float> converged(nCheck);
+	Geometry::AmbientOcclusionBaker::BakeVertices(bvh, subset.data(), nCheck, nStride, nNormalOffset, fine, converged.data());
+	double fError = 0.0, fMaxError = 0.0;
+	for(UINT i = 0; i < nCheck; ++i)
+	{
+		double fDiff = fabs(reference[i * nStep] - converged[i]);
+		fError += fDiff;
+		fMaxError = max(fMaxError, fDiff);
+	}
+	wprintf(L"  vs %u rays on %u vertices: mean abs error %.4f, max %.4f\n", fine.nRayCount, nCheck, fError / nCheck, fMaxError);
+
+	// 首次写入缓存, 之后命中
+	BaseHelper::AssetCache cache(lpszCache);
+	desc.pCache = &cache;
+	for(UINT nPass = 0; nPass < 2; ++nPass)
+	{
+		std::vector<float> cached;
+		fBegin = GetMilliseconds();
+		Geometry::AmbientOcclusionBaker::BakeMesh(pVertices, nVertexCount, nStride, nNormalOffset, model.GetIndexData(), model.emIndexFormat,
+												  model.GetIndexCount(), desc, cached);
+		double fTime = GetMilliseconds() - fBegin;
+		bool bSame = !memcmp(cached.data(), reference.data(), cached.size() * sizeof(float));
+		wprintf(L"  cached bake %9.3f ms (hits %u, misses %u)%ls\n", fTime, cache.GetHitCount(), cache.GetMissCount(), bSame? L"": L"  MISMATCH");
+	}
+
+	// 键只取位置与法线: 顶点中多出的成员即使每次内容不同也应命中
+	struct PaddedVertex
+	{
+		TextModelLoader::TextModelVertex Vertex;
+		float fAmbientAccess;
+	};
+	std::vector<PaddedVertex> padded(nVertexCount);
+	for(UINT i = 0; i < nVertexCount; ++i)
+	{
+		padded[i].Vertex = pVertices[i];
+		padded[i].fAmbientAccess = (float)rand();
+	}
+	UINT nHits = cache.GetHitCount();
+	std::vector<float> cached;
+	Geometry::AmbientOcclusionBaker::BakeMesh(padded.data(), nVertexCount, sizeof(PaddedVertex), offsetof(PaddedVertex, Vertex.vec3Normal),
+											  model.GetIndexData(), model.emIndexFormat, model.GetIndexCount(), desc, cached);
+	bool bHit = cache.GetHitCount() == nHits + 1 && !memcmp(cached.data(), reference.data(), cached.size() * sizeof(float));
+	wprintf(L"  padded vertices: %ls\n", bHit? L"hit": L"MISS");
+	return bHit? 0: 1;
+}
+
+// 顶点为 (+-0.5, +-0.5, +-0.5), 第 i 个顶点的 x, y, z 取 i 的第 0, 1, 2 位; 从外侧看为顺时针
+static const UINT16 s_UnitCubeIndices[36] =
+{
+	0, 2, 3, 0, 3, 1,	5, 7, 6, 5, 6, 4,	4, 6, 2, 4, 2, 0,
+	1, 3, 7, 1, 7, 5,	1, 5, 4, 1, 4, 0,	2, 6, 7, 2, 7, 3
+};
+
+static int BenchOcclusion(int argc, wchar_t** argv)
+{
+	UINT nObjects = argc > 0? _wtoi(argv[0]): 20000;
+	UINT nMaxThreads = argc > 1? _wtoi(argv[1]): std::thread::hardware_concurrency();
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	// 街区场景: 摄像机站在街道上, 沿 +z 看向纵深; 建筑为遮挡物, 街道上散布小物体作为被遮挡物
+	const int nBlocksX = 6, nBlocksZ = 24;
+	const float fBlock = 20.0f, fBuilding = 13.0f;
+	Camera camera;
+	camera.SetLens(0.3f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.LookAt(XMFLOAT3(fBlock * 0.5f, 1.7f, -5.0f), XMFLOAT3(fBlock * 0.5f + 2.0f, 1.7f, 40.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	const CameraMatrices& matrices = camera.GetMatrices();
+
+	XMFLOAT3 cube[8];
+	for(UINT i = 0; i < 8; ++i)
+		cube[i] = XMFLOAT3((i & 1)? 0.5f: -0.5f, (i & 2)? 0.5f: -0.5f, (i & 4)? 0.5f: -0.5f);
+
+	OcclusionCuller culler;
+	culler.Resize(256, 128);
+	UINT nCube = culler.AddMesh(cube, sizeof(XMFLOAT3), 8, s_UnitCubeIndices, DXGI_FORMAT_R16_UINT, 36);
+
+	std::vector<BoundingBox> buildings;
+	for(int z = 0; z < nBlocksZ; ++z)
+		for(int x = -nBlocksX; x <= nBlocksX; ++x)
+		{
+			float fHeight = MathHelper::RandomF(8.0f, 40.0f);
+			XMFLOAT3 center(x * fBlock, fHeight * 0.5f, z * fBlock + fBlock * 0.5f);
+			buildings.push_back(BoundingBox(center, XMFLOAT3(fBuilding * 0.5f, fHeight * 0.5f, fBuilding * 0.5f)));
+
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixScaling(fBuilding, fHeight, fBuilding) * XMMatrixTranslation(center.x, center.y, center.z));
+			culler.AddOccluder(nCube, world);
+		}
+
+	std::vector<BoundingBox> objects(nObjects);
+	for(auto& object: objects)
+	{
+		for(;;)
+		{
+			float fSize = MathHelper::RandomF(0.3f, 1.5f);
+			object.Center = XMFLOAT3(MathHelper::RandomF(-nBlocksX * fBlock, nBlocksX * fBlock), fSize,
+									 MathHelper::RandomF(0.0f, nBlocksZ * fBlock));
+			object.Extents = XMFLOAT3(fSize, fSize, fSize);
+			bool bInside = 0;
+			for(auto& building: buildings)
+				bInside |= building.Intersects(object);
+			if(!bInside)
+				break;
+		}
+	}
+	wprintf(L"%zu occluders (%zu triangles), %u objects, depth buffer %ux%u\n", buildings.size(), buildings.size() * 12, nObjects,
+			culler.GetWidth(), culler.GetHeight());
+
+	// 没有遮挡物时只剩视锥体测试
+	std::vector<UINT> inFrustum(nObjects), visible(nObjects);
+	OcclusionCuller frustum;
+	frustum.Render(matrices.matViewProj);
+	UINT nInFrustum = frustum.Cull(objects.data(), nObjects, inFrustum.data());
+
+	std::vector<UINT> reference;
+	UINT nVisible = 0;
+	for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+	{
+		BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+		const UINT nFrames = 50;
+		double fRender = 0.0, fTest = 0.0;
+		for(UINT f = 0; f < nFrames; ++f)
+		{
+			double fBegin = GetMilliseconds();
+			culler.Render(matrices.matViewProj, &pool);
+			double fMiddle = GetMilliseconds();
+			nVisible = culler.Cull(objects.data(), nObjects, visible.data(), &pool);
+			fTest += GetMilliseconds() - fMiddle;
+			fRender += fMiddle - fBegin;
+		}
+
+		std::vector<UINT> result(visible.begin(), visible.begin() + nVisible);
+		if(reference.empty())
+			reference = result;
+		wprintf(L"  %2u threads: raster %8.3f ms (%u triangles), test %8.3f ms/frame%ls\n", nThreads, fRender / nFrames,
+				culler.GetRasterizedTriangleCount(), fTest / nFrames, result == reference? L"": L"  MISMATCH");
+		if(nThreads == nMaxThreads)
+			break;
+	}
+	wprintf(L"  in frustum %u, visible %u, occlusion culled %u (%.1f%% of frustum)\n", nInFrustum, nVisible, nInFrustum - nVisible,
+			(nInFrustum - nVisible) * 100.0 / max(nInFrustum, 1u));
+
+	// 参照: 在每个物体的表面上取样, 以射线检查采样点与摄像机之间是否被建筑挡住
+	SceneBvh occluders;
+	occluders.Build(buildings.data(), NULL, (UINT)buildings.size());
+	std::vector<bool> kept(nObjects);
+	for(UINT i = 0; i < nVisible; ++i)
+		kept[visible[i]] = 1;
+
+	const UINT nGrid = 6;
+	XMVECTOR eye = camera.GetPosition();
+	UINT nFalseCulled = 0, nHidden = 0;
+	for(UINT i = 0; i < nInFrustum; ++i)
+	{
+		const BoundingBox& object = objects[inFrustum[i]];
+		bool bSeen = 0;
+		for(UINT nFace = 0; nFace < 6 && !bSeen; ++nFace)
+		{
+			UINT nAxis = nFace / 2, nU = (nAxis + 1) % 3, nV = (nAxis + 2) % 3;
+			for(UINT u = 0; u < nGrid && !bSeen; ++u)
+				for(UINT v = 0; v < nGrid && !bSeen; ++v)
+				{
+					float p[3], c[3] = {object.Center.x, object.Center.y, object.Center.z};
+					float e[3] = {object.Extents.x, object.Extents.y, object.Extents.z};
+					p[nAxis] = c[nAxis] + ((nFace & 1)? e[nAxis]: -e[nAxis]);
+					p[nU] = c[nU] + e[nU] * (2.0f * u / (nGrid - 1) - 1.0f);
+					p[nV] = c[nV] + e[nV] * (2.0f * v / (nGrid - 1) - 1.0f);
+					XMVECTOR point = XMVectorSet(p[0], p[1], p[2], 1.0f);
+
+					bool bInside = 1;
+					for(UINT k = 0; k < 6; ++k)
+						bInside &= XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&matrices.vec4FrustumPlanes[k]), point)) >= 0.0f;
+					if(!bInside)
+						continue;
+
+					float fHit = 0.0f;
+					UINT nHit = occluders.Raycast(eye, XMVectorSubtract(point, eye), 1.0f, RayBoxCallback, buildings.data(), &fHit);
+					bSeen = nHit == BVH_NULL_NODE || fHit >= 0.999f;
+				}
+		}
+		nFalseCulled += bSeen && !kept[inFrustum[i]];
+		nHidden += !bSeen;
+	}
+	wprintf(L"  sampled reference: %u hidden (ideal %.1f%%), %u visible objects culled by mistake\n", nHidden,
+			nHidden * 100.0 / max(nInFrustum, 1u), nFalseCulled);
+	return 0;
+}
+
+static int BenchShadowCulling(int argc, wchar_t** argv)
+{
+	UINT nObjects = argc > 0? _wtoi(argv[0]): 100000;
+
+	// 物体散布在地面上方, 摄像机位于中央; 光源体积像第 16 章那样包围整个场景
+	const float fRange = 500.0f;
+	std::vector<BoundingBox> objects(nObjects);
+	for(auto& object: objects)
+	{
+		object.Extents = XMFLOAT3(MathHelper::RandomF(0.5f, 4.0f), MathHelper::RandomF(0.5f, 8.0f), MathHelper::RandomF(0.5f, 4.0f));
+		object.Center = XMFLOAT3(MathHelper::RandomF(-fRange, fRange), object.Extents.y, MathHelper::RandomF(-fRange, fRange));
+	}
+
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 200.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.5f, 1.5f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	const XMFLOAT4* pCameraPlanes = camera.GetMatrices().vec4FrustumPlanes;
+	XMFLOAT3 cameraCorners[8];
+	ShadowCasterVolume::GetFrustumCorners(XMLoadFloat4x4(&camera.GetMatrices().matInvViewProj), cameraCorners);
+
+	float fRadius = fRange * 1.5f;
+	XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.57735f, -0.57735f, 0.57735f, 0.0f));
+	XMMATRIX lightView = XMMatrixLookAtLH(-2.0f * fRadius * lightDir, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorZero(), lightView));
+	XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(center.x - fRadius, center.x + fRadius, center.y - fRadius, center.y + fRadius,
+														 center.z - fRadius, center.z + fRadius);
+	XMMATRIX lightViewProj = XMMatrixMultiply(lightView, lightProj);
+
+	ShadowCasterVolume lightOnly, receivers;
+	lightOnly.Build(lightViewProj, lightDir);
+	receivers.Build(lightViewProj, lightDir, cameraCorners);
+
+	std::vector<UINT> visible(nObjects);
+	double fBegin = GetMilliseconds();
+	UINT nLightOnly = lightOnly.Cull(objects.data(), nObjects, visible.data());
+	double fLightOnly = GetMilliseconds() - fBegin;
+	fBegin = GetMilliseconds();
+	UINT nCasters = receivers.Cull(objects.data(), nObjects, visible.data());
+	double fReceivers = GetMilliseconds() - fBegin;
+
+	wprintf(L"%u objects\n", nObjects);
+	wprintf(L"  light volume only   %8.3f ms, %u casters\n", fLightOnly, nLightOnly);
+	wprintf(L"  with view receivers %8.3f ms, %u casters (%.1f%% of objects, %u receiver planes)\n", fReceivers, nCasters,
+			nCasters * 100.0 / max(nObjects, 1u), receivers.GetPlaneCount() - 5);
+
+	// 第 16 章以场景层次包围体查询投射体, 结果应与逐个测试相同
+	SceneBvh bvh;
+	bvh.Build(objects.data(), NULL, nObjects);
+	std::vector<UINT> bvhCasters;
+	fBegin = GetMilliseconds();
+	bvh.QueryPlanes(receivers.GetPlanes(), receivers.GetPlaneCount(), bvhCasters);
+	double fBvh = GetMilliseconds() - fBegin;
+	std::sort(bvhCasters.begin(), bvhCasters.end());
+	bool bSame = bvhCasters.size() == nCasters && std::equal(bvhCasters.begin(), bvhCasters.end(), visible.begin());
+	wprintf(L"  scene bvh query     %8.3f ms, %u casters%ls\n", fBvh, (UINT)bvhCasters.size(), bSame? L"": L"  MISMATCH");
+	if(!bSame)
+		return 1;
+
+	// 参照: 对被剔除物体的角点与中心沿光线方向步进, 落入视锥体则说明剔除有误
+	std::vector<bool> kept(nObjects);
+	for(UINT i = 0; i < nCasters; ++i)
+		kept[visible[i]] = 1;
+	UINT nMissed = 0;
+	for(UINT i = 0; i < nObjects; ++i)
+	{
+		if(kept[i])
+			continue;
+		XMFLOAT3 points[BoundingBox::CORNER_COUNT + 1];
+		objects[i].GetCorners(points);
+		points[BoundingBox::CORNER_COUNT] = objects[i].Center;
+		bool bCasts = 0;
+		for(UINT p = 0; p <= BoundingBox::CORNER_COUNT && !bCasts; ++p)
+		{
+			XMVECTOR point = XMLoadFloat3(&points[p]);
+			for(float t = 0.0f; t < 4.0f * fRadius && !bCasts; t += 1.0f)
+			{
+				XMVECTOR shadow = XMVectorSetW(XMVectorMultiplyAdd(lightDir, XMVectorReplicate(t), point), 1.0f);
+				bool bInside = 1;
+				for(UINT k = 0; k < 6; ++k)
+					bInside &= XMVectorGetX(XMVector4Dot(XMLoadFloat4(&pCameraPlanes[k]), shadow)) >= 0.0f;
+				bCasts = bInside;
+			}
+		}
+		nMissed += bCasts;
+	}
+	wprintf(L"  swept sample check: %u culled casters reach the view\n", nMissed);
+	return 0;
+}
+
+// 切片内的随机点: 角点的三线性插值, 位于切片的凸包内
+static XMVECTOR RandomSlicePoint(const Camera& camera, float fSplitNear, float fSplitFar)
+{
+	const XMFLOAT4X4& proj = camera.GetMatrices().matProj;
+	XMFLOAT3 corners[8];
+	ShadowCasterVolume::GetFrustumCorners(XMLoadFloat4x4(&camera.GetMatrices().matInvViewProj), corners,
+										  (fSplitNear * proj._33 + proj._43) / fSplitNear, (fSplitFar * proj._33 + proj._43) / fSplitFar);
+	float u = MathHelper::RandomF(0.0f, 1.0f), v = MathHelper::RandomF(0.0f, 1.0f), w = MathHelper::RandomF(0.0f, 1.0f);
+	XMVECTOR point = XMVectorZero();
+	for(UINT k = 0; k < 8; ++k)
+	{
+		float fWeight = ((k & 1)? u: 1.0f - u) * ((k & 2)? v: 1.0f - v) * ((k & 4)? w: 1.0f - w);
+		point = XMVectorMultiplyAdd(XMLoadFloat3(&corners[k]), XMVectorReplicate(fWeight), point);
+	}
+	return XMVectorSetW(point, 1.0f);
+}
+
+static int BenchCascadedShadow(int argc, wchar_t** argv)
+{
+	UINT nFrames = argc > 0? _wtoi(argv[0]): 600;
+
+	CascadedShadowDesc desc;
+	desc.nCascadeCount = 4;
+	desc.nResolution = 2048;
+	desc.fShadowDistance = 150.0f;
+	desc.nFirstCachedCascade = 2;
+	CascadedShadow csm;
+	csm.SetDesc(desc);
+
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 1.5f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	XMVECTOR lightDir = XMVectorSet(0.57735f, -0.57735f, 0.57735f, 0.0f);
+	csm.Update(camera, lightDir);
+
+	wprintf(L"%u cascades, %u px, shadow distance %g, cached from cascade %u\n", desc.nCascadeCount, desc.nResolution,
+			desc.fShadowDistance, desc.nFirstCachedCascade);
+	for(UINT i = 0; i < csm.GetCascadeCount(); ++i)
+	{
+		const ShadowCascade& cascade = csm.GetCascade(i);
+		wprintf(L"  cascade %u: [%7.2f, %7.2f], half width %7.2f, texel %.4f%ls\n", i, cascade.fSplitNear, cascade.fSplitFar,
+				cascade.fHalfWidth, cascade.fTexelSize, cascade.bCached? L", cached": L"");
+	}
+
+	// 每帧: 摄像机前进并转动, 检查切片内的点落在阴影图内; 未缓存的级联中固定点的纹素小数部分应保持不变
+	const UINT nSamples = 256;
+	UINT nOutside = 0, nRenders[MAX_NUM_CASCADE] = {0};
+	float fMaxShimmer = 0.0f;
+	XMFLOAT2 lastFraction[MAX_NUM_CASCADE];
+	double fUpdate = 0.0;
+	for(UINT f = 0; f < nFrames; ++f)
+	{
+		camera.Walk(0.05f);
+		camera.RotateY(0.002f);
+		camera.Pitch(0.0005f * sinf(f * 0.05f));
+		camera.UpdateViewMatrix();
+
+		double fBegin = GetMilliseconds();
+		csm.Update(camera, lightDir);
+		fUpdate += GetMilliseconds() - fBegin;
+
+		for(UINT i = 0; i < csm.GetCascadeCount(); ++i)
+		{
+			const ShadowCascade& cascade = csm.GetCascade(i);
+			nRenders[i] += cascade.bDirty;
+			XMMATRIX S = XMLoadFloat4x4(&cascade.matShadowTransform);
+			float fTexel = 1.0f / desc.nResolution;
+			for(UINT s = 0; s < nSamples; ++s)
+			{
+				XMFLOAT3 tex;
+				XMStoreFloat3(&tex, XMVector3TransformCoord(RandomSlicePoint(camera, cascade.fSplitNear, cascade.fSplitFar), S));
+				nOutside += tex.x < fTexel || tex.x > 1.0f - fTexel || tex.y < fTexel || tex.y > 1.0f - fTexel || tex.z < 0.0f || tex.z > 1.0f;
+			}
+
+			XMFLOAT3 origin;
+			XMStoreFloat3(&origin, XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), S));
+			XMFLOAT2 fraction(origin.x * desc.nResolution - floorf(origin.x * desc.nResolution),
+							  origin.y * desc.nResolution - floorf(origin.y * desc.nResolution));
+			if(f > 0 && !cascade.bCached)
+			{
+				float dx = fabsf(fraction.x - lastFraction[i].x), dy = fabsf(fraction.y - lastFraction[i].y);
+				fMaxShimmer = max(fMaxShimmer, max(min(dx, 1.0f - dx), min(dy, 1.0f - dy)));
+			}
+			lastFraction[i] = fraction;
+		}
+	}
+	wprintf(L"  %u frames walking and turning: update %.3f us/frame\n", nFrames, fUpdate * 1000.0 / nFrames);
+	wprintf(L"    slice samples outside their cascade: %u of %u\n", nOutside, nFrames * nSamples * csm.GetCascadeCount());
+	wprintf(L"    max sub-texel drift of a fixed point: %.5f texels\n", fMaxShimmer);
+	wprintf(L"    renders per cascade:");
+	for(UINT i = 0; i < csm.GetCascadeCount(); ++i)
+		wprintf(L" %u", nRenders[i]);
+	wprintf(L"\n");
+
+	csm.Update(camera, lightDir);
+	UINT nStill = csm.GetDirtyCount();
+	csm.InvalidateCache();
+	csm.Update(camera, lightDir);
+	UINT nInvalidated = csm.GetDirtyCount();
+	csm.Update(camera, XMVectorSet(0.6f, -0.57735f, 0.57735f, 0.0f));
+	UINT nLightMoved = csm.GetDirtyCount();
+	wprintf(L"    dirty cascades: still %u, static casters changed %u, light moved %u\n", nStill, nInvalidated, nLightMoved);
+
+	// 各级联的投射体剔除
+	std::vector<BoundingBox> objects(20000);
+	XMFLOAT3 eye = camera.GetPosition3f();
+	for(auto& object: objects)
+	{
+		object.Extents = XMFLOAT3(MathHelper::RandomF(0.5f, 4.0f), MathHelper::RandomF(0.5f, 8.0f), MathHelper::RandomF(0.5f, 4.0f));
+		object.Center = XMFLOAT3(eye.x + MathHelper::RandomF(-300.0f, 300.0f), object.Extents.y, eye.z + MathHelper::RandomF(-300.0f, 300.0f));
+	}
+	std::vector<UINT> casters(objects.size());
+	wprintf(L"    casters of %zu objects per cascade:", objects.size());
+	for(UINT i = 0; i < csm.GetCascadeCount(); ++i)
+		wprintf(L" %u", csm.GetCascade(i).Casters.Cull(objects.data(), (UINT)objects.size(), casters.data()));
+	wprintf(L"\n");
+	return 0;
+}
+
+// 逐对暴力测试: 光源球与簇包围盒, 聚光灯锥体与簇外接球
+static bool LightTouchesCluster(const BoundingBox& cluster, const Light::Light& light, bool bSpot, float fSpotCutoff)
+{
+	if(!cluster.Intersects(BoundingSphere(light.vec3Position, light.nFalloffEnd)))
+		return 0;
+	if(!bSpot)
+		return 1;
+
+	XMVECTOR center = XMLoadFloat3(&cluster.Center);
+	float fRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&cluster.Extents)));
+	XMVECTOR v = XMVectorSubtract(center, XMLoadFloat3(&light.vec3Position));
+	float fAxial = XMVectorGetX(XMVector3Dot(v, XMLoadFloat3(&light.vec3Direction)));
+	float fPerp = sqrtf(max(XMVectorGetX(XMVector3LengthSq(v)) - fAxial * fAxial, 0.0f));
+	float fCos = powf(fSpotCutoff, 1.0f / light.nSpotPower), fSin = sqrtf(1.0f - fCos * fCos);
+	return fCos * fPerp - fAxial * fSin <= fRadius && fAxial <= fRadius + light.nFalloffEnd && fAxial >= -fRadius;
+}
+
+static int BenchLightClustering(int argc, wchar_t** argv)
+{
+	UINT nLights = argc > 0? _wtoi(argv[0]): 4096;
+	UINT nMaxThreads = argc > 1? _wtoi(argv[1]): std::thread::hardware_concurrency();
+	nMaxThreads = max(nMaxThreads, 1u);
+
+	// 一半点光源, 一半聚光灯, 散布在摄像机周围 400 x 400 的地面上方
+	UINT nPointCount = nLights / 2, nSpotCount = nLights - nPointCount;
+	std::vector<Light::Light> lights(nLights);
+	for(UINT i = 0; i < nLights; ++i)
+	{
+		Light::Light& light = lights[i];
+		light.vec3Strength = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		light.vec3Position = XMFLOAT3(MathHelper::RandomF(-200.0f, 200.0f), MathHelper::RandomF(0.5f, 20.0f), MathHelper::RandomF(-200.0f, 200.0f));
+		light.nFalloffStart = 1.0f;
+		light.nFalloffEnd = MathHelper::RandomF(2.0f, 15.0f);
+		XMStoreFloat3(&light.vec3Direction, XMVector3Normalize(XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, -0.2f),
+																		   MathHelper::RandomF(-1.0f, 1.0f), 0.0f)));
+		light.nSpotPower = i < nPointCount? 0.0f: MathHelper::RandomF(1.0f, 64.0f);
+	}
+
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(10.0f, 1.0f, 40.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+	const CameraMatrices& matrices = camera.GetMatrices();
+
+	LightClusterBuilder builder;
+	LightClusterDesc desc = builder.GetDesc();
+	wprintf(L"%u point + %u spot lights, %u x %u x %u clusters\n", nPointCount, nSpotCount, desc.nTilesX, desc.nTilesY, desc.nSlices);
+
+	std::vector<UINT> reference;
+	for(UINT nThreads = 1; ; nThreads = min(nThreads * 2, nMaxThreads))
+	{
+		BaseHelper::Thread::ThreadPool pool(nThreads - 1);
+		const UINT nFrames = 50;
+		double fBegin = GetMilliseconds();
+		for(UINT f = 0; f < nFrames; ++f)
+			builder.Build(matrices.matView, matrices.matProj, lights.data(), nPointCount, nSpotCount, &pool);
+		double fBuild = (GetMilliseconds() - fBegin) / nFrames;
+
+		std::vector<UINT> result(builder.GetLightIndices(), builder.GetLightIndices() + builder.GetLightIndexCount());
+		if(reference.empty())
+			reference = result;
+		wprintf(L"  %2u threads: build %8.3f ms/frame%ls\n", nThreads, fBuild, result == reference? L"": L"  MISMATCH");
+		if(nThreads == nMaxThreads)
+			break;
+	}
+
+	UINT nClusters = builder.GetClusterCount(), nOccupied = 0;
+	for(UINT c = 0; c < nClusters; ++c)
+		nOccupied += builder.GetClusters()[c].nCount > 0;
+	wprintf(L"    %u indices, %u of %u clusters lit, %.2f lights per lit cluster, at most %u\n", builder.GetLightIndexCount(),
+			nOccupied, nClusters, (double)builder.GetLightIndexCount() / max(nOccupied, 1u), builder.GetMaxClusterLightCount());
+
+	// 观察空间中的光源, 供暴力测试使用
+	XMMATRIX view = XMLoadFloat4x4(&matrices.matView);
+	std::vector<Light::Light> viewLights = lights;
+	for(Light::Light& light : viewLights)
+	{
+		XMStoreFloat3(&light.vec3Position, XMVector3TransformCoord(XMLoadFloat3(&light.vec3Position), view));
+		XMStoreFloat3(&light.vec3Direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.vec3Direction), view)));
+	}
+
+	// 逐对比较: 分簇结果应与暴力测试一致
+	UINT nMissing = 0, nExtra = 0;
+	double fBegin = GetMilliseconds();
+	std::vector<UINT> expected;
+	for(UINT c = 0; c < nClusters; ++c)
+	{
+		BoundingBox bounds = builder.GetClusterBounds(c);
+		expected.clear();
+		for(UINT i = 0; i < nLights; ++i)
+			if(LightTouchesCluster(bounds, viewLights[i], i >= nPointCount, desc.fSpotCutoff))
+				expected.push_back(i);
+
+		const LightCluster& cluster = builder.GetClusters()[c];
+		const UINT* pBegin = builder.GetLightIndices() + cluster.nOffset;
+		const UINT* pEnd = pBegin + cluster.nCount;
+		for(UINT i : expected)
+			nMissing += !std::binary_search(pBegin, pEnd, i);
+		for(const UINT* p = pBegin; p < pEnd; ++p)
+			nExtra += !std::binary_search(expected.begin(), expected.end(), *p);
+	}
+	wprintf(L"    brute force (%.0f ms): %u missing, %u extra\n", GetMilliseconds() - fBegin, nMissing, nExtra);
+
+	// 逐点比较: 受光照的点所在的簇必须包含该光源
+	const UINT nSamples = 20000;
+	UINT nLitPairs = 0, nUnassigned = 0, nTested = 0;
+	XMMATRIX invProj = XMLoadFloat4x4(&matrices.matInvProj);
+	while(nTested < nSamples)
+	{
+		float fDepth = MathHelper::RandomF(0.5f, 220.0f);
+		XMVECTOR ndc = XMVectorSet(MathHelper::RandomF(-1.0f, 1.0f), MathHelper::RandomF(-1.0f, 1.0f), 1.0f, 1.0f);
+		XMVECTOR dir = XMVector3TransformCoord(ndc, invProj);
+		XMVECTOR pos = XMVectorScale(dir, fDepth / XMVectorGetZ(dir));
+		UINT nCluster = builder.GetClusterIndex(pos);
+		if(nCluster == UINT_MAX)
+			continue;
+		++nTested;
+
+		const LightCluster& cluster = builder.GetClusters()[nCluster];
+		const UINT* pBegin = builder.GetLightIndices() + cluster.nOffset;
+		for(UINT i = 0; i < nLights; ++i)
+		{
+			const Light::Light& light = viewLights[i];
+			XMVECTOR toPoint = XMVectorSubtract(pos, XMLoadFloat3(&light.vec3Position));
+			float d = XMVectorGetX(XMVector3Length(toPoint));
+			if(d > light.nFalloffEnd)
+				continue;
+			if(i >= nPointCount)
+			{
+				float fDot = XMVectorGetX(XMVector3Dot(toPoint, XMLoadFloat3(&light.vec3Direction))) / max(d, 1e-6f);
+				if(powf(max(fDot, 0.0f), light.nSpotPower) < desc.fSpotCutoff)
+					continue;
+			}
+			++nLitPairs;
+			nUnassigned += !std::binary_search(pBegin, pBegin + cluster.nCount, i);
+		}
+	}
+	wprintf(L"    %u sample points, %u lit by a light, %u lights missing from the point's cluster\n", nTested, nLitPairs, nUnassigned);
+	return 0;
+}
+
+static int BenchSimplify(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszModel = argc > 0? argv[0]: L"../Models/skull.txt";
+
+	TextModelLoader::TextModel model;
+	if(!TextModelLoader::LoadTextModel(lpszModel, model))
+	{
+		wprintf(L"cannot load %ls\n", lpszModel);
+		return 1;
+	}
+
+	Geometry::SimplifyVertexLayout layout = { sizeof(TextModelLoader::TextModelVertex), offsetof(TextModelLoader::TextModelVertex, vec3Position),
+											  offsetof(TextModelLoader::TextModelVertex, vec3Normal), -1 };
+	Geometry::LodChainDesc desc;
+
+	// 同样的输入构建两次, 索引应逐字节相同
+	std::vector<UINT> indices[2];
+	Resource::SubmeshGeometry submeshes[2];
+	std::vector<Geometry::MeshLodReport> reports[2];
+	double fBuild = 0.0;
+	for(UINT k = 0; k < 2; ++k)
+	{
+		model.GetIndices(indices[k]);
+		submeshes[k].nBaseVertexLocation = 0;
+		submeshes[k].nStartIndexLocation = 0;
+		submeshes[k].nIndexCount = (UINT)indices[k].size();
+		submeshes[k].Bounds = model.Bounds;
+
+		double fBegin = GetMilliseconds();
+		Geometry::MeshSimplifier::AppendLods(model.Vertices.data(), (UINT)model.Vertices.size(), layout, indices[k], submeshes[k],
+											 desc, "Skull", &reports[k]);
+		fBuild += GetMilliseconds() - fBegin;
+	}
+
+	wprintf(L"%ls: %zu vertices, %u triangles, %.3f ms per chain\n", lpszModel, model.Vertices.size(),
+			submeshes[0].nIndexCount / 3, fBuild / 2);
+	wprintf(L"  level  triangles     error\n");
+	for(const Geometry::MeshLodReport& report : reports[0])
+		wprintf(L"  %5u  %9u  %8.5f\n", report.nLevel, report.nTriangleCount, report.fError);
+
+	bool bOk = 1;
+	if(indices[0].size() != indices[1].size() || memcmp(indices[0].data(), indices[1].data(), indices[0].size() * sizeof(UINT)))
+	{
+		wprintf(L"FAILED: two builds produced different index buffers\n");
+		bOk = 0;
+	}
+	if(reports[0].size() < 2)
+	{
+		wprintf(L"FAILED: no LOD was generated\n");
+		bOk = 0;
+	}
+	for(size_t i = 1; i < reports[0].size(); ++i)
+	{
+		if(reports[0][i].nTriangleCount >= reports[0][i - 1].nTriangleCount)
+		{
+			wprintf(L"FAILED: LOD%u does not have fewer triangles than LOD%u\n", reports[0][i].nLevel, reports[0][i - 1].nLevel);
+			bOk = 0;
+		}
+		if(reports[0][i].fError < reports[0][i - 1].fError)
+		{
+			wprintf(L"FAILED: LOD%u has a smaller error than LOD%u\n", reports[0][i].nLevel, reports[0][i - 1].nLevel);
+			bOk = 0;
+		}
+	}
+	wprintf(L"%ls\n", bOk? L"deterministic, triangles decrease, errors do not decrease": L"simplify test FAILED");
+	return bOk? 0: 1;
+}
+
+// 读出缓存条目, 修改后原样写回
+template<typename ModifyFunc>
+static bool RewriteFile(PATH lpszFileName, ModifyFunc modify)
+{
+	FILE_HANDLE hFile = CreateFileW(lpszFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return 0;
+	void* pBuffer = NULL;
+	DWORD dwByteSize = 0;
+	bool bResult = BaseHelper::File::Read(hFile, &pBuffer, &dwByteSize);
+	CloseHandle(hFile);
+	if(!bResult)
+		return 0;
+
+	std::vector<BYTE> data((BYTE*)pBuffer, (BYTE*)pBuffer + dwByteSize);
+	BASE_MFREE(pBuffer);
+	modify(data);
+
+	hFile = BaseHelper::File::OpenFile(lpszFileName, BaseHelper::File::FILE_METHOD_CREATE_ALWAYS);
+	if(!hFile)
+		return 0;
+	DWORD dwWritten = 0;
+	bResult = BaseHelper::File::Write(hFile, data.data(), (DWORD)data.size(), &dwWritten) && dwWritten == data.size();
+	CloseHandle(hFile);
+	return bResult;
+}
+
+static int BenchHash(int argc, wchar_t** argv)
+{
+	LPCWSTR lpszCache = argc > 0? argv[0]: L"./Cache";
+	UINT nFailed = 0;
+
+	// xxHash64 参考实现的结果
+	struct { const char* lpszInput; UINT64 nSeed; UINT64 nDigest; } xxhVectors[] = {
+		{ "", 0, 0xEF46DB3751D8E999ULL },
+		{ "abc", 0, 0x44BC2CF5AD770999ULL },
+		{ "Nobody inspects the spammish repetition", 0, 0xFBCEA83C8A378BF1ULL },
+		{ "xxhash", 20141025, 0xB559B98D844E0635ULL },
+		{ "Nobody inspects the spammish repetition", 20141025, 0xCE06936136852706ULL },
+	};
+	for(const auto& v : xxhVectors)
+	{
+		UINT64 nDigest = xxhash64(v.lpszInput, strlen(v.lpszInput), v.nSeed);
+		bool bOk = nDigest == v.nDigest;
+		nFailed += !bOk;
+		wprintf(L"  xxh64(\"%hs\", %llu) = %016llx %ls\n", v.lpszInput, (unsigned long long)v.nSeed, (unsigned long long)nDigest, bOk? L"ok": L"FAILED");
+	}
+
+	// RFC 1321 附录 A.5
+	struct { const char* lpszInput; const char* lpszDigest; } md5Vectors[] = {
+		{ "", "d41d8cd98f00b204e9800998ecf8427e" },
+		{ "a", "0cc175b9c0f1b6a831c399e269772661" },
+		{ "abc", "900150983cd24fb0d6963f7d28e17f72" },
+		{ "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+		{ "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+		{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+		{ "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+	};
+	for(const auto& v : md5Vectors)
+	{
+		C_HASH_MD5_16 digest;
+		md5(v.lpszInput, strlen(v.lpszInput), &digest);
+		char hex[33];
+		for(UINT i = 0; i < 16; ++i)
+			sprintf_s(hex + 2 * i, 3, "%02x", ((const BYTE*)&digest)[i]);
+		bool bOk = !strcmp(hex, v.lpszDigest);
+		nFailed += !bOk;
+		wprintf(L"  md5(\"%.16hs%ls\") = %hs %ls\n", v.lpszInput, strlen(v.lpszInput) > 16? L"...": L"", hex, bOk? L"ok": L"FAILED");
+	}
+
+	// 流式计算: 在 0..64 的每个位置分段, 结果应与一次性计算相同
+	BYTE message[200];
+	for(UINT i = 0; i < sizeof(message); ++i)
+		message[i] = (BYTE)(i * 131 + 7);
+	UINT nStreamFailed = 0;
+	for(UINT64 nSeed : { 0ULL, 20141025ULL })
+	{
+		UINT64 nExpected = xxhash64(message, sizeof(message), nSeed);
+		for(UINT nSplit = 0; nSplit <= 64; ++nSplit)
+		{
+			C_HASH_XXH64_STATE state;
+			xxhash64_reset(&state, nSeed);
+			xxhash64_update(&state, message, nSplit);
+			xxhash64_update(&state, message + nSplit, sizeof(message) - nSplit);
+			nStreamFailed += xxhash64_digest(&state) != nExpected;
+		}
+
+		C_HASH_XXH64_STATE state;
+		xxhash64_reset(&state, nSeed);
+		for(UINT i = 0; i < sizeof(message); ++i)
+			xxhash64_update(&state, message + i, 1);
+		nStreamFailed += xxhash64_digest(&state) != nExpected;
+	}
+	nFailed += nStreamFailed;
+	wprintf(L"  streaming vs one-shot, splits 0..64 and byte by byte: %ls\n", nStreamFailed? L"FAILED": L"ok");
+
+	// 缓存: 往返, 截断与校验值损坏都应视为未命中
+	BaseHelper::AssetCache cache(lpszCache);
+	BaseHelper::AssetKey key = BaseHelper::AssetKeyBuilder("D3DAppTest.hash", 1).Append(message, sizeof(message)).GetKey();
+	std::wstring path = std::wstring(lpszCache) + L"/" + key.ToString() + L".bin";
+	std::vector<BYTE> loaded;
+
+	bool bRoundTrip = cache.Store(key, message, sizeof(message)) && cache.Load(key, loaded) &&
+					  loaded.size() == sizeof(message) && !memcmp(loaded.data(), message, sizeof(message));
+	bool bTruncated = RewriteFile(path.c_str(), [](std::vector<BYTE>& data){ data.pop_back(); }) && !cache.Load(key, loaded);
+	// 校验值是文件头的最后一个字段
+	bool bChecksum = cache.Store(key, message, sizeof(message)) &&
+					 RewriteFile(path.c_str(), [](std::vector<BYTE>& data){ data[data.size() - sizeof(message) - 1] ^= 0x01; }) &&
+					 !cache.Load(key, loaded);
+	bool bContent = cache.Store(key, message, sizeof(message)) &&
+					RewriteFile(path.c_str(), [](std::vector<BYTE>& data){ data.back() ^= 0x80; }) && !cache.Load(key, loaded);
+	bool bRestored = cache.Store(key, message, sizeof(message)) && cache.Load(key, loaded);
+	DeleteFileW(path.c_str());
+
+	nFailed += !bRoundTrip + !bTruncated + !bChecksum + !bContent + !bRestored;
+	wprintf(L"  cache round trip %ls, truncated entry %ls, corrupted checksum %ls, corrupted content %ls, rewrite %ls\n",
+			bRoundTrip? L"ok": L"FAILED", bTruncated? L"misses": L"FAILED", bChecksum? L"misses": L"FAILED",
+			bContent? L"misses": L"FAILED", bRestored? L"ok": L"FAILED");
+	wprintf(L"%ls\n", nFailed? L"hash test FAILED": L"all hash checks passed");
+	return nFailed? 1: 0;
+}
+
+int wmain(int argc, wchar_t** argv)
+{
+	if(argc > 1 && !wcscmp(argv[1], L"textmodel"))
+		return BenchTextModel(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"animation"))
+		return BenchAnimation(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"compression"))
+		return BenchCompression(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"posecache"))
+		return BenchPoseCache(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"palette"))
+		return BenchPalette(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"partition"))
+		return BenchPartition(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"skinning"))
+		return BenchSkinning(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"animlod"))
+		return BenchAnimationLod(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"camera"))
+		return BenchCamera(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"cull"))
+		return BenchFrustumCulling(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"bvh"))
+		return BenchSceneBvh(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"tribvh"))
+		return BenchTriangleBvh(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"rayquery"))
+		return BenchRayQuery(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"ao"))
+		return BenchAmbientOcclusion(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"occlusion"))
+		return BenchOcclusion(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"shadowcull"))
+		return BenchShadowCulling(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"csm"))
+		return BenchCascadedShadow(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"lights"))
+		return BenchLightClustering(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"simplify"))
+		return BenchSimplify(argc - 2, argv + 2);
+	if(argc > 1 && !wcscmp(argv[1], L"hash"))
+		return BenchHash(argc - 2, argv + 2);
+
+	wprintf(L"usage: D3DAppTest textmodel [model] [cache]\n");
+	wprintf(L"       D3DAppTest animation [m3d] [instances] [seconds]\n");
+	wprintf(L"       D3DAppTest compression [m3d] [tolerance]\n");
+	wprintf(L"       D3DAppTest posecache [m3d] [instances] [quantum ms]\n");
+	wprintf(L"       D3DAppTest palette [m3d] [instances, 0 = 1k and 10k] [max threads]\n");
+	wprintf(L"       D3DAppTest partition [m3d] [palette size]\n");
+	wprintf(L"       D3DAppTest skinning [m3d] [max threads]\n");
+	wprintf(L"       D3DAppTest animlod [m3d] [instances]\n");
+	wprintf(L"       D3DAppTest camera [cameras]\n");
+	wprintf(L"       D3DAppTest cull [instances...]\n");
+	wprintf(L"       D3DAppTest bvh [objects...]\n");
+	wprintf(L"       D3DAppTest tribvh [model] [rays]\n");
+	wprintf(L"       D3DAppTest rayquery [instances] [image side] [max threads]\n");
+	wprintf(L"       D3DAppTest ao [model] [rays] [max threads] [cache]\n");
+	wprintf(L"       D3DAppTest occlusion [objects] [max threads]\n");
+	wprintf(L"       D3DAppTest shadowcull [objects]\n");
+	wprintf(L"       D3DAppTest csm [frames]\n");
+	wprintf(L"       D3DAppTest lights [count] [max threads]\n");
+	wprintf(L"       D3DAppTest simplify [model]\n");
+	wprintf(L"       D3DAppTest hash [cache]\n");
+	return 1;
+}